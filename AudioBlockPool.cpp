@@ -0,0 +1,218 @@
+#include "AudioBlockPool.h"
+
+namespace MSHRTFSpatializer
+{
+	void AudioBlock::Release()
+	{
+		if (InterlockedDecrement(&m_RefCount) == 0)
+		{
+			if (p_Right != nullptr)
+			{
+				p_Right->Release();
+				p_Right = nullptr;
+			}
+			p_Pool->Recycle(this);
+		}
+	}
+
+	AudioBlockPool::AudioBlockPool(UINT32 BlockCount, AudioBlock* p_Blocks, volatile LONG* p_NextFree) :
+		m_BlockCount(BlockCount),
+		p_Blocks(p_Blocks),
+		p_NextFree(p_NextFree),
+		m_FreeTop(0),
+		m_Untouched(0),
+		m_Exhausted(0)
+	{
+	}
+
+	AudioBlockPool* AudioBlockPool::Create(UINT32 BlockCount)
+	{
+		// Reserved and committed up front, but the pages are only backed once a block on them is first used
+		AudioBlock* p_Blocks = (AudioBlock*)VirtualAlloc(nullptr, BlockCount * sizeof(AudioBlock), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (p_Blocks == nullptr)
+		{
+			return nullptr;
+		}
+
+		volatile LONG* p_NextFree = new LONG[BlockCount];
+		return new AudioBlockPool(BlockCount, p_Blocks, p_NextFree);
+	}
+
+	AudioBlockPool::~AudioBlockPool()
+	{
+		VirtualFree(p_Blocks, 0, MEM_RELEASE);
+		delete[] p_NextFree;
+	}
+
+	AudioBlock* AudioBlockPool::Acquire()
+	{
+		AudioBlock* p_Block = nullptr;
+
+		for (;;)
+		{
+			LONG64 Top = InterlockedCompareExchange64(&m_FreeTop, 0, 0);
+			LONG Index = (LONG)(Top & 0xffffffff) - 1;
+			if (Index < 0)
+			{
+				break;
+			}
+
+			LONG64 Popped = (Top & ~(LONG64)0xffffffff) | (LONG64)(ULONG)p_NextFree[Index];
+			if (InterlockedCompareExchange64(&m_FreeTop, Popped, Top) == Top)
+			{
+				p_Block = &p_Blocks[Index];
+				break;
+			}
+		}
+
+		// Only once no freed block is left is one touched for the first time
+		if (p_Block == nullptr)
+		{
+			LONG Index = InterlockedIncrement(&m_Untouched) - 1;
+			if ((UINT32)Index >= m_BlockCount)
+			{
+				InterlockedDecrement(&m_Untouched);
+				InterlockedIncrement(&m_Exhausted);
+				return nullptr;
+			}
+
+			p_Block = &p_Blocks[Index];
+			p_Block->p_Pool = this;
+		}
+
+		p_Block->m_RefCount = 1;
+		p_Block->p_Right = nullptr;
+		return p_Block;
+	}
+
+	void AudioBlockPool::Recycle(AudioBlock* p_Block)
+	{
+		LONG Index = (LONG)(p_Block - p_Blocks);
+
+		for (;;)
+		{
+			LONG64 Top = InterlockedCompareExchange64(&m_FreeTop, 0, 0);
+			p_NextFree[Index] = (LONG)(Top & 0xffffffff);
+
+			LONG64 Pushed = (LONG64)((((UINT64)Top >> 32) + 1) << 32) | (LONG64)(Index + 1);
+			if (InterlockedCompareExchange64(&m_FreeTop, Pushed, Top) == Top)
+			{
+				return;
+			}
+		}
+	}
+
+	BOOL AudioBlockChain::Queue()
+	{
+		BOOL Queued = m_Blocks.Write(&p_Open, 1) == 1;
+		if (!Queued)
+		{
+			p_Open->Release();
+		}
+
+		p_Open = nullptr;
+		return Queued;
+	}
+
+	BOOL AudioBlockChain::Write(AudioBlockPool* p_Pool, const float* p_Src, UINT32 Count, const float* p_SrcRight)
+	{
+		BOOL Complete = TRUE;
+
+		while (Count > 0)
+		{
+			if (p_Open == nullptr)
+			{
+				p_Open = p_Pool->Acquire();
+				if (p_Open == nullptr)
+				{
+					m_WritePos += Count;
+					return FALSE;
+				}
+
+				p_Open->m_StartPos = m_WritePos;
+				m_OpenCount = 0;
+
+				if (p_SrcRight != nullptr)
+				{
+					p_Open->p_Right = p_Pool->Acquire();
+				}
+			}
+
+			UINT32 Span = AUDIO_BLOCK_FRAMES - m_OpenCount;
+			if (Span > Count)
+			{
+				Span = Count;
+			}
+
+			memcpy(p_Open->m_Samples + m_OpenCount, p_Src, Span * sizeof(float));
+			if (p_Open->p_Right != nullptr)
+			{
+				memcpy(p_Open->p_Right->m_Samples + m_OpenCount, (p_SrcRight != nullptr) ? p_SrcRight : p_Src, Span * sizeof(float));
+			}
+			if (p_SrcRight != nullptr)
+			{
+				p_SrcRight += Span;
+			}
+
+			m_OpenCount += Span;
+			m_WritePos += Span;
+			p_Src += Span;
+			Count -= Span;
+
+			if (m_OpenCount == AUDIO_BLOCK_FRAMES && !Queue())
+			{
+				Complete = FALSE;
+			}
+		}
+
+		return Complete;
+	}
+
+	BOOL AudioBlockChain::Flush()
+	{
+		if (p_Open == nullptr)
+		{
+			return TRUE;
+		}
+
+		// The padding doesn't move the write position: the next block starts where the audio left off
+		memset(p_Open->m_Samples + m_OpenCount, 0, (AUDIO_BLOCK_FRAMES - m_OpenCount) * sizeof(float));
+		if (p_Open->p_Right != nullptr)
+		{
+			memset(p_Open->p_Right->m_Samples + m_OpenCount, 0, (AUDIO_BLOCK_FRAMES - m_OpenCount) * sizeof(float));
+		}
+		return Queue();
+	}
+
+	AudioBlock* AudioBlockChain::Peek()
+	{
+		AudioBlock* p_Block;
+		return m_Blocks.Peek(p_Block) ? p_Block : nullptr;
+	}
+
+	AudioBlock* AudioBlockChain::Take()
+	{
+		AudioBlock* p_Block;
+		return m_Blocks.Read(p_Block) ? p_Block : nullptr;
+	}
+
+	void AudioBlockChain::DropOldest(int Keep)
+	{
+		while (m_Blocks.GetNumBuffered() > Keep)
+		{
+			Take()->Release();
+		}
+	}
+
+	void AudioBlockChain::Clear()
+	{
+		DropOldest(0);
+		m_Blocks.Clear();
+
+		if (p_Open != nullptr)
+		{
+			p_Open->Release();
+			p_Open = nullptr;
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <windows.h>
+#include "AudioPluginUtil.h"
+
+// One pump period (10 ms at 48 kHz)
+#define AUDIO_BLOCK_FRAMES 480
+
+// Blocks a source can have queued, which is about as much audio (80 ms) as its ring used to hold
+#define AUDIO_BLOCK_CHAIN_LENGTH 8
+
+namespace MSHRTFSpatializer
+{
+	class AudioBlockPool;
+
+	// A period of mono audio from the shared pool. Whoever holds a reference may read it; the last Release hands it
+	// back to the pool.
+	struct AudioBlock
+	{
+		AudioBlockPool* p_Pool;
+		volatile LONG m_RefCount;
+
+		// Write position (see AudioBlockChain::GetWritePos) of the first sample
+		UINT32 m_StartPos;
+
+		// The right channel of a stereo period, in a second block from the same pool that goes back along with this one,
+		// or nullptr
+		AudioBlock* p_Right;
+
+		float m_Samples[AUDIO_BLOCK_FRAMES];
+
+		void AddRef()
+		{
+			InterlockedIncrement(&m_RefCount);
+		}
+
+		void Release();
+	};
+
+	// Fixed set of blocks shared by every source, so that the audio in flight takes as much memory as there is of it
+	// rather than a ring per source. Acquire and Release never lock or allocate and may be called from any thread. The
+	// blocks are only touched once first handed out, and freed ones are handed out again first, so the memory in use
+	// stays at the most audio that has been in flight at once.
+	class AudioBlockPool
+	{
+	public:
+		// Returns nullptr if the memory can't be reserved
+		static AudioBlockPool* Create(UINT32 BlockCount);
+		~AudioBlockPool();
+
+		// A block holding one reference, or nullptr if they are all in use
+		AudioBlock* Acquire();
+
+		UINT32 GetBlockCount() const { return m_BlockCount; }
+
+		// The most blocks that have been in use at once
+		UINT32 GetPeakBlocksInUse() const { return (UINT32)m_Untouched; }
+
+		// How many times Acquire found every block in use
+		UINT32 GetExhaustedCount() const { return (UINT32)m_Exhausted; }
+
+	private:
+		friend struct AudioBlock;
+
+		AudioBlockPool(UINT32 BlockCount, AudioBlock* p_Blocks, volatile LONG* p_NextFree);
+
+		void Recycle(AudioBlock* p_Block);
+
+		UINT32 m_BlockCount;
+		AudioBlock* p_Blocks;
+
+		// Freed blocks are a stack linked through p_NextFree by index plus one, so 0 ends it. The top is in the low half
+		// of m_FreeTop, and the high half counts pushes so that a thread that read the top before it was popped and
+		// pushed again can't swap in a stale link.
+		volatile LONG* p_NextFree;
+		volatile LONG64 m_FreeTop;
+
+		// Blocks from here on have never been handed out
+		volatile LONG m_Untouched;
+
+		volatile LONG m_Exhausted;
+	};
+
+	// The audio of one source on its way from ProcessCallback to the pump: a queue of full blocks, and the block being
+	// filled. Like SPSCRingBuffer it has exactly one producer thread and one consumer thread.
+	class AudioBlockChain
+	{
+	public:
+		// Producer side
+
+		// Free-running count of the samples written, including any that were dropped
+		UINT32 GetWritePos() const { return m_WritePos; }
+
+		// Appends Count samples, queueing each block as it fills. Returns FALSE if some were dropped because the queue was
+		// full or the pool ran dry. With p_SrcRight, each block also carries the right channel in its p_Right block; if
+		// the pool can't spare one, the block stays mono.
+		BOOL Write(AudioBlockPool* p_Pool, const float* p_Src, UINT32 Count, const float* p_SrcRight = nullptr);
+
+		// Queues the block being filled, padded with silence, so that the consumer gets the last of the audio without
+		// waiting for a full block
+		BOOL Flush();
+
+		// Consumer side
+
+		// Full blocks queued
+		int GetNumBuffered() const { return m_Blocks.GetNumBuffered(); }
+
+		// The oldest queued block, which stays queued, or nullptr
+		AudioBlock* Peek();
+
+		// Takes the oldest queued block off the queue, along with its reference, or returns nullptr
+		AudioBlock* Take();
+
+		// Releases all but the newest Keep queued blocks
+		void DropOldest(int Keep);
+
+		// Releases every block, the one being filled included. Only safe while neither side is using the chain.
+		void Clear();
+
+	private:
+		BOOL Queue();
+
+		SPSCRingBuffer<AUDIO_BLOCK_CHAIN_LENGTH, AudioBlock*, SPSCRingBufferPolicy_AllOrNothing> m_Blocks;
+
+		// Producer only
+		AudioBlock* p_Open = nullptr;
+		UINT32 m_OpenCount = 0;
+		UINT32 m_WritePos = 0;
+	};
+}
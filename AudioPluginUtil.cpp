@@ -1,9 +1,43 @@
 #include "AudioPluginUtil.h"
 
+#include <float.h>
+
+#if UNITY_AUDIO_SSE
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       define UNITY_AUDIO_TARGET_AVX2
+#   else
+#       include <cpuid.h>
+#       define UNITY_AUDIO_TARGET_AVX2 __attribute__((target("avx2")))
+#   endif
+#elif UNITY_AUDIO_NEON
+#   if !defined(_MSC_VER)
+#       include <stdint.h>
+#       if defined(__linux__) && defined(__arm__)
+#           include <sys/auxv.h>
+#           include <asm/hwcap.h>
+#       endif
+#   endif
+#endif
+
+// What AudioMutex parks its threads with
+#if UNITY_WIN
+#   pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   include <linux/futex.h>
+#elif !UNITY_SPU
+#   include <sched.h>
+#endif
+
 char* strnew(const char* src)
 {
-    char* newstr = new char[strlen(src) + 1];
-    strcpy_s(newstr, strlen(src) + 1, src);
+    // Not strcpy_s: outside Windows that is defined to strcpy, which takes no length
+    size_t length = strlen(src) + 1;
+    char* newstr = new char[length];
+    memcpy(newstr, src, length);
     return newstr;
 }
 
@@ -53,9 +87,80 @@ void FFT::Forward(UnityComplexNumber* data, int numsamples)
 
 void FFT::Backward(UnityComplexNumber* data, int numsamples)
 {
+    // The inverse is the conjugate of the forward transform of the conjugate. Transforming with the opposite sign as
+    // well would give the forward transform back, scaled and reversed in time.
+    for (int n = 0; n < numsamples; n++)
+        data[n].im = -data[n].im;
+    FFTProcess(data, numsamples, false);
+    const float scale = 1.0f / (float)numsamples;
+    for (int n = 0; n < numsamples; n++)
+    {
+        data[n].re =  scale * data[n].re;
+        data[n].im = -scale * data[n].im;
+    }
+}
+
+FFTPlan::FFTPlan(int numsamples)
+    : numsamples(numsamples)
+{
+    bitreverse = new int[numsamples];
+    int j = 0;
+    for (int i = 0; i < numsamples; i++)
+    {
+        bitreverse[i] = j;
+        int m = numsamples >> 1;
+        while (m > 0 && (j & m) != 0)
+        {
+            j ^= m;
+            m >>= 1;
+        }
+        j |= m;
+    }
+    twiddles = new UnityComplexNumber[numsamples];
+    for (int j = 1; j < numsamples; j <<= 1)
+    {
+        for (int m = 0; m < j; m++)
+        {
+            const float w = -kPI * (float)m / (float)j;
+            twiddles[j - 1 + m].Set(cosf(w), sinf(w));
+        }
+    }
+}
+
+FFTPlan::~FFTPlan()
+{
+    delete[] bitreverse;
+    delete[] twiddles;
+}
+
+void FFTPlan::Forward(UnityComplexNumber* data) const
+{
+    for (int i = 0; i < numsamples; i++)
+    {
+        const int j = bitreverse[i];
+        if (i < j)
+            UnitySwap(data[i], data[j]);
+    }
+
+    // The first stage has no twiddles, and its spans are too short for the kernel
+    for (int i = 0; i + 1 < numsamples; i += 2)
+    {
+        UnityComplexNumber t = data[i + 1];
+        UnityComplexNumber::Sub(data[i], t, data[i + 1]);
+        UnityComplexNumber::Add(data[i], t, data[i]);
+    }
+    const UnityAudioKernels& kernels = GetAudioKernels();
+    for (int j = 2; j < numsamples; j <<= 1)
+        for (int i = 0; i < numsamples; i += j << 1)
+            kernels.FFTButterflies(data + i, data + i + j, twiddles + j - 1, j);
+}
+
+void FFTPlan::Backward(UnityComplexNumber* data) const
+{
+    // Conjugate trick as in FFT::Backward
     for (int n = 0; n < numsamples; n++)
         data[n].im = -data[n].im;
-    FFTProcess(data, numsamples, true);
+    Forward(data);
     const float scale = 1.0f / (float)numsamples;
     for (int n = 0; n < numsamples; n++)
     {
@@ -167,30 +272,94 @@ void FFTAnalyzer::ReadBuffer(float* buffer, int numsamples, bool readInputBuffer
     }
 }
 
+#define BIQUAD_TRIG_TABLE_SIZE 1024
+#define BIQUAD_GAIN_TABLE_MIN -96.0f
+#define BIQUAD_GAIN_TABLE_MAX 48.0f
+#define BIQUAD_GAIN_TABLE_STEPS_PER_DB 4
+
+// Built once when the library is loaded so that lookups never have to check for initialization
+static struct BiquadCoeffTables
+{
+    enum { GAINTABLESIZE = (int)(BIQUAD_GAIN_TABLE_MAX - BIQUAD_GAIN_TABLE_MIN) * BIQUAD_GAIN_TABLE_STEPS_PER_DB + 1 };
+
+    BiquadCoeffTables()
+    {
+        for (int n = 0; n <= BIQUAD_TRIG_TABLE_SIZE; n++)
+        {
+            float w0 = kPI * (float)n / (float)BIQUAD_TRIG_TABLE_SIZE;
+            sintable[n] = sinf(w0);
+            costable[n] = cosf(w0);
+        }
+        for (int n = 0; n < GAINTABLESIZE; n++)
+            gaintable[n] = powf(10.0f, (BIQUAD_GAIN_TABLE_MIN + (float)n / (float)BIQUAD_GAIN_TABLE_STEPS_PER_DB) * 0.025f);
+    }
+
+    float sintable[BIQUAD_TRIG_TABLE_SIZE + 1];
+    float costable[BIQUAD_TRIG_TABLE_SIZE + 1];
+    float gaintable[GAINTABLESIZE];
+} g_BiquadCoeffTables;
+
+void BiquadTableSinCos(float w0, float& sinw0, float& cosw0)
+{
+    float f = FastClip(w0 * ((float)BIQUAD_TRIG_TABLE_SIZE / kPI), 0.0f, (float)BIQUAD_TRIG_TABLE_SIZE);
+    int i = (int)f;
+    if (i >= BIQUAD_TRIG_TABLE_SIZE)
+        i = BIQUAD_TRIG_TABLE_SIZE - 1;
+    f -= (float)i;
+    sinw0 = g_BiquadCoeffTables.sintable[i] + (g_BiquadCoeffTables.sintable[i + 1] - g_BiquadCoeffTables.sintable[i]) * f;
+    cosw0 = g_BiquadCoeffTables.costable[i] + (g_BiquadCoeffTables.costable[i + 1] - g_BiquadCoeffTables.costable[i]) * f;
+}
+
+float BiquadTableShelfGain(float gain)
+{
+    const int last = BiquadCoeffTables::GAINTABLESIZE - 1;
+    float f = FastClip((gain - BIQUAD_GAIN_TABLE_MIN) * (float)BIQUAD_GAIN_TABLE_STEPS_PER_DB, 0.0f, (float)last);
+    int i = (int)f;
+    if (i >= last)
+        i = last - 1;
+    f -= (float)i;
+    return g_BiquadCoeffTables.gaintable[i] + (g_BiquadCoeffTables.gaintable[i + 1] - g_BiquadCoeffTables.gaintable[i]) * f;
+}
+
 HistoryBuffer::HistoryBuffer()
     : length(0)
     , writeindex(0)
     , data(NULL)
+    , numlevels(0)
 {
+    for (int level = 0; level < MINMAXLEVELS; level++)
+        minmax[level] = NULL;
 }
 
 HistoryBuffer::~HistoryBuffer()
 {
     delete[] data;
+    for (int level = 0; level < MINMAXLEVELS; level++)
+        delete[] minmax[level];
 }
 
 void HistoryBuffer::Init(int _length)
 {
-    length = _length;
+    numlevels = 0;
+    while (numlevels < MINMAXLEVELS && (8 << (MINMAXSHIFT * (numlevels + 1))) <= _length)
+        numlevels++;
+    const int block = 1 << (MINMAXSHIFT * numlevels);
+    length = (_length + block - 1) / block * block;
     data = new float[length];
     memset(data, 0, sizeof(float) * length);
+    for (int level = 0; level < numlevels; level++)
+    {
+        const int numpairs = length >> (MINMAXSHIFT * (level + 1));
+        minmax[level] = new float[2 * numpairs];
+        memset(minmax[level], 0, sizeof(float) * 2 * numpairs);
+    }
 }
 
 void HistoryBuffer::ReadBuffer(float* buffer, int numsamplesTarget, int numsamplesSource, float offset)
 {
     numsamplesTarget--; // reserve last sample for count of how much we were able to read
     float speed = (float)numsamplesSource / (float)numsamplesTarget;
-    int n, w = writeindex; // since ReadBuffer is called from the GUI thread, writeindex may be modified by the DSP thread simultaneously
+    int n, w = writeindex.load(std::memory_order_acquire); // since ReadBuffer is called from the GUI thread, writeindex may be modified by the DSP thread simultaneously
     float p = offset;
     for (n = 0; n < numsamplesTarget; n++)
     {
@@ -208,67 +377,1150 @@ void HistoryBuffer::ReadBuffer(float* buffer, int numsamplesTarget, int numsampl
     buffer[numsamplesTarget] = (float)n; // how many samples were written
 }
 
-AudioMutex::AudioMutex()
+void HistoryBuffer::ReadBufferMinMax(float* buffer, int numsamplesTarget, int numsamplesSource, float offset)
 {
-#if UNITY_WIN
-#if UNITY_WINRT
-    BOOL const result = InitializeCriticalSectionEx(&crit_sec, 0, CRITICAL_SECTION_NO_DEBUG_INFO);
-    assert(FALSE != result);
+    int numpixels = (numsamplesTarget - 1) / 2; // reserve last sample for count of how many pairs we were able to read
+    float speed = (numpixels > 0) ? (float)numsamplesSource / (float)numpixels : 0.0f;
+
+    // Coarsest envelope level with at least 4 blocks to a pixel. Each pixel takes whole blocks of it, and the partial
+    // blocks at its edges from the finer levels; with fewer blocks the edges cost more than scanning the samples.
+    int level = -1;
+    while (level + 1 < numlevels && (float)(4 << (MINMAXSHIFT * (level + 2))) <= speed)
+        level++;
+
+    int n, w = writeindex.load(std::memory_order_acquire);
+    float p = offset;
+    for (n = 0; n < numpixels; n++)
+    {
+        // Range of sample ages (0 being the newest sample) covered by this pixel
+        int age0 = (int)p;
+        int age1 = (int)(p + speed);
+        if (age1 <= age0)
+            age1 = age0 + 1;
+        if (age1 > length)
+            break;
+
+        // The covered samples are contiguous in the buffer unless they wrap around its start
+        int i0 = w + 1 - age1;
+        int i1 = w + 1 - age0;
+        float minval = FLT_MAX, maxval = -FLT_MAX;
+        if (i0 >= 0)
+            ReadMinMax(i0, i1, level, minval, maxval);
+        else if (i1 <= 0)
+            ReadMinMax(i0 + length, i1 + length, level, minval, maxval);
+        else
+        {
+            ReadMinMax(i0 + length, length, level, minval, maxval);
+            ReadMinMax(0, i1, level, minval, maxval);
+        }
+        buffer[2 * (numpixels - 1 - n)] = minval;
+        buffer[2 * (numpixels - 1 - n) + 1] = maxval;
+        p += speed;
+    }
+    buffer[numsamplesTarget - 1] = (float)n; // how many pairs were written
+}
+
+// The spans at the edges of a pixel are mostly shorter than a vector or two, where the call costs more than the scan
+static inline void MinMaxSpan(const UnityAudioKernels& kernels, const float* src, int numsamples, float& minval, float& maxval)
+{
+    if (numsamples >= 16)
+    {
+        kernels.MinMax(src, numsamples, minval, maxval);
+        return;
+    }
+    float lo = minval, hi = maxval;
+    for (int n = 0; n < numsamples; n++)
+    {
+        lo = (src[n] < lo) ? src[n] : lo;
+        hi = (src[n] > hi) ? src[n] : hi;
+    }
+    minval = lo;
+    maxval = hi;
+}
+
+void HistoryBuffer::ReadMinMax(int i0, int i1, int level, float& minval, float& maxval) const
+{
+    // Whole blocks of the level are read from its pairs (the min of a pair never exceeds its max, so the kernel can take
+    // them interleaved), and the partial blocks at either end from the finer levels. Blocks wholly inside [i0, i1) are
+    // behind the write position, so they are complete.
+    const UnityAudioKernels& kernels = GetAudioKernels();
+    for (; level >= 0; level--)
+    {
+        const int shift = MINMAXSHIFT * (level + 1);
+        const int b0 = (i0 + (1 << shift) - 1) >> shift;
+        const int b1 = i1 >> shift;
+        if (b0 < b1)
+        {
+            MinMaxSpan(kernels, minmax[level] + 2 * b0, 2 * (b1 - b0), minval, maxval);
+            ReadMinMax(b1 << shift, i1, level - 1, minval, maxval);
+            i1 = b0 << shift;
+        }
+    }
+    MinMaxSpan(kernels, data + i0, i1 - i0, minval, maxval);
+}
+
+void HistoryBuffer::UpdateMinMax(int i0, int i1)
+{
+    // Samples i0 to i1 were just written. Each block they touch is rescanned from its start, which was written no
+    // earlier than the rest of it in this pass over the buffer, up to i1; the levels above work from the one below.
+    const UnityAudioKernels& kernels = GetAudioKernels();
+    for (int level = 0; level < numlevels; level++)
+    {
+        const int shift = MINMAXSHIFT * (level + 1);
+        for (int b = i0 >> shift; b <= (i1 - 1) >> shift; b++)
+        {
+            const int start = b << shift;
+            const int end = (i1 < ((b + 1) << shift)) ? i1 : ((b + 1) << shift);
+            float minval = FLT_MAX, maxval = -FLT_MAX;
+            if (level == 0)
+                MinMaxSpan(kernels, data + start, end - start, minval, maxval);
+            else
+            {
+                const int child0 = start >> (shift - MINMAXSHIFT);
+                const int child1 = ((end - 1) >> (shift - MINMAXSHIFT)) + 1;
+                MinMaxSpan(kernels, minmax[level - 1] + 2 * child0, 2 * (child1 - child0), minval, maxval);
+            }
+            minmax[level][2 * b] = minval;
+            minmax[level][2 * b + 1] = maxval;
+        }
+    }
+}
+
+void HistoryBuffer::Feed(const float* samples, int numsamples, int stride)
+{
+    // Only the newest length samples can be kept
+    if (numsamples > length)
+    {
+        samples += (numsamples - length) * stride;
+        numsamples = length;
+    }
+    if (numsamples <= 0)
+        return;
+    int w0 = writeindex.load(std::memory_order_relaxed) + 1;
+    if (w0 == length)
+        w0 = 0;
+    int w = RingWrite(data, length, w0, samples, stride, numsamples, 1.0f, 1.0f);
+    if (w0 + numsamples <= length)
+        UpdateMinMax(w0, w0 + numsamples);
+    else
+    {
+        UpdateMinMax(w0, length);
+        UpdateMinMax(0, w);
+    }
+    writeindex.store((w == 0) ? (length - 1) : (w - 1), std::memory_order_release);
+}
+
+LatencyHistogram::LatencyHistogram(float _binwidth)
+    : binwidth(_binwidth)
+{
+    for (int n = 0; n < NUMBINS; n++)
+        bins[n].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    minvalue.store(0.0f, std::memory_order_relaxed);
+    maxvalue.store(0.0f, std::memory_order_relaxed);
+    sum.store(0.0, std::memory_order_relaxed);
+    resetrequested.store(false, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Add(float value)
+{
+    if (resetrequested.exchange(false, std::memory_order_acq_rel))
+    {
+        for (int n = 0; n < NUMBINS; n++)
+            bins[n].store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_release);
+        sum.store(0.0, std::memory_order_relaxed);
+    }
+
+    // This is the only thread that writes, so plain loads and stores are enough
+    unsigned int c = count.load(std::memory_order_relaxed);
+    if (c == 0 || value < minvalue.load(std::memory_order_relaxed))
+        minvalue.store(value, std::memory_order_relaxed);
+    if (c == 0 || value > maxvalue.load(std::memory_order_relaxed))
+        maxvalue.store(value, std::memory_order_relaxed);
+    sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+    int bin = (value > 0.0f) ? (int)(value / binwidth) : 0;
+    if (bin >= NUMBINS)
+        bin = NUMBINS - 1;
+    bins[bin].store(bins[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // Published last, so a reader that sees the count also sees the value
+    count.store(c + 1, std::memory_order_release);
+}
+
+float LatencyHistogram::GetMean() const
+{
+    unsigned int c = GetCount();
+    return (c > 0) ? (float)(sum.load(std::memory_order_relaxed) / (double)c) : 0.0f;
+}
+
+float LatencyHistogram::GetPercentile(float fraction) const
+{
+    unsigned int c = GetCount();
+    if (c == 0)
+        return 0.0f;
+
+    // The bins may hold a few more values than the count the reader saw; that only shifts the result by a bin
+    unsigned int target = (unsigned int)ceilf(fraction * (float)c);
+    if (target < 1)
+        target = 1;
+    unsigned int seen = 0;
+    int bin = 0;
+    for (; bin < NUMBINS - 1; bin++)
+    {
+        seen += GetBin(bin);
+        if (seen >= target)
+            break;
+    }
+
+    float value = ((float)bin + 0.5f) * binwidth;
+    float minval = GetMin(), maxval = GetMax();
+    return (value < minval) ? minval : ((value > maxval) ? maxval : value);
+}
+
+template<bool METER>
+static inline float CopyScaledTail(float* dst, const float* src, int srcstride, int n, int numsamples, float gain0, float ginc, float peak)
+{
+    float gain = gain0 + ginc * (float)n;
+    for (; n < numsamples; n++)
+    {
+        float y = src[n * srcstride] * gain;
+        dst[n] = y;
+        if (METER && fabsf(y) > peak)
+            peak = fabsf(y);
+        gain += ginc;
+    }
+    return peak;
+}
+
+template<bool METER>
+static float CopyScaledScalar(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return 0.0f;
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    return CopyScaledTail<METER>(dst, src, srcstride, 0, numsamples, gain0, ginc, 0.0f);
+}
+
+static float PeakScalar(const float* src, int numsamples)
+{
+    float peak = 0.0f;
+    for (int n = 0; n < numsamples; n++)
+        if (fabsf(src[n]) > peak)
+            peak = fabsf(src[n]);
+    return peak;
+}
+
+static void MinMaxScalar(const float* src, int numsamples, float& minval, float& maxval)
+{
+    for (int n = 0; n < numsamples; n++)
+    {
+        if (src[n] < minval)
+            minval = src[n];
+        if (src[n] > maxval)
+            maxval = src[n];
+    }
+}
+
+static void MixScaledScalar(float* dst, const float* src, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return;
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    float gain = gain0;
+    for (int n = 0; n < numsamples; n++)
+    {
+        dst[n] += src[n] * gain;
+        gain += ginc;
+    }
+}
+
+static void DownmixScalar(float* dst, const float* src, int numchannels, int numsamples, float gain)
+{
+    for (int n = 0; n < numsamples; n++)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < numchannels; i++)
+            sum += src[n * numchannels + i];
+        dst[n] = sum * gain;
+    }
+}
+
+static void ComplexMultiplyScalar(UnityComplexNumber* dst, const UnityComplexNumber* a, const UnityComplexNumber* b, int numsamples)
+{
+    for (int n = 0; n < numsamples; n++)
+        UnityComplexNumber::Mul(a[n], b[n], dst[n]);
+}
+
+static void FFTButterfliesScalar(UnityComplexNumber* a, UnityComplexNumber* b, const UnityComplexNumber* w, int numsamples)
+{
+    for (int n = 0; n < numsamples; n++)
+    {
+        UnityComplexNumber t; UnityComplexNumber::Mul(w[n], b[n], t);
+        UnityComplexNumber::Sub(a[n], t, b[n]);
+        UnityComplexNumber::Add(a[n], t, a[n]);
+    }
+}
+
+static const UnityAudioKernels g_ScalarKernels =
+{
+    UnityAudioInstructionSet_Scalar, "Scalar",
+    CopyScaledScalar<false>, CopyScaledScalar<true>, PeakScalar, MinMaxScalar, MixScaledScalar, DownmixScalar, ComplexMultiplyScalar,
+    FFTButterfliesScalar
+};
+
+#if UNITY_AUDIO_SSE
+template<bool METER>
+static float CopyScaledSSE2(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return 0.0f;
+
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    __m128 g = _mm_add_ps(_mm_set1_ps(gain0), _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(ginc)));
+    const __m128 gstep = _mm_set1_ps(4.0f * ginc);
+    const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vpeak = _mm_setzero_ps();
+    int n = 0;
+    if (srcstride == 1)
+    {
+        for (; n + 4 <= numsamples; n += 4)
+        {
+            __m128 y = _mm_mul_ps(_mm_loadu_ps(src + n), g);
+            _mm_storeu_ps(dst + n, y);
+            if (METER)
+                vpeak = _mm_max_ps(vpeak, _mm_and_ps(y, absmask));
+            g = _mm_add_ps(g, gstep);
+        }
+    }
+    else if (srcstride == 2)
+    {
+        for (; n + 4 <= numsamples; n += 4)
+        {
+            __m128 a = _mm_loadu_ps(src + 2 * n);
+            __m128 b = _mm_loadu_ps(src + 2 * n + 4);
+            __m128 y = _mm_mul_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), g);
+            _mm_storeu_ps(dst + n, y);
+            if (METER)
+                vpeak = _mm_max_ps(vpeak, _mm_and_ps(y, absmask));
+            g = _mm_add_ps(g, gstep);
+        }
+    }
+    float peak = 0.0f;
+    if (METER)
+    {
+        vpeak = _mm_max_ps(vpeak, _mm_movehl_ps(vpeak, vpeak));
+        vpeak = _mm_max_ss(vpeak, _mm_shuffle_ps(vpeak, vpeak, _MM_SHUFFLE(1, 1, 1, 1)));
+        peak = _mm_cvtss_f32(vpeak);
+    }
+    return CopyScaledTail<METER>(dst, src, srcstride, n, numsamples, gain0, ginc, peak);
+}
+
+static float PeakSSE2(const float* src, int numsamples)
+{
+    const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 vpeak = _mm_setzero_ps();
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+        vpeak = _mm_max_ps(vpeak, _mm_and_ps(_mm_loadu_ps(src + n), absmask));
+    vpeak = _mm_max_ps(vpeak, _mm_movehl_ps(vpeak, vpeak));
+    vpeak = _mm_max_ss(vpeak, _mm_shuffle_ps(vpeak, vpeak, _MM_SHUFFLE(1, 1, 1, 1)));
+    float peak = _mm_cvtss_f32(vpeak);
+    float tail = PeakScalar(src + n, numsamples - n);
+    return (tail > peak) ? tail : peak;
+}
+
+static void MinMaxSSE2(const float* src, int numsamples, float& minval, float& maxval)
+{
+    __m128 vmin = _mm_set1_ps(minval), vmax = _mm_set1_ps(maxval);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        __m128 x = _mm_loadu_ps(src + n);
+        vmin = _mm_min_ps(vmin, x);
+        vmax = _mm_max_ps(vmax, x);
+    }
+    vmin = _mm_min_ps(vmin, _mm_movehl_ps(vmin, vmin));
+    vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+    minval = _mm_cvtss_f32(_mm_min_ss(vmin, _mm_shuffle_ps(vmin, vmin, _MM_SHUFFLE(1, 1, 1, 1))));
+    maxval = _mm_cvtss_f32(_mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(1, 1, 1, 1))));
+    MinMaxScalar(src + n, numsamples - n, minval, maxval);
+}
+
+static void MixScaledSSE2(float* dst, const float* src, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return;
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    __m128 g = _mm_add_ps(_mm_set1_ps(gain0), _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(ginc)));
+    const __m128 gstep = _mm_set1_ps(4.0f * ginc);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        _mm_storeu_ps(dst + n, _mm_add_ps(_mm_loadu_ps(dst + n), _mm_mul_ps(_mm_loadu_ps(src + n), g)));
+        g = _mm_add_ps(g, gstep);
+    }
+    MixScaledScalar(dst + n, src + n, numsamples - n, gain0 + ginc * (float)n, gain1);
+}
+
+static void DownmixSSE2(float* dst, const float* src, int numchannels, int numsamples, float gain)
+{
+    if (numchannels != 2)
+    {
+        DownmixScalar(dst, src, numchannels, numsamples, gain);
+        return;
+    }
+    const __m128 vgain = _mm_set1_ps(gain);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        __m128 a = _mm_loadu_ps(src + 2 * n);
+        __m128 b = _mm_loadu_ps(src + 2 * n + 4);
+        __m128 sum = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(dst + n, _mm_mul_ps(sum, vgain));
+    }
+    DownmixScalar(dst + n, src + 2 * n, 2, numsamples - n, gain);
+}
+
+static void ComplexMultiplySSE2(UnityComplexNumber* dst, const UnityComplexNumber* a, const UnityComplexNumber* b, int numsamples)
+{
+    // Two interleaved { re, im } pairs per vector. SSE2 has no addsub, so the sign of the re lanes is flipped explicitly.
+    const __m128 negre = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+    int n = 0;
+    for (; n + 2 <= numsamples; n += 2)
+    {
+        __m128 va = _mm_loadu_ps(&a[n].re);
+        __m128 vb = _mm_loadu_ps(&b[n].re);
+        __m128 bre = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 bim = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 aswap = _mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 y = _mm_add_ps(_mm_mul_ps(va, bre), _mm_xor_ps(_mm_mul_ps(aswap, bim), negre));
+        _mm_storeu_ps(&dst[n].re, y);
+    }
+    ComplexMultiplyScalar(dst + n, a + n, b + n, numsamples - n);
+}
+
+static void FFTButterfliesSSE2(UnityComplexNumber* a, UnityComplexNumber* b, const UnityComplexNumber* w, int numsamples)
+{
+    // Same product as ComplexMultiplySSE2
+    const __m128 negre = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+    int n = 0;
+    for (; n + 2 <= numsamples; n += 2)
+    {
+        __m128 va = _mm_loadu_ps(&a[n].re);
+        __m128 vb = _mm_loadu_ps(&b[n].re);
+        __m128 vw = _mm_loadu_ps(&w[n].re);
+        __m128 wre = _mm_shuffle_ps(vw, vw, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 wim = _mm_shuffle_ps(vw, vw, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 bswap = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 t = _mm_add_ps(_mm_mul_ps(vb, wre), _mm_xor_ps(_mm_mul_ps(bswap, wim), negre));
+        _mm_storeu_ps(&b[n].re, _mm_sub_ps(va, t));
+        _mm_storeu_ps(&a[n].re, _mm_add_ps(va, t));
+    }
+    FFTButterfliesScalar(a + n, b + n, w + n, numsamples - n);
+}
+
+static const UnityAudioKernels g_SSE2Kernels =
+{
+    UnityAudioInstructionSet_SSE2, "SSE2",
+    CopyScaledSSE2<false>, CopyScaledSSE2<true>, PeakSSE2, MinMaxSSE2, MixScaledSSE2, DownmixSSE2, ComplexMultiplySSE2,
+    FFTButterfliesSSE2
+};
+
+// The AVX2 variants are compiled for AVX2 on their own (the intrinsics need no /arch switch on MSVC, and a target
+// attribute elsewhere), so the rest of the library keeps building for the SSE2 baseline
+static UNITY_AUDIO_TARGET_AVX2 inline __m256 AVX2LoadEven(const float* p)
+{
+    // { p0, p2, p4, p6, p8, p10, p12, p14 }
+    __m256 x = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(2, 0, 2, 0));
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static UNITY_AUDIO_TARGET_AVX2 inline __m256 AVX2LoadOdd(const float* p)
+{
+    // { p1, p3, p5, p7, p9, p11, p13, p15 }
+    __m256 x = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static UNITY_AUDIO_TARGET_AVX2 inline float AVX2MaxAcross(__m256 v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(m);
+}
+
+template<bool METER>
+static UNITY_AUDIO_TARGET_AVX2 float CopyScaledAVX2(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return 0.0f;
+
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    __m256 g = _mm256_add_ps(_mm256_set1_ps(gain0), _mm256_mul_ps(_mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f), _mm256_set1_ps(ginc)));
+    const __m256 gstep = _mm256_set1_ps(8.0f * ginc);
+    const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 vpeak = _mm256_setzero_ps();
+    int n = 0;
+    if (srcstride == 1)
+    {
+        for (; n + 8 <= numsamples; n += 8)
+        {
+            __m256 y = _mm256_mul_ps(_mm256_loadu_ps(src + n), g);
+            _mm256_storeu_ps(dst + n, y);
+            if (METER)
+                vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(y, absmask));
+            g = _mm256_add_ps(g, gstep);
+        }
+    }
+    else if (srcstride == 2)
+    {
+        for (; n + 8 <= numsamples; n += 8)
+        {
+            __m256 y = _mm256_mul_ps(AVX2LoadEven(src + 2 * n), g);
+            _mm256_storeu_ps(dst + n, y);
+            if (METER)
+                vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(y, absmask));
+            g = _mm256_add_ps(g, gstep);
+        }
+    }
+    float peak = METER ? AVX2MaxAcross(vpeak) : 0.0f;
+    _mm256_zeroupper();
+    return CopyScaledTail<METER>(dst, src, srcstride, n, numsamples, gain0, ginc, peak);
+}
+
+static UNITY_AUDIO_TARGET_AVX2 float PeakAVX2(const float* src, int numsamples)
+{
+    const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 vpeak = _mm256_setzero_ps();
+    int n = 0;
+    for (; n + 8 <= numsamples; n += 8)
+        vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(_mm256_loadu_ps(src + n), absmask));
+    float peak = AVX2MaxAcross(vpeak);
+    _mm256_zeroupper();
+    float tail = PeakScalar(src + n, numsamples - n);
+    return (tail > peak) ? tail : peak;
+}
+
+static UNITY_AUDIO_TARGET_AVX2 void MinMaxAVX2(const float* src, int numsamples, float& minval, float& maxval)
+{
+    __m256 vmin = _mm256_set1_ps(minval), vmax = _mm256_set1_ps(maxval);
+    int n = 0;
+    for (; n + 8 <= numsamples; n += 8)
+    {
+        __m256 x = _mm256_loadu_ps(src + n);
+        vmin = _mm256_min_ps(vmin, x);
+        vmax = _mm256_max_ps(vmax, x);
+    }
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    minval = _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))));
+    maxval = AVX2MaxAcross(vmax);
+    _mm256_zeroupper();
+    MinMaxScalar(src + n, numsamples - n, minval, maxval);
+}
+
+static UNITY_AUDIO_TARGET_AVX2 void MixScaledAVX2(float* dst, const float* src, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return;
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    __m256 g = _mm256_add_ps(_mm256_set1_ps(gain0), _mm256_mul_ps(_mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f), _mm256_set1_ps(ginc)));
+    const __m256 gstep = _mm256_set1_ps(8.0f * ginc);
+    int n = 0;
+    for (; n + 8 <= numsamples; n += 8)
+    {
+        _mm256_storeu_ps(dst + n, _mm256_add_ps(_mm256_loadu_ps(dst + n), _mm256_mul_ps(_mm256_loadu_ps(src + n), g)));
+        g = _mm256_add_ps(g, gstep);
+    }
+    _mm256_zeroupper();
+    MixScaledScalar(dst + n, src + n, numsamples - n, gain0 + ginc * (float)n, gain1);
+}
+
+static UNITY_AUDIO_TARGET_AVX2 void DownmixAVX2(float* dst, const float* src, int numchannels, int numsamples, float gain)
+{
+    if (numchannels != 2)
+    {
+        DownmixScalar(dst, src, numchannels, numsamples, gain);
+        return;
+    }
+    const __m256 vgain = _mm256_set1_ps(gain);
+    int n = 0;
+    for (; n + 8 <= numsamples; n += 8)
+        _mm256_storeu_ps(dst + n, _mm256_mul_ps(_mm256_add_ps(AVX2LoadEven(src + 2 * n), AVX2LoadOdd(src + 2 * n)), vgain));
+    _mm256_zeroupper();
+    DownmixScalar(dst + n, src + 2 * n, 2, numsamples - n, gain);
+}
+
+static UNITY_AUDIO_TARGET_AVX2 void ComplexMultiplyAVX2(UnityComplexNumber* dst, const UnityComplexNumber* a, const UnityComplexNumber* b, int numsamples)
+{
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        __m256 va = _mm256_loadu_ps(&a[n].re);
+        __m256 vb = _mm256_loadu_ps(&b[n].re);
+        __m256 bre = _mm256_moveldup_ps(vb);
+        __m256 bim = _mm256_movehdup_ps(vb);
+        __m256 aswap = _mm256_permute_ps(va, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm256_storeu_ps(&dst[n].re, _mm256_addsub_ps(_mm256_mul_ps(va, bre), _mm256_mul_ps(aswap, bim)));
+    }
+    _mm256_zeroupper();
+    ComplexMultiplyScalar(dst + n, a + n, b + n, numsamples - n);
+}
+
+static UNITY_AUDIO_TARGET_AVX2 void FFTButterfliesAVX2(UnityComplexNumber* a, UnityComplexNumber* b, const UnityComplexNumber* w, int numsamples)
+{
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        __m256 va = _mm256_loadu_ps(&a[n].re);
+        __m256 vb = _mm256_loadu_ps(&b[n].re);
+        __m256 vw = _mm256_loadu_ps(&w[n].re);
+        __m256 wre = _mm256_moveldup_ps(vw);
+        __m256 wim = _mm256_movehdup_ps(vw);
+        __m256 bswap = _mm256_permute_ps(vb, _MM_SHUFFLE(2, 3, 0, 1));
+        __m256 t = _mm256_addsub_ps(_mm256_mul_ps(vb, wre), _mm256_mul_ps(bswap, wim));
+        _mm256_storeu_ps(&b[n].re, _mm256_sub_ps(va, t));
+        _mm256_storeu_ps(&a[n].re, _mm256_add_ps(va, t));
+    }
+    _mm256_zeroupper();
+    FFTButterfliesScalar(a + n, b + n, w + n, numsamples - n);
+}
+
+static const UnityAudioKernels g_AVX2Kernels =
+{
+    UnityAudioInstructionSet_AVX2, "AVX2",
+    CopyScaledAVX2<false>, CopyScaledAVX2<true>, PeakAVX2, MinMaxAVX2, MixScaledAVX2, DownmixAVX2, ComplexMultiplyAVX2,
+    FFTButterfliesAVX2
+};
+
+static bool CPUSupportsAVX2()
+{
+    // AVX2 needs CPU support as well as the OS saving the YMM registers on context switches (OSXSAVE and XCR0 bits 1-2)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
 #else
-    InitializeCriticalSection(&crit_sec);
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return false;
+    __cpuid(1, eax, ebx, ecx, edx);
+    if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0)
+        return false;
+    unsigned int xcr0, xcr0hi;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0), "=d"(xcr0hi) : "c"(0));
+    if ((xcr0 & 6) != 6)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_AVX2) != 0;
+#endif
+}
+#elif UNITY_AUDIO_NEON
+template<bool METER>
+static float CopyScaledNEON(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return 0.0f;
+
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    const float ramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t g = vmlaq_n_f32(vdupq_n_f32(gain0), vld1q_f32(ramp), ginc);
+    const float32x4_t gstep = vdupq_n_f32(4.0f * ginc);
+    float32x4_t vpeak = vdupq_n_f32(0.0f);
+    int n = 0;
+    if (srcstride == 1)
+    {
+        for (; n + 4 <= numsamples; n += 4)
+        {
+            float32x4_t y = vmulq_f32(vld1q_f32(src + n), g);
+            vst1q_f32(dst + n, y);
+            if (METER)
+                vpeak = vmaxq_f32(vpeak, vabsq_f32(y));
+            g = vaddq_f32(g, gstep);
+        }
+    }
+    else if (srcstride == 2)
+    {
+        for (; n + 4 <= numsamples; n += 4)
+        {
+            float32x4x2_t s = vld2q_f32(src + 2 * n);
+            float32x4_t y = vmulq_f32(s.val[0], g);
+            vst1q_f32(dst + n, y);
+            if (METER)
+                vpeak = vmaxq_f32(vpeak, vabsq_f32(y));
+            g = vaddq_f32(g, gstep);
+        }
+    }
+    float peak = 0.0f;
+    if (METER)
+    {
+        float32x2_t p = vpmax_f32(vget_low_f32(vpeak), vget_high_f32(vpeak));
+        peak = vget_lane_f32(vpmax_f32(p, p), 0);
+    }
+    return CopyScaledTail<METER>(dst, src, srcstride, n, numsamples, gain0, ginc, peak);
+}
+
+static float PeakNEON(const float* src, int numsamples)
+{
+    float32x4_t vpeak = vdupq_n_f32(0.0f);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(vld1q_f32(src + n)));
+    float32x2_t p = vpmax_f32(vget_low_f32(vpeak), vget_high_f32(vpeak));
+    float peak = vget_lane_f32(vpmax_f32(p, p), 0);
+    float tail = PeakScalar(src + n, numsamples - n);
+    return (tail > peak) ? tail : peak;
+}
+
+static void MinMaxNEON(const float* src, int numsamples, float& minval, float& maxval)
+{
+    float32x4_t vmin = vdupq_n_f32(minval), vmax = vdupq_n_f32(maxval);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        float32x4_t x = vld1q_f32(src + n);
+        vmin = vminq_f32(vmin, x);
+        vmax = vmaxq_f32(vmax, x);
+    }
+    float32x2_t lo = vpmin_f32(vget_low_f32(vmin), vget_high_f32(vmin));
+    float32x2_t hi = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+    minval = vget_lane_f32(vpmin_f32(lo, lo), 0);
+    maxval = vget_lane_f32(vpmax_f32(hi, hi), 0);
+    MinMaxScalar(src + n, numsamples - n, minval, maxval);
+}
+
+static void MixScaledNEON(float* dst, const float* src, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return;
+    const float ginc = (gain1 - gain0) / (float)numsamples;
+    const float ramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t g = vmlaq_n_f32(vdupq_n_f32(gain0), vld1q_f32(ramp), ginc);
+    const float32x4_t gstep = vdupq_n_f32(4.0f * ginc);
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        vst1q_f32(dst + n, vmlaq_f32(vld1q_f32(dst + n), vld1q_f32(src + n), g));
+        g = vaddq_f32(g, gstep);
+    }
+    MixScaledScalar(dst + n, src + n, numsamples - n, gain0 + ginc * (float)n, gain1);
+}
+
+static void DownmixNEON(float* dst, const float* src, int numchannels, int numsamples, float gain)
+{
+    if (numchannels != 2)
+    {
+        DownmixScalar(dst, src, numchannels, numsamples, gain);
+        return;
+    }
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        float32x4x2_t s = vld2q_f32(src + 2 * n);
+        vst1q_f32(dst + n, vmulq_n_f32(vaddq_f32(s.val[0], s.val[1]), gain));
+    }
+    DownmixScalar(dst + n, src + 2 * n, 2, numsamples - n, gain);
+}
+
+static void ComplexMultiplyNEON(UnityComplexNumber* dst, const UnityComplexNumber* a, const UnityComplexNumber* b, int numsamples)
+{
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        float32x4x2_t va = vld2q_f32(&a[n].re);
+        float32x4x2_t vb = vld2q_f32(&b[n].re);
+        float32x4x2_t y;
+        y.val[0] = vmlsq_f32(vmulq_f32(va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+        y.val[1] = vmlaq_f32(vmulq_f32(va.val[0], vb.val[1]), va.val[1], vb.val[0]);
+        vst2q_f32(&dst[n].re, y);
+    }
+    ComplexMultiplyScalar(dst + n, a + n, b + n, numsamples - n);
+}
+
+static void FFTButterfliesNEON(UnityComplexNumber* a, UnityComplexNumber* b, const UnityComplexNumber* w, int numsamples)
+{
+    int n = 0;
+    for (; n + 4 <= numsamples; n += 4)
+    {
+        float32x4x2_t va = vld2q_f32(&a[n].re);
+        float32x4x2_t vb = vld2q_f32(&b[n].re);
+        float32x4x2_t vw = vld2q_f32(&w[n].re);
+        float32x4_t tre = vmlsq_f32(vmulq_f32(vb.val[0], vw.val[0]), vb.val[1], vw.val[1]);
+        float32x4_t tim = vmlaq_f32(vmulq_f32(vb.val[0], vw.val[1]), vb.val[1], vw.val[0]);
+        float32x4x2_t y;
+        y.val[0] = vsubq_f32(va.val[0], tre);
+        y.val[1] = vsubq_f32(va.val[1], tim);
+        vst2q_f32(&b[n].re, y);
+        y.val[0] = vaddq_f32(va.val[0], tre);
+        y.val[1] = vaddq_f32(va.val[1], tim);
+        vst2q_f32(&a[n].re, y);
+    }
+    FFTButterfliesScalar(a + n, b + n, w + n, numsamples - n);
+}
+
+static const UnityAudioKernels g_NEONKernels =
+{
+    UnityAudioInstructionSet_NEON, "NEON",
+    CopyScaledNEON<false>, CopyScaledNEON<true>, PeakNEON, MinMaxNEON, MixScaledNEON, DownmixNEON, ComplexMultiplyNEON,
+    FFTButterfliesNEON
+};
 #endif
+
+static const UnityAudioKernels* SelectAudioKernels()
+{
+#if UNITY_AUDIO_SSE
+    return CPUSupportsAVX2() ? &g_AVX2Kernels : &g_SSE2Kernels;
+#elif UNITY_AUDIO_NEON
+#   if defined(__linux__) && defined(__arm__)
+    // NEON is optional on 32-bit ARM; AArch64 and Windows on ARM always have it
+    if ((getauxval(AT_HWCAP) & HWCAP_NEON) == 0)
+        return &g_ScalarKernels;
+#   endif
+    return &g_NEONKernels;
 #else
-# if !UNITY_SPU
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-    pthread_mutex_init(&mutex, &attr);
-    pthread_mutexattr_destroy(&attr);
-# endif
+    return &g_ScalarKernels;
 #endif
 }
 
-AudioMutex::~AudioMutex()
+static const UnityAudioKernels* g_AudioKernels = SelectAudioKernels();
+
+const UnityAudioKernels& GetAudioKernels()
 {
-#if UNITY_WIN
-    DeleteCriticalSection(&crit_sec);
-#else
-# if !UNITY_SPU
-    pthread_mutex_destroy(&mutex);
-# endif
+    // Only reached before static initialization when called from another module's static constructor
+    if (g_AudioKernels == NULL)
+        g_AudioKernels = SelectAudioKernels();
+    return *g_AudioKernels;
+}
+
+const UnityAudioKernels* GetAudioKernels(UnityAudioInstructionSet instructionset)
+{
+    // Every variant up to the selected one runs on this machine
+    const UnityAudioInstructionSet best = GetAudioKernels().instructionset;
+    switch (instructionset)
+    {
+        case UnityAudioInstructionSet_Scalar:
+            return &g_ScalarKernels;
+#if UNITY_AUDIO_SSE
+        case UnityAudioInstructionSet_SSE2:
+            return &g_SSE2Kernels;
+        case UnityAudioInstructionSet_AVX2:
+            return (best == UnityAudioInstructionSet_AVX2) ? &g_AVX2Kernels : NULL;
+#elif UNITY_AUDIO_NEON
+        case UnityAudioInstructionSet_NEON:
+            return (best == UnityAudioInstructionSet_NEON) ? &g_NEONKernels : NULL;
 #endif
+        default:
+            return NULL;
+    }
 }
 
-bool AudioMutex::TryLock()
+DenormalGuard::DenormalGuard()
 {
-#if UNITY_WIN
-    return TryEnterCriticalSection(&crit_sec) != 0;
+#if UNITY_AUDIO_SSE
+    previousmode = _mm_getcsr();
+    _mm_setcsr(previousmode | 0x8040); // FTZ (bit 15) and DAZ (bit 6)
+#elif UNITY_AUDIO_NEON && defined(_MSC_VER)
+    unsigned int mode;
+    _controlfp_s(&previousmode, 0, 0);
+    _controlfp_s(&mode, _DN_FLUSH, _MCW_DN);
+#elif UNITY_AUDIO_NEON && defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    previousmode = (unsigned int)fpcr;
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1 << 24))); // FZ
+#elif UNITY_AUDIO_NEON
+    unsigned int fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r"(fpscr));
+    previousmode = fpscr;
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(fpscr | (1 << 24))); // FZ
 #else
-# if !UNITY_SPU
-    return pthread_mutex_trylock(&mutex) == 0;
-# endif
+    previousmode = 0;
+#endif
+}
+
+DenormalGuard::~DenormalGuard()
+{
+#if UNITY_AUDIO_SSE
+    _mm_setcsr(previousmode);
+#elif UNITY_AUDIO_NEON && defined(_MSC_VER)
+    unsigned int mode;
+    _controlfp_s(&mode, previousmode, _MCW_DN);
+#elif UNITY_AUDIO_NEON && defined(__aarch64__)
+    uint64_t fpcr = previousmode;
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#elif UNITY_AUDIO_NEON
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r"(previousmode));
+#endif
+}
+
+void CopyScaled(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1, float* peak)
+{
+    const UnityAudioKernels& kernels = GetAudioKernels();
+    if (peak != NULL)
+        *peak = kernels.CopyScaledMetered(dst, src, srcstride, numsamples, gain0, gain1);
+    else if (srcstride == 1 && gain0 == 1.0f && gain1 == 1.0f && numsamples > 0)
+        memcpy(dst, src, sizeof(float) * numsamples);
+    else
+        kernels.CopyScaled(dst, src, srcstride, numsamples, gain0, gain1);
+}
+
+int RingWrite(float* ring, int ringlength, int writepos, const float* src, int srcstride, int numsamples, float gain0, float gain1, float* peak)
+{
+    if (peak != NULL)
+        *peak = 0.0f;
+    if (numsamples <= 0)
+        return writepos;
+    int first = ringlength - writepos;
+    if (first > numsamples)
+        first = numsamples;
+    float gmid = gain0 + (gain1 - gain0) * (float)first / (float)numsamples;
+    float peak1, peak2;
+    CopyScaled(ring + writepos, src, srcstride, first, gain0, gmid, (peak != NULL) ? &peak1 : NULL);
+    CopyScaled(ring, src + first * srcstride, srcstride, numsamples - first, gmid, gain1, (peak != NULL) ? &peak2 : NULL);
+    if (peak != NULL)
+        *peak = (peak1 > peak2) ? peak1 : peak2;
+    writepos += numsamples;
+    return (writepos >= ringlength) ? (writepos - ringlength) : writepos;
+}
+
+int RingRead(float* dst, const float* ring, int ringlength, int readpos, int numsamples, float gain0, float gain1)
+{
+    if (numsamples <= 0)
+        return readpos;
+    int first = ringlength - readpos;
+    if (first > numsamples)
+        first = numsamples;
+    float gmid = gain0 + (gain1 - gain0) * (float)first / (float)numsamples;
+    CopyScaled(dst, ring + readpos, 1, first, gain0, gmid);
+    CopyScaled(dst + first, ring, 1, numsamples - first, gmid, gain1);
+    readpos += numsamples;
+    return (readpos >= ringlength) ? (readpos - ringlength) : readpos;
+}
+
+int RingFill(float* ring, int ringlength, int writepos, float value, int numsamples)
+{
+    if (numsamples <= 0)
+        return writepos;
+    int first = ringlength - writepos;
+    if (first > numsamples)
+        first = numsamples;
+    for (int n = 0; n < first; n++)
+        ring[writepos + n] = value;
+    for (int n = first; n < numsamples; n++)
+        ring[n - first] = value;
+    writepos += numsamples;
+    return (writepos >= ringlength) ? (writepos - ringlength) : writepos;
+}
+
+void VBAPPanner::Init(const float* azimuths, const float* elevations, int _numspeakers)
+{
+    numspeakers = (_numspeakers < MAXSPEAKERS) ? _numspeakers : MAXSPEAKERS;
+    numlayers = 0;
+
+    // Speakers within 10 degrees of elevation of each other share a layer
+    for (int i = 0; i < numspeakers; i++)
+    {
+        int l = 0;
+        while (l < numlayers && fabsf(layers[l].elevation - elevations[i]) > 10.0f)
+            l++;
+        if (l == numlayers)
+        {
+            if (numlayers == MAXLAYERS)
+                continue;
+            layers[l].elevation = elevations[i];
+            layers[l].numspeakers = 0;
+            numlayers++;
+        }
+        Layer& layer = layers[l];
+        layer.speakers[layer.numspeakers] = i;
+        layer.azimuths[layer.numspeakers] = azimuths[i] * (kPI / 180.0f);
+        layer.numspeakers++;
+    }
+
+    // Layers bottom to top, speakers within a layer counter-clockwise
+    for (int l = 1; l < numlayers; l++)
+        for (int k = l; k > 0 && layers[k].elevation < layers[k - 1].elevation; k--)
+            UnitySwap(layers[k], layers[k - 1]);
+
+    for (int l = 0; l < numlayers; l++)
+    {
+        Layer& layer = layers[l];
+        for (int i = 1; i < layer.numspeakers; i++)
+        {
+            for (int k = i; k > 0 && layer.azimuths[k] < layer.azimuths[k - 1]; k--)
+            {
+                UnitySwap(layer.azimuths[k], layer.azimuths[k - 1]);
+                UnitySwap(layer.speakers[k], layer.speakers[k - 1]);
+            }
+        }
+
+        // Pair k spans from speaker k to speaker k + 1, the last pair closes the circle
+        int n = layer.numspeakers;
+        layer.numpairs = (n < 2) ? 0 : ((n + 3) & ~3);
+        for (int k = 0; k < layer.numpairs; k++)
+        {
+            layer.i00[k] = layer.i01[k] = layer.i10[k] = layer.i11[k] = 0.0f;
+            layer.bias[k] = -FLT_MAX;
+            if (k >= n)
+                continue;
+            float a = layer.azimuths[k], b = layer.azimuths[(k + 1) % n];
+            float det = sinf(b - a);
+            if (fabsf(det) < 1.0e-3f)
+                continue; // speakers facing each other (or on top of each other) don't form a pair
+            layer.i00[k] = sinf(b) / det;
+            layer.i10[k] = -cosf(b) / det;
+            layer.i01[k] = -sinf(a) / det;
+            layer.i11[k] = cosf(a) / det;
+            layer.bias[k] = 0.0f;
+        }
+    }
+}
+
+void VBAPPanner::PanLayer(const Layer& layer, float front, float left, float horizontal, float scale, float* gains) const
+{
+    // A layer with a single speaker, or a source straight above or below, gets spread evenly over the layer
+    if (layer.numpairs == 0 || horizontal < 1.0e-6f)
+    {
+        float g = scale / sqrtf((float)layer.numspeakers);
+        for (int i = 0; i < layer.numspeakers; i++)
+            gains[layer.speakers[i]] += g;
+        return;
+    }
+
+    // The pair that contains the source is the one where neither gain is negative, which is also the one whose smaller
+    // gain is largest
+    float x = front / horizontal, y = left / horizontal;
+    const UnityVec4 vx = Vec4Set1(x), vy = Vec4Set1(y);
+    int best = 0;
+    float bestgain = -FLT_MAX;
+    for (int k = 0; k < layer.numpairs; k += 4)
+    {
+        UnityVec4 g1 = Vec4Add(Vec4Mul(vx, Vec4Load(layer.i00 + k)), Vec4Mul(vy, Vec4Load(layer.i10 + k)));
+        UnityVec4 g2 = Vec4Add(Vec4Mul(vx, Vec4Load(layer.i01 + k)), Vec4Mul(vy, Vec4Load(layer.i11 + k)));
+        float m[4];
+        Vec4Store(m, Vec4Add(Vec4Min(g1, g2), Vec4Load(layer.bias + k)));
+        for (int j = 0; j < 4; j++)
+        {
+            if (m[j] > bestgain)
+            {
+                bestgain = m[j];
+                best = k + j;
+            }
+        }
+    }
+
+    if (bestgain < 0.0f)
+    {
+        // No pair contains the source, so it is in a gap of 180 degrees or more between two neighbouring speakers. Pairs
+        // can't pan across such a gap, so crossfade between its edges by how far across the gap the source is.
+        float azimuth = atan2f(y, x);
+        int n = layer.numspeakers;
+        for (int k = 0; k < n; k++)
+        {
+            float span = layer.azimuths[(k + 1) % n] - layer.azimuths[k] + ((k == n - 1) ? 2.0f * kPI : 0.0f);
+            float offset = azimuth - layer.azimuths[k];
+            offset -= 2.0f * kPI * floorf(offset / (2.0f * kPI));
+            if (span > kPI - 1.0e-3f && offset <= span)
+            {
+                float t = offset / span;
+                gains[layer.speakers[k]] += scale * cosf(t * kPI * 0.5f);
+                gains[layer.speakers[(k + 1) % n]] += scale * sinf(t * kPI * 0.5f);
+                return;
+            }
+        }
+    }
+
+    float g1 = FastMax(x * layer.i00[best] + y * layer.i10[best], 0.0f);
+    float g2 = FastMax(x * layer.i01[best] + y * layer.i11[best], 0.0f);
+    float norm = scale / sqrtf(g1 * g1 + g2 * g2);
+    gains[layer.speakers[best]] += g1 * norm;
+    gains[layer.speakers[(best + 1) % layer.numspeakers]] += g2 * norm;
+}
+
+void VBAPPanner::ComputeGains(float front, float left, float up, float* gains) const
+{
+    memset(gains, 0, sizeof(float) * numspeakers);
+    if (numlayers == 0)
+        return;
+
+    float horizontal = sqrtf(front * front + left * left);
+    float elevation = atan2f(up, horizontal) * (180.0f / kPI);
+
+    int lo = 0;
+    while (lo < numlayers - 1 && layers[lo + 1].elevation <= elevation)
+        lo++;
+
+    if (elevation <= layers[0].elevation || lo == numlayers - 1)
+    {
+        PanLayer(layers[lo], front, left, horizontal, 1.0f, gains);
+        return;
+    }
+
+    // Between two layers: constant power crossfade by elevation
+    float t = (elevation - layers[lo].elevation) / (layers[lo + 1].elevation - layers[lo].elevation);
+    PanLayer(layers[lo], front, left, horizontal, cosf(t * kPI * 0.5f), gains);
+    PanLayer(layers[lo + 1], front, left, horizontal, sinf(t * kPI * 0.5f), gains);
+}
+
+// Tells the core that this is a spin-wait loop, so it backs off and yields to its hyperthread sibling
+static inline void SpinPause()
+{
+#if UNITY_AUDIO_SSE
+    _mm_pause();
+#elif UNITY_AUDIO_NEON && defined(_MSC_VER)
+    __yield();
+#elif UNITY_AUDIO_NEON
+    __asm__ __volatile__("yield");
 #endif
 }
 
-void AudioMutex::Lock()
+void AudioMutex::LockContended()
+{
+    // Spin while the lock is held, reading rather than swapping so the holder keeps its cache line
+    for (int n = 0; n < SPINCOUNT; n++)
+    {
+        SpinPause();
+        int expected = 0;
+        if (state.load(std::memory_order_relaxed) == 0 &&
+            state.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+    }
+
+    // Mark the lock contended before every park, so that whoever holds it wakes us. Getting it this way leaves it marked
+    // contended, which at worst costs its holder one spurious wake.
+    while (state.exchange(CONTENDED, std::memory_order_acquire) != 0)
+        Park();
+}
+
+void AudioMutex::Park()
 {
 #if UNITY_WIN
-    EnterCriticalSection(&crit_sec);
-#else
-# if !UNITY_SPU
-    pthread_mutex_lock(&mutex);
-# endif
+    int contended = CONTENDED;
+    WaitOnAddress(&state, &contended, sizeof(int), INFINITE);
+#elif defined(__linux__)
+    syscall(SYS_futex, (int*)&state, FUTEX_WAIT_PRIVATE, CONTENDED, NULL, NULL, 0);
+#elif !UNITY_SPU
+    sched_yield();
 #endif
 }
 
-void AudioMutex::Unlock()
+void AudioMutex::Wake()
 {
 #if UNITY_WIN
-    LeaveCriticalSection(&crit_sec);
-#else
-# if !UNITY_SPU
-    pthread_mutex_unlock(&mutex);
-# endif
+    WakeByAddressSingle(&state);
+#elif defined(__linux__)
+    syscall(SYS_futex, (int*)&state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
 #endif
 }
 
@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <atomic>
+#include <type_traits>
 
 #if UNITY_WIN
 #   include <windows.h>
@@ -20,6 +22,68 @@
 #   define strcpy_s strcpy
 #endif
 
+#if !UNITY_SPU && (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__))
+#   define UNITY_AUDIO_SSE 1
+#   include <emmintrin.h>
+#elif !UNITY_SPU && (defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON))
+#   define UNITY_AUDIO_NEON 1
+#   include <arm_neon.h>
+#endif
+
+// Minimal 4-lane float vector for the SIMD code in this file. Maps to SSE or NEON, or to plain scalar code on other targets.
+#if UNITY_AUDIO_SSE
+typedef __m128 UnityVec4;
+inline UnityVec4 Vec4Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Vec4Store(float* p, UnityVec4 v) { _mm_storeu_ps(p, v); }
+inline UnityVec4 Vec4Set1(float x) { return _mm_set1_ps(x); }
+inline UnityVec4 Vec4Add(UnityVec4 a, UnityVec4 b) { return _mm_add_ps(a, b); }
+inline UnityVec4 Vec4Sub(UnityVec4 a, UnityVec4 b) { return _mm_sub_ps(a, b); }
+inline UnityVec4 Vec4Mul(UnityVec4 a, UnityVec4 b) { return _mm_mul_ps(a, b); }
+inline UnityVec4 Vec4ShiftIn(UnityVec4 v, float x) { return _mm_move_ss(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 1, 0, 0)), _mm_set_ss(x)); } // { x, v0, v1, v2 }
+inline float Vec4Last(UnityVec4 v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+inline UnityVec4 Vec4LoadEven(const float* p) { return _mm_shuffle_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _MM_SHUFFLE(2, 0, 2, 0)); } // { p0, p2, p4, p6 }
+inline UnityVec4 Vec4LoadOdd(const float* p) { return _mm_shuffle_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _MM_SHUFFLE(3, 1, 3, 1)); } // { p1, p3, p5, p7 }
+inline UnityVec4 Vec4Abs(UnityVec4 v) { return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))); }
+inline UnityVec4 Vec4Max(UnityVec4 a, UnityVec4 b) { return _mm_max_ps(a, b); }
+inline UnityVec4 Vec4Min(UnityVec4 a, UnityVec4 b) { return _mm_min_ps(a, b); }
+inline float Vec4MaxAcross(UnityVec4 v) { v = _mm_max_ps(v, _mm_movehl_ps(v, v)); return _mm_cvtss_f32(_mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)))); }
+inline float Vec4SumAcross(UnityVec4 v) { v = _mm_add_ps(v, _mm_movehl_ps(v, v)); return _mm_cvtss_f32(_mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)))); }
+#elif UNITY_AUDIO_NEON
+typedef float32x4_t UnityVec4;
+inline UnityVec4 Vec4Load(const float* p) { return vld1q_f32(p); }
+inline void Vec4Store(float* p, UnityVec4 v) { vst1q_f32(p, v); }
+inline UnityVec4 Vec4Set1(float x) { return vdupq_n_f32(x); }
+inline UnityVec4 Vec4Add(UnityVec4 a, UnityVec4 b) { return vaddq_f32(a, b); }
+inline UnityVec4 Vec4Sub(UnityVec4 a, UnityVec4 b) { return vsubq_f32(a, b); }
+inline UnityVec4 Vec4Mul(UnityVec4 a, UnityVec4 b) { return vmulq_f32(a, b); }
+inline UnityVec4 Vec4ShiftIn(UnityVec4 v, float x) { return vextq_f32(vdupq_n_f32(x), v, 3); } // { x, v0, v1, v2 }
+inline float Vec4Last(UnityVec4 v) { return vgetq_lane_f32(v, 3); }
+inline UnityVec4 Vec4LoadEven(const float* p) { return vld2q_f32(p).val[0]; } // { p0, p2, p4, p6 }
+inline UnityVec4 Vec4LoadOdd(const float* p) { return vld2q_f32(p).val[1]; } // { p1, p3, p5, p7 }
+inline UnityVec4 Vec4Abs(UnityVec4 v) { return vabsq_f32(v); }
+inline UnityVec4 Vec4Max(UnityVec4 a, UnityVec4 b) { return vmaxq_f32(a, b); }
+inline UnityVec4 Vec4Min(UnityVec4 a, UnityVec4 b) { return vminq_f32(a, b); }
+inline float Vec4MaxAcross(UnityVec4 v) { float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v)); return vget_lane_f32(vpmax_f32(m, m), 0); }
+inline float Vec4SumAcross(UnityVec4 v) { float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v)); return vget_lane_f32(vpadd_f32(s, s), 0); }
+#else
+struct UnityVec4 { float x[4]; };
+inline UnityVec4 Vec4Load(const float* p) { UnityVec4 r; r.x[0] = p[0]; r.x[1] = p[1]; r.x[2] = p[2]; r.x[3] = p[3]; return r; }
+inline void Vec4Store(float* p, UnityVec4 v) { p[0] = v.x[0]; p[1] = v.x[1]; p[2] = v.x[2]; p[3] = v.x[3]; }
+inline UnityVec4 Vec4Set1(float x) { UnityVec4 r; r.x[0] = r.x[1] = r.x[2] = r.x[3] = x; return r; }
+inline UnityVec4 Vec4Add(UnityVec4 a, UnityVec4 b) { for (int i = 0; i < 4; i++) a.x[i] += b.x[i]; return a; }
+inline UnityVec4 Vec4Sub(UnityVec4 a, UnityVec4 b) { for (int i = 0; i < 4; i++) a.x[i] -= b.x[i]; return a; }
+inline UnityVec4 Vec4Mul(UnityVec4 a, UnityVec4 b) { for (int i = 0; i < 4; i++) a.x[i] *= b.x[i]; return a; }
+inline UnityVec4 Vec4ShiftIn(UnityVec4 v, float x) { UnityVec4 r; r.x[0] = x; r.x[1] = v.x[0]; r.x[2] = v.x[1]; r.x[3] = v.x[2]; return r; }
+inline float Vec4Last(UnityVec4 v) { return v.x[3]; }
+inline UnityVec4 Vec4LoadEven(const float* p) { UnityVec4 r; r.x[0] = p[0]; r.x[1] = p[2]; r.x[2] = p[4]; r.x[3] = p[6]; return r; }
+inline UnityVec4 Vec4LoadOdd(const float* p) { UnityVec4 r; r.x[0] = p[1]; r.x[1] = p[3]; r.x[2] = p[5]; r.x[3] = p[7]; return r; }
+inline UnityVec4 Vec4Abs(UnityVec4 v) { for (int i = 0; i < 4; i++) v.x[i] = fabsf(v.x[i]); return v; }
+inline UnityVec4 Vec4Max(UnityVec4 a, UnityVec4 b) { for (int i = 0; i < 4; i++) a.x[i] = (a.x[i] > b.x[i]) ? a.x[i] : b.x[i]; return a; }
+inline UnityVec4 Vec4Min(UnityVec4 a, UnityVec4 b) { for (int i = 0; i < 4; i++) a.x[i] = (a.x[i] < b.x[i]) ? a.x[i] : b.x[i]; return a; }
+inline float Vec4MaxAcross(UnityVec4 v) { float m = v.x[0]; for (int i = 1; i < 4; i++) m = (v.x[i] > m) ? v.x[i] : m; return m; }
+inline float Vec4SumAcross(UnityVec4 v) { return (v.x[0] + v.x[1]) + (v.x[2] + v.x[3]); }
+#endif
+
 typedef int (*InternalEffectDefinitionRegistrationCallback)(UnityAudioEffectDefinition& desc);
 
 const float kMaxSampleRate = 22050.0f;
@@ -125,6 +189,25 @@ public:
     static void Backward(UnityComplexNumber* data, int numsamples);
 };
 
+// FFT of one fixed power-of-two size for audio paths. The bit reversal and twiddle factors are worked out once on
+// construction, and the butterflies of each stage run through the dispatched FFTButterflies kernel. Same transforms as FFT.
+class FFTPlan
+{
+public:
+    FFTPlan(int numsamples);
+    ~FFTPlan();
+    void Forward(UnityComplexNumber* data) const;
+    void Backward(UnityComplexNumber* data) const;
+
+private:
+    FFTPlan(const FFTPlan&);
+    FFTPlan& operator=(const FFTPlan&);
+
+    int numsamples;
+    int* bitreverse;
+    UnityComplexNumber* twiddles; // Stage with butterflies j apart uses twiddles[j - 1] to twiddles[2 * j - 2]
+};
+
 class FFTAnalyzer : public FFT
 {
 public:
@@ -158,22 +241,87 @@ public:
     void Init(int _length);
     void ReadBuffer(float* buffer, int numsamplesTarget, int numsamplesSource, float offset);
 
+    // Scope view of long histories: instead of interpolating, every output pixel gets the min and max of the source
+    // samples it covers, so peaks don't alias away. The buffer receives (numsamplesTarget - 1) / 2 interleaved min/max
+    // pairs, oldest first, and the last sample holds the number of pairs written.
+    void ReadBufferMinMax(float* buffer, int numsamplesTarget, int numsamplesSource, float offset);
+
 public:
+    // Only one thread may feed the buffer. writeindex (the position of the newest sample) is published with release
+    // semantics after the samples are stored, so readers on other threads never see an index ahead of the data.
     inline void Feed(float sample)
     {
-        // Don't try to optimize this with ++
-        // The writeindex veriable may be read at the same time, so we don't want intermediate values indexing out of the array.
-        int w = writeindex + 1;
+        int w = writeindex.load(std::memory_order_relaxed) + 1;
         if (w == length)
             w = 0;
         data[w] = sample;
-        writeindex = w;
+        for (int level = 0; level < numlevels; level++)
+        {
+            // Blocks are written front to back, so the first sample of one starts its range afresh
+            const int shift = MINMAXSHIFT * (level + 1);
+            float* pair = minmax[level] + 2 * (w >> shift);
+            if ((w & ((1 << shift) - 1)) == 0)
+                pair[0] = pair[1] = sample;
+            else
+            {
+                pair[0] = (sample < pair[0]) ? sample : pair[0];
+                pair[1] = (sample > pair[1]) ? sample : pair[1];
+            }
+        }
+        writeindex.store(w, std::memory_order_release);
     }
 
+    // Feeds a block, taking every stride'th sample (e.g. 2 for one channel of interleaved stereo)
+    void Feed(const float* samples, int numsamples, int stride = 1);
+
+protected:
+    void UpdateMinMax(int i0, int i1);
+    void ReadMinMax(int i0, int i1, int level, float& minval, float& maxval) const;
+
 public:
+    // Min/max envelope for ReadBufferMinMax: level l holds interleaved min/max pairs of blocks of 16^(l + 1) samples.
+    // Only levels whose blocks fit into the history at least 8 times are kept, and Init rounds length up to whole blocks.
+    enum { MINMAXLEVELS = 4, MINMAXSHIFT = 4 };
+
     int length;
-    int writeindex;
+    std::atomic<int> writeindex;
     float* data;
+    int numlevels;
+    float* minmax[MINMAXLEVELS];
+};
+
+// Distribution of a quantity that one thread measures and others report on, such as a latency in milliseconds. Values
+// are counted in NUMBINS bins of binwidth, the last bin also taking everything beyond it; min, max and mean are exact.
+// Readers get a snapshot without locking that may be a few values behind. Only the measuring thread changes the
+// counts, so a reset is requested and carried out by the next Add.
+class LatencyHistogram
+{
+public:
+    enum { NUMBINS = 1024 };
+
+    LatencyHistogram(float _binwidth);
+
+    void Add(float value);
+    void RequestReset() { resetrequested.store(true, std::memory_order_release); }
+
+    unsigned int GetCount() const { return count.load(std::memory_order_acquire); }
+    unsigned int GetBin(int index) const { return bins[index].load(std::memory_order_relaxed); }
+    float GetBinWidth() const { return binwidth; }
+    float GetMin() const { return minvalue.load(std::memory_order_relaxed); }
+    float GetMax() const { return maxvalue.load(std::memory_order_relaxed); }
+    float GetMean() const;
+
+    // Center of the bin the given fraction (0..1) of the values fall below, clamped to the range seen
+    float GetPercentile(float fraction) const;
+
+protected:
+    float binwidth;
+    std::atomic<unsigned int> bins[NUMBINS];
+    std::atomic<unsigned int> count;
+    std::atomic<float> minvalue;
+    std::atomic<float> maxvalue;
+    std::atomic<double> sum;
+    std::atomic<bool> resetrequested;
 };
 
 template<const int _LENGTH, typename T = float>
@@ -232,6 +380,296 @@ public:
     }
 };
 
+enum SPSCRingBufferPolicy
+{
+    SPSCRingBufferPolicy_Partial,       // Write and Read transfer as much as fits or is available
+    SPSCRingBufferPolicy_AllOrNothing,  // Write and Read transfer everything that was asked for, or nothing
+    SPSCRingBufferPolicy_Overwrite      // Write always succeeds; a reader that gets lapped loses the oldest data
+};
+
+// Lock-free queue for exactly one producer thread and one consumer thread. Positions are free-running 32 bit counters
+// masked into the buffer (LENGTH must be a power of two), so a full buffer is told apart from an empty one without
+// wasting a slot. The producer publishes its position with release semantics after storing the data and the consumer
+// does the same after reading it, and each position sits on its own cache line so the two threads don't false-share.
+// Reserve/Commit and Peek/Skip expose the (at most two) contiguous regions for in-place access on either side.
+//
+// With the Overwrite policy the producer never waits for the consumer, so it may be storing over elements while the
+// consumer copies them. Like a seqlock, the producer announces how far it is about to write (writeclaim) before storing,
+// and the consumer checks after copying that nothing it copied was claimed in the meantime, and copies again if it was.
+// In-place Peek can't be checked that way and isn't available with that policy.
+template<const int _LENGTH, typename T = float, const SPSCRingBufferPolicy POLICY = SPSCRingBufferPolicy_Partial>
+class SPSCRingBuffer
+{
+public:
+    enum { LENGTH = _LENGTH, MASK = _LENGTH - 1, CACHELINESIZE = 64 };
+
+    static_assert(LENGTH > 0 && (LENGTH & MASK) == 0, "SPSCRingBuffer length must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCRingBuffer elements are copied with memcpy");
+
+    SPSCRingBuffer() : writepos(0), writeclaim(0), readpos(0) {}
+
+public:
+    // Producer side
+
+    inline unsigned int GetWritePos() const
+    {
+        return writepos.load(std::memory_order_relaxed);
+    }
+
+    inline int GetFreeSpace() const
+    {
+        int buffered = (int)(writepos.load(std::memory_order_relaxed) - readpos.load(std::memory_order_acquire));
+        return (buffered < LENGTH) ? (LENGTH - buffered) : 0;
+    }
+
+    // Hands out space for up to num elements. Returns how many were granted; nothing is visible to the consumer until Commit.
+    inline int Reserve(int num, T*& region1, int& num1, T*& region2, int& num2)
+    {
+        int granted = (POLICY == SPSCRingBufferPolicy_Overwrite) ? ((num < LENGTH) ? num : LENGTH) : Grant(num, GetFreeSpace());
+        unsigned int w = writepos.load(std::memory_order_relaxed);
+        Claim(w + (unsigned int)granted);
+        GetRegions(w, granted, region1, num1, region2, num2);
+        return granted;
+    }
+
+    inline void Commit(int num)
+    {
+        writepos.store(writepos.load(std::memory_order_relaxed) + (unsigned int)num, std::memory_order_release);
+    }
+
+    inline int Write(const T* src, int num)
+    {
+        // With the Overwrite policy only the newest LENGTH elements of an oversized write are kept
+        int skip = (POLICY == SPSCRingBufferPolicy_Overwrite && num > LENGTH) ? (num - LENGTH) : 0;
+        int granted = (POLICY == SPSCRingBufferPolicy_Overwrite) ? (num - skip) : Grant(num, GetFreeSpace());
+        unsigned int w = writepos.load(std::memory_order_relaxed) + (unsigned int)skip;
+        Claim(w + (unsigned int)granted);
+        T* region1; T* region2; int num1, num2;
+        GetRegions(w, granted, region1, num1, region2, num2);
+        memcpy(region1, src + skip, num1 * sizeof(T));
+        memcpy(region2, src + skip + num1, num2 * sizeof(T));
+        writepos.store(w + (unsigned int)granted, std::memory_order_release);
+        return skip + granted;
+    }
+
+public:
+    // Consumer side
+
+    inline unsigned int GetReadPos() const
+    {
+        return readpos.load(std::memory_order_relaxed);
+    }
+
+    // More than LENGTH means the producer lapped the consumer (Overwrite policy only); see SkipToNewest
+    inline int GetNumBuffered() const
+    {
+        return (int)(writepos.load(std::memory_order_acquire) - readpos.load(std::memory_order_relaxed));
+    }
+
+    // Exposes up to num of the oldest buffered elements in place. Returns how many; they stay queued until Skip.
+    inline int Peek(const T*& region1, int& num1, const T*& region2, int& num2, int num = LENGTH)
+    {
+        static_assert(POLICY != SPSCRingBufferPolicy_Overwrite, "The producer may overwrite elements peeked in place; use Read");
+        return PeekRegions(region1, num1, region2, num2, num);
+    }
+
+    inline bool Peek(T& val)
+    {
+        for (;;)
+        {
+            if (GetAvailable() == 0)
+                return false;
+            unsigned int r = readpos.load(std::memory_order_relaxed);
+            val = buffer[r & MASK];
+            if (IsIntact(r))
+                return true;
+        }
+    }
+
+    inline void Skip(int num)
+    {
+        readpos.store(readpos.load(std::memory_order_relaxed) + (unsigned int)num, std::memory_order_release);
+    }
+
+    inline int Read(T* dst, int num)
+    {
+        for (;;)
+        {
+            const T* region1; const T* region2; int num1, num2;
+            int granted = PeekRegions(region1, num1, region2, num2, num);
+            unsigned int r = readpos.load(std::memory_order_relaxed);
+            memcpy(dst, region1, num1 * sizeof(T));
+            memcpy(dst + num1, region2, num2 * sizeof(T));
+            if (IsIntact(r))
+            {
+                Skip(granted);
+                return granted;
+            }
+        }
+    }
+
+    inline bool Read(T& val)
+    {
+        if (!Peek(val))
+            return false;
+        Skip(1);
+        return true;
+    }
+
+    // Drops everything but the newest num elements
+    inline void SkipToNewest(int num)
+    {
+        unsigned int w = writepos.load(std::memory_order_acquire);
+        if ((int)(w - readpos.load(std::memory_order_relaxed)) > num)
+            readpos.store(w - (unsigned int)num, std::memory_order_release);
+    }
+
+public:
+    // Only safe while neither the producer nor the consumer is using the buffer
+    inline void Clear()
+    {
+        writepos.store(0, std::memory_order_relaxed);
+        writeclaim.store(0, std::memory_order_relaxed);
+        readpos.store(0, std::memory_order_relaxed);
+    }
+
+protected:
+    inline int Grant(int requested, int available) const
+    {
+        if (requested <= available)
+            return requested;
+        return (POLICY == SPSCRingBufferPolicy_AllOrNothing) ? 0 : available;
+    }
+
+    // A lapped consumer (Overwrite policy) first jumps to the oldest element that the producer isn't writing over
+    inline int GetAvailable()
+    {
+        if (POLICY != SPSCRingBufferPolicy_Overwrite)
+            return GetNumBuffered();
+        unsigned int oldest = writeclaim.load(std::memory_order_acquire) - (unsigned int)LENGTH;
+        if ((int)(oldest - readpos.load(std::memory_order_relaxed)) > 0)
+            readpos.store(oldest, std::memory_order_release);
+        // A write larger than the buffer claims past elements it skips, so the consumer can land ahead of the producer
+        int buffered = GetNumBuffered();
+        if (buffered < 0)
+            return 0;
+        return (buffered < LENGTH) ? buffered : LENGTH;
+    }
+
+    inline int PeekRegions(const T*& region1, int& num1, const T*& region2, int& num2, int num)
+    {
+        int granted = Grant(num, GetAvailable());
+        T* r1; T* r2;
+        GetRegions(readpos.load(std::memory_order_relaxed), granted, r1, num1, r2, num2);
+        region1 = r1;
+        region2 = r2;
+        return granted;
+    }
+
+    // Overwrite policy: published before the producer stores anything up to end
+    inline void Claim(unsigned int end)
+    {
+        if (POLICY != SPSCRingBufferPolicy_Overwrite)
+            return;
+        writeclaim.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Overwrite policy: whether the elements copied from pos on were still intact once copied. The element at pos is
+    // stored over by the one LENGTH later, so nothing may have been claimed past pos + LENGTH.
+    inline bool IsIntact(unsigned int pos) const
+    {
+        if (POLICY != SPSCRingBufferPolicy_Overwrite)
+            return true;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return (int)(writeclaim.load(std::memory_order_relaxed) - pos) <= LENGTH;
+    }
+
+    inline void GetRegions(unsigned int pos, int num, T*& region1, int& num1, T*& region2, int& num2)
+    {
+        int offset = (int)(pos & MASK);
+        num1 = (num < LENGTH - offset) ? num : (LENGTH - offset);
+        num2 = num - num1;
+        region1 = buffer + offset;
+        region2 = buffer;
+    }
+
+protected:
+    T buffer[LENGTH];
+    char pad0[CACHELINESIZE];
+    std::atomic<unsigned int> writepos;
+    std::atomic<unsigned int> writeclaim;
+    char pad1[CACHELINESIZE - 2 * sizeof(std::atomic<unsigned int>)];
+    std::atomic<unsigned int> readpos;
+    char pad2[CACHELINESIZE - sizeof(std::atomic<unsigned int>)];
+};
+
+// Bulk transfer helpers for circular sample buffers. A ring transfer is split into at most two contiguous spans,
+// and each span is copied with a fused source stride (e.g. 2 to pick one channel out of interleaved stereo) and
+// a linear gain ramp that goes from gain0 at the first sample towards gain1 at the end of the transfer.
+// numsamples must not exceed ringlength. The ring functions return the ring position following the transfer.
+// If peak is not NULL, it receives the absolute peak level of the samples written, metered in the same pass.
+void CopyScaled(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1, float* peak = NULL);
+int RingWrite(float* ring, int ringlength, int writepos, const float* src, int srcstride, int numsamples, float gain0, float gain1, float* peak = NULL);
+int RingRead(float* dst, const float* ring, int ringlength, int readpos, int numsamples, float gain0, float gain1);
+int RingFill(float* ring, int ringlength, int writepos, float value, int numsamples);
+
+// Kernels built for several instruction sets. The best variant the machine supports is picked once at load, via CPUID
+// on x86/x64 (SSE2 is the baseline there, AVX2 is used when the CPU and OS support it) and auxv on 32-bit ARM Linux.
+// The functions above go through this table; call GetAudioKernels() directly for the rest.
+enum UnityAudioInstructionSet
+{
+    UnityAudioInstructionSet_Scalar,
+    UnityAudioInstructionSet_SSE2,
+    UnityAudioInstructionSet_AVX2,
+    UnityAudioInstructionSet_NEON
+};
+
+struct UnityAudioKernels
+{
+    UnityAudioInstructionSet instructionset;
+    const char* name;
+
+    // Span copy with source stride and linear gain ramp as in CopyScaled. The metered variant returns the output's peak level,
+    // the plain one returns 0.
+    float (*CopyScaled)(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1);
+    float (*CopyScaledMetered)(float* dst, const float* src, int srcstride, int numsamples, float gain0, float gain1);
+
+    // Absolute peak level of numsamples samples
+    float (*Peak)(const float* src, int numsamples);
+
+    // Widens [minval, maxval] to cover numsamples samples
+    void (*MinMax)(const float* src, int numsamples, float& minval, float& maxval);
+
+    // Adds src to dst with a linear gain ramp from gain0 to gain1
+    void (*MixScaled)(float* dst, const float* src, int numsamples, float gain0, float gain1);
+
+    // Sums numchannels interleaved channels into a mono signal, scaled by gain
+    void (*Downmix)(float* dst, const float* src, int numchannels, int numsamples, float gain);
+
+    // dst[n] = a[n] * b[n] over two spectra, dst may alias a or b
+    void (*ComplexMultiply)(UnityComplexNumber* dst, const UnityComplexNumber* a, const UnityComplexNumber* b, int numsamples);
+
+    // Radix-2 butterflies across two spans: t = w[n] * b[n], then b[n] = a[n] - t and a[n] = a[n] + t
+    void (*FFTButterflies)(UnityComplexNumber* a, UnityComplexNumber* b, const UnityComplexNumber* w, int numsamples);
+};
+
+const UnityAudioKernels& GetAudioKernels();
+
+// One variant by instruction set, for tests and benchmarks. NULL when it isn't built in or the machine can't run it.
+const UnityAudioKernels* GetAudioKernels(UnityAudioInstructionSet instructionset);
+
+// Turns on flush-to-zero and denormals-are-zero for the calling thread while in scope, so that decaying filter and
+// reverb tails don't fall into slow denormal arithmetic. The previous floating point mode is restored on exit.
+class DenormalGuard
+{
+public:
+    DenormalGuard();
+    ~DenormalGuard();
+protected:
+    unsigned int previousmode;
+};
+
 class BiquadFilter
 {
 public:
@@ -270,64 +708,302 @@ protected:
 
 void BiquadFilter::SetupPeaking(float cutoff, float samplerate, float gain, float Q)
 {
-    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), a0;
+    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), cosw0 = cosf(w0), a0;
     b0 = 1.0f + alpha * A;
-    b1 = -2.0f * cosf(w0);
+    b1 = -2.0f * cosw0;
     b2 = 1.0f - alpha * A;
     a0 = 1.0f + alpha / A;
-    a1 = -2.0f * cosf(w0);
+    a1 = -2.0f * cosw0;
     a2 = 1.0f - alpha / A;
     float inv_a0 = 1.0f / a0; a1 *= inv_a0; a2 *= inv_a0; b0 *= inv_a0; b1 *= inv_a0; b2 *= inv_a0;
 }
 
 void BiquadFilter::SetupLowShelf(float cutoff, float samplerate, float gain, float Q)
 {
-    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), a0;
-    b0 =          A * ((A + 1.0f) - (A - 1.0f) * cosf(w0) + 2.0f * sqrtf(A) * alpha);
-    b1 =   2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosf(w0));
-    b2 =          A * ((A + 1.0f) - (A - 1.0f) * cosf(w0) - 2.0f * sqrtf(A) * alpha);
-    a0 =               (A + 1.0f) + (A - 1.0f) * cosf(w0) + 2.0f * sqrtf(A) * alpha;
-    a1 =  -2.0f     * ((A - 1.0f) + (A + 1.0f) * cosf(w0));
-    a2 =               (A + 1.0f) + (A - 1.0f) * cosf(w0) - 2.0f * sqrtf(A) * alpha;
+    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), cosw0 = cosf(w0), beta = 2.0f * sqrtf(A) * alpha, a0;
+    b0 =          A * ((A + 1.0f) - (A - 1.0f) * cosw0 + beta);
+    b1 =   2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosw0);
+    b2 =          A * ((A + 1.0f) - (A - 1.0f) * cosw0 - beta);
+    a0 =               (A + 1.0f) + (A - 1.0f) * cosw0 + beta;
+    a1 =  -2.0f     * ((A - 1.0f) + (A + 1.0f) * cosw0);
+    a2 =               (A + 1.0f) + (A - 1.0f) * cosw0 - beta;
     float inv_a0 = 1.0f / a0; a1 *= inv_a0; a2 *= inv_a0; b0 *= inv_a0; b1 *= inv_a0; b2 *= inv_a0;
 }
 
 void BiquadFilter::SetupHighShelf(float cutoff, float samplerate, float gain, float Q)
 {
-    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), a0;
-    b0 =          A * ((A + 1.0f) + (A - 1.0f) * cosf(w0) + 2.0f * sqrtf(A) * alpha);
-    b1 =  -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosf(w0));
-    b2 =          A * ((A + 1.0f) + (A - 1.0f) * cosf(w0) - 2.0f * sqrtf(A) * alpha);
-    a0 =               (A + 1.0f) - (A - 1.0f) * cosf(w0) + 2.0f * sqrtf(A) * alpha;
-    a1 =   2.0f     * ((A - 1.0f) - (A + 1.0f) * cosf(w0));
-    a2 =               (A + 1.0f) - (A - 1.0f) * cosf(w0) - 2.0f * sqrtf(A) * alpha;
+    float w0 = 2.0f * kPI * cutoff / samplerate, A = powf(10.0f, gain * 0.025f), alpha = sinf(w0) / (2.0f * Q), cosw0 = cosf(w0), beta = 2.0f * sqrtf(A) * alpha, a0;
+    b0 =          A * ((A + 1.0f) + (A - 1.0f) * cosw0 + beta);
+    b1 =  -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosw0);
+    b2 =          A * ((A + 1.0f) + (A - 1.0f) * cosw0 - beta);
+    a0 =               (A + 1.0f) - (A - 1.0f) * cosw0 + beta;
+    a1 =   2.0f     * ((A - 1.0f) - (A + 1.0f) * cosw0);
+    a2 =               (A + 1.0f) - (A - 1.0f) * cosw0 - beta;
     float inv_a0 = 1.0f / a0; a1 *= inv_a0; a2 *= inv_a0; b0 *= inv_a0; b1 *= inv_a0; b2 *= inv_a0;
 }
 
 void BiquadFilter::SetupLowpass(float cutoff, float samplerate, float Q)
 {
-    float w0 = 2.0f * kPI * cutoff / samplerate, alpha = sinf(w0) / (2.0f * Q), a0;
-    b0 =  (1.0f - cosf(w0)) * 0.5f;
-    b1 =   1.0f - cosf(w0);
-    b2 =  (1.0f - cosf(w0)) * 0.5f;
+    float w0 = 2.0f * kPI * cutoff / samplerate, alpha = sinf(w0) / (2.0f * Q), cosw0 = cosf(w0), a0;
+    b0 =  (1.0f - cosw0) * 0.5f;
+    b1 =   1.0f - cosw0;
+    b2 =  (1.0f - cosw0) * 0.5f;
     a0 =   1.0f + alpha;
-    a1 =  -2.0f * cosf(w0);
+    a1 =  -2.0f * cosw0;
     a2 =   1.0f - alpha;
     float inv_a0 = 1.0f / a0; a1 *= inv_a0; a2 *= inv_a0; b0 *= inv_a0; b1 *= inv_a0; b2 *= inv_a0;
 }
 
 void BiquadFilter::SetupHighpass(float cutoff, float samplerate, float Q)
 {
-    float w0 = 2.0f * kPI * cutoff / samplerate, alpha = sinf(w0) / (2.0f * Q), a0;
-    b0 =  (1.0f + cosf(w0)) * 0.5f;
-    b1 = -(1.0f + cosf(w0));
-    b2 =  (1.0f + cosf(w0)) * 0.5f;
+    float w0 = 2.0f * kPI * cutoff / samplerate, alpha = sinf(w0) / (2.0f * Q), cosw0 = cosf(w0), a0;
+    b0 =  (1.0f + cosw0) * 0.5f;
+    b1 = -(1.0f + cosw0);
+    b2 =  (1.0f + cosw0) * 0.5f;
     a0 =   1.0f + alpha;
-    a1 =  -2.0f * cosf(w0);
+    a1 =  -2.0f * cosw0;
     a2 =   1.0f - alpha;
     float inv_a0 = 1.0f / a0; a1 *= inv_a0; a2 *= inv_a0; b0 *= inv_a0; b1 *= inv_a0; b2 *= inv_a0;
 }
 
+// Table lookups with linear interpolation for the fast coefficient path of BiquadFilterBank.
+// BiquadTableSinCos covers w0 in [0, pi], BiquadTableShelfGain returns 10^(gain/40) for gains in [-96, 48] dB.
+void BiquadTableSinCos(float w0, float& sinw0, float& cosw0);
+float BiquadTableShelfGain(float gain);
+
+// A bank of NUMFILTERS (4, 8 or 16) biquads in structure-of-arrays layout, so that all filters advance in lockstep on SIMD lanes.
+//
+// ProcessParallel: every lane filters its own voice. Data is interleaved by lane, i.e. data[n * NUMFILTERS + lane].
+// ProcessCascade: the lanes are consecutive sections applied to a single voice. The sections are pipelined one sample apart
+// so they can still run side by side, which delays the output by NUMFILTERS - 1 samples.
+//
+// Coefficients set with SetTargetCoeffs or the Setup*Fast functions are approached linearly over the next processed block
+// to avoid zipper noise; SetCoeffs changes them immediately. Call Init before using the bank.
+template<const int _NUMFILTERS>
+class BiquadFilterBank
+{
+public:
+    enum { NUMFILTERS = _NUMFILTERS, NUMVECTORS = _NUMFILTERS / 4 };
+    static_assert(NUMFILTERS == 4 || NUMFILTERS == 8 || NUMFILTERS == 16, "BiquadFilterBank holds 4, 8 or 16 filters");
+
+    void Init()
+    {
+        for (int i = 0; i < NUMFILTERS; i++)
+            SetCoeffs(i, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        ramping = false;
+        Clear();
+    }
+
+    void Clear()
+    {
+        memset(z1, 0, sizeof(z1));
+        memset(z2, 0, sizeof(z2));
+        memset(pipe, 0, sizeof(pipe));
+    }
+
+    inline void SetCoeffs(int lane, float _b0, float _b1, float _b2, float _a1, float _a2)
+    {
+        b0[lane] = t_b0[lane] = _b0;
+        b1[lane] = t_b1[lane] = _b1;
+        b2[lane] = t_b2[lane] = _b2;
+        a1[lane] = t_a1[lane] = _a1;
+        a2[lane] = t_a2[lane] = _a2;
+    }
+
+    inline void SetTargetCoeffs(int lane, float _b0, float _b1, float _b2, float _a1, float _a2)
+    {
+        t_b0[lane] = _b0;
+        t_b1[lane] = _b1;
+        t_b2[lane] = _b2;
+        t_a1[lane] = _a1;
+        t_a2[lane] = _a2;
+        ramping = true;
+    }
+
+    inline void SetTargetFilter(int lane, BiquadFilter& filter)
+    {
+        float c[5], *p = c;
+        filter.StoreCoeffs(p);
+        SetTargetCoeffs(lane, c[2], c[1], c[0], c[4], c[3]);
+    }
+
+    inline void SetupLowpassFast(int lane, float cutoff, float samplerate, float Q)
+    {
+        float sinw0, cosw0;
+        BiquadTableSinCos(2.0f * kPI * cutoff / samplerate, sinw0, cosw0);
+        float alpha = sinw0 / (2.0f * Q), inv_a0 = 1.0f / (1.0f + alpha);
+        float b = (1.0f - cosw0) * inv_a0;
+        SetTargetCoeffs(lane, 0.5f * b, b, 0.5f * b, -2.0f * cosw0 * inv_a0, (1.0f - alpha) * inv_a0);
+    }
+
+    inline void SetupHighpassFast(int lane, float cutoff, float samplerate, float Q)
+    {
+        float sinw0, cosw0;
+        BiquadTableSinCos(2.0f * kPI * cutoff / samplerate, sinw0, cosw0);
+        float alpha = sinw0 / (2.0f * Q), inv_a0 = 1.0f / (1.0f + alpha);
+        float b = (1.0f + cosw0) * inv_a0;
+        SetTargetCoeffs(lane, 0.5f * b, -b, 0.5f * b, -2.0f * cosw0 * inv_a0, (1.0f - alpha) * inv_a0);
+    }
+
+    inline void SetupHighShelfFast(int lane, float cutoff, float samplerate, float gain, float Q)
+    {
+        float sinw0, cosw0;
+        BiquadTableSinCos(2.0f * kPI * cutoff / samplerate, sinw0, cosw0);
+        float A = BiquadTableShelfGain(gain), alpha = sinw0 / (2.0f * Q), beta = 2.0f * sqrtf(A) * alpha;
+        float inv_a0 = 1.0f / ((A + 1.0f) - (A - 1.0f) * cosw0 + beta);
+        SetTargetCoeffs(lane,
+            A * ((A + 1.0f) + (A - 1.0f) * cosw0 + beta) * inv_a0,
+            -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosw0) * inv_a0,
+            A * ((A + 1.0f) + (A - 1.0f) * cosw0 - beta) * inv_a0,
+            2.0f * ((A - 1.0f) - (A + 1.0f) * cosw0) * inv_a0,
+            ((A + 1.0f) - (A - 1.0f) * cosw0 - beta) * inv_a0);
+    }
+
+    void ProcessParallel(float* data, int numsamples)
+    {
+        if (numsamples <= 0)
+            return;
+        const UnityVec4 rampscale = Vec4Set1(ramping ? 1.0f / (float)numsamples : 0.0f);
+        for (int v = 0; v < NUMVECTORS; v++)
+        {
+            const int o = v * 4;
+            UnityVec4 vb0 = Vec4Load(b0 + o), vb1 = Vec4Load(b1 + o), vb2 = Vec4Load(b2 + o), va1 = Vec4Load(a1 + o), va2 = Vec4Load(a2 + o);
+            UnityVec4 db0 = Vec4Mul(Vec4Sub(Vec4Load(t_b0 + o), vb0), rampscale);
+            UnityVec4 db1 = Vec4Mul(Vec4Sub(Vec4Load(t_b1 + o), vb1), rampscale);
+            UnityVec4 db2 = Vec4Mul(Vec4Sub(Vec4Load(t_b2 + o), vb2), rampscale);
+            UnityVec4 da1 = Vec4Mul(Vec4Sub(Vec4Load(t_a1 + o), va1), rampscale);
+            UnityVec4 da2 = Vec4Mul(Vec4Sub(Vec4Load(t_a2 + o), va2), rampscale);
+            UnityVec4 vz1 = Vec4Load(z1 + o), vz2 = Vec4Load(z2 + o);
+            float* p = data + o;
+            for (int n = 0; n < numsamples; n++)
+            {
+                UnityVec4 iir = Vec4Sub(Vec4Sub(Vec4Load(p), Vec4Mul(va1, vz1)), Vec4Mul(va2, vz2));
+                UnityVec4 fir = Vec4Add(Vec4Add(Vec4Mul(vb0, iir), Vec4Mul(vb1, vz1)), Vec4Mul(vb2, vz2));
+                vz2 = vz1;
+                vz1 = iir;
+                Vec4Store(p, fir);
+                p += NUMFILTERS;
+                if (ramping)
+                {
+                    vb0 = Vec4Add(vb0, db0); vb1 = Vec4Add(vb1, db1); vb2 = Vec4Add(vb2, db2);
+                    va1 = Vec4Add(va1, da1); va2 = Vec4Add(va2, da2);
+                }
+            }
+            Vec4Store(z1 + o, vz1);
+            Vec4Store(z2 + o, vz2);
+        }
+        FinishRamp();
+    }
+
+    void ProcessCascade(float* data, int numsamples)
+    {
+        if (numsamples <= 0)
+            return;
+        const UnityVec4 rampscale = Vec4Set1(ramping ? 1.0f / (float)numsamples : 0.0f);
+        UnityVec4 vb0[NUMVECTORS], vb1[NUMVECTORS], vb2[NUMVECTORS], va1[NUMVECTORS], va2[NUMVECTORS];
+        UnityVec4 db0[NUMVECTORS], db1[NUMVECTORS], db2[NUMVECTORS], da1[NUMVECTORS], da2[NUMVECTORS];
+        UnityVec4 vz1[NUMVECTORS], vz2[NUMVECTORS], vy[NUMVECTORS];
+        for (int v = 0; v < NUMVECTORS; v++)
+        {
+            const int o = v * 4;
+            vb0[v] = Vec4Load(b0 + o); vb1[v] = Vec4Load(b1 + o); vb2[v] = Vec4Load(b2 + o); va1[v] = Vec4Load(a1 + o); va2[v] = Vec4Load(a2 + o);
+            db0[v] = Vec4Mul(Vec4Sub(Vec4Load(t_b0 + o), vb0[v]), rampscale);
+            db1[v] = Vec4Mul(Vec4Sub(Vec4Load(t_b1 + o), vb1[v]), rampscale);
+            db2[v] = Vec4Mul(Vec4Sub(Vec4Load(t_b2 + o), vb2[v]), rampscale);
+            da1[v] = Vec4Mul(Vec4Sub(Vec4Load(t_a1 + o), va1[v]), rampscale);
+            da2[v] = Vec4Mul(Vec4Sub(Vec4Load(t_a2 + o), va2[v]), rampscale);
+            vz1[v] = Vec4Load(z1 + o); vz2[v] = Vec4Load(z2 + o); vy[v] = Vec4Load(pipe + o);
+        }
+        for (int n = 0; n < numsamples; n++)
+        {
+            // Each section takes the output its predecessor produced on the previous step; section 0 takes the new input sample
+            float carry = data[n];
+            for (int v = 0; v < NUMVECTORS; v++)
+            {
+                float nextcarry = Vec4Last(vy[v]);
+                UnityVec4 x = Vec4ShiftIn(vy[v], carry);
+                carry = nextcarry;
+                UnityVec4 iir = Vec4Sub(Vec4Sub(x, Vec4Mul(va1[v], vz1[v])), Vec4Mul(va2[v], vz2[v]));
+                vy[v] = Vec4Add(Vec4Add(Vec4Mul(vb0[v], iir), Vec4Mul(vb1[v], vz1[v])), Vec4Mul(vb2[v], vz2[v]));
+                vz2[v] = vz1[v];
+                vz1[v] = iir;
+                if (ramping)
+                {
+                    vb0[v] = Vec4Add(vb0[v], db0[v]); vb1[v] = Vec4Add(vb1[v], db1[v]); vb2[v] = Vec4Add(vb2[v], db2[v]);
+                    va1[v] = Vec4Add(va1[v], da1[v]); va2[v] = Vec4Add(va2[v], da2[v]);
+                }
+            }
+            data[n] = Vec4Last(vy[NUMVECTORS - 1]);
+        }
+        for (int v = 0; v < NUMVECTORS; v++)
+        {
+            Vec4Store(z1 + v * 4, vz1[v]);
+            Vec4Store(z2 + v * 4, vz2[v]);
+            Vec4Store(pipe + v * 4, vy[v]);
+        }
+        FinishRamp();
+    }
+
+protected:
+    inline void FinishRamp()
+    {
+        if (!ramping)
+            return;
+        // Land exactly on the targets rather than on the accumulated increments
+        memcpy(b0, t_b0, sizeof(b0));
+        memcpy(b1, t_b1, sizeof(b1));
+        memcpy(b2, t_b2, sizeof(b2));
+        memcpy(a1, t_a1, sizeof(a1));
+        memcpy(a2, t_a2, sizeof(a2));
+        ramping = false;
+    }
+
+protected:
+    float b0[NUMFILTERS], b1[NUMFILTERS], b2[NUMFILTERS], a1[NUMFILTERS], a2[NUMFILTERS];
+    float t_b0[NUMFILTERS], t_b1[NUMFILTERS], t_b2[NUMFILTERS], t_a1[NUMFILTERS], t_a2[NUMFILTERS];
+    float z1[NUMFILTERS], z2[NUMFILTERS];
+    float pipe[NUMFILTERS];
+    bool ramping;
+};
+
+// Layered pairwise VBAP. Speakers are grouped into horizontal layers by elevation. Within a layer a source is panned
+// between the two speakers that bracket its azimuth, and between the layers above and below it by elevation, with
+// constant power throughout. Speaker directions are given in degrees, azimuth counter-clockwise from the front (so
+// left is positive) and elevation upwards. The pair search evaluates four speaker pairs at a time.
+class VBAPPanner
+{
+public:
+    enum { MAXSPEAKERS = 32, MAXLAYERS = 4 };
+
+    void Init(const float* azimuths, const float* elevations, int numspeakers);
+
+    // Fills gains[0 .. numspeakers - 1] for a source in the given direction (which doesn't need to be normalized)
+    void ComputeGains(float front, float left, float up, float* gains) const;
+
+    inline int GetNumSpeakers() const { return numspeakers; }
+
+protected:
+    struct Layer
+    {
+        float elevation;
+        int numspeakers;
+        int numpairs; // rounded up to a multiple of 4, the padding pairs are never picked
+        int speakers[MAXSPEAKERS];
+        float azimuths[MAXSPEAKERS];
+
+        // Inverted speaker pair matrices: the gains of pair k for the unit vector (x, y) are
+        // g1 = x * i00[k] + y * i10[k] and g2 = x * i01[k] + y * i11[k]
+        float i00[MAXSPEAKERS], i01[MAXSPEAKERS], i10[MAXSPEAKERS], i11[MAXSPEAKERS];
+        float bias[MAXSPEAKERS];
+    };
+
+    void PanLayer(const Layer& layer, float front, float left, float horizontal, float scale, float* gains) const;
+
+    int numspeakers;
+    int numlayers;
+    Layer layers[MAXLAYERS];
+};
+
 class Random
 {
 public:
@@ -351,23 +1027,43 @@ protected:
     unsigned long seed;
 };
 
+// Lock for the short critical sections audio threads share. Taking a free lock is a single compare-and-swap, with no
+// call into the OS. A contended Lock spins for up to SPINCOUNT rounds in case the holder is about to leave, and only then
+// parks the thread on the lock word (WaitOnAddress on Windows, a futex on Linux, yielding elsewhere) until Unlock wakes
+// it. It is not recursive: a thread that locks it twice deadlocks.
 class AudioMutex
 {
 public:
-    AudioMutex();
-    ~AudioMutex();
+    enum { SPINCOUNT = 100 };
+
+    AudioMutex() : state(0) {}
 public:
-    bool TryLock();
-    void Lock();
-    void Unlock();
+    inline bool TryLock()
+    {
+        int expected = 0;
+        return state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    inline void Lock()
+    {
+        if (!TryLock())
+            LockContended();
+    }
+
+    inline void Unlock()
+    {
+        if (state.exchange(0, std::memory_order_release) == CONTENDED)
+            Wake();
+    }
 protected:
-#if UNITY_WIN
-    CRITICAL_SECTION crit_sec;
-#else
-# if !UNITY_SPU
-    pthread_mutex_t mutex;
-# endif
-#endif
+    // 0 is free; CONTENDED means there may be threads parked that Unlock has to wake
+    enum { LOCKED = 1, CONTENDED = 2 };
+
+    void LockContended();
+    void Park();
+    void Wake();
+
+    std::atomic<int> state;
 };
 
 class MutexScopeLock
@@ -379,6 +1075,18 @@ protected:
     AudioMutex* mutex;
 };
 
+// Takes the lock only if it is free right now, for an audio thread that would rather skip optional work than wait:
+// check IsLocked before doing the work.
+class MutexScopeTryLock
+{
+public:
+    MutexScopeTryLock(AudioMutex& _mutex) : mutex(_mutex.TryLock() ? &_mutex : NULL) {}
+    ~MutexScopeTryLock() { if (mutex != NULL) mutex->Unlock(); }
+    bool IsLocked() const { return mutex != NULL; }
+protected:
+    AudioMutex* mutex;
+};
+
 void RegisterParameter(
     UnityAudioEffectDefinition& desc,
     const char* name,
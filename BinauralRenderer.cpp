@@ -0,0 +1,227 @@
+#include "BinauralRenderer.h"
+
+namespace MSHRTFSpatializer
+{
+	// Shared by all voices; transforms run on the audio thread, so the twiddles are worked out at load
+	static const FFTPlan g_BinauralFFT(BINAURAL_FFT_SIZE);
+
+	BinauralVoice* BinauralVoice::Create(const HrirDatabase* p_Database)
+	{
+		if (p_Database->GetLength() > HRIR_MAX_LENGTH)
+		{
+			return nullptr;
+		}
+
+		BinauralVoice* p_Voice = new BinauralVoice;
+		p_Voice->p_Database = p_Database;
+		p_Voice->m_Active = true;
+		p_Voice->Reset();
+		return p_Voice;
+	}
+
+	void BinauralVoice::Reset()
+	{
+		// A gated source is reset on every block, so only clear what was used since the last reset
+		if (!m_Active)
+		{
+			return;
+		}
+
+		memset(m_Overlap, 0, sizeof(m_Overlap));
+		memset(m_DelayLines, 0, sizeof(m_DelayLines));
+		m_DelayWrite = 0;
+		m_HasDirection = false;
+		m_Active = false;
+	}
+
+	bool BinauralVoice::UpdateDirection(float X, float Y, float Z)
+	{
+		// A source right on the listener keeps the direction it had, or starts out in front
+		float Length = sqrtf(X * X + Y * Y + Z * Z);
+		if (Length < 1e-6f)
+		{
+			if (m_HasDirection)
+			{
+				return false;
+			}
+
+			X = 0.0f;
+			Y = 0.0f;
+			Z = 1.0f;
+			Length = 1.0f;
+		}
+
+		X /= Length;
+		Y /= Length;
+		Z /= Length;
+		if (m_HasDirection && X * m_DirX + Y * m_DirY + Z * m_DirZ > BINAURAL_UPDATE_COS)
+		{
+			return false;
+		}
+
+		// SOFA angles: azimuth counterclockwise from the front, elevation up from the horizontal plane
+		float Azimuth = atan2f(-X, Z) * (180.0f / kPI);
+		float Elevation = atan2f(Y, sqrtf(X * X + Z * Z)) * (180.0f / kPI);
+
+		int Next = 1 - m_Current;
+		uint32_t ResponseLength = p_Database->GetLength();
+		p_Database->Interpolate(Azimuth, Elevation, m_Responses[0], m_Responses[1], &m_Delays[Next][0], &m_Delays[Next][1]);
+
+		UnityComplexNumber* p_Filter = m_Filters[Next];
+		for (uint32_t n = 0; n < ResponseLength; n++)
+		{
+			p_Filter[n].Set(m_Responses[0][n], m_Responses[1][n]);
+		}
+		for (uint32_t n = ResponseLength; n < BINAURAL_FFT_SIZE; n++)
+		{
+			p_Filter[n].Set(0.0f, 0.0f);
+		}
+		g_BinauralFFT.Forward(p_Filter);
+
+		// The first direction after a reset has nothing to crossfade from
+		bool Crossfade = m_HasDirection;
+		if (!Crossfade)
+		{
+			m_Delays[m_Current][0] = m_Delays[Next][0];
+			m_Delays[m_Current][1] = m_Delays[Next][1];
+		}
+
+		m_Current = Next;
+		m_HasDirection = true;
+		m_DirX = X;
+		m_DirY = Y;
+		m_DirZ = Z;
+		return Crossfade;
+	}
+
+	void BinauralVoice::Convolve(uint32_t Count, bool Crossfade)
+	{
+		UnityComplexNumber* p_Work = m_Work;
+		const UnityComplexNumber* p_Current = m_Filters[m_Current];
+
+		if (!Crossfade)
+		{
+			// The input is real, so one complex product with the packed filter gives left + j right
+			for (uint32_t n = 0; n < Count; n++)
+			{
+				p_Work[n].Set(m_Input[n], 0.0f);
+			}
+			memset(p_Work + Count, 0, (BINAURAL_FFT_SIZE - Count) * sizeof(UnityComplexNumber));
+			g_BinauralFFT.Forward(p_Work);
+			GetAudioKernels().ComplexMultiply(p_Work, p_Work, p_Current, BINAURAL_FFT_SIZE);
+		}
+		else
+		{
+			// The chunk faded out goes through the old filter and faded in through the new one. Both halves go through
+			// one FFT, as the real and imaginary parts, and are told apart by the symmetry of the spectra of real signals.
+			const UnityComplexNumber* p_Previous = m_Filters[1 - m_Current];
+			float FadeStep = 1.0f / (float)Count;
+			for (uint32_t n = 0; n < Count; n++)
+			{
+				float Fade = ((float)n + 0.5f) * FadeStep;
+				p_Work[n].Set(m_Input[n] * (1.0f - Fade), m_Input[n] * Fade);
+			}
+			memset(p_Work + Count, 0, (BINAURAL_FFT_SIZE - Count) * sizeof(UnityComplexNumber));
+			g_BinauralFFT.Forward(p_Work);
+
+			for (uint32_t k = 0; k <= BINAURAL_FFT_SIZE / 2; k++)
+			{
+				uint32_t Mirror = (BINAURAL_FFT_SIZE - k) & (BINAURAL_FFT_SIZE - 1);
+				UnityComplexNumber A = p_Work[k];
+				UnityComplexNumber B = p_Work[Mirror];
+
+				// Out = (A + conj(B)) / 2 and In = (A - conj(B)) / 2j at k, and their conjugates at the mirror bin
+				UnityComplexNumber Out, In, Product;
+				Out.Set(0.5f * (A.re + B.re), 0.5f * (A.im - B.im));
+				In.Set(0.5f * (A.im + B.im), 0.5f * (B.re - A.re));
+				UnityComplexNumber::Mul(Out, p_Previous[k], p_Work[k]);
+				UnityComplexNumber::Mul(In, p_Current[k], Product);
+				UnityComplexNumber::Add(p_Work[k], Product, p_Work[k]);
+
+				if (Mirror != k)
+				{
+					Out.im = -Out.im;
+					In.im = -In.im;
+					UnityComplexNumber::Mul(Out, p_Previous[Mirror], p_Work[Mirror]);
+					UnityComplexNumber::Mul(In, p_Current[Mirror], Product);
+					UnityComplexNumber::Add(p_Work[Mirror], Product, p_Work[Mirror]);
+				}
+			}
+		}
+
+		g_BinauralFFT.Backward(p_Work);
+
+		// The tail of the previous chunks is already in m_Overlap; nothing reaches past the end of it
+		for (uint32_t n = 0; n < BINAURAL_FFT_SIZE; n++)
+		{
+			m_Overlap[0][n] += p_Work[n].re;
+			m_Overlap[1][n] += p_Work[n].im;
+		}
+	}
+
+	void BinauralVoice::Process(const float* inbuffer, float* outbuffer, uint32_t length, int inchannels, float X, float Y, float Z, float GainStart, float GainEnd)
+	{
+		m_Active = true;
+
+		bool Crossfade = UpdateDirection(X, Y, Z);
+		const float GainStep = (GainEnd - GainStart) / (float)length;
+
+		for (uint32_t Done = 0; Done < length; )
+		{
+			uint32_t Count = length - Done;
+			if (Count > BINAURAL_CHUNK_SIZE)
+			{
+				Count = BINAURAL_CHUNK_SIZE;
+			}
+
+			for (uint32_t n = 0; n < Count; n++)
+			{
+				m_Input[n] = inbuffer[(Done + n) * inchannels] * (GainStart + GainStep * (float)(Done + n));
+			}
+
+			Convolve(Count, Crossfade);
+
+			// Each ear is read back out of its delay line, with the delay gliding to the new direction's over a crossfade
+			for (int Ear = 0; Ear < 2; Ear++)
+			{
+				float* p_Line = m_DelayLines[Ear];
+				for (uint32_t n = 0; n < Count; n++)
+				{
+					p_Line[(m_DelayWrite + n) & (BINAURAL_DELAY_LINE_SIZE - 1)] = m_Overlap[Ear][n];
+				}
+
+				float Delay = m_Delays[1 - m_Current][Ear];
+				float Target = m_Delays[m_Current][Ear];
+				float DelayStep = Crossfade ? (Target - Delay) / (float)Count : 0.0f;
+				if (!Crossfade)
+				{
+					Delay = Target;
+				}
+
+				float* p_Out = outbuffer + 2 * Done + Ear;
+				for (uint32_t n = 0; n < Count; n++)
+				{
+					float Position = (float)n - Delay - DelayStep * (float)n;
+					float Whole = floorf(Position);
+					float Fraction = Position - Whole;
+					uint32_t Index = (m_DelayWrite + BINAURAL_DELAY_LINE_SIZE + (int)Whole) & (BINAURAL_DELAY_LINE_SIZE - 1);
+					p_Out[2 * n] = p_Line[Index] * (1.0f - Fraction) + p_Line[(Index + 1) & (BINAURAL_DELAY_LINE_SIZE - 1)] * Fraction;
+				}
+
+				memmove(m_Overlap[Ear], m_Overlap[Ear] + Count, (BINAURAL_FFT_SIZE - Count) * sizeof(float));
+				memset(m_Overlap[Ear] + BINAURAL_FFT_SIZE - Count, 0, Count * sizeof(float));
+			}
+
+			// The glide is over after the first chunk
+			if (Crossfade)
+			{
+				m_Delays[1 - m_Current][0] = m_Delays[m_Current][0];
+				m_Delays[1 - m_Current][1] = m_Delays[m_Current][1];
+				Crossfade = false;
+			}
+
+			m_DelayWrite = (m_DelayWrite + Count) & (BINAURAL_DELAY_LINE_SIZE - 1);
+			Done += Count;
+		}
+	}
+}
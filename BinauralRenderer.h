@@ -0,0 +1,75 @@
+#pragma once
+
+#include "AudioPluginUtil.h"
+#include "HrirDatabase.h"
+
+// Audio is convolved in chunks of at most this many samples, by overlap-add with FFTs of BINAURAL_FFT_SIZE points, which
+// fit a chunk and a response of HRIR_MAX_LENGTH taps. A chunk can be shorter, so no latency is added.
+#define BINAURAL_CHUNK_SIZE 256
+#define BINAURAL_FFT_SIZE 512
+
+// Each ear's delay line holds a chunk and the longest delay, rounded up to a power of two
+#define BINAURAL_DELAY_LINE_SIZE 512
+
+// The filters are only interpolated again once the source has moved this far (cos of 1 degree) from where they were
+// last interpolated for
+#define BINAURAL_UPDATE_COS 0.99985f
+
+namespace MSHRTFSpatializer
+{
+	static_assert(BINAURAL_CHUNK_SIZE + HRIR_MAX_LENGTH - 1 <= BINAURAL_FFT_SIZE, "A chunk convolved with a response must fit the FFT");
+	static_assert(BINAURAL_CHUNK_SIZE + (int)HRIR_MAX_DELAY + 2 <= BINAURAL_DELAY_LINE_SIZE, "A chunk and the longest delay must fit the delay line");
+
+	// Renders one mono source to two ears with the responses of an HRIR database, in software. Both ears are convolved at
+	// once: the left response is the real part and the right one the imaginary part of one complex filter, so each chunk
+	// takes one forward and one inverse FFT. When the source moves, the responses for the new direction are interpolated
+	// and the chunk is crossfaded from the old filter to the new one, and each ear's onset delay glides to its new value.
+	class BinauralVoice
+	{
+	public:
+		// Returns nullptr if the database's responses are longer than the voice can convolve
+		static BinauralVoice* Create(const HrirDatabase* p_Database);
+
+		// Forgets the audio and the direction, for a source that starts over
+		void Reset();
+
+		// Renders length frames of the first channel of inbuffer, arriving from X, Y, Z in the listener's space (x to the
+		// right, y up, z to the front), into the two channels of outbuffer. The gain fades from GainStart to GainEnd over
+		// the block. Doesn't allocate or lock.
+		void Process(const float* inbuffer, float* outbuffer, uint32_t length, int inchannels, float X, float Y, float Z, float GainStart, float GainEnd);
+
+	private:
+		BinauralVoice() {}
+
+		// Interpolates new filters if the direction has moved far enough. Returns true if the next chunk is to crossfade
+		// from the old ones.
+		bool UpdateDirection(float X, float Y, float Z);
+
+		// Convolves the Count samples in m_Input into m_Overlap, which then starts with the Count samples of each ear
+		void Convolve(uint32_t Count, bool Crossfade);
+
+		const HrirDatabase* p_Database = nullptr;
+		bool m_Active = false;
+
+		// Spectra of the responses (left + j right) for the current direction and the one before
+		UnityComplexNumber m_Filters[2][BINAURAL_FFT_SIZE];
+		int m_Current = 0;
+		bool m_HasDirection = false;
+		float m_DirX = 0.0f;
+		float m_DirY = 0.0f;
+		float m_DirZ = 0.0f;
+
+		// Onset delays in samples of each ear, for the current direction and the one before
+		float m_Delays[2][2];
+
+		UnityComplexNumber m_Work[BINAURAL_FFT_SIZE];
+		float m_Input[BINAURAL_CHUNK_SIZE];
+		float m_Responses[2][HRIR_MAX_LENGTH];
+
+		// Convolved audio of each ear that hasn't been output yet
+		float m_Overlap[2][BINAURAL_FFT_SIZE];
+
+		float m_DelayLines[2][BINAURAL_DELAY_LINE_SIZE];
+		uint32_t m_DelayWrite = 0;
+	};
+}
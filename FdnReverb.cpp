@@ -0,0 +1,190 @@
+#include "FdnReverb.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace MSHRTFSpatializer
+{
+	// Delay line lengths of a medium room, in milliseconds. They are spread out and share no common factor once rounded
+	// to samples, so the echoes of the lines don't pile up on each other.
+	static const float REVERB_LINE_LENGTHS[REVERB_LINE_COUNT] = { 23.1f, 27.7f, 31.9f, 36.3f, 41.3f, 45.7f, 51.1f, 56.9f };
+
+	static const ReverbPreset REVERB_PRESETS[ReverbEnvironment_Count] =
+	{
+		// Decay, high decay, size, pre-delay, level
+		{ 0.5f, 0.25f, 0.6f, 2.0f, 0.15f },		// Small
+		{ 1.0f, 0.5f, 1.0f, 6.0f, 0.13f },		// Medium
+		{ 2.2f, 1.0f, 2.0f, 15.0f, 0.11f },		// Large
+		{ 0.0f, 0.0f, 1.0f, 0.0f, 0.0f },		// Outdoors: nothing to reflect off
+	};
+
+	// Copies Count samples of a ring of Size samples (a power of two), from Position on, to every Stride'th float of p_Dst
+	static void ReadRing(const float* p_Ring, uint32_t Size, uint32_t Position, float* p_Dst, uint32_t Stride, uint32_t Count)
+	{
+		uint32_t Offset = Position & (Size - 1);
+		uint32_t First = (Count < Size - Offset) ? Count : (Size - Offset);
+		for (uint32_t n = 0; n < First; n++)
+		{
+			p_Dst[n * Stride] = p_Ring[Offset + n];
+		}
+		for (uint32_t n = First; n < Count; n++)
+		{
+			p_Dst[n * Stride] = p_Ring[n - First];
+		}
+	}
+
+	// The other way around: from every Stride'th float of p_Src into the ring
+	static void WriteRing(float* p_Ring, uint32_t Size, uint32_t Position, const float* p_Src, uint32_t Stride, uint32_t Count)
+	{
+		uint32_t Offset = Position & (Size - 1);
+		uint32_t First = (Count < Size - Offset) ? Count : (Size - Offset);
+		for (uint32_t n = 0; n < First; n++)
+		{
+			p_Ring[Offset + n] = p_Src[n * Stride];
+		}
+		for (uint32_t n = First; n < Count; n++)
+		{
+			p_Ring[n - First] = p_Src[n * Stride];
+		}
+	}
+
+	FdnReverb* FdnReverb::Create(uint32_t SampleRate, int Environment)
+	{
+		FdnReverb* p_Reverb = new FdnReverb;
+		p_Reverb->m_SampleRate = SampleRate;
+		p_Reverb->SetEnvironment(Environment);
+		return p_Reverb;
+	}
+
+	const ReverbPreset& FdnReverb::GetPreset(int Environment)
+	{
+		if (Environment < 0)
+		{
+			Environment = 0;
+		}
+		else if (Environment >= ReverbEnvironment_Count)
+		{
+			Environment = ReverbEnvironment_Count - 1;
+		}
+		return REVERB_PRESETS[Environment];
+	}
+
+	void FdnReverb::SetEnvironment(int Environment)
+	{
+		const ReverbPreset& Preset = GetPreset(Environment);
+		m_Environment = Environment;
+		m_Level = Preset.m_Level;
+
+		memset(m_Lines, 0, sizeof(m_Lines));
+		memset(m_PreDelayLine, 0, sizeof(m_PreDelayLine));
+		memset(m_Lowpass, 0, sizeof(m_Lowpass));
+		m_Write = 0;
+
+		float SamplesPerMillisecond = (float)m_SampleRate / 1000.0f;
+		m_PreDelay = (uint32_t)(Preset.m_PreDelay * SamplesPerMillisecond + 0.5f);
+		if (m_PreDelay > REVERB_PRE_DELAY_SIZE - 1)
+		{
+			m_PreDelay = REVERB_PRE_DELAY_SIZE - 1;
+		}
+
+		m_SpanLength = REVERB_SPAN_SIZE;
+		for (int Line = 0; Line < REVERB_LINE_COUNT; Line++)
+		{
+			// Odd lengths, so that no two lines share a factor of two
+			uint32_t Length = (uint32_t)(REVERB_LINE_LENGTHS[Line] * Preset.m_Size * SamplesPerMillisecond) | 1;
+			m_Lengths[Line] = (Length < REVERB_LINE_SIZE) ? Length : REVERB_LINE_SIZE - 1;
+			if (m_Lengths[Line] < m_SpanLength)
+			{
+				m_SpanLength = m_Lengths[Line];
+			}
+
+			// The gain that takes the decay time to fall by 60 dB, and the lowpass that lowers it to what takes the
+			// high decay time at the Nyquist frequency, where a one-pole lowpass has a gain of (1 - a) / (1 + a)
+			float Seconds = (float)m_Lengths[Line] / (float)m_SampleRate;
+			float Gain = (Preset.m_DecayTime > 0.0f) ? powf(10.0f, -3.0f * Seconds / Preset.m_DecayTime) : 0.0f;
+			float HighGain = (Preset.m_HighDecayTime > 0.0f) ? powf(10.0f, -3.0f * Seconds / Preset.m_HighDecayTime) : 0.0f;
+			float Ratio = (Gain > 0.0f) ? HighGain / Gain : 1.0f;
+			m_Gains[Line] = Gain;
+			m_Damping[Line] = (1.0f - Ratio) / (1.0f + Ratio);
+
+			m_InputSigns[Line] = ((0x5A >> Line) & 1) ? -1.0f : 1.0f;
+		}
+	}
+
+	float FdnReverb::Process(const float* p_Input, float* const* pp_Outputs, uint32_t Count)
+	{
+		const UnityVec4 Gains[2] = { Vec4Load(m_Gains), Vec4Load(m_Gains + 4) };
+		const UnityVec4 Damping[2] = { Vec4Load(m_Damping), Vec4Load(m_Damping + 4) };
+		const UnityVec4 InputSigns[2] = { Vec4Load(m_InputSigns), Vec4Load(m_InputSigns + 4) };
+		const UnityVec4 Level = Vec4Set1(m_Level);
+		UnityVec4 Lowpass[2] = { Vec4Load(m_Lowpass), Vec4Load(m_Lowpass + 4) };
+		UnityVec4 Peak = Vec4Set1(0.0f);
+
+		// Each line's taps for the span are turned around into one frame of all the lines per sample, which the vector
+		// code works through and leaves the samples to write back in
+		float Frames[REVERB_SPAN_SIZE][REVERB_LINE_COUNT];
+		float OutputFrames[REVERB_SPAN_SIZE][REVERB_OUTPUT_COUNT];
+		float Delayed[REVERB_SPAN_SIZE];
+
+		for (uint32_t Start = 0; Start < Count; Start += m_SpanLength)
+		{
+			uint32_t Span = (Count - Start < m_SpanLength) ? (Count - Start) : m_SpanLength;
+
+			// The pre-delay line has what comes out before the input of this span does
+			uint32_t Buffered = (m_PreDelay < Span) ? m_PreDelay : Span;
+			ReadRing(m_PreDelayLine, REVERB_PRE_DELAY_SIZE, m_Write - m_PreDelay, Delayed, 1, Buffered);
+			memcpy(Delayed + Buffered, p_Input + Start, (Span - Buffered) * sizeof(float));
+			WriteRing(m_PreDelayLine, REVERB_PRE_DELAY_SIZE, m_Write, p_Input + Start, 1, Span);
+
+			for (int Line = 0; Line < REVERB_LINE_COUNT; Line++)
+			{
+				ReadRing(m_Lines[Line], REVERB_LINE_SIZE, m_Write - m_Lengths[Line], &Frames[0][Line], REVERB_LINE_COUNT, Span);
+			}
+
+			for (uint32_t n = 0; n < Span; n++)
+			{
+				UnityVec4 Input = Vec4Set1(Delayed[n]);
+
+				UnityVec4 Lines[2];
+				for (int Group = 0; Group < 2; Group++)
+				{
+					UnityVec4 Tap = Vec4Load(Frames[n] + 4 * Group);
+					Lowpass[Group] = Vec4Add(Tap, Vec4Mul(Damping[Group], Vec4Sub(Lowpass[Group], Tap)));
+					Lines[Group] = Vec4Mul(Lowpass[Group], Gains[Group]);
+				}
+
+				// Each output is one line of each group, and the same sum is what the Householder matrix takes off every line
+				UnityVec4 Outputs = Vec4Add(Lines[0], Lines[1]);
+				UnityVec4 Feedback = Vec4Set1(-0.25f * Vec4SumAcross(Outputs));
+
+				Outputs = Vec4Mul(Outputs, Level);
+				Peak = Vec4Max(Peak, Vec4Abs(Outputs));
+				Vec4Store(OutputFrames[n], Outputs);
+
+				for (int Group = 0; Group < 2; Group++)
+				{
+					Vec4Store(Frames[n] + 4 * Group, Vec4Add(Vec4Add(Lines[Group], Feedback), Vec4Mul(Input, InputSigns[Group])));
+				}
+			}
+
+			for (int Line = 0; Line < REVERB_LINE_COUNT; Line++)
+			{
+				WriteRing(m_Lines[Line], REVERB_LINE_SIZE, m_Write, &Frames[0][Line], REVERB_LINE_COUNT, Span);
+			}
+			for (int Output = 0; Output < REVERB_OUTPUT_COUNT; Output++)
+			{
+				float* p_Output = pp_Outputs[Output] + Start;
+				for (uint32_t n = 0; n < Span; n++)
+				{
+					p_Output[n] = OutputFrames[n][Output];
+				}
+			}
+
+			m_Write += Span;
+		}
+
+		Vec4Store(m_Lowpass, Lowpass[0]);
+		Vec4Store(m_Lowpass + 4, Lowpass[1]);
+		return Vec4MaxAcross(Peak);
+	}
+}
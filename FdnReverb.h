@@ -0,0 +1,92 @@
+#pragma once
+
+#include "AudioPluginUtil.h"
+
+#include <stdint.h>
+
+// Delay lines in the network, processed four at a time, and the decorrelated outputs taken from them
+#define REVERB_LINE_COUNT 8
+#define REVERB_OUTPUT_COUNT 4
+
+// Each delay line holds the longest line of the largest preset at 48 kHz, rounded up to a power of two, and the
+// pre-delay line the longest pre-delay
+#define REVERB_LINE_SIZE 8192
+#define REVERB_PRE_DELAY_SIZE 2048
+
+// Most samples processed per span (see FdnReverb::Process)
+#define REVERB_SPAN_SIZE 256
+
+namespace MSHRTFSpatializer
+{
+	static_assert(REVERB_LINE_COUNT == 8, "The network is processed as two groups of four lines");
+	static_assert(REVERB_OUTPUT_COUNT == 4, "Each output is taken from one line of each group");
+
+	// The environment sizes of the Environment parameter, which are those of the Windows HRTF APO
+	enum ReverbEnvironment
+	{
+		ReverbEnvironment_Small = 0,
+		ReverbEnvironment_Medium,
+		ReverbEnvironment_Large,
+		ReverbEnvironment_Outdoors,
+		ReverbEnvironment_Count
+	};
+
+	struct ReverbPreset
+	{
+		float m_DecayTime;			// Seconds for the tail to fall by 60 dB at low frequencies
+		float m_HighDecayTime;		// and at the Nyquist frequency
+		float m_Size;				// Scales the delay lines; 1 is a medium room
+		float m_PreDelay;			// Milliseconds from the direct sound to the tail
+		float m_Level;				// Gain from the input to each output, or 0 for no reverb
+	};
+
+	// The one reverb all sources share: an eight-line feedback delay network. Every line feeds back into every other
+	// through a Householder matrix (each line less a quarter of the sum of all of them), which is lossless and dense, so
+	// the loss is only the per-line gain that sets the decay time and a one-pole lowpass that makes the highs decay
+	// sooner. The lines are read and written a span of samples at a time, and everything in between is done on four
+	// lines at once. Its cost only depends on how long the audio is, not on how many sources feed it.
+	class FdnReverb
+	{
+	public:
+		// Allocates and clears the delay lines, so it doesn't belong on an audio thread. Out of range environments are
+		// clamped.
+		static FdnReverb* Create(uint32_t SampleRate, int Environment);
+
+		static const ReverbPreset& GetPreset(int Environment);
+
+		// Whether an environment has any reverb at all
+		static bool HasTail(int Environment) { return GetPreset(Environment).m_Level > 0.0f; }
+
+		int GetEnvironment() const { return m_Environment; }
+
+		// Reverberates Count samples of mono input into the REVERB_OUTPUT_COUNT channels of pp_Outputs, and returns
+		// their peak level. Doesn't allocate or lock.
+		float Process(const float* p_Input, float* const* pp_Outputs, uint32_t Count);
+
+	private:
+		FdnReverb() {}
+
+		void SetEnvironment(int Environment);
+
+		uint32_t m_SampleRate = 0;
+		int m_Environment = -1;
+
+		float m_Lines[REVERB_LINE_COUNT][REVERB_LINE_SIZE];
+		uint32_t m_Lengths[REVERB_LINE_COUNT];
+		uint32_t m_Write = 0;
+
+		// No span is longer than the shortest line, so that every tap a span reads was written before it
+		uint32_t m_SpanLength = 1;
+
+		float m_PreDelayLine[REVERB_PRE_DELAY_SIZE];
+		uint32_t m_PreDelay = 0;
+
+		// Per line, in two groups of four: the feedback gains, the lowpass coefficients and state, and the signs the
+		// input is fed in with
+		float m_Gains[REVERB_LINE_COUNT];
+		float m_Damping[REVERB_LINE_COUNT];
+		float m_Lowpass[REVERB_LINE_COUNT];
+		float m_InputSigns[REVERB_LINE_COUNT];
+		float m_Level = 0.0f;
+	};
+}
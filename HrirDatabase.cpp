@@ -0,0 +1,243 @@
+#include "HrirDatabase.h"
+#include "AudioPluginInterface.h"
+
+#include <math.h>
+#include <string.h>
+
+#if UNITY_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MSHRTFSpatializer
+{
+	HrirDatabase* HrirDatabase::Open(const char* p_Path)
+	{
+		const unsigned char* p_Base = nullptr;
+		uint64_t Size = 0;
+
+#ifdef UWPBUILD
+		// Apps can only map files through the FromApp variants, and can't read a path from the environment anyway
+		return nullptr;
+#elif UNITY_WIN
+		HANDLE File = CreateFileA(p_Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER FileSize;
+		HANDLE Mapping = GetFileSizeEx(File, &FileSize) ? CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		CloseHandle(File);
+		if (Mapping == nullptr)
+		{
+			return nullptr;
+		}
+
+		// The view keeps the mapping alive
+		p_Base = (const unsigned char*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(Mapping);
+		if (p_Base == nullptr)
+		{
+			return nullptr;
+		}
+		Size = (uint64_t)FileSize.QuadPart;
+#else
+		int File = open(p_Path, O_RDONLY);
+		if (File < 0)
+		{
+			return nullptr;
+		}
+
+		struct stat FileStat;
+		void* p_Mapping = MAP_FAILED;
+		if (fstat(File, &FileStat) == 0 && FileStat.st_size > 0)
+		{
+			p_Mapping = mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_SHARED, File, 0);
+		}
+		close(File);
+		if (p_Mapping == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		p_Base = (const unsigned char*)p_Mapping;
+		Size = (uint64_t)FileStat.st_size;
+#endif
+
+		HrirDatabase* p_Database = new HrirDatabase;
+		p_Database->p_Base = p_Base;
+		p_Database->m_Size = Size;
+
+		// Everything has to be where the header says, so that Interpolate needn't check
+		const HrirFileHeader* p_Header = (const HrirFileHeader*)p_Base;
+		if (Size < sizeof(HrirFileHeader) || p_Header->Magic != HRIR_DATABASE_MAGIC || p_Header->Version != HRIR_DATABASE_VERSION ||
+			p_Header->Length == 0 || p_Header->Length > HRIR_MAX_LENGTH || p_Header->RingCount == 0 || p_Header->DirectionCount == 0 ||
+			p_Header->RingCount > p_Header->DirectionCount)
+		{
+			delete p_Database;
+			return nullptr;
+		}
+
+		uint64_t RingsOffset = sizeof(HrirFileHeader);
+		uint64_t DirectionsOffset = RingsOffset + (uint64_t)p_Header->RingCount * sizeof(HrirFileRing);
+		uint64_t TapsOffset = DirectionsOffset + (uint64_t)p_Header->DirectionCount * sizeof(HrirFileDirection);
+		uint64_t End = TapsOffset + (uint64_t)p_Header->DirectionCount * 2 * p_Header->Length * sizeof(int16_t);
+		if (End > Size)
+		{
+			delete p_Database;
+			return nullptr;
+		}
+
+		p_Database->p_Header = p_Header;
+		p_Database->p_Rings = (const HrirFileRing*)(p_Base + RingsOffset);
+		p_Database->p_Directions = (const HrirFileDirection*)(p_Base + DirectionsOffset);
+		p_Database->p_Taps = (const int16_t*)(p_Base + TapsOffset);
+
+		for (uint32_t Ring = 0; Ring < p_Header->RingCount; Ring++)
+		{
+			const HrirFileRing& FileRing = p_Database->p_Rings[Ring];
+			if (FileRing.DirectionCount == 0 || FileRing.FirstDirection > p_Header->DirectionCount ||
+				FileRing.DirectionCount > p_Header->DirectionCount - FileRing.FirstDirection ||
+				(Ring > 0 && !(FileRing.Elevation > p_Database->p_Rings[Ring - 1].Elevation)))
+			{
+				delete p_Database;
+				return nullptr;
+			}
+		}
+
+		for (uint32_t Direction = 0; Direction < p_Header->DirectionCount; Direction++)
+		{
+			const HrirFileDirection& FileDirection = p_Database->p_Directions[Direction];
+			if (!(FileDirection.DelayLeft >= 0.0f && FileDirection.DelayLeft <= HRIR_MAX_DELAY &&
+				FileDirection.DelayRight >= 0.0f && FileDirection.DelayRight <= HRIR_MAX_DELAY))
+			{
+				delete p_Database;
+				return nullptr;
+			}
+		}
+
+		// Read the whole file in now rather than on the audio thread
+		volatile unsigned char Touched = 0;
+		for (uint64_t Page = 0; Page < Size; Page += 4096)
+		{
+			Touched = Touched + p_Base[Page];
+		}
+
+		return p_Database;
+	}
+
+	HrirDatabase::~HrirDatabase()
+	{
+#if UNITY_WIN
+		UnmapViewOfFile(p_Base);
+#else
+		munmap((void*)p_Base, (size_t)m_Size);
+#endif
+	}
+
+	void HrirDatabase::FindAzimuths(const HrirFileRing& Ring, float Azimuth, uint32_t* p_First, uint32_t* p_Second, float* p_Weight) const
+	{
+		const HrirFileDirection* p_Ring = p_Directions + Ring.FirstDirection;
+		uint32_t Count = Ring.DirectionCount;
+
+		// The first direction past Azimuth, wrapping around to the start of the ring
+		uint32_t Low = 0;
+		uint32_t High = Count;
+		while (Low < High)
+		{
+			uint32_t Middle = (Low + High) / 2;
+			if (p_Ring[Middle].Azimuth <= Azimuth)
+			{
+				Low = Middle + 1;
+			}
+			else
+			{
+				High = Middle;
+			}
+		}
+
+		uint32_t Second = Low % Count;
+		uint32_t First = (Low + Count - 1) % Count;
+		*p_First = Ring.FirstDirection + First;
+		*p_Second = Ring.FirstDirection + Second;
+
+		// A ring of one direction (a pole) has nothing to interpolate
+		float Span = p_Ring[Second].Azimuth - p_Ring[First].Azimuth;
+		float Offset = Azimuth - p_Ring[First].Azimuth;
+		if (Span <= 0.0f)
+		{
+			Span += 360.0f;
+		}
+		if (Offset < 0.0f)
+		{
+			Offset += 360.0f;
+		}
+		*p_Weight = (Count > 1) ? Offset / Span : 0.0f;
+	}
+
+	void HrirDatabase::Accumulate(uint32_t Direction, float Weight, float* p_Left, float* p_Right, float* p_DelayLeft, float* p_DelayRight) const
+	{
+		if (Weight <= 0.0f)
+		{
+			return;
+		}
+
+		uint32_t Length = p_Header->Length;
+		const int16_t* p_LeftTaps = p_Taps + (uint64_t)Direction * 2 * Length;
+		const int16_t* p_RightTaps = p_LeftTaps + Length;
+		float Scale = Weight * p_Header->Scale;
+
+		for (uint32_t n = 0; n < Length; n++)
+		{
+			p_Left[n] += Scale * (float)p_LeftTaps[n];
+			p_Right[n] += Scale * (float)p_RightTaps[n];
+		}
+
+		*p_DelayLeft += Weight * p_Directions[Direction].DelayLeft;
+		*p_DelayRight += Weight * p_Directions[Direction].DelayRight;
+	}
+
+	void HrirDatabase::Interpolate(float Azimuth, float Elevation, float* p_Left, float* p_Right, float* p_DelayLeft, float* p_DelayRight) const
+	{
+		memset(p_Left, 0, p_Header->Length * sizeof(float));
+		memset(p_Right, 0, p_Header->Length * sizeof(float));
+		*p_DelayLeft = 0.0f;
+		*p_DelayRight = 0.0f;
+
+		Azimuth = fmodf(Azimuth, 360.0f);
+		if (Azimuth < 0.0f)
+		{
+			Azimuth += 360.0f;
+		}
+
+		// The rings on either side of Elevation. Above the highest ring or below the lowest, that ring is used alone.
+		uint32_t Lower = 0;
+		while (Lower + 1 < p_Header->RingCount && p_Rings[Lower + 1].Elevation <= Elevation)
+		{
+			Lower++;
+		}
+
+		uint32_t Upper = Lower;
+		float UpperWeight = 0.0f;
+		if (Lower + 1 < p_Header->RingCount && Elevation > p_Rings[Lower].Elevation)
+		{
+			Upper = Lower + 1;
+			UpperWeight = (Elevation - p_Rings[Lower].Elevation) / (p_Rings[Upper].Elevation - p_Rings[Lower].Elevation);
+		}
+
+		const uint32_t Rings[2] = { Lower, Upper };
+		const float RingWeights[2] = { 1.0f - UpperWeight, UpperWeight };
+		for (int r = 0; r < 2; r++)
+		{
+			uint32_t First, Second;
+			float Weight;
+			FindAzimuths(p_Rings[Rings[r]], Azimuth, &First, &Second, &Weight);
+			Accumulate(First, RingWeights[r] * (1.0f - Weight), p_Left, p_Right, p_DelayLeft, p_DelayRight);
+			Accumulate(Second, RingWeights[r] * Weight, p_Left, p_Right, p_DelayLeft, p_DelayRight);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace MSHRTFSpatializer
+{
+	// An HRIR database holds a measured set of head-related impulse responses, indexed by direction so that the filters
+	// for any direction can be interpolated without searching. It is an HrirFileHeader, then RingCount HrirFileRing
+	// entries, then DirectionCount HrirFileDirection entries, then the taps: Length int16 samples for the left ear and
+	// Length for the right ear of each direction in turn. Everything is little-endian.
+	//
+	// The directions are grouped into rings of equal elevation, in ascending order of elevation, and the directions of
+	// each ring are in ascending order of azimuth. Angles follow SOFA: azimuth in degrees counterclockwise from the
+	// front (90 is to the left) in [0, 360), elevation in degrees up from the horizontal plane.
+	//
+	// The responses are stored with their onsets removed, and the onset of each ear kept as a delay. Aligned responses
+	// can be interpolated without comb filtering, and the interaural time difference is interpolated as a delay.
+	//
+	// HrirConverter (Tools\HrirConverter) writes databases from SOFA files.
+	const uint32_t HRIR_DATABASE_MAGIC = 0x52495248;		// "HRIR"
+	const uint32_t HRIR_DATABASE_VERSION = 1;
+
+	// The software binaural mode is opt-in: set this environment variable to the path of the database to render with
+	#define HRIR_DATABASE_ENVIRONMENT_VARIABLE "UNITY_ISAC_HRIR"
+
+	// Longest response the renderer takes (see BINAURAL_FFT_SIZE), and the longest onset delay in samples
+	#define HRIR_MAX_LENGTH 256
+	#define HRIR_MAX_DELAY 127.0f
+
+	struct HrirFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t SampleRate;
+		uint32_t Length;			// Taps per ear
+		uint32_t RingCount;
+		uint32_t DirectionCount;
+		float Scale;				// Converts the int16 taps to the measured amplitude
+		uint32_t Reserved;
+	};
+
+	struct HrirFileRing
+	{
+		float Elevation;
+		uint32_t FirstDirection;
+		uint32_t DirectionCount;
+		uint32_t Reserved;
+	};
+
+	struct HrirFileDirection
+	{
+		float Azimuth;
+		float DelayLeft;			// Onset of each ear's response in samples, less the earliest onset in the database
+		float DelayRight;
+		uint32_t Reserved;
+	};
+
+	// A database mapped read-only, so that every voice (and every process) rendering with it shares the file's pages.
+	// The pages are all touched when it is opened, so that the audio thread never waits on the disk.
+	class HrirDatabase
+	{
+	public:
+		// Returns nullptr if the file can't be mapped, isn't a database this build can read, or this platform can't map
+		// files
+		static HrirDatabase* Open(const char* p_Path);
+		~HrirDatabase();
+
+		uint32_t GetSampleRate() const { return p_Header->SampleRate; }
+		uint32_t GetLength() const { return p_Header->Length; }
+
+		// Interpolates the responses for a direction from the measured directions around it: the two nearest in
+		// azimuth on each of the two rings nearest in elevation, weighted bilinearly. Writes GetLength() taps per ear
+		// and the onset delay of each ear in samples. Doesn't allocate or lock.
+		void Interpolate(float Azimuth, float Elevation, float* p_Left, float* p_Right, float* p_DelayLeft, float* p_DelayRight) const;
+
+	private:
+		HrirDatabase() {}
+
+		// The measured directions on either side of Azimuth on a ring, and the weight of the second
+		void FindAzimuths(const HrirFileRing& Ring, float Azimuth, uint32_t* p_First, uint32_t* p_Second, float* p_Weight) const;
+		void Accumulate(uint32_t Direction, float Weight, float* p_Left, float* p_Right, float* p_DelayLeft, float* p_DelayRight) const;
+
+		const unsigned char* p_Base = nullptr;
+		uint64_t m_Size = 0;
+
+		const HrirFileHeader* p_Header = nullptr;
+		const HrirFileRing* p_Rings = nullptr;
+		const HrirFileDirection* p_Directions = nullptr;
+		const int16_t* p_Taps = nullptr;
+	};
+}
@@ -0,0 +1,272 @@
+#include "ObjectCapture.h"
+#include "AudioPluginInterface.h"
+
+#include <string.h>
+#include <chrono>
+
+#if UNITY_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace MSHRTFSpatializer
+{
+	ObjectCaptureWriter* ObjectCaptureWriter::Create(const char* p_Path, uint32_t SampleRate)
+	{
+#ifdef UWPBUILD
+		// Apps can only map files through the FromApp variants, and can't write where a capture would be useful anyway
+		return nullptr;
+#else
+#if UNITY_WIN
+		HANDLE File = CreateFileA(p_Path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+		intptr_t Handle = (intptr_t)File;
+#else
+		int Handle = open(p_Path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (Handle < 0)
+		{
+			return nullptr;
+		}
+#endif
+
+		ObjectCaptureWriter* p_Writer = new ObjectCaptureWriter;
+		p_Writer->m_File = Handle;
+		p_Writer->m_Next = nullptr;
+		p_Writer->m_Retired = nullptr;
+
+		// The first segment is mapped here, so that the pump can start right away
+		p_Writer->m_Current = p_Writer->MapSegment(0);
+		if (p_Writer->m_Current == nullptr)
+		{
+			delete p_Writer;
+			return nullptr;
+		}
+		p_Writer->m_NextOffset = OBJECT_CAPTURE_SEGMENT_SIZE;
+
+		ObjectCaptureFileHeader* p_FileHeader = (ObjectCaptureFileHeader*)p_Writer->m_Current->p_Base;
+		p_FileHeader->Magic = OBJECT_CAPTURE_MAGIC;
+		p_FileHeader->Version = OBJECT_CAPTURE_VERSION;
+		p_FileHeader->SampleRate = SampleRate;
+		p_FileHeader->PassHeaderSize = sizeof(ObjectCapturePassHeader);
+		p_FileHeader->ObjectHeaderSize = sizeof(ObjectCaptureObjectHeader);
+		p_FileHeader->Reserved = 0;
+		p_FileHeader->TimestampFrequency = 1000000000;
+		p_Writer->m_Used = sizeof(ObjectCaptureFileHeader);
+
+		p_Writer->m_MapperActive = true;
+		p_Writer->m_Mapper = std::thread(&ObjectCaptureWriter::RunMapper, p_Writer);
+
+		return p_Writer;
+#endif
+	}
+
+	ObjectCaptureWriter::~ObjectCaptureWriter()
+	{
+		if (m_Mapper.joinable())
+		{
+			m_MapperActive = false;
+			m_Mapper.join();
+		}
+
+		UnmapSegment(m_Next.exchange(nullptr));
+		UnmapSegment(m_Retired.exchange(nullptr));
+
+		// Everything after the last pass is zeros from growing the file; a segment has to be unmapped before the file
+		// can be cut short
+		uint64_t Length = 0;
+		if (m_Current != nullptr)
+		{
+			Length = m_Current->Offset + m_Used;
+			UnmapSegment(m_Current);
+			m_Current = nullptr;
+		}
+
+#if UNITY_WIN
+		if (m_File != -1)
+		{
+			LARGE_INTEGER End;
+			End.QuadPart = (LONGLONG)Length;
+			if (Length > 0 && SetFilePointerEx((HANDLE)m_File, End, nullptr, FILE_BEGIN))
+			{
+				SetEndOfFile((HANDLE)m_File);
+			}
+			CloseHandle((HANDLE)m_File);
+		}
+#else
+		if (m_File != -1)
+		{
+			if (Length > 0)
+			{
+				// If this fails, the trailing zeros still read as the end of the capture
+				int Result = ftruncate((int)m_File, (off_t)Length);
+				(void)Result;
+			}
+			close((int)m_File);
+		}
+#endif
+	}
+
+	int64_t ObjectCaptureWriter::Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	ObjectCaptureWriter::Segment* ObjectCaptureWriter::MapSegment(uint64_t Offset)
+	{
+		unsigned char* p_Base = nullptr;
+
+#ifdef UWPBUILD
+		return nullptr;
+#elif UNITY_WIN
+		// Creating a mapping past the end of the file grows the file to match
+		uint64_t End = Offset + OBJECT_CAPTURE_SEGMENT_SIZE;
+		HANDLE Mapping = CreateFileMappingA((HANDLE)m_File, nullptr, PAGE_READWRITE, (DWORD)(End >> 32), (DWORD)End, nullptr);
+		if (Mapping == nullptr)
+		{
+			return nullptr;
+		}
+
+		// The view keeps the mapping alive
+		p_Base = (unsigned char*)MapViewOfFile(Mapping, FILE_MAP_WRITE, (DWORD)(Offset >> 32), (DWORD)Offset, (SIZE_T)OBJECT_CAPTURE_SEGMENT_SIZE);
+		CloseHandle(Mapping);
+		if (p_Base == nullptr)
+		{
+			return nullptr;
+		}
+#else
+		if (ftruncate((int)m_File, (off_t)(Offset + OBJECT_CAPTURE_SEGMENT_SIZE)) != 0)
+		{
+			return nullptr;
+		}
+
+		void* p_Mapping = mmap(nullptr, OBJECT_CAPTURE_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, (int)m_File, (off_t)Offset);
+		if (p_Mapping == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		p_Base = (unsigned char*)p_Mapping;
+#endif
+
+		// Fault every page in now rather than on the pump
+		for (uint64_t Page = 0; Page < OBJECT_CAPTURE_SEGMENT_SIZE; Page += 4096)
+		{
+			((volatile unsigned char*)p_Base)[Page] = 0;
+		}
+
+		Segment* p_Segment = new Segment;
+		p_Segment->p_Base = p_Base;
+		p_Segment->Offset = Offset;
+		return p_Segment;
+	}
+
+	void ObjectCaptureWriter::UnmapSegment(Segment* p_Segment)
+	{
+		if (p_Segment == nullptr)
+		{
+			return;
+		}
+
+		// Dirty pages are written back by the system after the view is gone
+#if UNITY_WIN
+		UnmapViewOfFile(p_Segment->p_Base);
+#else
+		munmap(p_Segment->p_Base, OBJECT_CAPTURE_SEGMENT_SIZE);
+#endif
+		delete p_Segment;
+	}
+
+	bool ObjectCaptureWriter::BeginPass(uint64_t Sequence, int64_t BeginTimestamp, uint32_t NumObjects, uint32_t FrameCount)
+	{
+		uint64_t Size = sizeof(ObjectCapturePassHeader) + (uint64_t)NumObjects * ObjectCaptureObjectSize(FrameCount);
+		if (m_Current == nullptr || Size > OBJECT_CAPTURE_SEGMENT_SIZE)
+		{
+			return false;
+		}
+
+		if (m_Used + Size > OBJECT_CAPTURE_SEGMENT_SIZE)
+		{
+			// Move on to the next segment, if the background thread has it ready and has taken the last one away
+			Segment* p_Next = m_Next.load(std::memory_order_acquire);
+			if (p_Next == nullptr || m_Retired.load(std::memory_order_acquire) != nullptr)
+			{
+				return false;
+			}
+			m_Next.store(nullptr, std::memory_order_release);
+
+			if (m_Used < OBJECT_CAPTURE_SEGMENT_SIZE)
+			{
+				uint32_t* p_Padding = (uint32_t*)(m_Current->p_Base + m_Used);
+				p_Padding[0] = (uint32_t)(OBJECT_CAPTURE_SEGMENT_SIZE - m_Used);
+				p_Padding[1] = ObjectCaptureRecord_Padding;
+			}
+
+			m_Retired.store(m_Current, std::memory_order_release);
+			m_Current = p_Next;
+			m_Used = 0;
+		}
+
+		m_Pass = m_Current->p_Base + m_Used;
+		m_PassUsed = sizeof(ObjectCapturePassHeader);
+		m_FrameCount = FrameCount;
+
+		ObjectCapturePassHeader* p_Header = (ObjectCapturePassHeader*)m_Pass;
+		p_Header->Type = ObjectCaptureRecord_Pass;
+		p_Header->Sequence = Sequence;
+		p_Header->BeginTimestamp = BeginTimestamp;
+		p_Header->FrameCount = FrameCount;
+		p_Header->NumObjects = 0;
+		return true;
+	}
+
+	void ObjectCaptureWriter::AddObject(uint32_t Index, uint32_t Type, float X, float Y, float Z, float Volume, const float* p_Samples)
+	{
+		ObjectCaptureObjectHeader* p_Object = (ObjectCaptureObjectHeader*)(m_Pass + m_PassUsed);
+		p_Object->Index = Index;
+		p_Object->Type = Type;
+		p_Object->X = X;
+		p_Object->Y = Y;
+		p_Object->Z = Z;
+		p_Object->Volume = Volume;
+		memcpy(p_Object + 1, p_Samples, m_FrameCount * sizeof(float));
+
+		m_PassUsed += ObjectCaptureObjectSize(m_FrameCount);
+		((ObjectCapturePassHeader*)m_Pass)->NumObjects++;
+	}
+
+	void ObjectCaptureWriter::EndPass()
+	{
+		ObjectCapturePassHeader* p_Header = (ObjectCapturePassHeader*)m_Pass;
+		p_Header->EndTimestamp = Now();
+
+		// The size goes in last: if the process dies in the middle of a pass, the capture ends before it
+		p_Header->Size = m_PassUsed;
+		m_Used += m_PassUsed;
+		m_Pass = nullptr;
+	}
+
+	void ObjectCaptureWriter::RunMapper()
+	{
+		while (m_MapperActive)
+		{
+			UnmapSegment(m_Retired.exchange(nullptr, std::memory_order_acq_rel));
+
+			if (m_Next.load(std::memory_order_acquire) == nullptr)
+			{
+				Segment* p_Next = MapSegment(m_NextOffset);
+				if (p_Next != nullptr)
+				{
+					m_NextOffset += OBJECT_CAPTURE_SEGMENT_SIZE;
+					m_Next.store(p_Next, std::memory_order_release);
+				}
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+namespace MSHRTFSpatializer
+{
+	// An object capture holds what the pump handed to the sink: every object of every pass, with its position, volume
+	// and samples. It is an ObjectCaptureFileHeader followed by records; a record of size 0 (or the end of the file) ends
+	// the capture. Pass records are an ObjectCapturePassHeader followed by NumObjects objects, each an
+	// ObjectCaptureObjectHeader followed by FrameCount floats, padded to a multiple of 8 bytes. Passes that couldn't
+	// be written show up as gaps in the sequence numbers. Everything is little-endian.
+	//
+	// Unlike the callback capture this format includes no Windows types, so captures can be read on any platform.
+	const uint32_t OBJECT_CAPTURE_MAGIC = 0x4B4E5349;		// "ISNK"
+	const uint32_t OBJECT_CAPTURE_VERSION = 1;
+
+	// The AudioObjectType of dynamic objects; static objects carry their own type
+	const uint32_t OBJECT_CAPTURE_DYNAMIC = 1;
+
+	// Capturing is opt-in: set this environment variable to the path of the file to write
+	#define OBJECT_CAPTURE_ENVIRONMENT_VARIABLE "UNITY_ISAC_OBJECT_CAPTURE"
+
+	// The file is mapped and grown this much at a time. 64 MB is a bit over 5 seconds of 64 objects.
+	#define OBJECT_CAPTURE_SEGMENT_SIZE (64ull << 20)
+
+	enum ObjectCaptureRecordType
+	{
+		ObjectCaptureRecord_End = 0,
+		ObjectCaptureRecord_Pass,
+		ObjectCaptureRecord_Padding,	// Fills the end of a segment that the next record didn't fit in
+	};
+
+	struct ObjectCaptureFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t SampleRate;
+		uint32_t PassHeaderSize;		// sizeof(ObjectCapturePassHeader) when the capture was written
+		uint32_t ObjectHeaderSize;		// sizeof(ObjectCaptureObjectHeader) when the capture was written
+		uint32_t Reserved;
+		int64_t TimestampFrequency;		// Ticks per second of the pass timestamps
+	};
+
+	struct ObjectCapturePassHeader
+	{
+		uint32_t Size;					// Of the whole record, including this header and the objects
+		uint32_t Type;
+		uint64_t Sequence;				// Counts every pass, including the ones that couldn't be written
+		int64_t BeginTimestamp;			// When the pump began updating the sink
+		int64_t EndTimestamp;			// When it was done writing the objects
+		uint32_t FrameCount;
+		uint32_t NumObjects;
+	};
+	static_assert(sizeof(ObjectCapturePassHeader) % 8 == 0, "Records must stay 8 byte aligned");
+
+	struct ObjectCaptureObjectHeader
+	{
+		uint32_t Index;					// Slot of a dynamic object, or bed channel of a static one
+		uint32_t Type;					// OBJECT_CAPTURE_DYNAMIC or the AudioObjectType of a static object
+		float X;						// Position in ISAC's coordinate system: x to the right, y up, z to the back
+		float Y;
+		float Z;
+		float Volume;
+	};
+	static_assert(sizeof(ObjectCaptureObjectHeader) % 8 == 0, "Records must stay 8 byte aligned");
+
+	inline uint32_t ObjectCaptureObjectSize(uint32_t FrameCount)
+	{
+		return (sizeof(ObjectCaptureObjectHeader) + FrameCount * sizeof(float) + 7) & ~7u;
+	}
+
+	// Appends passes to an object capture through a memory mapping of the file. Passes are written straight into the
+	// mapping, so there is no buffering and no write call on the pump. The file grows a segment at a time; a background
+	// thread maps and touches the next segment before the pump needs it and unmaps the ones it is done with, so the
+	// pump never waits on the file system. If the next segment isn't ready in time, the pass is dropped.
+	class ObjectCaptureWriter
+	{
+	public:
+		// Returns nullptr if the file can't be created, or captures aren't supported on this platform
+		static ObjectCaptureWriter* Create(const char* p_Path, uint32_t SampleRate);
+
+		// Stops the background thread and trims the file to what was written
+		~ObjectCaptureWriter();
+
+		// Timestamp for the passes, in ticks of the frequency in the file header
+		static int64_t Now();
+
+		// Starts the pass with the given sequence number. Returns false if there is no room for it right now, in which
+		// case the pass is dropped and AddObject and EndPass must not be called. Pump thread only.
+		bool BeginPass(uint64_t Sequence, int64_t BeginTimestamp, uint32_t NumObjects, uint32_t FrameCount);
+		void AddObject(uint32_t Index, uint32_t Type, float X, float Y, float Z, float Volume, const float* p_Samples);
+		void EndPass();
+
+		// Body of the background thread; runs until the writer is destroyed
+		void RunMapper();
+
+	protected:
+		struct Segment
+		{
+			unsigned char* p_Base;
+			uint64_t Offset;			// Of the segment in the file
+		};
+
+		ObjectCaptureWriter() {}
+
+		Segment* MapSegment(uint64_t Offset);
+		void UnmapSegment(Segment* p_Segment);
+
+		// File handle (Windows) or descriptor
+		intptr_t m_File = -1;
+
+		// Owned by the pump thread
+		Segment* m_Current = nullptr;
+		uint32_t m_Used = 0;					// Bytes written to the current segment
+		unsigned char* m_Pass = nullptr;		// Pass being written, between BeginPass and EndPass
+		uint32_t m_PassUsed = 0;
+		uint32_t m_FrameCount = 0;
+
+		// Handed between the pump and the background thread: the pump takes m_Next and leaves the segment it is
+		// done with in m_Retired
+		std::atomic<Segment*> m_Next;
+		std::atomic<Segment*> m_Retired;
+		uint64_t m_NextOffset = 0;				// Background thread only
+
+		std::atomic<bool> m_MapperActive;
+		std::thread m_Mapper;
+	};
+}
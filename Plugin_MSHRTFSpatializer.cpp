@@ -1,1021 +1,2666 @@
-#include "AudioPluginUtil.h"
-
-#include <wrl/client.h>
-#include <xapo.h>
-#include "hrtfapoapi.h"
-#include <DirectXMath.h>
-
-#include <stdint.h>
-#include <objbase.h>
-#include <memory>
-#include <mmreg.h>
-#include <windows.h>
-#include <stdlib.h>
-#include <malloc.h>
-#include <memory.h>
-#include <tchar.h>
-#include <devpropdef.h>
-#include <mmeapi.h>
-#include "SpatialAudioClient.h"
-#include "mmdeviceapi.h"
-#include <mmeapi.h>
-#include <wrl.h>
-#include <memory>
-#include <vector>
-#include <list>
-#include <iostream>
-
-using namespace Microsoft::WRL;
-
-// CONVENTIONS:
-//   Global variables g_NameOfVariable
-//   Member variables m_NameOfVariable
-//   Local variables NameOfVariable
-//   Pointer: p_NameOfVariable
-//   Defines/Consts NAME_OF_VARIABLE
-
-// TODOS
-//  1: All Mutex waits: what to do if wait is abandoned
-//  2: Remove goto statments
-
-namespace MSHRTFSpatializer
-{
-//################ TODO: REMOVE ################
-	// because of the way HRTF is initialized, and because the unity plugin is initialized before we can touch it via a script ...
-	//  if we want to expose all parameters we have to re-initialize the HRTF object inside ProcessCallback on first run if a param changes
-	float m_currentEnvironment = 1.f;	// these are the windows default values for these params
-	float m_currentMingain = -96.f;
-	float m_currentMaxgain = 12.f;
-	float m_currentUnitygain = 1.f;
-	float m_bypass_attenuation = 0.f;
-
-//################ DEFINES AND CONSTS ################
-	#define ISAC_CALLBACK_BUF_SIZE 4800
-	#define EMPTY_COUNT_LIMIT 5
-	#define ISACFRAMECOUNTPERPUMP 480
-
-	// This GUID uniquely identifies a Middleware Stack. WWise, FMod etc each will need to have their own GUID
-	// that should never change.
-	// We log this value as part of spatial audio client telemetry; and map the GUIDs to middleware
-	// while processing the telemetry, so we can filter telemetry by middleware.
-	const GUID UNITY_ISAC_MIDDLEWARE_ID = { 0xe07049bc, 0xa91e, 0x489d,{ 0xad, 0xeb, 0xb1, 0x70, 0xa4, 0xa, 0x30, 0x6f } };
-
-	// Middleware can use up to 4 integers to pass the version info
-	const int MAJOR_VERSION = 0;
-	const int MINOR_VERSION1 = 2;
-	const int MINOR_VERSION2 = 0;
-
-	// The sample rate required by ISAC
-	const int REQUIRED_SAMPLE_RATE = 48000;
-
-//################ ENUMS AND STRUCTS ################
-	enum
-	{
-		P_CUTOFFDIST = 0,
-		P_ENVIRONMENT,
-		P_MINGAIN,
-		P_MAXGAIN,
-		P_UNITYGAINDISTANCE,
-		P_BYPASS_ATTENUATION,
-		P_NUM
-	};
-
-	struct UnityAudioData
-	{
-		float p[P_NUM];
-
-		float	m_DataBuf[ISAC_CALLBACK_BUF_SIZE];
-		float	m_DataPosX[ISAC_CALLBACK_BUF_SIZE];
-		float	m_DataPosY[ISAC_CALLBACK_BUF_SIZE];
-		float	m_DataPosZ[ISAC_CALLBACK_BUF_SIZE];
-
-		UINT32	m_ReadIndex = 0;
-		UINT32	m_WriteIndex = 0;
-		BOOL	m_WriteIndexOverflowed = FALSE;
-
-		UINT32  m_EmptyCount = 0;
-
-		BOOL	m_InQueue = FALSE;
-
-		std::list<UnityAudioData *>::iterator m_UnityAudioObjectQueueIter;
-
-		HANDLE  m_Lock = nullptr;
-	};
-
-//################ GLOBALS ################
-	UINT32 g_SystemSampleRate = 0;
-
-	// Keeps track of how many ISAC objects will be available in the next processing pass
-	// ISAC can grant or revoke ISAC objects any time
-	UINT32 g_ISACObjectCount = 0;
-	HANDLE g_ISACObjectCountMutex = nullptr;
-
-	// "Queue" containing UnityAudioData objects that will be rendered by ISAC in the next
-	// processing pass. UnityAudioData objects are added/removed from this queue based on
-	// how many ISAC objects are available, and when Unity adds or removes audio objects to 
-	// the scene
-	std::list<UnityAudioData *> g_UnityAudioObjectQueue;
-	HANDLE g_UnityAudioObjectQueueMutex;
-
-	// Indicates if there is space in the queue above. Created to avoid checking
-	// the queue size again and again.
-	LONG g_ThereIsSpaceInUnityAudioObjectQueue = FALSE;
-
-	// Vector containing ISAC objects (not all objects in here are active or used)
-	std::vector<ComPtr<ISpatialAudioObject>> g_ISACObjectVector;
-
-	// Variables to manage operation of ISAC
-	ComPtr<ISpatialAudioClient> g_SpatialAudioClient;
-	ComPtr<ISpatialAudioObjectRenderStream> g_SpatialAudioStream;
-	HANDLE g_ISACBufferCompletionEvent;
-
-	// Indicates if this is the first time the CreateCallback is called
-	// this is an opportunity to initialize stuff
-	BOOL g_FirstCreateCallback = TRUE;
-
-	// Indicates if ISAC is up and running
-	BOOL g_SpatialAudioClientCreated = FALSE;
-
-	BOOL g_SpatialAudioRenderStreamCreated = FALSE;
-
-	// Worker thread for ISpatialAudioClient work
-	PTP_WORK g_WorkThread;
-	BOOL g_WorkThreadActive = FALSE;
-
-//################ CLASS AND FUNCTION DEFINITIONS ################
-	// Registers spatializer plugin parameters to Unity
-	int InternalRegisterEffectDefinition(UnityAudioEffectDefinition& definition)
-	{
-		// TODO would put realtime parameter control here: roomsize, decay types, min/max gains, zero-gain affected distance (unity gain), directionality?
-		int numparams = P_NUM;
-		definition.paramdefs = new UnityAudioParameterDefinition[numparams];
-		RegisterParameter(definition, "CutoffDist", "", 0.0f, 10000.0f, 999.0f, 1.0f, 1.0f, P_CUTOFFDIST, "HRTF cutoff distance");
-		RegisterParameter(definition, "Environment", "", 0.0f, 3.0f, m_currentEnvironment, 1.0f, 1.0f, P_ENVIRONMENT, "Environment size");
-		RegisterParameter(definition, "MinGain", "", -96.0f, 12.0f, m_currentMingain, 1.0f, 1.0f, P_MINGAIN, "Minimum gain allowed for room modelling");
-		RegisterParameter(definition, "MaxGain", "", -96.0f, 12.0f, m_currentMaxgain, 1.0f, 1.0f, P_MAXGAIN, "Maximum gain allowed for room modelling");
-		RegisterParameter(definition, "UnityGainDist", "", 0.05f, FLT_MAX, m_currentUnitygain, 1.0f, 1.0f, P_UNITYGAINDISTANCE, "Distance at which the gain applied is 0dB");
-		RegisterParameter(definition, "BypassCurves", "", 0.f, 1.f, m_bypass_attenuation, 1.0f, 1.0f, P_BYPASS_ATTENUATION, "Ignore the Unity Volume curves for more realistic simulation");
-		definition.flags |= UnityAudioEffectDefinitionFlags_IsSpatializer;
-		return numparams;
-	}
-
-	// Declaration
-	BOOL InitializeSpatialAudioClient(int sampleRate);
-	BOOL CreateSpatialAudioRenderStream();
-
-	// Function that actually sends data to ISAC. Runs in a separate thread, waits for
-	// ISAC to signal its invocation through g_ISACBufferCompletionEvent
-	VOID CALLBACK SpatialWorkCallbackNew(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_WORK Work)
-	{
-		HRESULT hr = S_OK;
-		hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);	// TODO: Find out why this is needed and how this affects things.
-		
-		Work;
-		Instance;
-
-		DWORD ISACBufferCompletionMaxWaitTime = 100;
-		// At this point, ISAC has initialized and we can start sending data to it.
-		while (g_WorkThreadActive)
-		{
-			UINT32 FrameCount = 0;
-			UINT32 AvailableObjectCount = 0;
-			UINT32 ISACObjInx = 0;
-
-			// Wait for ISAC Event 
-			if (WaitForSingleObject(g_ISACBufferCompletionEvent, ISACBufferCompletionMaxWaitTime) != WAIT_OBJECT_0)
-			{
-				// Ideally, we should get an ISAC event every 10ms when ISAC is active.
-				// So if we don't get the event within 100 ms, we have an issue. There
-				// are three possibilities that we can do something about: 
-				// 
-				// 1. ISAC hasn't been initialized yet. So we initialize it.
-				//
-				// 2. ISAC Render stream initialization failed because Spatial Audio is
-				//    turned off (Spatial Rendering Mode is set to None). In this case
-				//    we want to keep trying to create the ISAC stream to check if Spatial Audio
-				//    has been enabled by the user.
-				//
-				// 3. The ISAC graph was torn down because the user changed the Spatial 
-				//    Rendering mode or changed the Default device. We try to detect if 
-				//    that is the case. If so, we reset everything and try to initialize 
-				//    ISAC again. Meanwhile, rendering will be handled by Unity.
-
-				// Case 1
-				if (!g_SpatialAudioClientCreated)
-				{
-					g_SpatialAudioClientCreated = InitializeSpatialAudioClient(g_SystemSampleRate);
-					continue;
-				}
-
-				// Case 2
-				if (!g_SpatialAudioRenderStreamCreated)
-				{
-					g_SpatialAudioRenderStreamCreated = CreateSpatialAudioRenderStream();
-					continue;
-				}
-
-				// Case 3: If the ISAC graph was torn down, we will get an error when calling this method
-				hr = g_SpatialAudioStream->Reset();
-
-				if (FAILED(hr))
-				{
-					g_SpatialAudioRenderStreamCreated = FALSE;
-
-					for (std::list<UnityAudioData*>::iterator iter = g_UnityAudioObjectQueue.begin(); iter != g_UnityAudioObjectQueue.end(); iter++)
-					{
-						UnityAudioData *p_ObjData = *iter;
-
-						p_ObjData->m_InQueue = FALSE;
-					}
-
-					g_UnityAudioObjectQueue.clear();
-
-					g_SpatialAudioClientCreated = InitializeSpatialAudioClient(g_SystemSampleRate);
-
-					g_SpatialAudioRenderStreamCreated = CreateSpatialAudioRenderStream();
-
-					if (g_SpatialAudioRenderStreamCreated)
-					{
-						ISACBufferCompletionMaxWaitTime = 100;
-					}
-				}
-				continue;
-			}
-			
-			// If we discover that UnityAudioObject needs to be removed from g_UnityAudioObjectQueue,
-			// we put it into this temporary Queue and remove it later in this function.
-			std::list<UnityAudioData *> RemoveQueue;
-
-			// In order to not hold down the g_UnityAudioObjectQueue lock for too long, we just make a copy of it
-			// locally and render using that.
-			std::list<UnityAudioData *> LocalCopyOfQueue;
-			DWORD dwWaitResult = WaitForSingleObject(g_UnityAudioObjectQueueMutex, INFINITE);
-				if (dwWaitResult == WAIT_OBJECT_0)
-				{
-					LocalCopyOfQueue = g_UnityAudioObjectQueue;		// Make a local copy of the queue
-				}
-			ReleaseMutex(g_UnityAudioObjectQueueMutex);
-
-			// Copy data over to ISAC within a Begin/EndUpdatingAudioObjects() block
-			hr = g_SpatialAudioStream->BeginUpdatingAudioObjects( &AvailableObjectCount, &FrameCount);
-			if (FAILED(hr))
-			{
-				continue;
-			}
-
-			{
-				// Go through the local copy of the g_UnityAudioObjectQueue and copy data to ISAC Objects
-				for (std::list<UnityAudioData*>::iterator iter = LocalCopyOfQueue.begin(); iter != LocalCopyOfQueue.end(); iter++)
-				{
-					UnityAudioData *p_ObjData = *iter;
-
-					// Defensive check
-					if (ISACObjInx >= AvailableObjectCount)
-					{
-						continue;
-					}
-
-					ComPtr<ISpatialAudioObject> &p_ObjISAC = g_ISACObjectVector[ISACObjInx];
-					ISACObjInx++;
-
-					if (p_ObjISAC == nullptr)
-					{
-						hr = g_SpatialAudioStream->ActivateSpatialAudioObject(AudioObjectType_Dynamic, &p_ObjISAC);
-						if (FAILED(hr))
-						{
-							continue;
-						}
-					}
-
-					BOOL IsActive = FALSE;
-					hr = p_ObjISAC->IsActive(&IsActive);
-					if (!IsActive)
-					{
-						p_ObjISAC = nullptr;
-
-						hr = g_SpatialAudioStream->ActivateSpatialAudioObject(AudioObjectType_Dynamic, &p_ObjISAC);
-						if (FAILED(hr))
-						{
-							continue;
-						}
-					}
-
-					// We use circular buffers to sync between Unity and ISAC; if the buffer circled back, take that into account
-					UINT32 ActualWriteIndex;
-					DWORD dwWaitResultIn = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-						if (dwWaitResultIn == WAIT_OBJECT_0)
-						{
-							ActualWriteIndex = p_ObjData->m_WriteIndexOverflowed ? p_ObjData->m_WriteIndex + ISAC_CALLBACK_BUF_SIZE : p_ObjData->m_WriteIndex;
-						}
-					ReleaseMutex(p_ObjData->m_Lock);
-
-					BOOL EnoughData = ((float)ActualWriteIndex - (float)p_ObjData->m_ReadIndex) >= 2*(float)ISACFRAMECOUNTPERPUMP;
-
-					//Get the object buffer
-					BYTE* p_ISACObjBuffer = nullptr;
-					UINT32 ByteCount;
-					hr = p_ObjISAC->GetBuffer(&p_ISACObjBuffer, &ByteCount);
-					if (FAILED(hr))
-					{
-						continue;
-					}
-
-					p_ObjISAC->SetPosition(p_ObjData->m_DataPosX[p_ObjData->m_ReadIndex],
-											p_ObjData->m_DataPosY[p_ObjData->m_ReadIndex],
-											p_ObjData->m_DataPosZ[p_ObjData->m_ReadIndex]);
-
-					p_ObjISAC->SetVolume(1.0f);
-
-					if (EnoughData)
-					{
-						for (UINT32 inx = 0; inx < ISACFRAMECOUNTPERPUMP; inx++)
-						{
-							//*((float*)buffer) = 0.0f;
-							*((float*)p_ISACObjBuffer) = p_ObjData->m_DataBuf[p_ObjData->m_ReadIndex];
-							p_ISACObjBuffer += sizeof(float); // this is a BYTE array and we filled it up with a float
-
-							p_ObjData->m_ReadIndex++;
-							if (p_ObjData->m_ReadIndex >= ISAC_CALLBACK_BUF_SIZE)
-							{
-								p_ObjData->m_ReadIndex -= ISAC_CALLBACK_BUF_SIZE;
-
-								DWORD dwWaitResultIn = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-									if (dwWaitResultIn == WAIT_OBJECT_0)
-									{
-										p_ObjData->m_WriteIndexOverflowed = FALSE;
-									}
-								ReleaseMutex(p_ObjData->m_Lock);
-							}
-						}
-					}
-					else
-					{
-						UINT32 CurObjEmptyCount = 0;
-						DWORD dwWaitResultIn = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-							if (dwWaitResultIn == WAIT_OBJECT_0)
-							{
-								CurObjEmptyCount = ++(p_ObjData->m_EmptyCount);
-							}
-						ReleaseMutex(p_ObjData->m_Lock);
-
-						if (CurObjEmptyCount == EMPTY_COUNT_LIMIT)
-						{
-							RemoveQueue.push_back(p_ObjData);
-						}
-
-						// fill with silence
-						for (UINT32 inx = 0; inx < ISACFRAMECOUNTPERPUMP; inx++)
-						{
-							*((float*)p_ISACObjBuffer) = 0.0f;
-							p_ISACObjBuffer += sizeof(float);
-						}
-					}
-				}
-			}
-
-			// Let the audio-engine know that the object data are available for processing now 
-			hr = g_SpatialAudioStream->EndUpdatingAudioObjects();
-			if (FAILED(hr))
-			{
-				continue;
-			}
-
-			// Remove inactive UnityAudioObject from the Queue
-			if (!RemoveQueue.empty())
-			{
-				DWORD dwWaitResult = WaitForSingleObject(g_UnityAudioObjectQueueMutex, INFINITE);
-					if (dwWaitResult == WAIT_OBJECT_0)
-					{
-						// Go through the remove queue and remove the elements in it from the global queue
-						while (!RemoveQueue.empty())
-						{
-							UnityAudioData *p_ObjData = RemoveQueue.front();
-							RemoveQueue.pop_front();
-
-							// Check one last time before removing
-							DWORD dwWaitResultIn = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-								if (dwWaitResultIn == WAIT_OBJECT_0)
-								{
-									if (p_ObjData->m_EmptyCount == EMPTY_COUNT_LIMIT)
-									{
-										g_UnityAudioObjectQueue.erase(p_ObjData->m_UnityAudioObjectQueueIter);
-										p_ObjData->m_InQueue = FALSE;
-									}
-								}
-							ReleaseMutex(p_ObjData->m_Lock);
-						}
-					}
-
-					if (g_UnityAudioObjectQueue.size() < g_ISACObjectCount)
-					{
-						InterlockedExchange(&g_ThereIsSpaceInUnityAudioObjectQueue, TRUE);
-					}
-				ReleaseMutex(g_UnityAudioObjectQueueMutex);
-			}
-		}
-	}
-
-	// When creating the ISAC client, we can pass in activation parameters for telemetry purposes. This includes a GUID to indicate which middleware
-	// is using the API, and the version of the middleware. In this code, I use a GUID specifically for this Unity Plugin.
-	HRESULT CreateSpatialAudioClientActivationParams(GUID contextId, GUID appId, int majorVer, int minorVer1, int minorVer2, int minorVer3, PROPVARIANT* pActivationParams)
-	{
-		PROPVARIANT var;
-		PropVariantInit(&var);
-
-		SpatialAudioClientActivationParams* params = reinterpret_cast<SpatialAudioClientActivationParams*>(CoTaskMemAlloc(sizeof(SpatialAudioClientActivationParams)));
-
-		if (params == nullptr)
-		{
-			return E_OUTOFMEMORY;
-		}
-
-		params->tracingContextId = contextId;
-		params->appId = appId;
-		params->majorVersion = majorVer;
-		params->minorVersion1 = minorVer1;
-		params->minorVersion2 = minorVer2;
-		params->minorVersion3 = minorVer3;
-		var.vt = VT_BLOB;
-		var.blob.cbSize = sizeof(*params);
-		var.blob.pBlobData = reinterpret_cast<BYTE *>(params);
-		*pActivationParams = var;
-
-		return S_OK;
-	}
-	
-	// If we're building the Plugin for use in UWP apps, then we need to Initialize ISAC using an Initializer class
-#ifdef UWPBUILD
-	class ISACInitializer :
-		public Microsoft::WRL::RuntimeClass< Microsoft::WRL::RuntimeClassFlags< Microsoft::WRL::ClassicCom >, Microsoft::WRL::FtmBase, IActivateAudioInterfaceCompletionHandler >
-	{
-	public:
-		ISACInitializer();
-		~ISACInitializer();
-
-		Platform::String^		m_DeviceIdString;
-		bool					m_ISACDeviceActive;
-
-		ISpatialAudioClient	   *m_SpatialAudioClient;
-		HANDLE                  m_CompletedEvent;
-		HRESULT					m_ActivateHResult;
-
-		HRESULT InitializeAudioDeviceAsync();
-
-		STDMETHOD(ActivateCompleted) (IActivateAudioInterfaceAsyncOperation *operation);
-	};
-
-	ISACInitializer::ISACInitializer() :
-		m_SpatialAudioClient(nullptr),
-		m_ActivateHResult(E_FAIL)
-	{
-		m_CompletedEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-	}
-
-	ISACInitializer::~ISACInitializer()
-	{
-		CloseHandle(m_CompletedEvent);
-	}
-
-	HRESULT ISACInitializer::InitializeAudioDeviceAsync()
-	{
-		ComPtr<IActivateAudioInterfaceAsyncOperation> AsyncOp;
-		HRESULT hr = S_OK;
-		PROPVARIANT ActivationParams;
-		PROPVARIANT* p_ActivationParams = nullptr;
-
-		// Get a string representing the Default Audio Device Renderer
-		m_DeviceIdString = Windows::Media::Devices::MediaDevice::GetDefaultAudioRenderId(Windows::Media::Devices::AudioDeviceRole::Default);
-
-		// Create activation params - this specifies a GUID that lets ISAC know that the Middleware being used by the App is Unity
-		hr = CreateSpatialAudioClientActivationParams(GUID_NULL, UNITY_ISAC_MIDDLEWARE_ID, MAJOR_VERSION, MINOR_VERSION1, MINOR_VERSION2, 0, &ActivationParams);
-		p_ActivationParams = SUCCEEDED(hr) ? &ActivationParams : nullptr;
-
-		// This call must be made on the main UI thread.  Async operation will call back to 
-		// IActivateAudioInterfaceCompletionHandler::ActivateCompleted, which must be an agile interface implementation
-		hr = ActivateAudioInterfaceAsync(m_DeviceIdString->Data(), __uuidof(ISpatialAudioClient), p_ActivationParams, this, &AsyncOp);
-		if (FAILED(hr))
-		{
-			m_ISACDeviceActive = false;
-		}
-
-		return hr;
-	}
-
-	HRESULT ISACInitializer::ActivateCompleted(IActivateAudioInterfaceAsyncOperation *operation)
-	{
-		HRESULT hr = S_OK;
-		IUnknown *p_AudioInterface = nullptr;
-
-		hr = operation->GetActivateResult(&m_ActivateHResult, &p_AudioInterface);
-
-		if (p_AudioInterface == nullptr)
-		{
-			hr = E_FAIL;
-			goto exit;
-		}
-
-		// Finally. Get the pointer for the Spatial Audio Client Interface
-		p_AudioInterface->QueryInterface(IID_PPV_ARGS(&m_SpatialAudioClient));
-
-		if (m_SpatialAudioClient == nullptr)
-		{
-			hr = E_FAIL;
-			goto exit;
-		}
-
-	exit:
-		if (p_AudioInterface != nullptr)
-		{
-			p_AudioInterface->Release();
-			p_AudioInterface = nullptr;
-		}
-
-		if (FAILED(hr))
-		{
-			if (m_SpatialAudioClient != nullptr)
-			{
-				m_SpatialAudioClient->Release();
-				m_SpatialAudioClient = nullptr;
-			}
-		}
-
-		// Signal the completion of the Asynchronous Activation operation
-		SetEvent(m_CompletedEvent);
-		return S_OK;
-	}
-		
-	ISpatialAudioClient* GetSpatialAudioClientFromInitializer()
-	{
-		ISACInitializer Initializer;
-		DWORD dwWaitResult;
-
-		HRESULT hr;
-
-		hr = Initializer.InitializeAudioDeviceAsync();
-		if (FAILED(hr))
-		{
-			return nullptr;
-		}
-
-		dwWaitResult = WaitForSingleObject(Initializer.m_CompletedEvent, INFINITE);
-		if (dwWaitResult == WAIT_OBJECT_0)
-		{
-			hr = S_OK;
-		}
-		else if (dwWaitResult == WAIT_TIMEOUT)
-		{
-			hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
-			//TODO ERROR HANDLING
-		}
-		else if (dwWaitResult == WAIT_FAILED)
-		{
-			hr = HRESULT_FROM_WIN32(GetLastError());
-			//TODO ERROR HANDLING
-		}
-		else
-		{
-			hr = E_FAIL;
-			//TODO ERROR HANDLING
-		}
-
-		if (Initializer.m_ActivateHResult != S_OK)
-		{
-			return nullptr;
-		}
-		else
-		{
-			return Initializer.m_SpatialAudioClient;
-		}
-	}
-#endif
-
-	// ISAC Notifies us when its object count changes. This class is used to get that notification.
-	class ISACNotify WrlSealed :
-		public Microsoft::WRL::RuntimeClass<
-		Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>,
-		ISpatialAudioObjectRenderStreamNotify,
-		Microsoft::WRL::FtmBase>
-	{
-	public:
-		STDMETHOD(OnAvailableDynamicObjectCountChange)(
-			_In_ ISpatialAudioObjectRenderStreamBase *sender,
-			_In_ LONGLONG hnsComplianceDeadlineTime,
-			_In_ UINT32 objectCount)
-		{
-			BOOL CountLowered = FALSE;
-			UINT32 Difference = 0;
-
-			// Change g_ISACObjectCount to reflect the new value
-			DWORD dwWaitResult = WaitForSingleObject(g_ISACObjectCountMutex, INFINITE);
-				if (dwWaitResult == WAIT_OBJECT_0)
-				{
-					if (objectCount < g_ISACObjectCount)
-					{
-						CountLowered = TRUE;
-						Difference = g_ISACObjectCount - objectCount;
-					}
-					else if (objectCount > g_ISACObjectCount)
-					{
-						InterlockedExchange(&g_ThereIsSpaceInUnityAudioObjectQueue, TRUE);		// Indicates that there is more space in the queue
-					}
-
-					g_ISACObjectCount = objectCount;
-				}
-			ReleaseMutex(g_ISACObjectCountMutex);
-			
-			if (CountLowered)
-			{
-				// Resize the queue by removing elements from the end
-				dwWaitResult = WaitForSingleObject(g_UnityAudioObjectQueueMutex, INFINITE);
-					if (dwWaitResult == WAIT_OBJECT_0)
-					{
-						while (Difference > 0 && g_UnityAudioObjectQueue.size() > 0)
-						{
-							// Pop from queue
-							UnityAudioData* p_ObjData = g_UnityAudioObjectQueue.back();
-							g_UnityAudioObjectQueue.pop_back();
-							Difference--;
-
-							// Update status of object to 'not in queue'
-							DWORD dwWaitResultIn = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-								if (dwWaitResultIn == WAIT_OBJECT_0)
-								{
-									p_ObjData->m_InQueue = FALSE;
-								}
-							ReleaseMutex(p_ObjData->m_Lock);
-						}
-					}
-				ReleaseMutex(g_UnityAudioObjectQueueMutex);
-			}
-			return S_OK;
-		}
-	};
-	ISACNotify g_notifyObj;
-
-	BOOL InitializeSpatialAudioClient(int sampleRate) 
-	{
-		IMMDevice* p_Device = NULL;
-		IMMDeviceEnumerator* p_Enumerator = NULL;
-		HRESULT hr = S_OK;
-		PROPVARIANT* p_ActivationParams = nullptr;
-
-		// Reset ISAC variables in case we are restarting ISAC
-		g_SpatialAudioClient = nullptr;
-		g_SpatialAudioStream = nullptr;
-
-		// ISAC only supports 48K at this point
-		// TODO: Add support for other sampling rates when ISAC adds support for them.
-		g_SystemSampleRate = sampleRate;
-		if (g_SystemSampleRate != REQUIRED_SAMPLE_RATE)	
-			return FALSE;
-
-#ifndef UWPBUILD
-		/* QUERY IMMDEVICE TO GET DEFAULT ENDPOINT AND INITIALIZE ISAC ON IT */
-		CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),	(void**)&p_Enumerator);
-
-		p_Enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &p_Device);
-
-		if (!&p_Device)
-			return FALSE;
-
-		PROPVARIANT activationParams;
-
-		// Create activation params - this specifies a GUID that lets ISAC know that the Middleware being used by the App is Unity
-		hr = CreateSpatialAudioClientActivationParams(GUID_NULL, UNITY_ISAC_MIDDLEWARE_ID, MAJOR_VERSION, MINOR_VERSION1, MINOR_VERSION2, 0, &activationParams);
-		p_ActivationParams = SUCCEEDED(hr) ? &activationParams : nullptr;
-
-		hr = p_Device->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, p_ActivationParams, (void**)&g_SpatialAudioClient);
-#else
-		g_SpatialAudioClient = GetSpatialAudioClientFromInitializer();
-#endif
-	
-		if (g_SpatialAudioClient == nullptr)
-		{
-			// Spatial Audio Client creation failed
-			return FALSE;
-		}
-
-		return TRUE;
-	}
-
-	BOOL CreateSpatialAudioRenderStream()
-	{
-		HRESULT hr = S_OK;
-
-		if (g_SpatialAudioClient == nullptr)
-		{
-			return FALSE;
-		}
-
-		// Check the available rendering formats 
-		ComPtr<IAudioFormatEnumerator> AudioObjectFormatEnumerator;
-		hr = g_SpatialAudioClient->GetSupportedAudioObjectFormatEnumerator(&AudioObjectFormatEnumerator);
-		if (FAILED(hr))
-		{
-			return FALSE;
-		}
-
-		WAVEFORMATEX* p_ObjectFormat = nullptr;
-
-		UINT32 AudioObjectFormatCount;
-		hr = AudioObjectFormatEnumerator->GetCount(&AudioObjectFormatCount); // There should be at least one format that the API accepts
-		if (AudioObjectFormatCount == 0)
-		{
-			return FALSE;
-		}
-
-		// Select the most favorable format: the first one
-		hr = AudioObjectFormatEnumerator->GetFormat(0, &p_ObjectFormat);
-		if (FAILED(hr))
-		{
-			return FALSE;
-		}
-
-		// Ask ISAC about the maximum number of objects we can have
-		UINT32 MaxNumISACObjects = 0;
-		hr = g_SpatialAudioClient->GetMaxDynamicObjectCount(&MaxNumISACObjects);
-		if (FAILED(hr))
-		{
-			return FALSE;
-		}
-
-		// This means Spatial Audio is turned off on this endpoint, return failure
-		if (MaxNumISACObjects == 0)
-		{
-			return FALSE;
-		}
-
-		g_ISACObjectVector.resize(MaxNumISACObjects, nullptr);
-
-		SpatialAudioObjectRenderStreamActivationParams Params = {};
-		Params.Category = AudioCategory_GameEffects;
-		Params.EventHandle = g_ISACBufferCompletionEvent;
-		Params.MinDynamicObjectCount = (UINT32)(0.2f * (float)MaxNumISACObjects);		// set minimum to 20% of max
-		Params.MaxDynamicObjectCount = MaxNumISACObjects;
-		Params.NotifyObject = &g_notifyObj;
-		Params.ObjectFormat = p_ObjectFormat;
-		Params.StaticObjectTypeMask = AudioObjectType_None;		// No Static bed objects
-
-		PROPVARIANT ActivateParams;
-		PropVariantInit(&ActivateParams);
-		ActivateParams.vt = VT_BLOB;
-		ActivateParams.blob.cbSize = sizeof(Params);
-		ActivateParams.blob.pBlobData = reinterpret_cast<BYTE*>(&Params);
-
-		hr = g_SpatialAudioClient->ActivateSpatialAudioStream(&ActivateParams, __uuidof(ISpatialAudioObjectRenderStream), &g_SpatialAudioStream);
-		if (FAILED(hr))
-		{
-			return FALSE;
-		}
-
-		hr = g_SpatialAudioStream->Start();
-		if (FAILED(hr))
-		{
-			return FALSE;
-		}
-
-		return TRUE;
-	}
-
-	static UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK DistanceAttenuationCallback(UnityAudioEffectState* state, float distanceIn, float attenuationIn, float* attenuationOut)
-	{
-		*attenuationOut = attenuationIn;
-		return UNITY_AUDIODSP_OK;
-	}
-
-	inline bool IsHostCompatible(UnityAudioEffectState* state)
-    {
-        // Somewhat convoluted error checking here because hostapiversion is only supported from SDK version 1.03 (i.e. Unity 5.2) and onwards.
-		return
-            state->structsize >= sizeof(UnityAudioEffectState) &&
-            state->hostapiversion >= UNITY_AUDIO_PLUGIN_API_VERSION;
-    }
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK CreateCallback(UnityAudioEffectState* state)
-	{
-		// Create the object which contains the buffer and variables necessary 
-		// for transfer of audio data from Unity to ISAC audio objects
-		UnityAudioData* p_ObjData = new UnityAudioData;
-		memset (p_ObjData, 0, sizeof(UnityAudioData));
-
-		p_ObjData->m_Lock = CreateMutex(NULL, FALSE, NULL);
-		if (p_ObjData->m_Lock == NULL)
-		{
-			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-		}
-
-		state->effectdata = p_ObjData;
-
-		// Fills in default values (from the effects definition) into the params array
-		InitParametersFromDefinitions(InternalRegisterEffectDefinition, p_ObjData->p);
-
-		// If the current Unity version supports it, set the distance attenuation callback
-		if (IsHostCompatible(state))
-			state->spatializerdata->distanceattenuationcallback = DistanceAttenuationCallback;
-
-		// If this is the first ever create callback, we need to initialize some stuff in order
-		// for ISAC to work. This includes creating mutexes and starting the Spatial Work thread.
-		if (g_FirstCreateCallback)	
-		{
-			g_UnityAudioObjectQueueMutex = CreateMutex(NULL, FALSE, NULL);
-			if (g_UnityAudioObjectQueueMutex == NULL)
-			{
-				return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-			}
-
-			g_ISACObjectCountMutex = CreateMutex(NULL, FALSE, NULL);
-			if (g_ISACObjectCountMutex == NULL)
-			{
-				return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-			}
-
-			g_SystemSampleRate = state->samplerate;
-
-			// Create event used to signal the worker thread for more data.
-			g_ISACBufferCompletionEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-
-			// Create the Spatial Work thread. This also takes care of initializing ISAC for us.
-			g_WorkThreadActive = TRUE;
-			g_WorkThread = CreateThreadpoolWork(SpatialWorkCallbackNew, nullptr, nullptr);
-			SubmitThreadpoolWork(g_WorkThread);
-
-			g_FirstCreateCallback = FALSE;
-		}
-
-		return UNITY_AUDIODSP_OK;
-	}
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK ReleaseCallback(UnityAudioEffectState* state)
-	{
-		UnityAudioData* objData = state->GetEffectData<UnityAudioData>();
-
-		// Wait until the EmptyCount for the object becomes the limit
-		// At that point, it would have been removed from the queue, so it is safe to delete it
-		while (TRUE)
-		{
-			if (objData->m_InQueue == FALSE)
-			{
-				//Wait a millisecond before deleting it
-				Sleep(1);
-				delete objData;
-				break;
-			}
-			else
-			{
-				// Wait 10ms until it has been removed from the queue
-				Sleep(10);
-			}
-		}
-
-		return UNITY_AUDIODSP_OK;
-	}
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK SetFloatParameterCallback(UnityAudioEffectState* state, int index, float value)
-	{
-		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
-		if (index >= P_NUM)
-			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-		p_ObjData->p[index] = value;
-		return UNITY_AUDIODSP_OK;
-	}
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK GetFloatParameterCallback(UnityAudioEffectState* state, int index, float* value, char *valuestr)
-	{
-		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
-		if (index >= P_NUM)
-			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-		if (value != NULL)
-			*value = p_ObjData->p[index];
-		if (valuestr != NULL)
-			valuestr[0] = 0;
-		return UNITY_AUDIODSP_OK;
-	}
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK GetFloatBufferCallback(UnityAudioEffectState* state, const char* name, float* buffer, int numsamples)
-	{
-		return UNITY_AUDIODSP_OK;
-	}
-
-	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK ProcessCallback(UnityAudioEffectState* state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels)
-	{
-		// If ISAC hasn't been initialized yet, or if the provided data doesn't meet ISAC's requirements, just pass it back to Unity
-		if (g_SpatialAudioClientCreated != TRUE || g_SpatialAudioRenderStreamCreated != TRUE || inchannels != 2 || outchannels != 2 || g_SystemSampleRate != REQUIRED_SAMPLE_RATE)
-		{
-			memcpy(outbuffer, inbuffer, length * outchannels * sizeof(float));
-			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
-		}
-
-		BOOL SendDataToISAC = TRUE;
-
-		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
-
-		DWORD dwWaitResult = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-			if (dwWaitResult == WAIT_OBJECT_0)
-			{
-				// Since this object has new data, revert EmptyCount back to 0
-				p_ObjData->m_EmptyCount = 0;
-			}
-			ReleaseMutex(p_ObjData->m_Lock);
-
-				// If the object isn't already in the queue, check if there's space to add it
-				if (p_ObjData->m_InQueue == FALSE)
-				{
-					LONG ThereIsSpaceInQueue = InterlockedCompareExchange(&g_ThereIsSpaceInUnityAudioObjectQueue, 0, 0);
-					BOOL ObjectQueuedToISAC = FALSE;
-
-					// If the queue has space, lock it and try to put this object in it
-					if (ThereIsSpaceInQueue)
-					{
-						// Get how many objects ISAC can render in the next processing pass
-						DWORD dwWaitResultIn = WaitForSingleObject(g_ISACObjectCountMutex, INFINITE);
-							if (dwWaitResultIn == WAIT_OBJECT_0)
-							{
-								DWORD dwWaitResultInIn = WaitForSingleObject(g_UnityAudioObjectQueueMutex, INFINITE);
-									if (dwWaitResultInIn == WAIT_OBJECT_0)
-									{
-										ObjectQueuedToISAC = g_UnityAudioObjectQueue.size() < g_ISACObjectCount;
-
-										// Only queue this object to be rendered by ISAC if the queue has enough capacity 
-										if (ObjectQueuedToISAC)
-										{
-											g_UnityAudioObjectQueue.push_back(p_ObjData);
-											DWORD dwWaitResult = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-											if (dwWaitResult == WAIT_OBJECT_0)
-											{
-												// Set Read and Write Indexes back to 0 in case this object was taken
-												// off queue so that ISAC doesn't render stale data.
-												p_ObjData->m_ReadIndex = 0;
-												p_ObjData->m_WriteIndex = 0;
-												p_ObjData->m_WriteIndexOverflowed = FALSE;
-												p_ObjData->m_EmptyCount = 0;
-
-												p_ObjData->m_UnityAudioObjectQueueIter = --g_UnityAudioObjectQueue.end();
-												p_ObjData->m_InQueue = TRUE;
-											}
-											ReleaseMutex(p_ObjData->m_Lock);
-
-											if (g_UnityAudioObjectQueue.size() == g_ISACObjectCount)
-											{
-												InterlockedExchange(&g_ThereIsSpaceInUnityAudioObjectQueue, FALSE);
-											}
-										}
-									}
-								ReleaseMutex(g_UnityAudioObjectQueueMutex);
-							}
-						ReleaseMutex(g_ISACObjectCountMutex);
-					}
-
-					if (!ObjectQueuedToISAC)
-					{
-						// If the queue didn't have enough space, then send the data back to Unity
-						memcpy(outbuffer, inbuffer, length * outchannels * sizeof(float));
-						SendDataToISAC = FALSE;
-					}
-				}
-
-				if (SendDataToISAC)
-				{
-					memset(outbuffer, 0, length);	// Send back silence to Unity since this will be rendered by ISAC
-
-					// Convert position data from Unity's coordinate system to ISAC's coordinate system
-					float* m = state->spatializerdata->listenermatrix;
-					float* s = state->spatializerdata->sourcematrix;
-
-					// Currently we ignore source orientation and only use source position
-					float px = s[12];
-					float py = s[13];
-					float pz = s[14];
-
-					float dir_x = m[0] * px + m[4] * py + m[8] * pz + m[12];
-					float dir_y = m[1] * px + m[5] * py + m[9] * pz + m[13];
-					float dir_z = m[2] * px + m[6] * py + m[10] * pz + m[14];
-
-					DWORD dwWaitResult = WaitForSingleObject(p_ObjData->m_Lock, INFINITE);
-					if (dwWaitResult == WAIT_OBJECT_0)
-					{
-
-						for (UINT32 inx = 0; inx < length; inx++)
-						{
-							p_ObjData->m_WriteIndex++;
-
-							if (p_ObjData->m_WriteIndex >= ISAC_CALLBACK_BUF_SIZE)
-							{
-								p_ObjData->m_WriteIndex -= ISAC_CALLBACK_BUF_SIZE;
-								p_ObjData->m_WriteIndexOverflowed = TRUE;
-							}
-
-							p_ObjData->m_DataPosX[p_ObjData->m_WriteIndex] = dir_x;
-							p_ObjData->m_DataPosY[p_ObjData->m_WriteIndex] = dir_y;
-							p_ObjData->m_DataPosZ[p_ObjData->m_WriteIndex] = -dir_z;
-
-							p_ObjData->m_DataBuf[p_ObjData->m_WriteIndex] = inbuffer[inx * 2];
-						}
-					}
-					ReleaseMutex(p_ObjData->m_Lock);
-				}
-
-
-		return UNITY_AUDIODSP_OK;
-	}
-}
-
+#include "AudioPluginUtil.h"
+#include "SpatialAudioSink.h"
+#include "RecordingSink.h"
+#include "SpatializerCapture.h"
+#include "RealtimeCheck.h"
+#include "WorkerPool.h"
+#include "AudioBlockPool.h"
+#include "HrirDatabase.h"
+#include "BinauralRenderer.h"
+#include "FdnReverb.h"
+
+#include <wrl/client.h>
+#include <xapo.h>
+#include "hrtfapoapi.h"
+#include <DirectXMath.h>
+
+#include <stdint.h>
+#include <objbase.h>
+#include <memory>
+#include <mmreg.h>
+#include <windows.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <memory.h>
+#include <tchar.h>
+#include <devpropdef.h>
+#include <mmeapi.h>
+#include "SpatialAudioClient.h"
+#include "mmdeviceapi.h"
+#include <mmeapi.h>
+#include <wrl.h>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+using namespace Microsoft::WRL;
+
+// CONVENTIONS:
+//   Global variables g_NameOfVariable
+//   Member variables m_NameOfVariable
+//   Local variables NameOfVariable
+//   Pointer: p_NameOfVariable
+//   Defines/Consts NAME_OF_VARIABLE
+
+// TODOS
+//  1: Remove goto statments
+
+namespace MSHRTFSpatializer
+{
+//################ DEFINES AND CONSTS ################
+	// Defaults of the room modelling parameters, which are those of the Windows HRTF APO
+	#define DEFAULT_ENVIRONMENT ReverbEnvironment_Medium
+	#define DEFAULT_MIN_GAIN -96.0f
+	#define DEFAULT_MAX_GAIN 12.0f
+	#define DEFAULT_UNITY_GAIN_DISTANCE 1.0f
+	#define DEFAULT_BYPASS_CURVES 0.0f
+
+	// Longest block of audio from ProcessCallback that is sent to ISAC (85ms at 48kHz); the rest of a longer one is dropped
+	#define ISAC_MAX_BLOCK_SIZE 4096
+	// One position per block, enough for 64 sample blocks filling a whole chain of audio blocks
+	#define ISAC_POSITION_QUEUE_SIZE 64
+	#define EMPTY_COUNT_LIMIT 5
+	#define ISACFRAMECOUNTPERPUMP 480
+
+	// Size of the table of sources with a dynamic ISAC object. The budget ISAC grants is capped to this.
+	#define ISAC_MAX_DYNAMIC_OBJECTS 256
+
+	// Set to a thread count above 1 to fill the dynamic objects of each pump on that many threads (see SetObjectFillThreads).
+	// A pump with fewer objects than PARALLEL_FILL_MIN_OBJECTS is filled on the pump thread alone, as waking the workers
+	// would cost more than it saves.
+	#define FILL_THREADS_ENVIRONMENT_VARIABLE "UNITY_ISAC_FILL_THREADS"
+	#define PARALLEL_FILL_MIN_OBJECTS 8
+
+	// A culled source is only re-admitted once it is closer than CutoffDist * CULL_HYSTERESIS
+	#define CULL_HYSTERESIS 0.9f
+
+	// Attenuation at or below this level is reported to Unity as silence, so that its voice management can virtualize the source
+	#define INAUDIBLE_GAIN_DB -96.0f
+	#define MIN_ATTENUATION_DISTANCE 0.001f
+
+	// A block whose peak level stays below this (-100 dB) is treated as digital silence
+	#define SILENCE_THRESHOLD 1e-5f
+
+	// A source is only taken off its ISAC object once its input has stayed silent this long (200 ms at 48 kHz), so that
+	// the gaps in a gated or rhythmic signal don't have it give its object up and claim one back every few blocks
+	#define SILENCE_RELEASE_SAMPLES 9600
+
+	// Voices beyond the dynamic object budget are panned into the bed (see ISAC_BED_MASK), up to this many at once
+	#define ISAC_BED_MAX_SOURCES 128
+
+	// Sources that are mostly 2D (spatial blend below this) or spread wider than this (in degrees) go straight to the bed,
+	// leaving the dynamic objects to point-like sources
+	#define BED_ROUTE_SPATIAL_BLEND 0.5f
+	#define BED_ROUTE_SPREAD 90.0f
+
+	// The 2D part of a source has its left and right channels on speakers this far (in degrees) to either side of front,
+	// both shifted towards one side by its stereo pan
+	#define BED_STEREO_PAN_ANGLE 30.0f
+
+	// Audio blocks shared by the sources in the slot tables: four per source on average, which covers the period being
+	// filled, the period of slack and the staged period with a DSP block in flight. Sources in the bed are stereo, so
+	// they take twice as many. A source that finds the pool dry drops its audio.
+	#define AUDIO_BLOCK_POOL_SIZE ((ISAC_MAX_DYNAMIC_OBJECTS + 2 * ISAC_BED_MAX_SOURCES) * 4)
+
+	// Parameter changes a source can have queued for ProcessCallback. Past that they are handed over all at once instead.
+	#define PARAMETER_QUEUE_SIZE 32
+
+	// The gain limits glide to new values by at most this factor (1 dB) per block, so that changing them doesn't zipper
+	#define PARAMETER_RAMP_STEP 1.122018f
+
+	// Reverbs the pump has swapped out, waiting for the next build to delete them. Each build is swapped in at most
+	// once, so a few are plenty.
+	#define REVERB_RETIRE_QUEUE_SIZE 8
+
+	// Without a bed, the reverb goes to one dynamic object above the listener, where a diffuse tail is least out of place
+	#define REVERB_OBJECT_X 0.0f
+	#define REVERB_OBJECT_Y 1.0f
+	#define REVERB_OBJECT_Z 0.0f
+
+	// Latencies are counted in bins this wide (in milliseconds), which covers up to 256 ms
+	#define LATENCY_BIN_WIDTH 0.25f
+	// and the Begin/EndUpdate window in bins this wide, which covers a whole pump period
+	#define UPDATE_WINDOW_BIN_WIDTH 0.01f
+
+	// This GUID uniquely identifies a Middleware Stack. WWise, FMod etc each will need to have their own GUID
+	// that should never change.
+	// We log this value as part of spatial audio client telemetry; and map the GUIDs to middleware
+	// while processing the telemetry, so we can filter telemetry by middleware.
+	const GUID UNITY_ISAC_MIDDLEWARE_ID = { 0xe07049bc, 0xa91e, 0x489d,{ 0xad, 0xeb, 0xb1, 0x70, 0xa4, 0xa, 0x30, 0x6f } };
+
+	// Middleware can use up to 4 integers to pass the version info
+	const int MAJOR_VERSION = 0;
+	const int MINOR_VERSION1 = 2;
+	const int MINOR_VERSION2 = 0;
+
+	// The sample rate required by ISAC
+	const int REQUIRED_SAMPLE_RATE = 48000;
+
+//################ ENUMS AND STRUCTS ################
+	enum
+	{
+		P_CUTOFFDIST = 0,
+		P_ENVIRONMENT,
+		P_MINGAIN,
+		P_MAXGAIN,
+		P_UNITYGAINDISTANCE,
+		P_BYPASS_ATTENUATION,
+		P_MEASURE_LATENCY,
+		P_NUM
+	};
+
+	// How GetFloatParameterCallback describes a value
+	enum ParameterFormat
+	{
+		ParameterFormat_Number = 0,
+		ParameterFormat_Toggle,
+		ParameterFormat_Environment
+	};
+
+	struct ParameterSchema
+	{
+		int m_Index;
+		const char* m_Name;			// At most 15 characters, as are units
+		const char* m_Unit;
+		float m_Min;
+		float m_Max;
+		float m_Default;
+		ParameterFormat m_Format;
+		const char* m_Description;
+	};
+
+	// Every parameter, in order. Registration, the defaults of each new source, the range SetFloatParameterCallback
+	// clamps to and the text GetFloatParameterCallback reports all come from here.
+	constexpr ParameterSchema PARAMETER_SCHEMA[] =
+	{
+		{ P_CUTOFFDIST, "CutoffDist", "m", 0.0f, 10000.0f, 999.0f, ParameterFormat_Number, "HRTF cutoff distance" },
+		{ P_ENVIRONMENT, "Environment", "", 0.0f, (float)(ReverbEnvironment_Count - 1), (float)DEFAULT_ENVIRONMENT, ParameterFormat_Environment, "Environment size: small, medium, large or outdoors" },
+		{ P_MINGAIN, "MinGain", "dB", -96.0f, 12.0f, DEFAULT_MIN_GAIN, ParameterFormat_Number, "Minimum gain allowed for room modelling" },
+		{ P_MAXGAIN, "MaxGain", "dB", -96.0f, 12.0f, DEFAULT_MAX_GAIN, ParameterFormat_Number, "Maximum gain allowed for room modelling" },
+		{ P_UNITYGAINDISTANCE, "UnityGainDist", "m", 0.05f, FLT_MAX, DEFAULT_UNITY_GAIN_DISTANCE, ParameterFormat_Number, "Distance at which the gain applied is 0dB" },
+		{ P_BYPASS_ATTENUATION, "BypassCurves", "", 0.0f, 1.0f, DEFAULT_BYPASS_CURVES, ParameterFormat_Toggle, "Ignore the Unity Volume curves for more realistic simulation" },
+		{ P_MEASURE_LATENCY, "MeasureLatency", "", 0.0f, 1.0f, 0.0f, ParameterFormat_Toggle, "Measure the latency from the spatializer to the spatial sink" },
+	};
+
+	// Names of the environments, as GetFloatParameterCallback reports them
+	const char* const ENVIRONMENT_NAMES[ReverbEnvironment_Count] = { "small", "medium", "large", "outdoors" };
+
+	// Unity doesn't say how long valuestr is, so what is written to it is kept as short as a unit
+	#define PARAMETER_VALUE_STRING_SIZE 16
+
+	constexpr bool IsParameterSchemaValid(int Index)
+	{
+		return Index == P_NUM ||
+			(PARAMETER_SCHEMA[Index].m_Index == Index &&
+			PARAMETER_SCHEMA[Index].m_Min <= PARAMETER_SCHEMA[Index].m_Default &&
+			PARAMETER_SCHEMA[Index].m_Default <= PARAMETER_SCHEMA[Index].m_Max &&
+			IsParameterSchemaValid(Index + 1));
+	}
+
+	static_assert(sizeof(PARAMETER_SCHEMA) / sizeof(PARAMETER_SCHEMA[0]) == P_NUM, "Every parameter needs an entry in PARAMETER_SCHEMA");
+	static_assert(IsParameterSchemaValid(0), "PARAMETER_SCHEMA is out of order or has a default outside its range");
+
+	// Source position in ISAC's coordinate system, valid from the sample at write position StartPos onwards. The bed also
+	// needs the source's spatial blend, spread (in degrees, 0 to 360) and stereo pan, which dynamic objects ignore. ReverbSend is
+	// the gain the source is sent to the shared reverb with. Timestamp is when ProcessCallback wrote the block (in
+	// QueryPerformanceCounter ticks), or 0 when latency isn't being measured.
+	struct UnityAudioPosition
+	{
+		UINT32 StartPos;
+		float X;
+		float Y;
+		float Z;
+		float SpatialBlend;
+		float Spread;
+		float StereoPan;
+		float ReverbSend;
+		INT64 Timestamp;
+	};
+
+	// Where the first sample of a pump period was in the block ProcessCallback wrote it in, for timing the period once it
+	// reaches the sink. m_Timestamp is 0 when the block wasn't timed.
+	struct LatencyMark
+	{
+		INT64 m_Timestamp;
+		INT32 m_BlockOffset;
+	};
+
+	// Distance attenuation model derived from the parameters in ComputeAttenuationModel, so that
+	// DistanceAttenuationCallback doesn't have to convert decibels for every source and block
+	struct AttenuationModel
+	{
+		float m_MinGain;
+		float m_MaxGain;
+		float m_UnityGainDist;
+		BOOL m_BypassCurves;
+	};
+
+	// A parameter change on its way from SetFloatParameterCallback to ProcessCallback, with the attenuation model of
+	// all the parameters once it is applied
+	struct ParameterChange
+	{
+		int m_Index;
+		float m_Value;
+		AttenuationModel m_Attenuation;
+	};
+
+	struct UnityAudioData
+	{
+		// The parameters as ProcessCallback and DistanceAttenuationCallback see them. Only the audio thread touches them,
+		// once it has applied the changes queued since its last block (see ApplyParameterChanges).
+		float p[P_NUM] = {};
+
+		// The parameters as they were last set, which only Unity's main thread touches. Each change is queued to the audio
+		// thread along with the attenuation model it leads to. If the queue is full, because the source isn't being
+		// processed, m_ParametersResync is set instead and the audio thread copies them all under m_ControlLock, which
+		// it only tries to take.
+		float m_ControlParams[P_NUM] = {};
+		AttenuationModel m_ControlAttenuation = {};
+		SPSCRingBuffer<PARAMETER_QUEUE_SIZE, ParameterChange, SPSCRingBufferPolicy_AllOrNothing> m_ParameterChanges;
+		volatile LONG m_ParametersResync = FALSE;
+		AudioMutex m_ControlLock;
+
+		// ProcessCallback produces and the worker thread consumes, in blocks from g_AudioBlockPool. A dynamic object is mono,
+		// so it gets both channels averaged; a source in the bed keeps its right channel in each block's p_Right. The worker
+		// thread hands the queued blocks back when it takes the source off its slot, and a part-filled one goes back when the
+		// source is next queued or released. If ISAC stalls the newest audio is dropped once the chain is full, and the worker
+		// thread skips ahead to the most recent audio once it catches up.
+		AudioBlockChain m_Audio;
+
+		// One entry per block of samples, so the worker thread can pick the position that goes with the audio it sends.
+		// The entry in effect is kept in the source's slot (see SourceSlotTable::m_PumpPosition).
+		SPSCRingBuffer<ISAC_POSITION_QUEUE_SIZE, UnityAudioPosition, SPSCRingBufferPolicy_Overwrite> m_Positions;
+
+		// Set once the last audio of a culled, paused, muted or silent source has been written, so the worker thread
+		// can release the ISAC object as soon as that audio has been played instead of waiting for EMPTY_COUNT_LIMIT
+		volatile LONG	m_ReleaseRequested = FALSE;
+
+		// Gating state, only touched by ProcessCallback. m_FadeGain is the gain reached at the end of the previous
+		// block, so that crossing the culling radius or pausing fades instead of clicking. m_Silent is set while the
+		// source is off ISAC because its input is silent, and m_SilentSamples counts the silent input up to now.
+		BOOL	m_Culled = FALSE;
+		float	m_FadeGain = 1.0f;
+		BOOL	m_Silent = FALSE;
+		UINT32	m_SilentSamples = 0;
+
+		// The attenuation model in use, which glides towards the one the parameters lead to
+		AttenuationModel	m_Attenuation = {};
+		AttenuationModel	m_AttenuationTarget = {};
+
+		// Ingest kernel specialized for Unity's DSP buffer size, picked in CreateCallback. Blocks of any other
+		// length go through IngestGeneric.
+		IngestKernel	m_IngestKernel = nullptr;
+		UINT32	m_IngestBlockSize = 0;
+
+		// Set by ProcessCallback when it puts the source in a slot, and cleared by the worker thread when it takes it out
+		volatile LONG	m_InQueue = FALSE;
+		int		m_Slot = 0;
+
+		// Tells this source's records apart in a capture
+		UINT32	m_SourceId = 0;
+
+		// Set while the source is queued to the static bed instead of a dynamic ISAC object
+		BOOL	m_InBed = FALSE;
+
+		// Latency from ProcessCallback to the sink, in milliseconds, added to by the worker thread while P_MEASURE_LATENCY is set
+		LatencyHistogram*	m_Latency = nullptr;
+
+		// Renders the source in ProcessCallback when an HRIR database is loaded (see g_HrirDatabase)
+		BinauralVoice*	p_Binaural = nullptr;
+	};
+
+	// Fixed table of the sources being sent to ISAC, which ProcessCallback adds to without blocking or allocating. A
+	// slot is claimed by setting its bit in m_Occupied with a single compare-and-swap; the claimant then owns the slot
+	// and publishes its source there once the source is ready to be read. Only the worker thread frees slots.
+	//
+	// What the pump looks at for every source on every pass is kept here, one array per field indexed by slot, rather
+	// than in the sources themselves, which are scattered across the heap.
+	template<int SIZE>
+	struct SourceSlotTable
+	{
+		static_assert(SIZE % 32 == 0, "SIZE must be a multiple of 32");
+
+		volatile LONG m_Occupied[SIZE / 32];
+		UnityAudioData* volatile m_Sources[SIZE];
+
+		// Only touched by the worker thread once the slot is published: the pump periods in a row the source had too
+		// little audio for, and the position that goes with the audio the pump is sending
+		UINT32 m_EmptyCount[SIZE];
+		UnityAudioPosition m_PumpPosition[SIZE];
+
+		// The reverb send the source's previous period ended on, so that the send ramps rather than steps
+		float m_ReverbSend[SIZE];
+
+		// The source whose next period the worker thread read ahead, once the previous pump was done with the sink, or
+		// nullptr if the next pump has to read it itself, and the block it read if it is still to be copied. Cleared when
+		// the slot is freed.
+		UnityAudioData* m_Staged[SIZE];
+		AudioBlock* m_StagedBlock[SIZE];
+		LatencyMark m_StagedLatency[SIZE];
+
+		// Claims the lowest free slot below Limit and resets its state. Returns -1 if they are all taken.
+		int Claim(int Limit)
+		{
+			for (int Word = 0; Word * 32 < Limit && Word < SIZE / 32; Word++)
+			{
+				int Remaining = Limit - Word * 32;
+				ULONG Allowed = (Remaining >= 32) ? 0xFFFFFFFF : ((1u << Remaining) - 1);
+
+				while (TRUE)
+				{
+					LONG Bits = m_Occupied[Word];
+					ULONG Free = ~(ULONG)Bits & Allowed;
+					if (Free == 0)
+					{
+						break;
+					}
+
+					// If another source got in first, or the worker thread freed a slot in the meantime, look again
+					ULONG Bit;
+					_BitScanForward(&Bit, Free);
+					if (InterlockedCompareExchange(&m_Occupied[Word], Bits | (LONG)(1u << Bit), Bits) == Bits)
+					{
+						int Slot = Word * 32 + (int)Bit;
+						m_EmptyCount[Slot] = 0;
+						memset(&m_PumpPosition[Slot], 0, sizeof(UnityAudioPosition));
+						m_ReverbSend[Slot] = 0.0f;
+						return Slot;
+					}
+				}
+			}
+			return -1;
+		}
+
+		void Publish(int Slot, UnityAudioData* p_ObjData)
+		{
+			InterlockedExchangePointer((PVOID volatile*)&m_Sources[Slot], p_ObjData);
+		}
+
+		// The source in a slot, or nullptr if the slot is free or hasn't been published yet
+		UnityAudioData* Get(int Slot) const
+		{
+			return m_Sources[Slot];
+		}
+
+		// Worker thread only, and only for a published slot
+		void Free(int Slot)
+		{
+			if (m_StagedBlock[Slot] != nullptr)
+			{
+				m_StagedBlock[Slot]->Release();
+				m_StagedBlock[Slot] = nullptr;
+			}
+			m_Staged[Slot] = nullptr;
+			InterlockedExchangePointer((PVOID volatile*)&m_Sources[Slot], nullptr);
+			InterlockedAnd(&m_Occupied[Slot / 32], ~(LONG)(1u << (Slot % 32)));
+		}
+
+		// The first occupied slot from Slot onwards, or -1
+		int NextOccupied(int Slot) const
+		{
+			while (Slot < SIZE)
+			{
+				ULONG Bits = (ULONG)m_Occupied[Slot / 32] >> (Slot % 32);
+				if (Bits != 0)
+				{
+					ULONG Bit;
+					_BitScanForward(&Bit, Bits);
+					return Slot + (int)Bit;
+				}
+				Slot = (Slot / 32 + 1) * 32;
+			}
+			return -1;
+		}
+	};
+
+	// Sources that ran dry or asked to be released during a pump. They keep their slot until the pump is done with the sink.
+	struct RemoveList
+	{
+		UnityAudioData* m_Sources[ISAC_MAX_DYNAMIC_OBJECTS + ISAC_BED_MAX_SOURCES];
+		volatile LONG m_Count;
+
+		// Safe to call from every thread filling objects at once
+		void Add(UnityAudioData* p_ObjData)
+		{
+			m_Sources[InterlockedIncrement(&m_Count) - 1] = p_ObjData;
+		}
+	};
+
+	// The dynamic objects of one pump, with the buffers the sink gave them, for filling (or staging, with no buffer)
+	// them in any order
+	struct ObjectFillBatch
+	{
+		struct Fill
+		{
+			UnityAudioData* p_ObjData;
+			int m_Slot;
+			float* p_Buffer;
+
+			// Set when the source wasn't staged and its audio was read straight into p_Buffer
+			BOOL m_Pulled;
+		};
+
+		Fill m_Fills[ISAC_MAX_DYNAMIC_OBJECTS];
+		UINT32 m_Count;
+		RemoveList* p_Removals;
+	};
+
+//################ GLOBALS ################
+	UINT32 g_SystemSampleRate = 0;
+
+	// Keeps track of how many ISAC objects will be available in the next processing pass
+	// ISAC can grant or revoke ISAC objects any time. ProcessCallback only claims slots below
+	// this, and the worker thread evicts the sources in slots at or above it.
+	volatile LONG g_ISACObjectBudget = 0;
+
+	// UnityAudioData objects that will be rendered by ISAC in the next processing pass, each
+	// in the slot of the dynamic ISAC object it is rendered by. UnityAudioData objects are
+	// added/removed from this table based on how many ISAC objects are available, and when
+	// Unity adds or removes audio objects to the scene
+	SourceSlotTable<ISAC_MAX_DYNAMIC_OBJECTS> g_ObjectSlots;
+
+	// Vector containing ISAC objects (not all objects in here are active or used)
+	std::vector<ComPtr<ISpatialAudioObject>> g_ISACObjectVector;
+
+	// Sources panned into the static bed, and the speaker gains the previous pump ended on for the left and right
+	// channels of the source in each slot
+	SourceSlotTable<ISAC_BED_MAX_SOURCES> g_BedSlots;
+	float g_BedSlotGains[ISAC_BED_MAX_SOURCES][2][ISAC_BED_MAX_CHANNELS];
+
+	// The static objects of the bed and the panner that feeds them, set up along with the render stream. Each panner
+	// speaker maps to one bed channel; the LFE channel is never panned to and only carries silence.
+	UINT32 g_BedChannelCount = 0;
+	AudioObjectType g_BedChannelTypes[ISAC_BED_MAX_CHANNELS];
+	ComPtr<ISpatialAudioObject> g_BedObjects[ISAC_BED_MAX_CHANNELS];
+	int g_BedSpeakerChannel[ISAC_BED_MAX_CHANNELS];
+	VBAPPanner g_BedPanner;
+	float g_BedMix[ISAC_BED_MAX_CHANNELS][ISACFRAMECOUNTPERPUMP];
+
+	// Set while g_BedMix already holds the sources staged for the next pump
+	BOOL g_BedStaged = FALSE;
+
+	// Indicates if the render stream has the bed, so ProcessCallback can queue sources to it
+	LONG g_BedActive = FALSE;
+
+	// Variables to manage operation of ISAC
+	ComPtr<ISpatialAudioClient> g_SpatialAudioClient;
+	ComPtr<ISpatialAudioObjectRenderStream> g_SpatialAudioStream;
+	HANDLE g_ISACBufferCompletionEvent;
+
+	// Indicates if this is the first time the CreateCallback is called
+	// this is an opportunity to initialize stuff
+	BOOL g_FirstCreateCallback = TRUE;
+
+	// Indicates if ISAC is up and running
+	BOOL g_SpatialAudioClientCreated = FALSE;
+
+	BOOL g_SpatialAudioRenderStreamCreated = FALSE;
+
+	// Worker thread for ISpatialAudioClient work
+	PTP_WORK g_WorkThread;
+	BOOL g_WorkThreadActive = FALSE;
+
+	// Records every callback while a capture is running (see CAPTURE_ENVIRONMENT_VARIABLE)
+	CaptureRecorder* g_CaptureRecorder = nullptr;
+	LONG g_NextSourceId = 0;
+
+	// For converting the timestamps of latency measurements
+	double g_TicksPerMillisecond = 0.0;
+
+	// Records what the pump hands to ISAC while an object capture is running (see OBJECT_CAPTURE_ENVIRONMENT_VARIABLE)
+	RecordingSink* g_ObjectCaptureSink = nullptr;
+
+	// Fills dynamic objects alongside the pump when there is more than one fill thread (see SetObjectFillThreads).
+	// g_FillThreadCount is what FILL_THREADS_ENVIRONMENT_VARIABLE asked for, for the worker thread to create it with.
+	WorkerPool* g_FillPool = nullptr;
+	UINT32 g_FillThreadCount = 1;
+
+	// The dynamic objects the pump is filling or staging
+	ObjectFillBatch g_ObjectFillBatch;
+
+	// Where every source's audio is carried from ProcessCallback to the pump, created along with the first source
+	AudioBlockPool* g_AudioBlockPool = nullptr;
+
+	// ProcessCallback calls whose audio didn't all make it into the source's chain
+	volatile LONG g_DroppedAudioWrites = 0;
+
+	// How long each pump spends between BeginUpdate and the end of EndUpdate, in milliseconds. That is the window in which
+	// ISAC waits on the pump, so it is what deadline misses come from.
+	LatencyHistogram g_UpdateWindow(UPDATE_WINDOW_BIN_WIDTH);
+
+	// Set when HRIR_DATABASE_ENVIRONMENT_VARIABLE names a database at the output's sample rate. Every source is then
+	// rendered binaurally in ProcessCallback, and ISAC isn't started.
+	HrirDatabase* g_HrirDatabase = nullptr;
+
+	// The reverb every source is sent to, run by the pump on what the sources sent it since the previous pump (see
+	// StageReverb). Created along with the first source, except in the binaural mode. g_ReverbEnvironment is the
+	// environment of the reverb in use.
+	FdnReverb* g_Reverb = nullptr;
+	volatile LONG g_ReverbEnvironment = DEFAULT_ENVIRONMENT;
+
+	// The environment is the one any source's Environment parameter was last set to. A reverb for it is built on the
+	// thread pool (see BuildReverb) and left in g_PendingReverb, and the pump swaps it in between periods. The one it
+	// replaces rings out as g_FadingReverb, and then goes back through g_RetiredReverbs to be deleted.
+	volatile LONG g_RequestedEnvironment = DEFAULT_ENVIRONMENT;
+	PTP_WORK g_ReverbWork = nullptr;
+	AudioMutex g_ReverbBuildLock;
+	FdnReverb* volatile g_PendingReverb = nullptr;
+	FdnReverb* g_FadingReverb = nullptr;
+	SPSCRingBuffer<REVERB_RETIRE_QUEUE_SIZE, FdnReverb*, SPSCRingBufferPolicy_AllOrNothing> g_RetiredReverbs;
+
+	float g_ReverbInput[ISACFRAMECOUNTPERPUMP];
+	BOOL g_ReverbInputActive = FALSE;
+
+	// The reverb's outputs for the next pump, and their mono mix for the reverb's dynamic object when there is no bed.
+	// g_ReverbAudible is set while they aren't silent.
+	float g_ReverbOutputs[REVERB_OUTPUT_COUNT][ISACFRAMECOUNTPERPUMP];
+	float g_ReverbObjectMix[ISACFRAMECOUNTPERPUMP];
+	BOOL g_ReverbAudible = FALSE;
+
+//################ CLASS AND FUNCTION DEFINITIONS ################
+	// Registers spatializer plugin parameters to Unity
+	int InternalRegisterEffectDefinition(UnityAudioEffectDefinition& definition)
+	{
+		int numparams = P_NUM;
+		definition.paramdefs = new UnityAudioParameterDefinition[numparams];
+		for (const ParameterSchema& Parameter : PARAMETER_SCHEMA)
+		{
+			RegisterParameter(definition, Parameter.m_Name, Parameter.m_Unit, Parameter.m_Min, Parameter.m_Max, Parameter.m_Default, 1.0f, 1.0f,
+				Parameter.m_Index, Parameter.m_Description);
+		}
+		definition.flags |= UnityAudioEffectDefinitionFlags_IsSpatializer;
+		return numparams;
+	}
+
+	// Handles any block length and channel count
+	void IngestGeneric(float* p_Dst, float* p_DstRight, UINT32 Count, const float* inbuffer, float* outbuffer, UINT32 length, int inchannels, int outchannels, float GainStart, float GainEnd)
+	{
+		memset(outbuffer, 0, length * outchannels * sizeof(float));
+
+		if (p_DstRight != nullptr)
+		{
+			CopyScaled(p_Dst, inbuffer, inchannels, Count, GainStart, GainEnd);
+			CopyScaled(p_DstRight, inbuffer + ((inchannels > 1) ? 1 : 0), inchannels, Count, GainStart, GainEnd);
+		}
+		else
+		{
+			GetAudioKernels().Downmix(p_Dst, inbuffer, inchannels, Count, 1.0f / (float)inchannels);
+			CopyScaled(p_Dst, p_Dst, 1, Count, GainStart, GainEnd);
+		}
+	}
+
+	// Stereo in/out with a fixed block length. With the trip counts known at compile time the loops carry no remainder
+	// handling, and the sample loop runs on SSE or NEON where available.
+	template<UINT32 LENGTH>
+	void IngestStereo(float* p_Dst, float* p_DstRight, UINT32 Count, const float* inbuffer, float* outbuffer, UINT32 length, int inchannels, int outchannels, float GainStart, float GainEnd)
+	{
+		static_assert(LENGTH % 4 == 0 && LENGTH <= ISAC_MAX_BLOCK_SIZE, "LENGTH must be a multiple of 4 that is sent whole");
+
+		memset(outbuffer, 0, LENGTH * 2 * sizeof(float));
+
+		static const float Ramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+		const float GainStep = (GainEnd - GainStart) / (float)LENGTH;
+		UnityVec4 Gain = Vec4Add(Vec4Set1(GainStart), Vec4Mul(Vec4Load(Ramp), Vec4Set1(GainStep)));
+		const UnityVec4 GainInc = Vec4Set1(4.0f * GainStep);
+
+		if (p_DstRight != nullptr)
+		{
+			for (UINT32 n = 0; n < LENGTH; n += 4)
+			{
+				Vec4Store(p_Dst + n, Vec4Mul(Vec4LoadEven(inbuffer + 2 * n), Gain));
+				Vec4Store(p_DstRight + n, Vec4Mul(Vec4LoadOdd(inbuffer + 2 * n), Gain));
+				Gain = Vec4Add(Gain, GainInc);
+			}
+		}
+		else
+		{
+			GetAudioKernels().Downmix(p_Dst, inbuffer, 2, LENGTH, 0.5f);
+			for (UINT32 n = 0; n < LENGTH; n += 4)
+			{
+				Vec4Store(p_Dst + n, Vec4Mul(Vec4Load(p_Dst + n), Gain));
+				Gain = Vec4Add(Gain, GainInc);
+			}
+		}
+	}
+
+	struct IngestKernelEntry
+	{
+		UINT32 BlockSize;
+		IngestKernel Kernel;
+	};
+
+	// The DSP buffer sizes Unity offers (Best latency, Good latency, Best performance)
+	const IngestKernelEntry INGEST_KERNELS[] =
+	{
+		{ 256, IngestStereo<256> },
+		{ 512, IngestStereo<512> },
+		{ 1024, IngestStereo<1024> },
+	};
+
+	IngestKernel GetIngestKernel(UINT32 BlockSize)
+	{
+		for (const IngestKernelEntry& Entry : INGEST_KERNELS)
+		{
+			if (Entry.BlockSize == BlockSize)
+			{
+				return Entry.Kernel;
+			}
+		}
+		return IngestGeneric;
+	}
+
+	void SelectIngestKernel(UnityAudioData* p_ObjData, UINT32 BlockSize)
+	{
+		p_ObjData->m_IngestKernel = GetIngestKernel(BlockSize);
+		p_ObjData->m_IngestBlockSize = (p_ObjData->m_IngestKernel != IngestGeneric) ? BlockSize : 0;
+	}
+
+	// Declaration
+	BOOL InitializeSpatialAudioClient(int sampleRate);
+	BOOL CreateSpatialAudioRenderStream();
+
+	// Adds the latency of a period that has just been handed to the sink to the source's measurements
+	void MeasureLatency(UnityAudioData* p_ObjData, const LatencyMark& Mark)
+	{
+		if (Mark.m_Timestamp != 0 && Mark.m_BlockOffset >= 0)
+		{
+			LARGE_INTEGER Now;
+			QueryPerformanceCounter(&Now);
+			double Latency = (double)(Now.QuadPart - Mark.m_Timestamp) / g_TicksPerMillisecond - (double)Mark.m_BlockOffset * 1000.0 / (double)g_SystemSampleRate;
+			p_ObjData->m_Latency->Add((float)Latency);
+		}
+	}
+
+	// The right channel of a block, which is the left one if the block is mono
+	inline const float* GetRightSamples(const AudioBlock* p_Block)
+	{
+		return (p_Block->p_Right != nullptr) ? p_Block->p_Right->m_Samples : p_Block->m_Samples;
+	}
+
+	// Takes the block with the next pump period of a source off its chain if at least MinBlocks are queued, and moves the
+	// position that goes with it to PumpPosition. Returns nullptr, taking nothing, if there aren't. The caller releases
+	// the block.
+	AudioBlock* TakeSourceBlock(UnityAudioData* p_ObjData, UnityAudioPosition& PumpPosition, int MinBlocks, LatencyMark& Mark)
+	{
+		// The chain is lock-free, with this thread as its only consumer
+		int BufferedBlocks = p_ObjData->m_Audio.GetNumBuffered();
+
+		// A full chain means Unity got ahead of us and has been dropping audio: skip ahead to the most recent
+		if (BufferedBlocks == AUDIO_BLOCK_CHAIN_LENGTH)
+		{
+			p_ObjData->m_Audio.DropOldest(2);
+			BufferedBlocks = 2;
+		}
+
+		AudioBlock* p_Block = p_ObjData->m_Audio.Peek();
+		if (p_Block == nullptr)
+		{
+			return nullptr;
+		}
+
+		// Move on to the position of the block the next sample to be played belongs to
+		UINT32 ReadPos = p_Block->m_StartPos;
+		UnityAudioPosition Position;
+		while (p_ObjData->m_Positions.Peek(Position) && (INT32)(Position.StartPos - ReadPos) <= 0)
+		{
+			PumpPosition = Position;
+			p_ObjData->m_Positions.Skip(1);
+		}
+
+		if (BufferedBlocks < MinBlocks)
+		{
+			return nullptr;
+		}
+
+		// When measuring, the first sample of this period is timed from when it would have played in Unity's block
+		Mark.m_Timestamp = PumpPosition.Timestamp;
+		Mark.m_BlockOffset = (INT32)(ReadPos - PumpPosition.StartPos);
+
+		return p_ObjData->m_Audio.Take();
+	}
+
+	// Moves the next pump period of a source's audio to p_Dst (and its right channel to p_DstRight, if not nullptr), and
+	// the position that goes with it to PumpPosition. If there isn't enough audio, p_Dst gets silence and a source that
+	// has run dry or asked to be released is put on Removals. EmptyCount and PumpPosition are the source's state in its
+	// slot.
+	void PullSourceFrames(UnityAudioData* p_ObjData, UINT32& EmptyCount, UnityAudioPosition& PumpPosition, float* p_Dst, float* p_DstRight, RemoveList& Removals)
+	{
+		// Keep one pump period of slack, except for a source that is being released: play out whatever it has left
+		LONG CurObjReleaseRequested = InterlockedCompareExchange(&p_ObjData->m_ReleaseRequested, 0, 0);
+
+		LatencyMark Mark;
+		AudioBlock* p_Block = TakeSourceBlock(p_ObjData, PumpPosition, CurObjReleaseRequested ? 1 : 2, Mark);
+		if (p_Block != nullptr)
+		{
+			EmptyCount = 0;
+			memcpy(p_Dst, p_Block->m_Samples, ISACFRAMECOUNTPERPUMP * sizeof(float));
+			if (p_DstRight != nullptr)
+			{
+				memcpy(p_DstRight, GetRightSamples(p_Block), ISACFRAMECOUNTPERPUMP * sizeof(float));
+			}
+			p_Block->Release();
+			MeasureLatency(p_ObjData, Mark);
+		}
+		else
+		{
+			if (++EmptyCount == EMPTY_COUNT_LIMIT || CurObjReleaseRequested)
+			{
+				Removals.Add(p_ObjData);
+			}
+
+			// fill with silence
+			memset(p_Dst, 0, ISACFRAMECOUNTPERPUMP * sizeof(float));
+			if (p_DstRight != nullptr)
+			{
+				memset(p_DstRight, 0, ISACFRAMECOUNTPERPUMP * sizeof(float));
+			}
+		}
+	}
+
+	// Takes the next pump period of the source in a slot ahead of the pump that sends it, leaving the block in
+	// m_StagedBlock. The staged period is the one period of slack PullSourceFrames would otherwise keep in the chain, so
+	// one block queued is enough. If there isn't one, nothing is staged or counted as empty, and the next pump pulls the
+	// source itself.
+	template<int SIZE>
+	BOOL StageSourceBlock(SourceSlotTable<SIZE>& Table, int Slot, UnityAudioData* p_ObjData)
+	{
+		AudioBlock* p_Block = TakeSourceBlock(p_ObjData, Table.m_PumpPosition[Slot], 1, Table.m_StagedLatency[Slot]);
+		if (p_Block == nullptr)
+		{
+			return FALSE;
+		}
+
+		Table.m_EmptyCount[Slot] = 0;
+		Table.m_Staged[Slot] = p_ObjData;
+		Table.m_StagedBlock[Slot] = p_Block;
+		return TRUE;
+	}
+
+	// Adds one pump period of the source in a slot to the reverb's input, ramping from the send of its previous period.
+	// A stereo source (p_Right not nullptr) is sent both channels averaged. Pump thread only, outside the fill pool.
+	template<int SIZE>
+	void MixReverbSend(SourceSlotTable<SIZE>& Table, int Slot, const float* p_Frames, const float* p_Right = nullptr)
+	{
+		if (g_Reverb == nullptr || !FdnReverb::HasTail(g_Reverb->GetEnvironment()))
+		{
+			return;
+		}
+
+		float Send = Table.m_PumpPosition[Slot].ReverbSend;
+		float& PrevSend = Table.m_ReverbSend[Slot];
+		if (Send != 0.0f || PrevSend != 0.0f)
+		{
+			const UnityAudioKernels& Kernels = GetAudioKernels();
+			if (p_Right != nullptr)
+			{
+				Kernels.MixScaled(g_ReverbInput, p_Frames, ISACFRAMECOUNTPERPUMP, 0.5f * PrevSend, 0.5f * Send);
+				Kernels.MixScaled(g_ReverbInput, p_Right, ISACFRAMECOUNTPERPUMP, 0.5f * PrevSend, 0.5f * Send);
+			}
+			else
+			{
+				Kernels.MixScaled(g_ReverbInput, p_Frames, ISACFRAMECOUNTPERPUMP, PrevSend, Send);
+			}
+			g_ReverbInputActive = TRUE;
+		}
+		PrevSend = Send;
+	}
+
+	// The dynamic object the reverb goes to when there is no bed: the last one in the budget, which sources don't get
+	// then. -1 if the reverb goes to the bed or the environment has no reverb.
+	LONG GetReverbObjectIndex()
+	{
+		if (g_Reverb == nullptr || InterlockedCompareExchange(&g_BedActive, 0, 0) || !FdnReverb::HasTail(InterlockedCompareExchange(&g_ReverbEnvironment, 0, 0)))
+		{
+			return -1;
+		}
+		return InterlockedCompareExchange(&g_ISACObjectBudget, 0, 0) - 1;
+	}
+
+	// How many of the dynamic objects ISAC grants the sources can have
+	LONG GetSourceObjectBudget()
+	{
+		LONG Budget = InterlockedCompareExchange(&g_ISACObjectBudget, 0, 0);
+		return (GetReverbObjectIndex() >= 0) ? Budget - 1 : Budget;
+	}
+
+	// Speaker gains for the left and right channels of a source in the bed. The 3D part of each channel is panned to the
+	// source's direction turned by half the spread towards that channel's side, as Unity spreads channels: at 0 both are
+	// on the source, at 180 they are 90 degrees to either side of it, and at 360 both are directly opposite it. The 2D
+	// part of each channel is panned across the front to its own side, shifted by the stereo pan. The two parts are
+	// blended by power, so the total stays the same whatever the mix.
+	void ComputeBedGains(const UnityAudioPosition& Position, float* p_LeftGains, float* p_RightGains)
+	{
+		const int NumSpeakers = g_BedPanner.GetNumSpeakers();
+
+		float Blend = FastMin(FastMax(Position.SpatialBlend, 0.0f), 1.0f);
+		float Spread = FastMin(FastMax(Position.Spread, 0.0f), 360.0f);
+		float PanWeight = 1.0f - Blend;
+
+		// Channels on the same spot add up coherently, so each is at half level there, which keeps a mono clip (the same
+		// on both channels) at its level; once they are 180 degrees apart they add up by power
+		float PointLevel = 0.5f + (0.70710678f - 0.5f) * FastMin(Spread, 180.0f) / 180.0f;
+		float PointWeight = Blend * PointLevel * PointLevel;
+
+		// Back to the panner's frame: x is front, y is left, z is up
+		float Front = -Position.Z;
+		float Left = -Position.X;
+
+		for (int Channel = 0; Channel < 2; Channel++)
+		{
+			// The left channel turns towards the left, which is a positive azimuth for the panner
+			float Side = (Channel == 0) ? 1.0f : -1.0f;
+			float* p_Gains = (Channel == 0) ? p_LeftGains : p_RightGains;
+
+			float PointGains[ISAC_BED_MAX_CHANNELS] = { 0 };
+			if (PointWeight > 0.0f)
+			{
+				float Turn = Side * 0.5f * Spread * (kPI / 180.0f);
+				float Cos = cosf(Turn);
+				float Sin = sinf(Turn);
+				g_BedPanner.ComputeGains(Front * Cos - Left * Sin, Front * Sin + Left * Cos, Position.Y, PointGains);
+			}
+
+			// A stereo pan of -1 moves both channels fully left
+			float PanGains[ISAC_BED_MAX_CHANNELS] = { 0 };
+			if (PanWeight > 0.0f)
+			{
+				float Pan = FastMin(FastMax(Position.StereoPan - Side, -1.0f), 1.0f);
+				float Azimuth = -Pan * BED_STEREO_PAN_ANGLE * (kPI / 180.0f);
+				g_BedPanner.ComputeGains(cosf(Azimuth), sinf(Azimuth), 0.0f, PanGains);
+			}
+
+			for (int Speaker = 0; Speaker < NumSpeakers; Speaker++)
+			{
+				p_Gains[Speaker] = sqrtf(PointWeight * PointGains[Speaker] * PointGains[Speaker] + PanWeight * PanGains[Speaker] * PanGains[Speaker]);
+			}
+		}
+	}
+
+	// Pans one pump period of both channels of the bed source in Slot into g_BedMix, ramping from the gains of its previous
+	// period so that a moving source doesn't zipper
+	void MixBedSource(int Slot, const float* p_Left, const float* p_Right)
+	{
+		const UnityAudioKernels& Kernels = GetAudioKernels();
+		const int NumSpeakers = g_BedPanner.GetNumSpeakers();
+
+		float Gains[2][ISAC_BED_MAX_CHANNELS];
+		ComputeBedGains(g_BedSlots.m_PumpPosition[Slot], Gains[0], Gains[1]);
+
+		const float* p_Channels[2] = { p_Left, p_Right };
+		for (int Channel = 0; Channel < 2; Channel++)
+		{
+			float* p_PrevGains = g_BedSlotGains[Slot][Channel];
+			for (int Speaker = 0; Speaker < NumSpeakers; Speaker++)
+			{
+				float Gain = Gains[Channel][Speaker];
+				if (Gain != 0.0f || p_PrevGains[Speaker] != 0.0f)
+				{
+					Kernels.MixScaled(g_BedMix[g_BedSpeakerChannel[Speaker]], p_Channels[Channel], ISACFRAMECOUNTPERPUMP, p_PrevGains[Speaker], Gain);
+				}
+				p_PrevGains[Speaker] = Gain;
+			}
+		}
+	}
+
+	// Pans the sources queued to the bed into its static objects. Must be called between BeginUpdate and EndUpdate.
+	// Sources staged by StageBed are already in g_BedMix, along with the reverb; only the others are read and panned here,
+	// and their reverb sends go to the next pump's reverb.
+	// The static objects are only activated once the first source gets to the bed, and from then on get a buffer every pass.
+	void MixBed(SpatialAudioSink* p_Sink, RemoveList& Removals)
+	{
+		BOOL HasSources = FALSE;
+
+		if (!g_BedStaged)
+		{
+			memset(g_BedMix, 0, sizeof(g_BedMix));
+		}
+
+		for (int Slot = g_BedSlots.NextOccupied(0); Slot >= 0; Slot = g_BedSlots.NextOccupied(Slot + 1))
+		{
+			UnityAudioData *p_ObjData = g_BedSlots.Get(Slot);
+			if (p_ObjData == nullptr)
+			{
+				continue;
+			}
+			HasSources = TRUE;
+
+			if (g_BedStaged && g_BedSlots.m_Staged[Slot] == p_ObjData)
+			{
+				g_BedSlots.m_Staged[Slot] = nullptr;
+				MeasureLatency(p_ObjData, g_BedSlots.m_StagedLatency[Slot]);
+				continue;
+			}
+
+			float Frames[ISACFRAMECOUNTPERPUMP];
+			float RightFrames[ISACFRAMECOUNTPERPUMP];
+			PullSourceFrames(p_ObjData, g_BedSlots.m_EmptyCount[Slot], g_BedSlots.m_PumpPosition[Slot], Frames, RightFrames, Removals);
+			MixBedSource(Slot, Frames, RightFrames);
+			MixReverbSend(g_BedSlots, Slot, Frames, RightFrames);
+		}
+		g_BedStaged = FALSE;
+
+		// The reverb's tail keeps the bed going after its sources are gone
+		BOOL Activate = HasSources || g_ReverbAudible;
+		for (UINT32 Channel = 0; Channel < g_BedChannelCount; Channel++)
+		{
+			float* p_Buffer = nullptr;
+			if (p_Sink->GetStaticObjectBuffer(Channel, g_BedChannelTypes[Channel], Activate, &p_Buffer) == S_OK)
+			{
+				memcpy(p_Buffer, g_BedMix[Channel], ISACFRAMECOUNTPERPUMP * sizeof(float));
+			}
+		}
+	}
+
+	// Reads and pans the next period of the bed's sources into g_BedMix ahead of the pump that sends it
+	void StageBed()
+	{
+		memset(g_BedMix, 0, sizeof(g_BedMix));
+
+		for (int Slot = g_BedSlots.NextOccupied(0); Slot >= 0; Slot = g_BedSlots.NextOccupied(Slot + 1))
+		{
+			UnityAudioData *p_ObjData = g_BedSlots.Get(Slot);
+			if (p_ObjData != nullptr && StageSourceBlock(g_BedSlots, Slot, p_ObjData))
+			{
+				// Only the mix is kept
+				const AudioBlock* p_Block = g_BedSlots.m_StagedBlock[Slot];
+				MixBedSource(Slot, p_Block->m_Samples, GetRightSamples(p_Block));
+				MixReverbSend(g_BedSlots, Slot, p_Block->m_Samples, GetRightSamples(p_Block));
+				g_BedSlots.m_StagedBlock[Slot]->Release();
+				g_BedSlots.m_StagedBlock[Slot] = nullptr;
+			}
+		}
+		g_BedStaged = TRUE;
+	}
+
+	// Hands a reverb the pump is done with to the next BuildReverb to delete
+	void RetireReverb(FdnReverb* p_Reverb)
+	{
+		g_RetiredReverbs.Write(&p_Reverb, 1);
+	}
+
+	// Runs the reverb over what the sources sent it for the next pump, and adds its outputs to the staged bed (each
+	// speaker gets one of them in turn) or, without a bed, mixes them down for the reverb's dynamic object. A reverb
+	// built for a new environment is swapped in here, between pumps; the old one rings out alongside it with no more
+	// input. The reverb sits idle once its input stops and its tail has died away.
+	void StageReverb()
+	{
+		static const float Silence[ISACFRAMECOUNTPERPUMP] = { 0 };
+
+		FdnReverb* p_Pending = (FdnReverb*)InterlockedExchangePointer((PVOID volatile*)&g_PendingReverb, nullptr);
+		if (p_Pending != nullptr)
+		{
+			if (g_FadingReverb != nullptr)
+			{
+				RetireReverb(g_FadingReverb);
+				g_FadingReverb = nullptr;
+			}
+
+			if (g_ReverbAudible)
+			{
+				g_FadingReverb = g_Reverb;
+			}
+			else
+			{
+				RetireReverb(g_Reverb);
+			}
+
+			g_Reverb = p_Pending;
+			InterlockedExchange(&g_ReverbEnvironment, g_Reverb->GetEnvironment());
+		}
+
+		if (!g_ReverbInputActive && !g_ReverbAudible)
+		{
+			return;
+		}
+
+		float* p_Outputs[REVERB_OUTPUT_COUNT];
+		for (int Output = 0; Output < REVERB_OUTPUT_COUNT; Output++)
+		{
+			p_Outputs[Output] = g_ReverbOutputs[Output];
+		}
+		float Peak = g_Reverb->Process(g_ReverbInput, p_Outputs, ISACFRAMECOUNTPERPUMP);
+
+		memset(g_ReverbInput, 0, sizeof(g_ReverbInput));
+		g_ReverbInputActive = FALSE;
+
+		const UnityAudioKernels& Kernels = GetAudioKernels();
+		if (g_FadingReverb != nullptr)
+		{
+			float Fading[REVERB_OUTPUT_COUNT][ISACFRAMECOUNTPERPUMP];
+			float* p_Fading[REVERB_OUTPUT_COUNT];
+			for (int Output = 0; Output < REVERB_OUTPUT_COUNT; Output++)
+			{
+				p_Fading[Output] = Fading[Output];
+			}
+
+			float FadingPeak = g_FadingReverb->Process(Silence, p_Fading, ISACFRAMECOUNTPERPUMP);
+			for (int Output = 0; Output < REVERB_OUTPUT_COUNT; Output++)
+			{
+				Kernels.MixScaled(g_ReverbOutputs[Output], Fading[Output], ISACFRAMECOUNTPERPUMP, 1.0f, 1.0f);
+			}
+
+			if (FadingPeak < SILENCE_THRESHOLD)
+			{
+				RetireReverb(g_FadingReverb);
+				g_FadingReverb = nullptr;
+			}
+			Peak = FastMax(Peak, FadingPeak);
+		}
+		g_ReverbAudible = Peak >= SILENCE_THRESHOLD;
+
+		if (g_BedStaged)
+		{
+			// The outputs are decorrelated, so their power adds up over the speakers that share them
+			const int NumSpeakers = g_BedPanner.GetNumSpeakers();
+			float Gain = (NumSpeakers > REVERB_OUTPUT_COUNT) ? sqrtf((float)REVERB_OUTPUT_COUNT / (float)NumSpeakers) : 1.0f;
+			for (int Speaker = 0; Speaker < NumSpeakers; Speaker++)
+			{
+				Kernels.MixScaled(g_BedMix[g_BedSpeakerChannel[Speaker]], g_ReverbOutputs[Speaker % REVERB_OUTPUT_COUNT], ISACFRAMECOUNTPERPUMP, Gain, Gain);
+			}
+		}
+		else
+		{
+			memset(g_ReverbObjectMix, 0, sizeof(g_ReverbObjectMix));
+			for (int Output = 0; Output < REVERB_OUTPUT_COUNT; Output++)
+			{
+				Kernels.MixScaled(g_ReverbObjectMix, g_ReverbOutputs[Output], ISACFRAMECOUNTPERPUMP, 0.5f, 0.5f);
+			}
+		}
+	}
+
+	// Builds a reverb for the environment last asked for and leaves it for the pump to swap in, replacing one the pump
+	// hasn't picked up yet. Deletes the reverbs the pump has retired on the way. Allocates, so it runs on the thread pool
+	// (or, in a replay, on the thread that changed the environment), never on an audio thread.
+	void BuildReverb()
+	{
+		MutexScopeLock Lock(g_ReverbBuildLock);
+
+		FdnReverb* p_Retired;
+		while (g_RetiredReverbs.Read(p_Retired))
+		{
+			delete p_Retired;
+		}
+
+		FdnReverb* p_Reverb = FdnReverb::Create(g_SystemSampleRate, InterlockedCompareExchange(&g_RequestedEnvironment, 0, 0));
+		delete (FdnReverb*)InterlockedExchangePointer((PVOID volatile*)&g_PendingReverb, p_Reverb);
+	}
+
+	VOID CALLBACK BuildReverbCallback(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_WORK Work)
+	{
+		BuildReverb();
+	}
+
+	// Asks for the reverb of another environment. Called on Unity's main thread.
+	void RequestEnvironment(LONG Environment)
+	{
+		if (g_Reverb == nullptr || InterlockedExchange(&g_RequestedEnvironment, Environment) == Environment)
+		{
+			return;
+		}
+
+		// A replay builds it on the spot, so that it is swapped in at the same pump every time
+		if (g_ReverbWork != nullptr)
+		{
+			SubmitThreadpoolWork(g_ReverbWork);
+		}
+		else
+		{
+			BuildReverb();
+		}
+	}
+
+	// Renders through the ISAC render stream
+	class ISACSink : public SpatialAudioSink
+	{
+	public:
+		HRESULT BeginUpdate(UINT32* p_AvailableDynamicObjectCount, UINT32* p_FrameCount) override
+		{
+			return g_SpatialAudioStream->BeginUpdatingAudioObjects(p_AvailableDynamicObjectCount, p_FrameCount);
+		}
+
+		HRESULT EndUpdate() override
+		{
+			return g_SpatialAudioStream->EndUpdatingAudioObjects();
+		}
+
+		HRESULT GetDynamicObjectBuffer(UINT32 Index, float** pp_Buffer) override
+		{
+			HRESULT hr = S_OK;
+			ComPtr<ISpatialAudioObject> &p_ObjISAC = g_ISACObjectVector[Index];
+
+			if (p_ObjISAC == nullptr)
+			{
+				hr = g_SpatialAudioStream->ActivateSpatialAudioObject(AudioObjectType_Dynamic, &p_ObjISAC);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+			}
+
+			BOOL IsActive = FALSE;
+			hr = p_ObjISAC->IsActive(&IsActive);
+			if (!IsActive)
+			{
+				p_ObjISAC = nullptr;
+
+				hr = g_SpatialAudioStream->ActivateSpatialAudioObject(AudioObjectType_Dynamic, &p_ObjISAC);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+			}
+
+			// The object buffer is a BYTE array holding float samples
+			BYTE* p_ISACObjBuffer = nullptr;
+			UINT32 ByteCount;
+			hr = p_ObjISAC->GetBuffer(&p_ISACObjBuffer, &ByteCount);
+			*pp_Buffer = (float*)p_ISACObjBuffer;
+			return hr;
+		}
+
+		void SetDynamicObjectPosition(UINT32 Index, float X, float Y, float Z) override
+		{
+			g_ISACObjectVector[Index]->SetPosition(X, Y, Z);
+		}
+
+		void SetDynamicObjectVolume(UINT32 Index, float Volume) override
+		{
+			g_ISACObjectVector[Index]->SetVolume(Volume);
+		}
+
+		HRESULT GetStaticObjectPosition(AudioObjectType Type, float* p_X, float* p_Y, float* p_Z) override
+		{
+			return g_SpatialAudioClient->GetStaticObjectPosition(Type, p_X, p_Y, p_Z);
+		}
+
+		HRESULT GetStaticObjectBuffer(UINT32 Channel, AudioObjectType Type, BOOL Activate, float** pp_Buffer) override
+		{
+			ComPtr<ISpatialAudioObject> &p_ObjISAC = g_BedObjects[Channel];
+
+			if (p_ObjISAC == nullptr)
+			{
+				if (!Activate)
+				{
+					return S_FALSE;
+				}
+
+				HRESULT hr = g_SpatialAudioStream->ActivateSpatialAudioObject(Type, &p_ObjISAC);
+				if (FAILED(hr))
+				{
+					p_ObjISAC = nullptr;
+					return hr;
+				}
+			}
+
+			BYTE* p_ISACObjBuffer = nullptr;
+			UINT32 ByteCount;
+			HRESULT hr = p_ObjISAC->GetBuffer(&p_ISACObjBuffer, &ByteCount);
+			*pp_Buffer = (float*)p_ISACObjBuffer;
+			return hr;
+		}
+	};
+	ISACSink g_ISACSink;
+
+	// Set by AttachSimulatedSink; replaces ISAC and the worker thread
+	SpatialAudioSink* g_SimulatedSink = nullptr;
+
+	// Takes a source off its slot table and hands its queued audio back to the pool. Worker thread only. Once m_InQueue
+	// is cleared, ProcessCallback may queue the source again and ReleaseCallback may delete it.
+	void FreeSource(UnityAudioData* p_ObjData)
+	{
+		p_ObjData->m_Audio.DropOldest(0);
+
+		if (p_ObjData->m_InBed)
+		{
+			g_BedSlots.Free(p_ObjData->m_Slot);
+			p_ObjData->m_InBed = FALSE;
+		}
+		else
+		{
+			g_ObjectSlots.Free(p_ObjData->m_Slot);
+		}
+		InterlockedExchange(&p_ObjData->m_InQueue, FALSE);
+	}
+
+	// Task of the fill pool: one dynamic object of g_ObjectFillBatch
+	void FillObject(void* p_Context, UINT32 Task)
+	{
+		ObjectFillBatch* p_Batch = (ObjectFillBatch*)p_Context;
+		ObjectFillBatch::Fill& ObjectFill = p_Batch->m_Fills[Task];
+
+		int Slot = ObjectFill.m_Slot;
+
+		if (g_ObjectSlots.m_Staged[Slot] == ObjectFill.p_ObjData)
+		{
+			memcpy(ObjectFill.p_Buffer, g_ObjectSlots.m_StagedBlock[Slot]->m_Samples, ISACFRAMECOUNTPERPUMP * sizeof(float));
+			g_ObjectSlots.m_StagedBlock[Slot]->Release();
+			g_ObjectSlots.m_StagedBlock[Slot] = nullptr;
+			g_ObjectSlots.m_Staged[Slot] = nullptr;
+			MeasureLatency(ObjectFill.p_ObjData, g_ObjectSlots.m_StagedLatency[Slot]);
+		}
+		else
+		{
+			PullSourceFrames(ObjectFill.p_ObjData, g_ObjectSlots.m_EmptyCount[Slot], g_ObjectSlots.m_PumpPosition[Slot], ObjectFill.p_Buffer, nullptr, *p_Batch->p_Removals);
+			ObjectFill.m_Pulled = TRUE;
+		}
+	}
+
+	// Task of the fill pool: stages the next period of one dynamic object of g_ObjectFillBatch
+	void StageObject(void* p_Context, UINT32 Task)
+	{
+		ObjectFillBatch* p_Batch = (ObjectFillBatch*)p_Context;
+		const ObjectFillBatch::Fill& ObjectFill = p_Batch->m_Fills[Task];
+
+		StageSourceBlock(g_ObjectSlots, ObjectFill.m_Slot, ObjectFill.p_ObjData);
+	}
+
+	// Runs a task for every object in g_ObjectFillBatch, on the fill pool if it's worth waking
+	void RunObjectFillBatch(WorkerPool::TaskFunction p_Task)
+	{
+		ObjectFillBatch& Batch = g_ObjectFillBatch;
+
+		if (g_FillPool != nullptr && Batch.m_Count >= PARALLEL_FILL_MIN_OBJECTS)
+		{
+			g_FillPool->Run(p_Task, &Batch, Batch.m_Count);
+		}
+		else
+		{
+			for (UINT32 Task = 0; Task < Batch.m_Count; Task++)
+			{
+				p_Task(&Batch, Task);
+			}
+		}
+	}
+
+	// Reads the next period of every source ahead of the pump that sends it, once this pump is done with the sink, so
+	// that the next Begin/EndUpdate window is mostly copies and setter calls. The reverb is run here too.
+	void StageNextPump()
+	{
+		LONG Budget = GetSourceObjectBudget();
+
+		ObjectFillBatch& Batch = g_ObjectFillBatch;
+		Batch.m_Count = 0;
+		Batch.p_Removals = nullptr;
+
+		for (int Slot = g_ObjectSlots.NextOccupied(0); Slot >= 0 && Slot < Budget; Slot = g_ObjectSlots.NextOccupied(Slot + 1))
+		{
+			// An object the last pump couldn't get a buffer for is still staged
+			UnityAudioData *p_ObjData = g_ObjectSlots.Get(Slot);
+			if (p_ObjData != nullptr && g_ObjectSlots.m_Staged[Slot] != p_ObjData)
+			{
+				ObjectFillBatch::Fill& ObjectFill = Batch.m_Fills[Batch.m_Count++];
+				ObjectFill.p_ObjData = p_ObjData;
+				ObjectFill.m_Slot = Slot;
+				ObjectFill.p_Buffer = nullptr;
+				ObjectFill.m_Pulled = FALSE;
+			}
+		}
+		RunObjectFillBatch(StageObject);
+
+		// The reverb's input is shared, so the sends are only mixed once the fill pool is done
+		for (UINT32 Task = 0; Task < Batch.m_Count; Task++)
+		{
+			int Slot = Batch.m_Fills[Task].m_Slot;
+			if (g_ObjectSlots.m_StagedBlock[Slot] != nullptr)
+			{
+				MixReverbSend(g_ObjectSlots, Slot, g_ObjectSlots.m_StagedBlock[Slot]->m_Samples);
+			}
+		}
+
+		if (InterlockedCompareExchange(&g_BedActive, 0, 0))
+		{
+			StageBed();
+		}
+
+		if (g_Reverb != nullptr)
+		{
+			StageReverb();
+		}
+	}
+
+	void SetObjectFillThreads(UINT32 ThreadCount)
+	{
+		delete g_FillPool;
+		g_FillPool = (ThreadCount > 1) ? WorkerPool::Create(ThreadCount) : nullptr;
+	}
+
+	void PumpOnce(SpatialAudioSink* p_Sink)
+	{
+		REALTIME_SCOPE();
+
+		HRESULT hr = S_OK;
+		UINT32 FrameCount = 0;
+		UINT32 AvailableObjectCount = 0;
+
+		// If we discover that a source needs to be taken off its slot, we put it in here
+		// and remove it once the sink has its audio.
+		RemoveList Removals;
+		Removals.m_Count = 0;
+
+		// Copy data over to the sink within a Begin/EndUpdate block
+		LARGE_INTEGER WindowStart;
+		QueryPerformanceCounter(&WindowStart);
+
+		hr = p_Sink->BeginUpdate(&AvailableObjectCount, &FrameCount);
+		if (FAILED(hr))
+		{
+			return;
+		}
+
+		{
+			// Sources that claimed a slot before ISAC lowered the budget (or the reverb took the last object) are
+			// evicted here, and get a slot within the budget (or the bed) on their next ProcessCallback
+			LONG Budget = GetSourceObjectBudget();
+
+			// Go through the occupied slots and get the buffer of the ISAC Object of each. Only the filling can
+			// be spread over threads; the sink itself is only called from this one.
+			ObjectFillBatch& Batch = g_ObjectFillBatch;
+			Batch.m_Count = 0;
+			Batch.p_Removals = &Removals;
+
+			for (int Slot = g_ObjectSlots.NextOccupied(0); Slot >= 0; Slot = g_ObjectSlots.NextOccupied(Slot + 1))
+			{
+				UnityAudioData *p_ObjData = g_ObjectSlots.Get(Slot);
+				if (p_ObjData == nullptr)
+				{
+					continue;
+				}
+
+				if (Slot >= Budget)
+				{
+					FreeSource(p_ObjData);
+					continue;
+				}
+
+				// Defensive check
+				if ((UINT32)Slot >= AvailableObjectCount)
+				{
+					continue;
+				}
+
+				//Get the object buffer
+				float* p_ISACObjBuffer = nullptr;
+				hr = p_Sink->GetDynamicObjectBuffer(Slot, &p_ISACObjBuffer);
+				if (FAILED(hr))
+				{
+					continue;
+				}
+
+				ObjectFillBatch::Fill& ObjectFill = Batch.m_Fills[Batch.m_Count++];
+				ObjectFill.p_ObjData = p_ObjData;
+				ObjectFill.m_Slot = Slot;
+				ObjectFill.p_Buffer = p_ISACObjBuffer;
+				ObjectFill.m_Pulled = FALSE;
+			}
+
+			// Staged objects are only copied. Run only returns once every object is filled, so the pool has joined
+			// before EndUpdate.
+			RunObjectFillBatch(FillObject);
+
+			for (UINT32 Task = 0; Task < Batch.m_Count; Task++)
+			{
+				int Slot = Batch.m_Fills[Task].m_Slot;
+				const UnityAudioPosition& PumpPosition = g_ObjectSlots.m_PumpPosition[Slot];
+
+				p_Sink->SetDynamicObjectPosition(Slot,
+												PumpPosition.X,
+												PumpPosition.Y,
+												PumpPosition.Z);
+				p_Sink->SetDynamicObjectVolume(Slot, 1.0f);
+
+				// What wasn't staged only gets to the reverb with the next pump
+				if (Batch.m_Fills[Task].m_Pulled)
+				{
+					MixReverbSend(g_ObjectSlots, Slot, Batch.m_Fills[Task].p_Buffer);
+				}
+			}
+
+			if (InterlockedCompareExchange(&g_BedActive, 0, 0))
+			{
+				MixBed(p_Sink, Removals);
+			}
+
+			// The reverb's object only gets a buffer while its tail is audible
+			LONG ReverbObject = GetReverbObjectIndex();
+			if (ReverbObject >= 0 && (UINT32)ReverbObject < AvailableObjectCount && g_ReverbAudible)
+			{
+				float* p_ReverbBuffer = nullptr;
+				if (SUCCEEDED(p_Sink->GetDynamicObjectBuffer(ReverbObject, &p_ReverbBuffer)))
+				{
+					memcpy(p_ReverbBuffer, g_ReverbObjectMix, ISACFRAMECOUNTPERPUMP * sizeof(float));
+					p_Sink->SetDynamicObjectPosition(ReverbObject, REVERB_OBJECT_X, REVERB_OBJECT_Y, REVERB_OBJECT_Z);
+					p_Sink->SetDynamicObjectVolume(ReverbObject, 1.0f);
+				}
+			}
+		}
+
+		// Let the audio-engine know that the object data are available for processing now 
+		hr = p_Sink->EndUpdate();
+		if (FAILED(hr))
+		{
+			return;
+		}
+
+		LARGE_INTEGER WindowEnd;
+		QueryPerformanceCounter(&WindowEnd);
+		g_UpdateWindow.Add((float)((double)(WindowEnd.QuadPart - WindowStart.QuadPart) / g_TicksPerMillisecond));
+
+		// Remove inactive sources from their slots, checking one last time in case ProcessCallback
+		// has written to them in the meantime
+		for (LONG Index = 0; Index < Removals.m_Count; Index++)
+		{
+			UnityAudioData *p_ObjData = Removals.m_Sources[Index];
+
+			BOOL RanDry = p_ObjData->m_Audio.GetNumBuffered() < 2;
+			if (RanDry || InterlockedCompareExchange(&p_ObjData->m_ReleaseRequested, 0, 0))
+			{
+				FreeSource(p_ObjData);
+			}
+		}
+
+		StageNextPump();
+	}
+
+	// Takes every source off the slot tables, so that Unity renders them until they are queued again
+	void FreeAllSources()
+	{
+		g_BedStaged = FALSE;
+
+		for (int Slot = g_ObjectSlots.NextOccupied(0); Slot >= 0; Slot = g_ObjectSlots.NextOccupied(Slot + 1))
+		{
+			UnityAudioData *p_ObjData = g_ObjectSlots.Get(Slot);
+			if (p_ObjData != nullptr)
+			{
+				FreeSource(p_ObjData);
+			}
+		}
+
+		for (int Slot = g_BedSlots.NextOccupied(0); Slot >= 0; Slot = g_BedSlots.NextOccupied(Slot + 1))
+		{
+			UnityAudioData *p_ObjData = g_BedSlots.Get(Slot);
+			if (p_ObjData != nullptr)
+			{
+				FreeSource(p_ObjData);
+			}
+		}
+	}
+
+	// Function that actually sends data to ISAC. Runs in a separate thread, waits for
+	// ISAC to signal its invocation through g_ISACBufferCompletionEvent
+	VOID CALLBACK SpatialWorkCallbackNew(_Inout_ PTP_CALLBACK_INSTANCE Instance, _Inout_opt_ PVOID Context, _Inout_ PTP_WORK Work)
+	{
+		HRESULT hr = S_OK;
+		hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);	// TODO: Find out why this is needed and how this affects things.
+		
+		Work;
+		Instance;
+
+		// Flush denormals for as long as this thread pumps audio
+		DenormalGuard Denormals;
+
+		// The fill workers take this thread's priority
+		SetObjectFillThreads(g_FillThreadCount);
+
+		DWORD ISACBufferCompletionMaxWaitTime = 100;
+		// At this point, ISAC has initialized and we can start sending data to it.
+		while (g_WorkThreadActive)
+		{
+			// Wait for ISAC Event 
+			if (WaitForSingleObject(g_ISACBufferCompletionEvent, ISACBufferCompletionMaxWaitTime) != WAIT_OBJECT_0)
+			{
+				// Ideally, we should get an ISAC event every 10ms when ISAC is active.
+				// So if we don't get the event within 100 ms, we have an issue. There
+				// are three possibilities that we can do something about: 
+				// 
+				// 1. ISAC hasn't been initialized yet. So we initialize it.
+				//
+				// 2. ISAC Render stream initialization failed because Spatial Audio is
+				//    turned off (Spatial Rendering Mode is set to None). In this case
+				//    we want to keep trying to create the ISAC stream to check if Spatial Audio
+				//    has been enabled by the user.
+				//
+				// 3. The ISAC graph was torn down because the user changed the Spatial 
+				//    Rendering mode or changed the Default device. We try to detect if 
+				//    that is the case. If so, we reset everything and try to initialize 
+				//    ISAC again. Meanwhile, rendering will be handled by Unity.
+
+				// Case 1
+				if (!g_SpatialAudioClientCreated)
+				{
+					g_SpatialAudioClientCreated = InitializeSpatialAudioClient(g_SystemSampleRate);
+					continue;
+				}
+
+				// Case 2
+				if (!g_SpatialAudioRenderStreamCreated)
+				{
+					g_SpatialAudioRenderStreamCreated = CreateSpatialAudioRenderStream();
+					continue;
+				}
+
+				// Case 3: If the ISAC graph was torn down, we will get an error when calling this method
+				hr = g_SpatialAudioStream->Reset();
+
+				if (FAILED(hr))
+				{
+					g_SpatialAudioRenderStreamCreated = FALSE;
+					InterlockedExchange(&g_BedActive, FALSE);
+
+					FreeAllSources();
+
+					g_SpatialAudioClientCreated = InitializeSpatialAudioClient(g_SystemSampleRate);
+
+					g_SpatialAudioRenderStreamCreated = CreateSpatialAudioRenderStream();
+
+					if (g_SpatialAudioRenderStreamCreated)
+					{
+						ISACBufferCompletionMaxWaitTime = 100;
+					}
+				}
+				continue;
+			}
+
+			PumpOnce((g_ObjectCaptureSink != nullptr) ? (SpatialAudioSink*)g_ObjectCaptureSink : &g_ISACSink);
+		}
+
+		SetObjectFillThreads(1);
+	}
+
+	// When creating the ISAC client, we can pass in activation parameters for telemetry purposes. This includes a GUID to indicate which middleware
+	// is using the API, and the version of the middleware. In this code, I use a GUID specifically for this Unity Plugin.
+	HRESULT CreateSpatialAudioClientActivationParams(GUID contextId, GUID appId, int majorVer, int minorVer1, int minorVer2, int minorVer3, PROPVARIANT* pActivationParams)
+	{
+		PROPVARIANT var;
+		PropVariantInit(&var);
+
+		SpatialAudioClientActivationParams* params = reinterpret_cast<SpatialAudioClientActivationParams*>(CoTaskMemAlloc(sizeof(SpatialAudioClientActivationParams)));
+
+		if (params == nullptr)
+		{
+			return E_OUTOFMEMORY;
+		}
+
+		params->tracingContextId = contextId;
+		params->appId = appId;
+		params->majorVersion = majorVer;
+		params->minorVersion1 = minorVer1;
+		params->minorVersion2 = minorVer2;
+		params->minorVersion3 = minorVer3;
+		var.vt = VT_BLOB;
+		var.blob.cbSize = sizeof(*params);
+		var.blob.pBlobData = reinterpret_cast<BYTE *>(params);
+		*pActivationParams = var;
+
+		return S_OK;
+	}
+	
+	// If we're building the Plugin for use in UWP apps, then we need to Initialize ISAC using an Initializer class
+#ifdef UWPBUILD
+	class ISACInitializer :
+		public Microsoft::WRL::RuntimeClass< Microsoft::WRL::RuntimeClassFlags< Microsoft::WRL::ClassicCom >, Microsoft::WRL::FtmBase, IActivateAudioInterfaceCompletionHandler >
+	{
+	public:
+		ISACInitializer();
+		~ISACInitializer();
+
+		Platform::String^		m_DeviceIdString;
+		bool					m_ISACDeviceActive;
+
+		ISpatialAudioClient	   *m_SpatialAudioClient;
+		HANDLE                  m_CompletedEvent;
+		HRESULT					m_ActivateHResult;
+
+		HRESULT InitializeAudioDeviceAsync();
+
+		STDMETHOD(ActivateCompleted) (IActivateAudioInterfaceAsyncOperation *operation);
+	};
+
+	ISACInitializer::ISACInitializer() :
+		m_SpatialAudioClient(nullptr),
+		m_ActivateHResult(E_FAIL)
+	{
+		m_CompletedEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	}
+
+	ISACInitializer::~ISACInitializer()
+	{
+		CloseHandle(m_CompletedEvent);
+	}
+
+	HRESULT ISACInitializer::InitializeAudioDeviceAsync()
+	{
+		ComPtr<IActivateAudioInterfaceAsyncOperation> AsyncOp;
+		HRESULT hr = S_OK;
+		PROPVARIANT ActivationParams;
+		PROPVARIANT* p_ActivationParams = nullptr;
+
+		// Get a string representing the Default Audio Device Renderer
+		m_DeviceIdString = Windows::Media::Devices::MediaDevice::GetDefaultAudioRenderId(Windows::Media::Devices::AudioDeviceRole::Default);
+
+		// Create activation params - this specifies a GUID that lets ISAC know that the Middleware being used by the App is Unity
+		hr = CreateSpatialAudioClientActivationParams(GUID_NULL, UNITY_ISAC_MIDDLEWARE_ID, MAJOR_VERSION, MINOR_VERSION1, MINOR_VERSION2, 0, &ActivationParams);
+		p_ActivationParams = SUCCEEDED(hr) ? &ActivationParams : nullptr;
+
+		// This call must be made on the main UI thread.  Async operation will call back to 
+		// IActivateAudioInterfaceCompletionHandler::ActivateCompleted, which must be an agile interface implementation
+		hr = ActivateAudioInterfaceAsync(m_DeviceIdString->Data(), __uuidof(ISpatialAudioClient), p_ActivationParams, this, &AsyncOp);
+		if (FAILED(hr))
+		{
+			m_ISACDeviceActive = false;
+		}
+
+		return hr;
+	}
+
+	HRESULT ISACInitializer::ActivateCompleted(IActivateAudioInterfaceAsyncOperation *operation)
+	{
+		HRESULT hr = S_OK;
+		IUnknown *p_AudioInterface = nullptr;
+
+		hr = operation->GetActivateResult(&m_ActivateHResult, &p_AudioInterface);
+
+		if (p_AudioInterface == nullptr)
+		{
+			hr = E_FAIL;
+			goto exit;
+		}
+
+		// Finally. Get the pointer for the Spatial Audio Client Interface
+		p_AudioInterface->QueryInterface(IID_PPV_ARGS(&m_SpatialAudioClient));
+
+		if (m_SpatialAudioClient == nullptr)
+		{
+			hr = E_FAIL;
+			goto exit;
+		}
+
+	exit:
+		if (p_AudioInterface != nullptr)
+		{
+			p_AudioInterface->Release();
+			p_AudioInterface = nullptr;
+		}
+
+		if (FAILED(hr))
+		{
+			if (m_SpatialAudioClient != nullptr)
+			{
+				m_SpatialAudioClient->Release();
+				m_SpatialAudioClient = nullptr;
+			}
+		}
+
+		// Signal the completion of the Asynchronous Activation operation
+		SetEvent(m_CompletedEvent);
+		return S_OK;
+	}
+		
+	ISpatialAudioClient* GetSpatialAudioClientFromInitializer()
+	{
+		ISACInitializer Initializer;
+		DWORD dwWaitResult;
+
+		HRESULT hr;
+
+		hr = Initializer.InitializeAudioDeviceAsync();
+		if (FAILED(hr))
+		{
+			return nullptr;
+		}
+
+		dwWaitResult = WaitForSingleObject(Initializer.m_CompletedEvent, INFINITE);
+		if (dwWaitResult == WAIT_OBJECT_0)
+		{
+			hr = S_OK;
+		}
+		else if (dwWaitResult == WAIT_TIMEOUT)
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+			//TODO ERROR HANDLING
+		}
+		else if (dwWaitResult == WAIT_FAILED)
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+			//TODO ERROR HANDLING
+		}
+		else
+		{
+			hr = E_FAIL;
+			//TODO ERROR HANDLING
+		}
+
+		if (Initializer.m_ActivateHResult != S_OK)
+		{
+			return nullptr;
+		}
+		else
+		{
+			return Initializer.m_SpatialAudioClient;
+		}
+	}
+#endif
+
+	// ISAC Notifies us when its object count changes. This class is used to get that notification.
+	class ISACNotify WrlSealed :
+		public Microsoft::WRL::RuntimeClass<
+		Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>,
+		ISpatialAudioObjectRenderStreamNotify,
+		Microsoft::WRL::FtmBase>
+	{
+	public:
+		STDMETHOD(OnAvailableDynamicObjectCountChange)(
+			_In_ ISpatialAudioObjectRenderStreamBase *sender,
+			_In_ LONGLONG hnsComplianceDeadlineTime,
+			_In_ UINT32 objectCount)
+		{
+			// Published for ProcessCallback to claim slots against. If the count was lowered, the worker thread
+			// evicts the sources over it on its next pass, well within the compliance deadline.
+			InterlockedExchange(&g_ISACObjectBudget, (LONG)((objectCount < ISAC_MAX_DYNAMIC_OBJECTS) ? objectCount : ISAC_MAX_DYNAMIC_OBJECTS));
+			return S_OK;
+		}
+	};
+	ISACNotify g_notifyObj;
+
+	BOOL InitializeSpatialAudioClient(int sampleRate) 
+	{
+		IMMDevice* p_Device = NULL;
+		IMMDeviceEnumerator* p_Enumerator = NULL;
+		HRESULT hr = S_OK;
+		PROPVARIANT* p_ActivationParams = nullptr;
+
+		// Reset ISAC variables in case we are restarting ISAC
+		g_SpatialAudioClient = nullptr;
+		g_SpatialAudioStream = nullptr;
+
+		// ISAC only supports 48K at this point
+		// TODO: Add support for other sampling rates when ISAC adds support for them.
+		g_SystemSampleRate = sampleRate;
+		if (g_SystemSampleRate != REQUIRED_SAMPLE_RATE)	
+			return FALSE;
+
+#ifndef UWPBUILD
+		/* QUERY IMMDEVICE TO GET DEFAULT ENDPOINT AND INITIALIZE ISAC ON IT */
+		CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),	(void**)&p_Enumerator);
+
+		p_Enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &p_Device);
+
+		if (!&p_Device)
+			return FALSE;
+
+		PROPVARIANT activationParams;
+
+		// Create activation params - this specifies a GUID that lets ISAC know that the Middleware being used by the App is Unity
+		hr = CreateSpatialAudioClientActivationParams(GUID_NULL, UNITY_ISAC_MIDDLEWARE_ID, MAJOR_VERSION, MINOR_VERSION1, MINOR_VERSION2, 0, &activationParams);
+		p_ActivationParams = SUCCEEDED(hr) ? &activationParams : nullptr;
+
+		hr = p_Device->Activate(__uuidof(ISpatialAudioClient), CLSCTX_INPROC_SERVER, p_ActivationParams, (void**)&g_SpatialAudioClient);
+#else
+		g_SpatialAudioClient = GetSpatialAudioClientFromInitializer();
+#endif
+	
+		if (g_SpatialAudioClient == nullptr)
+		{
+			// Spatial Audio Client creation failed
+			return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	// Lays out the bed channels in the mask and sets up the panner with the speaker positions the sink reports for them
+	void CreateBed(SpatialAudioSink* p_Sink, AudioObjectType Mask)
+	{
+		g_BedChannelCount = LayOutBed(p_Sink, Mask, g_BedChannelTypes, g_BedSpeakerChannel, g_BedPanner);
+		InterlockedExchange(&g_BedActive, g_BedPanner.GetNumSpeakers() > 0);
+	}
+
+	BOOL CreateSpatialAudioRenderStream()
+	{
+		HRESULT hr = S_OK;
+
+		if (g_SpatialAudioClient == nullptr)
+		{
+			return FALSE;
+		}
+
+		// Check the available rendering formats 
+		ComPtr<IAudioFormatEnumerator> AudioObjectFormatEnumerator;
+		hr = g_SpatialAudioClient->GetSupportedAudioObjectFormatEnumerator(&AudioObjectFormatEnumerator);
+		if (FAILED(hr))
+		{
+			return FALSE;
+		}
+
+		WAVEFORMATEX* p_ObjectFormat = nullptr;
+
+		UINT32 AudioObjectFormatCount;
+		hr = AudioObjectFormatEnumerator->GetCount(&AudioObjectFormatCount); // There should be at least one format that the API accepts
+		if (AudioObjectFormatCount == 0)
+		{
+			return FALSE;
+		}
+
+		// Select the most favorable format: the first one
+		hr = AudioObjectFormatEnumerator->GetFormat(0, &p_ObjectFormat);
+		if (FAILED(hr))
+		{
+			return FALSE;
+		}
+
+		// Ask ISAC about the maximum number of objects we can have
+		UINT32 MaxNumISACObjects = 0;
+		hr = g_SpatialAudioClient->GetMaxDynamicObjectCount(&MaxNumISACObjects);
+		if (FAILED(hr))
+		{
+			return FALSE;
+		}
+
+		// This means Spatial Audio is turned off on this endpoint, return failure
+		if (MaxNumISACObjects == 0)
+		{
+			return FALSE;
+		}
+
+		// Objects past the end of the slot table would never be used
+		if (MaxNumISACObjects > ISAC_MAX_DYNAMIC_OBJECTS)
+		{
+			MaxNumISACObjects = ISAC_MAX_DYNAMIC_OBJECTS;
+		}
+
+		g_ISACObjectVector.resize(MaxNumISACObjects, nullptr);
+
+		SpatialAudioObjectRenderStreamActivationParams Params = {};
+		Params.Category = AudioCategory_GameEffects;
+		Params.EventHandle = g_ISACBufferCompletionEvent;
+		Params.MinDynamicObjectCount = (UINT32)(0.2f * (float)MaxNumISACObjects);		// set minimum to 20% of max
+		Params.MaxDynamicObjectCount = MaxNumISACObjects;
+		Params.NotifyObject = &g_notifyObj;
+		Params.ObjectFormat = p_ObjectFormat;
+		Params.StaticObjectTypeMask = ISAC_BED_MASK;		// Static bed for the voices that don't get a dynamic object
+
+		PROPVARIANT ActivateParams;
+		PropVariantInit(&ActivateParams);
+		ActivateParams.vt = VT_BLOB;
+		ActivateParams.blob.cbSize = sizeof(Params);
+		ActivateParams.blob.pBlobData = reinterpret_cast<BYTE*>(&Params);
+
+		hr = g_SpatialAudioClient->ActivateSpatialAudioStream(&ActivateParams, __uuidof(ISpatialAudioObjectRenderStream), &g_SpatialAudioStream);
+		if (FAILED(hr))
+		{
+			// Fall back to dynamic objects only
+			Params.StaticObjectTypeMask = AudioObjectType_None;
+			hr = g_SpatialAudioClient->ActivateSpatialAudioStream(&ActivateParams, __uuidof(ISpatialAudioObjectRenderStream), &g_SpatialAudioStream);
+			if (FAILED(hr))
+			{
+				return FALSE;
+			}
+		}
+
+		for (UINT32 Channel = 0; Channel < ISAC_BED_MAX_CHANNELS; Channel++)
+		{
+			g_BedObjects[Channel] = nullptr;
+		}
+		CreateBed(&g_ISACSink, Params.StaticObjectTypeMask);
+
+		hr = g_SpatialAudioStream->Start();
+		if (FAILED(hr))
+		{
+			return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	void AttachSimulatedSink(SpatialAudioSink* p_Sink, UINT32 DynamicObjectCount, UINT32 SampleRate)
+	{
+		g_SimulatedSink = p_Sink;
+		g_SystemSampleRate = SampleRate;
+
+		InterlockedExchange(&g_ISACObjectBudget, (LONG)((DynamicObjectCount < ISAC_MAX_DYNAMIC_OBJECTS) ? DynamicObjectCount : ISAC_MAX_DYNAMIC_OBJECTS));
+
+		CreateBed(p_Sink, ISAC_BED_MASK);
+
+		g_SpatialAudioClientCreated = TRUE;
+		g_SpatialAudioRenderStreamCreated = TRUE;
+	}
+
+	inline float DecibelsToGain(float Decibels)
+	{
+		return (Decibels <= INAUDIBLE_GAIN_DB) ? 0.0f : powf(10.0f, Decibels * 0.05f);
+	}
+
+	// Works out the linear gain limits used by DistanceAttenuationCallback. Called on the thread that changes the
+	// parameters, so the audio thread never converts decibels.
+	AttenuationModel ComputeAttenuationModel(const float* p_Params)
+	{
+		float MinGainDB = p_Params[P_MINGAIN];
+		float MaxGainDB = p_Params[P_MAXGAIN];
+		if (MinGainDB > MaxGainDB)
+		{
+			MinGainDB = MaxGainDB;
+		}
+
+		AttenuationModel Model;
+		Model.m_MinGain = DecibelsToGain(MinGainDB);
+		Model.m_MaxGain = DecibelsToGain(MaxGainDB);
+		Model.m_UnityGainDist = p_Params[P_UNITYGAINDISTANCE];
+		Model.m_BypassCurves = p_Params[P_BYPASS_ATTENUATION] >= 0.5f;
+		return Model;
+	}
+
+	// Moves a gain towards Target by at most PARAMETER_RAMP_STEP. A gain rising from silence starts at the inaudible level.
+	inline float RampGain(float Gain, float Target)
+	{
+		const float MinRampGain = 1.5849e-5f;		// INAUDIBLE_GAIN_DB
+		float Up = Gain * PARAMETER_RAMP_STEP;
+		float Down = Gain / PARAMETER_RAMP_STEP;
+		if (Target > Up)
+		{
+			return FastMax(Up, MinRampGain);
+		}
+		if (Target < Down && Down > MinRampGain)
+		{
+			return Down;
+		}
+		return Target;
+	}
+
+	// Applies the parameter changes SetFloatParameterCallback queued since the source's last block, then moves the
+	// attenuation model one step towards the one they lead to. Audio thread only, at the start of every block.
+	void ApplyParameterChanges(UnityAudioData* p_ObjData)
+	{
+		ParameterChange Change;
+		while (p_ObjData->m_ParameterChanges.Read(Change))
+		{
+			p_ObjData->p[Change.m_Index] = Change.m_Value;
+			p_ObjData->m_AttenuationTarget = Change.m_Attenuation;
+		}
+
+		// What didn't fit in the queue is copied over once the main thread isn't changing it
+		if (InterlockedCompareExchange(&p_ObjData->m_ParametersResync, 0, 0))
+		{
+			MutexScopeTryLock Lock(p_ObjData->m_ControlLock);
+			if (Lock.IsLocked())
+			{
+				memcpy(p_ObjData->p, p_ObjData->m_ControlParams, sizeof(p_ObjData->p));
+				p_ObjData->m_AttenuationTarget = p_ObjData->m_ControlAttenuation;
+				InterlockedExchange(&p_ObjData->m_ParametersResync, FALSE);
+			}
+		}
+
+		AttenuationModel& Model = p_ObjData->m_Attenuation;
+		const AttenuationModel& Target = p_ObjData->m_AttenuationTarget;
+		Model.m_MinGain = RampGain(Model.m_MinGain, Target.m_MinGain);
+		Model.m_MaxGain = RampGain(Model.m_MaxGain, Target.m_MaxGain);
+		Model.m_UnityGainDist = RampGain(Model.m_UnityGainDist, Target.m_UnityGainDist);
+		Model.m_BypassCurves = Target.m_BypassCurves;
+	}
+
+	// With BypassCurves set, the AudioSource volume curve is replaced by a natural inverse-distance decay that is 0 dB at
+	// UnityGainDist. Either way the result is held within MinGain..MaxGain, and sources beyond CutoffDist are silent. The value
+	// returned here is what Unity uses to prioritize voices, so inaudible sources must report 0 to be virtualized.
+	static UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK DistanceAttenuationCallback(UnityAudioEffectState* state, float distanceIn, float attenuationIn, float* attenuationOut)
+	{
+		REALTIME_SCOPE();
+
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+
+		if (distanceIn >= p_ObjData->p[P_CUTOFFDIST])
+		{
+			*attenuationOut = 0.0f;
+			return UNITY_AUDIODSP_OK;
+		}
+
+		const AttenuationModel& Model = p_ObjData->m_Attenuation;
+		float Gain = attenuationIn;
+		if (Model.m_BypassCurves)
+		{
+			// Sources closer than UnityGainDist get louder until MaxGain kicks in
+			Gain = Model.m_UnityGainDist / FastMax(distanceIn, MIN_ATTENUATION_DISTANCE);
+		}
+
+		if (Gain > Model.m_MaxGain)
+		{
+			Gain = Model.m_MaxGain;
+		}
+		else if (Gain < Model.m_MinGain)
+		{
+			Gain = Model.m_MinGain;
+		}
+
+		*attenuationOut = Gain;
+		return UNITY_AUDIODSP_OK;
+	}
+
+	inline bool IsHostCompatible(UnityAudioEffectState* state)
+    {
+        // Somewhat convoluted error checking here because hostapiversion is only supported from SDK version 1.03 (i.e. Unity 5.2) and onwards.
+		return
+            state->structsize >= sizeof(UnityAudioEffectState) &&
+            state->hostapiversion >= UNITY_AUDIO_PLUGIN_API_VERSION;
+    }
+
+	// Writes a source's latency measurements to the debug output
+	void LogLatency(UnityAudioData* p_ObjData, UnityAudioEffectState* state)
+	{
+		const LatencyHistogram* p_Latency = p_ObjData->m_Latency;
+		if (p_Latency->GetCount() == 0)
+		{
+			return;
+		}
+
+		char Message[256];
+		sprintf_s(Message, "MS HRTF Spatializer: source %u latency over %u periods (DSP buffer %u): min %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms, mean %.2f ms\n",
+			p_ObjData->m_SourceId, p_Latency->GetCount(), IsHostCompatible(state) ? state->dspbuffersize : 0,
+			p_Latency->GetMin(), p_Latency->GetPercentile(0.5f), p_Latency->GetPercentile(0.99f), p_Latency->GetMax(), p_Latency->GetMean());
+		OutputDebugStringA(Message);
+	}
+
+	// Appends what a callback was handed to the capture, so that ISACReplay can drive the plugin with it later
+	void CaptureCallback(CaptureRecordType Type, UnityAudioEffectState* state, const float* inbuffer, unsigned int length, int inchannels, int outchannels)
+	{
+		static_assert(P_NUM <= CAPTURE_MAX_PARAMS, "CAPTURE_MAX_PARAMS is too small for the parameters");
+
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+
+		CaptureRecordHeader Header;
+		memset(&Header, 0, sizeof(Header));
+		Header.Type = Type;
+		Header.SourceId = p_ObjData->m_SourceId;
+		Header.Flags = state->flags;
+		Header.DspTick = state->currdsptick;
+		Header.Timestamp = CaptureRecorder::Now();
+		Header.SampleRate = state->samplerate;
+		Header.Length = length;
+		Header.InChannels = inchannels;
+		Header.OutChannels = outchannels;
+		memcpy(Header.Params, p_ObjData->p, sizeof(p_ObjData->p));
+
+		Header.HostCompatible = IsHostCompatible(state);
+		if (Header.HostCompatible)
+		{
+			Header.DspBufferSize = state->dspbuffersize;
+			memcpy(Header.ListenerMatrix, state->spatializerdata->listenermatrix, sizeof(Header.ListenerMatrix));
+			memcpy(Header.SourceMatrix, state->spatializerdata->sourcematrix, sizeof(Header.SourceMatrix));
+			Header.SpatialBlend = state->spatializerdata->spatialblend;
+			Header.Spread = state->spatializerdata->spread;
+			Header.StereoPan = state->spatializerdata->stereopan;
+		}
+
+		g_CaptureRecorder->Append(Header, inbuffer, length * inchannels);
+	}
+
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK CreateCallback(UnityAudioEffectState* state)
+	{
+		// Create the object which contains the buffer and variables necessary 
+		// for transfer of audio data from Unity to ISAC audio objects
+		UnityAudioData* p_ObjData = new UnityAudioData();
+		p_ObjData->m_SourceId = InterlockedIncrement(&g_NextSourceId);
+		p_ObjData->m_Latency = new LatencyHistogram(LATENCY_BIN_WIDTH);
+
+		state->effectdata = p_ObjData;
+
+		for (const ParameterSchema& Parameter : PARAMETER_SCHEMA)
+		{
+			p_ObjData->p[Parameter.m_Index] = Parameter.m_Default;
+		}
+		memcpy(p_ObjData->m_ControlParams, p_ObjData->p, sizeof(p_ObjData->p));
+		p_ObjData->m_ControlAttenuation = ComputeAttenuationModel(p_ObjData->p);
+		p_ObjData->m_Attenuation = p_ObjData->m_ControlAttenuation;
+		p_ObjData->m_AttenuationTarget = p_ObjData->m_ControlAttenuation;
+
+		// If the current Unity version supports it, set the distance attenuation callback. The DSP buffer size is
+		// only reported by the same versions, so older ones always get the generic ingest kernel.
+		if (IsHostCompatible(state))
+		{
+			state->spatializerdata->distanceattenuationcallback = DistanceAttenuationCallback;
+			SelectIngestKernel(p_ObjData, state->dspbuffersize);
+		}
+		else
+		{
+			SelectIngestKernel(p_ObjData, 0);
+		}
+
+		// If this is the first ever create callback, we need to initialize some stuff in order
+		// for ISAC to work. This includes starting the Spatial Work thread.
+		if (g_FirstCreateCallback)	
+		{
+			g_SystemSampleRate = state->samplerate;
+
+			LARGE_INTEGER Frequency;
+			QueryPerformanceFrequency(&Frequency);
+			g_TicksPerMillisecond = (double)Frequency.QuadPart / 1000.0;
+
+			static_assert(ISACFRAMECOUNTPERPUMP == AUDIO_BLOCK_FRAMES, "An audio block must hold one pump period");
+			g_AudioBlockPool = AudioBlockPool::Create(AUDIO_BLOCK_POOL_SIZE);
+
+			// Capturing is opt-in through an environment variable naming the file to write. A replay is never captured.
+			char CapturePath[MAX_PATH];
+			DWORD CapturePathLength = GetEnvironmentVariableA(CAPTURE_ENVIRONMENT_VARIABLE, CapturePath, MAX_PATH);
+			if (CapturePathLength > 0 && CapturePathLength < MAX_PATH && g_SimulatedSink == nullptr)
+			{
+				g_CaptureRecorder = CaptureRecorder::Create(CapturePath, P_NUM);
+			}
+
+			// The same goes for capturing what the pump sends to ISAC. It has to be in place before the worker starts.
+			DWORD ObjectCapturePathLength = GetEnvironmentVariableA(OBJECT_CAPTURE_ENVIRONMENT_VARIABLE, CapturePath, MAX_PATH);
+			if (ObjectCapturePathLength > 0 && ObjectCapturePathLength < MAX_PATH && g_SimulatedSink == nullptr)
+			{
+				ObjectCaptureWriter* p_Writer = ObjectCaptureWriter::Create(CapturePath, state->samplerate);
+				if (p_Writer != nullptr)
+				{
+					g_ObjectCaptureSink = new RecordingSink(&g_ISACSink, p_Writer);
+				}
+			}
+
+			// A replay picks its fill threads itself
+			char FillThreads[16];
+			DWORD FillThreadsLength = GetEnvironmentVariableA(FILL_THREADS_ENVIRONMENT_VARIABLE, FillThreads, sizeof(FillThreads));
+			if (FillThreadsLength > 0 && FillThreadsLength < sizeof(FillThreads) && g_SimulatedSink == nullptr)
+			{
+				int ThreadCount = atoi(FillThreads);
+				g_FillThreadCount = (ThreadCount > 1) ? (UINT32)ThreadCount : 1;
+			}
+
+			// The software binaural mode is opt-in the same way. It needs no ISAC, so it works wherever ISAC isn't available.
+			char HrirPath[MAX_PATH];
+			DWORD HrirPathLength = GetEnvironmentVariableA(HRIR_DATABASE_ENVIRONMENT_VARIABLE, HrirPath, MAX_PATH);
+			if (HrirPathLength > 0 && HrirPathLength < MAX_PATH)
+			{
+				g_HrirDatabase = HrirDatabase::Open(HrirPath);
+				if (g_HrirDatabase != nullptr && g_HrirDatabase->GetSampleRate() != (UINT32)state->samplerate)
+				{
+					OutputDebugStringA("MS HRTF Spatializer: the HRIR database doesn't match the output sample rate, so it isn't used\n");
+					delete g_HrirDatabase;
+					g_HrirDatabase = nullptr;
+				}
+			}
+
+			// The binaural mode mixes each source straight into Unity's output, so there is nowhere to put a shared reverb
+			if (g_HrirDatabase == nullptr)
+			{
+				g_Reverb = FdnReverb::Create(state->samplerate, DEFAULT_ENVIRONMENT);
+				if (g_SimulatedSink == nullptr)
+				{
+					g_ReverbWork = CreateThreadpoolWork(BuildReverbCallback, nullptr, nullptr);
+				}
+			}
+
+			// With a simulated sink attached, whoever attached it runs the pump
+			if (g_SimulatedSink == nullptr && g_HrirDatabase == nullptr)
+			{
+				// Create event used to signal the worker thread for more data.
+				g_ISACBufferCompletionEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+				// Create the Spatial Work thread. This also takes care of initializing ISAC for us.
+				g_WorkThreadActive = TRUE;
+				g_WorkThread = CreateThreadpoolWork(SpatialWorkCallbackNew, nullptr, nullptr);
+				SubmitThreadpoolWork(g_WorkThread);
+			}
+
+			g_FirstCreateCallback = FALSE;
+		}
+
+		if (g_HrirDatabase != nullptr)
+		{
+			p_ObjData->p_Binaural = BinauralVoice::Create(g_HrirDatabase);
+		}
+
+		if (g_CaptureRecorder != nullptr)
+		{
+			CaptureCallback(CaptureRecord_Create, state, nullptr, 0, 0, 0);
+		}
+
+		return UNITY_AUDIODSP_OK;
+	}
+
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK ReleaseCallback(UnityAudioEffectState* state)
+	{
+		UnityAudioData* objData = state->GetEffectData<UnityAudioData>();
+
+		if (g_CaptureRecorder != nullptr)
+		{
+			CaptureCallback(CaptureRecord_Release, state, nullptr, 0, 0, 0);
+		}
+
+		// Wait until the EmptyCount for the object becomes the limit
+		// At that point, it would have been removed from the queue, so it is safe to delete it
+		while (TRUE)
+		{
+			if (objData->m_InQueue == FALSE)
+			{
+				if (objData->m_ControlParams[P_MEASURE_LATENCY] >= 0.5f)
+				{
+					LogLatency(objData, state);
+				}
+
+				//Wait a millisecond before deleting it
+				Sleep(1);
+				objData->m_Audio.Clear();
+				delete objData->m_Latency;
+				delete objData->p_Binaural;
+				delete objData;
+				break;
+			}
+			else if (g_SimulatedSink != nullptr)
+			{
+				// There is no worker thread to take it off the queue, so pump until the source has played out
+				PumpOnce(g_SimulatedSink);
+			}
+			else
+			{
+				// Wait 10ms until it has been removed from the queue
+				Sleep(10);
+			}
+		}
+
+		return UNITY_AUDIODSP_OK;
+	}
+
+	// Called on Unity's main thread. The change reaches the audio thread at the start of the source's next block.
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK SetFloatParameterCallback(UnityAudioEffectState* state, int index, float value)
+	{
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+		if (index < 0 || index >= P_NUM)
+			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
+
+		// Scripts can set anything, NaN included, so the value is clamped to the registered range
+		const ParameterSchema& Parameter = PARAMETER_SCHEMA[index];
+		if (!(value >= Parameter.m_Min))
+		{
+			value = Parameter.m_Min;
+		}
+		else if (value > Parameter.m_Max)
+		{
+			value = Parameter.m_Max;
+		}
+
+		// Each measurement starts from scratch, and its results are logged when it stops
+		if (index == P_MEASURE_LATENCY)
+		{
+			BOOL WasMeasuring = p_ObjData->m_ControlParams[P_MEASURE_LATENCY] >= 0.5f;
+			BOOL Measuring = value >= 0.5f;
+			if (Measuring && !WasMeasuring)
+			{
+				p_ObjData->m_Latency->RequestReset();
+			}
+			else if (!Measuring && WasMeasuring)
+			{
+				LogLatency(p_ObjData, state);
+			}
+		}
+
+		{
+			MutexScopeLock Lock(p_ObjData->m_ControlLock);
+			p_ObjData->m_ControlParams[index] = value;
+			p_ObjData->m_ControlAttenuation = ComputeAttenuationModel(p_ObjData->m_ControlParams);
+
+			ParameterChange Change = { index, value, p_ObjData->m_ControlAttenuation };
+			if (p_ObjData->m_ParameterChanges.Write(&Change, 1) == 0)
+			{
+				InterlockedExchange(&p_ObjData->m_ParametersResync, TRUE);
+			}
+		}
+
+		// The reverb is shared, so the environment is whatever a source last set it to
+		if (index == P_ENVIRONMENT)
+		{
+			RequestEnvironment((LONG)(value + 0.5f));
+		}
+		return UNITY_AUDIODSP_OK;
+	}
+
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK GetFloatParameterCallback(UnityAudioEffectState* state, int index, float* value, char *valuestr)
+	{
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+		if (index < 0 || index >= P_NUM)
+			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
+
+		float Value = p_ObjData->m_ControlParams[index];
+		if (value != NULL)
+			*value = Value;
+		if (valuestr != NULL)
+		{
+			const ParameterSchema& Parameter = PARAMETER_SCHEMA[index];
+			switch (Parameter.m_Format)
+			{
+			case ParameterFormat_Toggle:
+				sprintf_s(valuestr, PARAMETER_VALUE_STRING_SIZE, "%s", (Value >= 0.5f) ? "on" : "off");
+				break;
+			case ParameterFormat_Environment:
+				sprintf_s(valuestr, PARAMETER_VALUE_STRING_SIZE, "%s", ENVIRONMENT_NAMES[(int)(Value + 0.5f)]);
+				break;
+			default:
+				sprintf_s(valuestr, PARAMETER_VALUE_STRING_SIZE, "%.4g %s", Value, Parameter.m_Unit);
+				break;
+			}
+		}
+		return UNITY_AUDIODSP_OK;
+	}
+
+	// The number of values in a histogram, then its min, p50, p99, max and mean
+	void GetHistogramStats(const LatencyHistogram* p_Histogram, float* buffer, int numsamples)
+	{
+		float Stats[6] = { (float)p_Histogram->GetCount(), p_Histogram->GetMin(), p_Histogram->GetPercentile(0.5f),
+			p_Histogram->GetPercentile(0.99f), p_Histogram->GetMax(), p_Histogram->GetMean() };
+		for (int n = 0; n < numsamples; n++)
+		{
+			buffer[n] = (n < 6) ? Stats[n] : 0.0f;
+		}
+	}
+
+	void GetHistogramBins(const LatencyHistogram* p_Histogram, float* buffer, int numsamples)
+	{
+		for (int n = 0; n < numsamples; n++)
+		{
+			buffer[n] = (n < LatencyHistogram::NUMBINS) ? (float)p_Histogram->GetBin(n) : 0.0f;
+		}
+	}
+
+	// Reports the latency measurements (see P_MEASURE_LATENCY) in milliseconds. "LatencyStats" gets the number of
+	// periods measured, min, p50, p99, max and mean; "LatencyHistogram" gets the period counts of LATENCY_BIN_WIDTH bins.
+	// "UpdateWindowStats" and "UpdateWindowHistogram" report the pump's Begin/EndUpdate window the same way, with
+	// UPDATE_WINDOW_BIN_WIDTH bins. It is measured for every pump, whichever source it is asked for.
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK GetFloatBufferCallback(UnityAudioEffectState* state, const char* name, float* buffer, int numsamples)
+	{
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+
+		if (strcmp(name, "LatencyStats") == 0)
+		{
+			GetHistogramStats(p_ObjData->m_Latency, buffer, numsamples);
+		}
+		else if (strcmp(name, "LatencyHistogram") == 0)
+		{
+			GetHistogramBins(p_ObjData->m_Latency, buffer, numsamples);
+		}
+		else if (strcmp(name, "UpdateWindowStats") == 0)
+		{
+			GetHistogramStats(&g_UpdateWindow, buffer, numsamples);
+		}
+		else if (strcmp(name, "UpdateWindowHistogram") == 0)
+		{
+			GetHistogramBins(&g_UpdateWindow, buffer, numsamples);
+		}
+
+		return UNITY_AUDIODSP_OK;
+	}
+
+	const LatencyHistogram& GetUpdateWindowHistogram()
+	{
+		return g_UpdateWindow;
+	}
+
+	void GetAudioBlockUsage(UINT32* p_PeakInUse, UINT32* p_BlockCount, UINT32* p_Exhausted, UINT32* p_DroppedWrites)
+	{
+		*p_PeakInUse = (g_AudioBlockPool != nullptr) ? g_AudioBlockPool->GetPeakBlocksInUse() : 0;
+		*p_BlockCount = (g_AudioBlockPool != nullptr) ? g_AudioBlockPool->GetBlockCount() : 0;
+		*p_Exhausted = (g_AudioBlockPool != nullptr) ? g_AudioBlockPool->GetExhaustedCount() : 0;
+		*p_DroppedWrites = (UINT32)g_DroppedAudioWrites;
+	}
+
+	// Renders a source binaurally straight into Unity's output. The 2D part of a source with a spatial blend below 1 is
+	// passed through as it came in, as Unity would render it.
+	void RenderBinaural(UnityAudioData* p_ObjData, const float* inbuffer, float* outbuffer, UINT32 length, float X, float Y, float Z, float SpatialBlend, float GainStart, float GainEnd)
+	{
+		p_ObjData->p_Binaural->Process(inbuffer, outbuffer, length, 2, X, Y, Z, GainStart * SpatialBlend, GainEnd * SpatialBlend);
+
+		if (SpatialBlend < 1.0f)
+		{
+			const float GainStep = (GainEnd - GainStart) / (float)length;
+			for (UINT32 n = 0; n < length; n++)
+			{
+				float Direct = (1.0f - SpatialBlend) * (GainStart + GainStep * (float)n);
+				outbuffer[2 * n] += inbuffer[2 * n] * Direct;
+				outbuffer[2 * n + 1] += inbuffer[2 * n + 1] * Direct;
+			}
+		}
+	}
+
+	// Empties the queues of a source that is about to be put in a slot, in case it was taken off one, so that ISAC
+	// doesn't render stale data. The worker thread doesn't read them until the source is published.
+	void ResetQueuedSource(UnityAudioData* p_ObjData)
+	{
+		p_ObjData->m_Audio.Clear();
+		p_ObjData->m_Positions.Clear();
+		InterlockedExchange(&p_ObjData->m_ReleaseRequested, FALSE);
+	}
+
+	// Gives a source a dynamic ISAC object, if ISAC's budget has one left. Never blocks.
+	BOOL QueueToObject(UnityAudioData* p_ObjData)
+	{
+		int Slot = g_ObjectSlots.Claim(GetSourceObjectBudget());
+		if (Slot < 0)
+		{
+			return FALSE;
+		}
+
+		ResetQueuedSource(p_ObjData);
+		p_ObjData->m_Slot = Slot;
+		p_ObjData->m_InBed = FALSE;
+		InterlockedExchange(&p_ObjData->m_InQueue, TRUE);
+
+		g_ObjectSlots.Publish(Slot, p_ObjData);
+		return TRUE;
+	}
+
+	// Queues a source that didn't get a dynamic ISAC object to be panned into the static bed by the worker thread
+	BOOL QueueToBed(UnityAudioData* p_ObjData)
+	{
+		int Slot = g_BedSlots.Claim(ISAC_BED_MAX_SOURCES);
+		if (Slot < 0)
+		{
+			return FALSE;
+		}
+
+		// Same as for a dynamic object, and the bed gains start from silence so the source fades in
+		ResetQueuedSource(p_ObjData);
+		memset(g_BedSlotGains[Slot], 0, sizeof(g_BedSlotGains[Slot]));
+		p_ObjData->m_Slot = Slot;
+		p_ObjData->m_InBed = TRUE;
+		InterlockedExchange(&p_ObjData->m_InQueue, TRUE);
+
+		g_BedSlots.Publish(Slot, p_ObjData);
+		return TRUE;
+	}
+
+	UNITY_AUDIODSP_RESULT UNITY_AUDIODSP_CALLBACK ProcessCallback(UnityAudioEffectState* state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int outchannels)
+	{
+		REALTIME_SCOPE();
+
+		// The parameters are captured as this block uses them
+		UnityAudioData* p_ObjData = state->GetEffectData<UnityAudioData>();
+		ApplyParameterChanges(p_ObjData);
+
+		if (g_CaptureRecorder != nullptr)
+		{
+			CaptureCallback(CaptureRecord_Process, state, inbuffer, length, inchannels, outchannels);
+		}
+
+		// The binaural mode renders stereo in and out at the database's sample rate, which was checked when it was loaded
+		BOOL Binaural = p_ObjData->p_Binaural != nullptr && inchannels == 2 && outchannels == 2;
+
+		// If ISAC hasn't been initialized yet, or if the provided data doesn't meet ISAC's requirements, just pass it back to Unity
+		if (!Binaural && (g_SpatialAudioClientCreated != TRUE || g_SpatialAudioRenderStreamCreated != TRUE || inchannels != 2 || outchannels != 2 || g_SystemSampleRate != REQUIRED_SAMPLE_RATE))
+		{
+			memcpy(outbuffer, inbuffer, length * outchannels * sizeof(float));
+			return UNITY_AUDIODSP_ERR_UNSUPPORTED;
+		}
+
+		DenormalGuard Denormals;
+
+		BOOL SendDataToISAC = TRUE;
+
+		// Convert position data from Unity's coordinate system to ISAC's coordinate system
+		float* m = state->spatializerdata->listenermatrix;
+		float* s = state->spatializerdata->sourcematrix;
+
+		// Currently we ignore source orientation and only use source position
+		float px = s[12];
+		float py = s[13];
+		float pz = s[14];
+
+		float dir_x = m[0] * px + m[4] * py + m[8] * pz + m[12];
+		float dir_y = m[1] * px + m[5] * py + m[9] * pz + m[13];
+		float dir_z = m[2] * px + m[6] * py + m[10] * pz + m[14];
+
+		// Older hosts don't report these; their sources are treated as 3D point sources
+		float SpatialBlend = 1.0f;
+		float Spread = 0.0f;
+		float StereoPan = 0.0f;
+		if (IsHostCompatible(state))
+		{
+			SpatialBlend = state->spatializerdata->spatialblend;
+			Spread = state->spatializerdata->spread;
+			StereoPan = state->spatializerdata->stereopan;
+		}
+
+		// Sources beyond CutoffDist are culled. They only come back once they are well inside the radius again, so a
+		// source hovering around the boundary doesn't keep grabbing and releasing its ISAC object.
+		float Distance = sqrtf(dir_x * dir_x + dir_y * dir_y + dir_z * dir_z);
+		float CutoffDist = p_ObjData->p[P_CUTOFFDIST];
+		BOOL WasCulled = p_ObjData->m_Culled;
+		if (!WasCulled && Distance > CutoffDist)
+		{
+			p_ObjData->m_Culled = TRUE;
+		}
+		else if (WasCulled && Distance < CutoffDist * CULL_HYSTERESIS)
+		{
+			p_ObjData->m_Culled = FALSE;
+		}
+
+		// Paused and muted sources are gated just like culled ones. Entering or leaving the gate fades over this block.
+		BOOL Muted = (state->flags & (UnityAudioEffectStateFlags_IsPaused | UnityAudioEffectStateFlags_IsMuted)) != 0;
+		BOOL FadingOut = p_ObjData->m_Culled || Muted;
+
+		float GainStart = p_ObjData->m_FadeGain;
+		float GainEnd = FadingOut ? 0.0f : 1.0f;
+		p_ObjData->m_FadeGain = GainEnd;
+
+		if (FadingOut && GainStart == 0.0f)
+		{
+			// Fully gated: no ISAC object, no buffering, and nothing for Unity to render either
+			memset(outbuffer, 0, length * outchannels * sizeof(float));
+			if (p_ObjData->p_Binaural != nullptr)
+			{
+				p_ObjData->p_Binaural->Reset();
+			}
+			return UNITY_AUDIODSP_OK;
+		}
+
+		if (Binaural)
+		{
+			RenderBinaural(p_ObjData, inbuffer, outbuffer, length, dir_x, dir_y, dir_z, SpatialBlend, GainStart, GainEnd);
+			return UNITY_AUDIODSP_OK;
+		}
+
+		// The input is metered before anything is done with it, so that a source that was taken off ISAC for being silent
+		// is queued again in the very block its signal comes back in, rather than playing that block through Unity
+		BOOL InputSilent = GetAudioKernels().Peak(inbuffer, length * inchannels) < SILENCE_THRESHOLD;
+		if (!InputSilent)
+		{
+			p_ObjData->m_SilentSamples = 0;
+		}
+		else if (p_ObjData->m_SilentSamples < SILENCE_RELEASE_SAMPLES)
+		{
+			p_ObjData->m_SilentSamples += length;
+		}
+
+		// A silent source doesn't hold an ISAC object or buffer anything. Its input is handed back to Unity, which has
+		// nothing to render.
+		if (p_ObjData->m_Silent && InputSilent)
+		{
+			memset(outbuffer, 0, length * outchannels * sizeof(float));
+			return UNITY_AUDIODSP_OK;
+		}
+		p_ObjData->m_Silent = FALSE;
+
+		if (!FadingOut)
+		{
+			// Since this object has new data, it isn't being released anymore. The worker thread
+			// starts counting empty periods over once the data gets to it.
+			InterlockedExchange(&p_ObjData->m_ReleaseRequested, FALSE);
+		}
+
+				// If the object isn't already in the queue, check if there's space to add it
+				if (p_ObjData->m_InQueue == FALSE)
+				{
+					LONG BedActive = InterlockedCompareExchange(&g_BedActive, 0, 0);
+					BOOL ObjectQueuedToISAC = FALSE;
+
+					// Mostly 2D or widely spread sources aren't point sources, so they don't get a dynamic object when there is a bed
+					BOOL PointLike = SpatialBlend >= BED_ROUTE_SPATIAL_BLEND && Spread <= BED_ROUTE_SPREAD;
+
+					// Try to claim a slot for this object. A source that is fading out towards the
+					// culling radius or a pause isn't worth an ISAC object, and without the block pool
+					// there is nothing to carry its audio. Nor does a silent source need one.
+					BOOL CanQueue = !FadingOut && !InputSilent && g_AudioBlockPool != nullptr;
+					if (CanQueue && (PointLike || !BedActive))
+					{
+						ObjectQueuedToISAC = QueueToObject(p_ObjData);
+					}
+
+					// Not point-like, or over the dynamic object budget: pan the source into the static bed rather than handing it back to Unity
+					if (!ObjectQueuedToISAC && CanQueue && BedActive)
+					{
+						ObjectQueuedToISAC = QueueToBed(p_ObjData);
+					}
+
+					if (!ObjectQueuedToISAC)
+					{
+						// If the queue didn't have enough space, then send the data back to Unity
+						CopyScaled(outbuffer, inbuffer, 1, length * outchannels, GainStart, GainEnd);
+						p_ObjData->m_Silent = InputSilent;
+						SendDataToISAC = FALSE;
+					}
+				}
+
+				if (SendDataToISAC)
+				{
+					// This thread is the only producer of the source's queues. The block's position goes first, then the
+					// ingest kernel copies the samples out of Unity's block (and sends back silence to Unity, since this
+					// will be rendered by ISAC), and they are appended to the chain once they are all there.
+					UINT32 WriteCount = (length < ISAC_MAX_BLOCK_SIZE) ? length : ISAC_MAX_BLOCK_SIZE;
+
+					LARGE_INTEGER Timestamp = { 0 };
+					if (p_ObjData->p[P_MEASURE_LATENCY] >= 0.5f)
+					{
+						QueryPerformanceCounter(&Timestamp);
+					}
+
+					// The reverb falls off more slowly with distance than the direct sound (which Unity has already
+					// attenuated), so that further sources sound further away. The room modelling gain limits hold it
+					// in, and the 2D part of a source isn't in the room at all.
+					const AttenuationModel& Model = p_ObjData->m_Attenuation;
+					float ReverbSend = SpatialBlend * FastMin(FastMax(sqrtf(Distance / Model.m_UnityGainDist), Model.m_MinGain), Model.m_MaxGain);
+
+					UnityAudioPosition Position = { p_ObjData->m_Audio.GetWritePos(), dir_x, dir_y, -dir_z, SpatialBlend, Spread, StereoPan, ReverbSend, Timestamp.QuadPart };
+					p_ObjData->m_Positions.Write(&Position, 1);
+
+					// The bed pans each channel on its own; a dynamic object gets them averaged
+					float Samples[ISAC_MAX_BLOCK_SIZE];
+					float RightSamples[ISAC_MAX_BLOCK_SIZE];
+					float* p_RightSamples = p_ObjData->m_InBed ? RightSamples : nullptr;
+					IngestKernel Kernel = (length == p_ObjData->m_IngestBlockSize) ? p_ObjData->m_IngestKernel : IngestGeneric;
+					Kernel(Samples, p_RightSamples, WriteCount, inbuffer, outbuffer, length, inchannels, outchannels, GainStart, GainEnd);
+
+					if (!p_ObjData->m_Audio.Write(g_AudioBlockPool, Samples, WriteCount, p_RightSamples))
+					{
+						InterlockedIncrement(&g_DroppedAudioWrites);
+					}
+
+					// The fade-out block (or the one that makes SILENCE_RELEASE_SAMPLES of silence) is in the chain now,
+					// the last of it padded out to a whole period; the worker thread hands the ISAC object back once it
+					// has played it
+					p_ObjData->m_Silent = p_ObjData->m_SilentSamples >= SILENCE_RELEASE_SAMPLES;
+					if (FadingOut || p_ObjData->m_Silent)
+					{
+						p_ObjData->m_Audio.Flush();
+						InterlockedExchange(&p_ObjData->m_ReleaseRequested, TRUE);
+					}
+				}
+
+
+		return UNITY_AUDIODSP_OK;
+	}
+}
+
@@ -0,0 +1,427 @@
+#include "RealtimeCheck.h"
+
+#ifdef REALTIME_CHECK
+
+#include "AudioPluginInterface.h"
+
+#include <atomic>
+#include <string.h>
+
+#if UNITY_WIN
+#include <windows.h>
+#ifndef UWPBUILD
+#include <dbghelp.h>
+#pragma comment(lib, "dbghelp.lib")
+#endif
+#else
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace MSHRTFSpatializer
+{
+	struct RealtimeViolation
+	{
+		const char* p_What;
+		unsigned int NumFrames;
+		void* Frames[REALTIME_CHECK_MAX_FRAMES];
+	};
+
+	static RealtimeViolation g_RealtimeViolations[REALTIME_CHECK_MAX_REPORTS];
+	static std::atomic<unsigned int> g_RealtimeViolationCount(0);
+
+	// How many real-time scopes the calling thread is in, and whether it is in the middle of a report
+	static thread_local int t_RealtimeDepth = 0;
+	static thread_local bool t_Reporting = false;
+
+	void RealtimeCheck::Enter()
+	{
+		t_RealtimeDepth++;
+	}
+
+	void RealtimeCheck::Leave()
+	{
+		t_RealtimeDepth--;
+	}
+
+	void RealtimeCheck::Report(const char* p_What)
+	{
+		if (t_RealtimeDepth == 0 || t_Reporting)
+		{
+			return;
+		}
+
+		// Walking the stack can allocate or lock on its own; that isn't reported again
+		t_Reporting = true;
+
+		unsigned int Index = g_RealtimeViolationCount.fetch_add(1);
+		if (Index < REALTIME_CHECK_MAX_REPORTS)
+		{
+			RealtimeViolation& Violation = g_RealtimeViolations[Index];
+			Violation.p_What = p_What;
+#if UNITY_WIN
+			Violation.NumFrames = CaptureStackBackTrace(1, REALTIME_CHECK_MAX_FRAMES, Violation.Frames, nullptr);
+#else
+			int NumFrames = backtrace(Violation.Frames, REALTIME_CHECK_MAX_FRAMES);
+			Violation.NumFrames = (NumFrames > 0) ? (unsigned int)NumFrames : 0;
+#endif
+		}
+
+		t_Reporting = false;
+	}
+
+	unsigned int RealtimeCheck::GetViolationCount()
+	{
+		return g_RealtimeViolationCount.load();
+	}
+
+	void RealtimeCheck::PrintReports(FILE* p_File)
+	{
+		unsigned int Count = GetViolationCount();
+		unsigned int Kept = (Count < REALTIME_CHECK_MAX_REPORTS) ? Count : REALTIME_CHECK_MAX_REPORTS;
+		fprintf(p_File, "%u real-time violations\n", Count);
+
+#if UNITY_WIN && !defined(UWPBUILD)
+		HANDLE Process = GetCurrentProcess();
+		BOOL HaveSymbols = (Kept > 0) && SymInitialize(Process, nullptr, TRUE);
+#endif
+
+		for (unsigned int Index = 0; Index < Kept; Index++)
+		{
+			const RealtimeViolation& Violation = g_RealtimeViolations[Index];
+			fprintf(p_File, "%s on a real-time thread:\n", Violation.p_What);
+
+#if UNITY_WIN && !defined(UWPBUILD)
+			for (unsigned int Frame = 0; Frame < Violation.NumFrames; Frame++)
+			{
+				DWORD64 Address = (DWORD64)Violation.Frames[Frame];
+
+				char SymbolBuffer[sizeof(SYMBOL_INFO) + 256];
+				SYMBOL_INFO* p_Symbol = (SYMBOL_INFO*)SymbolBuffer;
+				p_Symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+				p_Symbol->MaxNameLen = 256;
+				DWORD64 Displacement = 0;
+
+				IMAGEHLP_LINE64 Line;
+				Line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+				DWORD LineDisplacement = 0;
+
+				if (HaveSymbols && SymFromAddr(Process, Address, &Displacement, p_Symbol))
+				{
+					if (SymGetLineFromAddr64(Process, Address, &LineDisplacement, &Line))
+						fprintf(p_File, "    %s (%s:%lu)\n", p_Symbol->Name, Line.FileName, Line.LineNumber);
+					else
+						fprintf(p_File, "    %s+0x%llx\n", p_Symbol->Name, (unsigned long long)Displacement);
+				}
+				else
+				{
+					fprintf(p_File, "    %p\n", Violation.Frames[Frame]);
+				}
+			}
+#elif UNITY_WIN
+			for (unsigned int Frame = 0; Frame < Violation.NumFrames; Frame++)
+			{
+				fprintf(p_File, "    %p\n", Violation.Frames[Frame]);
+			}
+#else
+			char** pp_Symbols = backtrace_symbols(Violation.Frames, (int)Violation.NumFrames);
+			for (unsigned int Frame = 0; Frame < Violation.NumFrames; Frame++)
+			{
+				fprintf(p_File, "    %s\n", (pp_Symbols != nullptr) ? pp_Symbols[Frame] : "?");
+			}
+			free(pp_Symbols);
+#endif
+		}
+
+#if UNITY_WIN && !defined(UWPBUILD)
+		if (HaveSymbols)
+		{
+			SymCleanup(Process);
+		}
+#endif
+	}
+
+#if UNITY_WIN && !defined(UWPBUILD)
+	// Each hook reports and then calls through to the import it was patched over
+	#define REALTIME_HOOK(Convention, Return, Name, Params, Args) \
+		static Return (Convention* p_Original##Name) Params = nullptr; \
+		static Return Convention Checked##Name Params \
+		{ \
+			RealtimeCheck::Report(#Name); \
+			return p_Original##Name Args; \
+		}
+
+	// Waiting with a timeout of 0 only polls, so it isn't reported
+	#define REALTIME_WAIT_HOOK(Convention, Return, Name, Params, Args, Timeout) \
+		static Return (Convention* p_Original##Name) Params = nullptr; \
+		static Return Convention Checked##Name Params \
+		{ \
+			if (Timeout != 0) \
+			{ \
+				RealtimeCheck::Report(#Name); \
+			} \
+			return p_Original##Name Args; \
+		}
+
+	REALTIME_HOOK(__cdecl, void*, malloc, (size_t Size), (Size))
+	REALTIME_HOOK(__cdecl, void*, calloc, (size_t Count, size_t Size), (Count, Size))
+	REALTIME_HOOK(__cdecl, void*, realloc, (void* p_Memory, size_t Size), (p_Memory, Size))
+	REALTIME_HOOK(__cdecl, void, free, (void* p_Memory), (p_Memory))
+	REALTIME_HOOK(__cdecl, void*, _aligned_malloc, (size_t Size, size_t Alignment), (Size, Alignment))
+	REALTIME_HOOK(__cdecl, void, _aligned_free, (void* p_Memory), (p_Memory))
+	REALTIME_HOOK(WINAPI, LPVOID, HeapAlloc, (HANDLE Heap, DWORD Flags, SIZE_T Bytes), (Heap, Flags, Bytes))
+	REALTIME_HOOK(WINAPI, LPVOID, HeapReAlloc, (HANDLE Heap, DWORD Flags, LPVOID p_Memory, SIZE_T Bytes), (Heap, Flags, p_Memory, Bytes))
+	REALTIME_HOOK(WINAPI, BOOL, HeapFree, (HANDLE Heap, DWORD Flags, LPVOID p_Memory), (Heap, Flags, p_Memory))
+	REALTIME_HOOK(WINAPI, void, Sleep, (DWORD Milliseconds), (Milliseconds))
+	REALTIME_HOOK(WINAPI, DWORD, SleepEx, (DWORD Milliseconds, BOOL Alertable), (Milliseconds, Alertable))
+	REALTIME_HOOK(WINAPI, void, EnterCriticalSection, (LPCRITICAL_SECTION p_Section), (p_Section))
+	REALTIME_HOOK(WINAPI, void, AcquireSRWLockExclusive, (PSRWLOCK p_Lock), (p_Lock))
+	REALTIME_HOOK(WINAPI, void, AcquireSRWLockShared, (PSRWLOCK p_Lock), (p_Lock))
+	REALTIME_WAIT_HOOK(WINAPI, DWORD, WaitForSingleObject, (HANDLE Handle, DWORD Milliseconds), (Handle, Milliseconds), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, DWORD, WaitForSingleObjectEx, (HANDLE Handle, DWORD Milliseconds, BOOL Alertable), (Handle, Milliseconds, Alertable), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, DWORD, WaitForMultipleObjects, (DWORD Count, const HANDLE* p_Handles, BOOL WaitAll, DWORD Milliseconds), (Count, p_Handles, WaitAll, Milliseconds), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, DWORD, WaitForMultipleObjectsEx, (DWORD Count, const HANDLE* p_Handles, BOOL WaitAll, DWORD Milliseconds, BOOL Alertable), (Count, p_Handles, WaitAll, Milliseconds, Alertable), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, BOOL, SleepConditionVariableCS, (PCONDITION_VARIABLE p_Condition, PCRITICAL_SECTION p_Section, DWORD Milliseconds), (p_Condition, p_Section, Milliseconds), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, BOOL, SleepConditionVariableSRW, (PCONDITION_VARIABLE p_Condition, PSRWLOCK p_Lock, DWORD Milliseconds, ULONG Flags), (p_Condition, p_Lock, Milliseconds, Flags), Milliseconds)
+	REALTIME_WAIT_HOOK(WINAPI, BOOL, WaitOnAddress, (volatile VOID* p_Address, PVOID p_Compare, SIZE_T Size, DWORD Milliseconds), (p_Address, p_Compare, Size, Milliseconds), Milliseconds)
+
+	struct RealtimeHook
+	{
+		const char* p_Name;
+		void* p_Hook;
+		void** pp_Original;
+	};
+
+	#define REALTIME_HOOK_ENTRY(Name) { #Name, (void*)Checked##Name, (void**)&p_Original##Name }
+
+	static const RealtimeHook REALTIME_HOOKS[] =
+	{
+		REALTIME_HOOK_ENTRY(malloc),
+		REALTIME_HOOK_ENTRY(calloc),
+		REALTIME_HOOK_ENTRY(realloc),
+		REALTIME_HOOK_ENTRY(free),
+		REALTIME_HOOK_ENTRY(_aligned_malloc),
+		REALTIME_HOOK_ENTRY(_aligned_free),
+		REALTIME_HOOK_ENTRY(HeapAlloc),
+		REALTIME_HOOK_ENTRY(HeapReAlloc),
+		REALTIME_HOOK_ENTRY(HeapFree),
+		REALTIME_HOOK_ENTRY(Sleep),
+		REALTIME_HOOK_ENTRY(SleepEx),
+		REALTIME_HOOK_ENTRY(EnterCriticalSection),
+		REALTIME_HOOK_ENTRY(AcquireSRWLockExclusive),
+		REALTIME_HOOK_ENTRY(AcquireSRWLockShared),
+		REALTIME_HOOK_ENTRY(WaitForSingleObject),
+		REALTIME_HOOK_ENTRY(WaitForSingleObjectEx),
+		REALTIME_HOOK_ENTRY(WaitForMultipleObjects),
+		REALTIME_HOOK_ENTRY(WaitForMultipleObjectsEx),
+		REALTIME_HOOK_ENTRY(SleepConditionVariableCS),
+		REALTIME_HOOK_ENTRY(SleepConditionVariableSRW),
+		REALTIME_HOOK_ENTRY(WaitOnAddress),
+	};
+
+	extern "C" IMAGE_DOS_HEADER __ImageBase;
+
+	// Points the imports of this module that have a hook at the hook. With the static CRT the heap functions are
+	// linked in and reach the kernel32 heap through the imports; with the CRT DLL the CRT functions are imports.
+	static void PatchImports()
+	{
+		BYTE* p_Base = (BYTE*)&__ImageBase;
+		IMAGE_NT_HEADERS* p_Headers = (IMAGE_NT_HEADERS*)(p_Base + __ImageBase.e_lfanew);
+		const IMAGE_DATA_DIRECTORY& Directory = p_Headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+		if (Directory.VirtualAddress == 0)
+		{
+			return;
+		}
+
+		for (IMAGE_IMPORT_DESCRIPTOR* p_Import = (IMAGE_IMPORT_DESCRIPTOR*)(p_Base + Directory.VirtualAddress); p_Import->Name != 0; p_Import++)
+		{
+			// The names are in the original thunks, and the addresses the loader bound them to in the first thunks
+			if (p_Import->OriginalFirstThunk == 0)
+			{
+				continue;
+			}
+			IMAGE_THUNK_DATA* p_Name = (IMAGE_THUNK_DATA*)(p_Base + p_Import->OriginalFirstThunk);
+			IMAGE_THUNK_DATA* p_Address = (IMAGE_THUNK_DATA*)(p_Base + p_Import->FirstThunk);
+
+			for (; p_Name->u1.AddressOfData != 0; p_Name++, p_Address++)
+			{
+				if (IMAGE_SNAP_BY_ORDINAL(p_Name->u1.Ordinal))
+				{
+					continue;
+				}
+				const char* p_Function = (const char*)((IMAGE_IMPORT_BY_NAME*)(p_Base + p_Name->u1.AddressOfData))->Name;
+
+				for (const RealtimeHook& Hook : REALTIME_HOOKS)
+				{
+					DWORD Protection;
+					if (strcmp(p_Function, Hook.p_Name) != 0 ||
+						!VirtualProtect(&p_Address->u1.Function, sizeof(p_Address->u1.Function), PAGE_READWRITE, &Protection))
+					{
+						continue;
+					}
+
+					// A function imported through more than one DLL name ends up in the same place
+					if (*Hook.pp_Original == nullptr)
+					{
+						*Hook.pp_Original = (void*)p_Address->u1.Function;
+					}
+					p_Address->u1.Function = (ULONG_PTR)Hook.p_Hook;
+					VirtualProtect(&p_Address->u1.Function, sizeof(p_Address->u1.Function), Protection, &Protection);
+				}
+			}
+		}
+	}
+#endif
+
+	// Hooks are in place as soon as the module is loaded, before any of its threads can be real-time
+	static struct RealtimeCheckInstaller
+	{
+		RealtimeCheckInstaller()
+		{
+#if UNITY_WIN && !defined(UWPBUILD)
+			PatchImports();
+#elif !UNITY_WIN
+			// The first backtrace loads the unwinder, which allocates
+			void* Frame;
+			backtrace(&Frame, 1);
+#endif
+		}
+	} g_RealtimeCheckInstaller;
+}
+
+#if !UNITY_WIN
+// Interposed over the C library. The allocator is reached through its internal names, which doesn't need dlsym (and
+// dlsym itself allocates); everything else calls on to the next definition.
+extern "C"
+{
+	void* __libc_malloc(size_t Size);
+	void* __libc_calloc(size_t Count, size_t Size);
+	void* __libc_realloc(void* p_Memory, size_t Size);
+	void __libc_free(void* p_Memory);
+	void* __libc_memalign(size_t Alignment, size_t Size);
+
+	void* malloc(size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("malloc");
+		return __libc_malloc(Size);
+	}
+
+	void* calloc(size_t Count, size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("calloc");
+		return __libc_calloc(Count, Size);
+	}
+
+	void* realloc(void* p_Memory, size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("realloc");
+		return __libc_realloc(p_Memory, Size);
+	}
+
+	void free(void* p_Memory) noexcept
+	{
+		if (p_Memory != nullptr)
+		{
+			MSHRTFSpatializer::RealtimeCheck::Report("free");
+		}
+		__libc_free(p_Memory);
+	}
+
+	void* memalign(size_t Alignment, size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("memalign");
+		return __libc_memalign(Alignment, Size);
+	}
+
+	void* aligned_alloc(size_t Alignment, size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("aligned_alloc");
+		return __libc_memalign(Alignment, Size);
+	}
+
+	int posix_memalign(void** pp_Memory, size_t Alignment, size_t Size) noexcept
+	{
+		MSHRTFSpatializer::RealtimeCheck::Report("posix_memalign");
+		void* p_Memory = __libc_memalign(Alignment, Size);
+		if (p_Memory == nullptr)
+		{
+			return ENOMEM;
+		}
+		*pp_Memory = p_Memory;
+		return 0;
+	}
+
+	// The next definition is looked up on first use; the pointer is constant-initialized, so there is no guard to take
+	#define REALTIME_INTERPOSE(Return, Name, Params, Args, Exceptions) \
+		Return Name Params Exceptions \
+		{ \
+			typedef Return (*Function) Params; \
+			static Function p_Next = nullptr; \
+			if (p_Next == nullptr) \
+			{ \
+				p_Next = (Function)dlsym(RTLD_NEXT, #Name); \
+			} \
+			MSHRTFSpatializer::RealtimeCheck::Report(#Name); \
+			return p_Next Args; \
+		}
+
+	REALTIME_INTERPOSE(int, pthread_mutex_lock, (pthread_mutex_t* p_Mutex), (p_Mutex), noexcept)
+	REALTIME_INTERPOSE(int, pthread_rwlock_rdlock, (pthread_rwlock_t* p_Lock), (p_Lock), noexcept)
+	REALTIME_INTERPOSE(int, pthread_rwlock_wrlock, (pthread_rwlock_t* p_Lock), (p_Lock), noexcept)
+	REALTIME_INTERPOSE(int, pthread_cond_wait, (pthread_cond_t* p_Condition, pthread_mutex_t* p_Mutex), (p_Condition, p_Mutex), )
+	REALTIME_INTERPOSE(int, pthread_cond_timedwait, (pthread_cond_t* p_Condition, pthread_mutex_t* p_Mutex, const struct timespec* p_Time), (p_Condition, p_Mutex, p_Time), )
+	REALTIME_INTERPOSE(int, pthread_join, (pthread_t Thread, void** pp_Result), (Thread, pp_Result), )
+	REALTIME_INTERPOSE(int, sem_wait, (sem_t* p_Semaphore), (p_Semaphore), )
+	REALTIME_INTERPOSE(int, sem_timedwait, (sem_t* p_Semaphore, const struct timespec* p_Time), (p_Semaphore, p_Time), )
+	REALTIME_INTERPOSE(int, nanosleep, (const struct timespec* p_Time, struct timespec* p_Remaining), (p_Time, p_Remaining), )
+	REALTIME_INTERPOSE(int, clock_nanosleep, (clockid_t Clock, int Flags, const struct timespec* p_Time, struct timespec* p_Remaining), (Clock, Flags, p_Time, p_Remaining), )
+	REALTIME_INTERPOSE(int, usleep, (useconds_t Microseconds), (Microseconds), )
+	REALTIME_INTERPOSE(unsigned int, sleep, (unsigned int Seconds), (Seconds), )
+
+#if defined(__linux__)
+	// Futex waits made directly, as AudioMutex::Park does, never go through the pthread functions. A system call takes
+	// at most six arguments, all passed as longs, so they can be read and passed on without knowing which call it is.
+	long syscall(long Number, ...) noexcept
+	{
+		typedef long (*Function)(long, ...);
+		static Function p_Next = nullptr;
+		if (p_Next == nullptr)
+		{
+			p_Next = (Function)dlsym(RTLD_NEXT, "syscall");
+		}
+
+		long Args[6];
+		va_list Arguments;
+		va_start(Arguments, Number);
+		for (int i = 0; i < 6; i++)
+		{
+			Args[i] = va_arg(Arguments, long);
+		}
+		va_end(Arguments);
+
+		if (Number == SYS_futex)
+		{
+			int Operation = (int)Args[1] & FUTEX_CMD_MASK;
+			if (Operation == FUTEX_WAIT || Operation == FUTEX_WAIT_BITSET || Operation == FUTEX_LOCK_PI)
+			{
+				MSHRTFSpatializer::RealtimeCheck::Report("futex");
+			}
+		}
+		return p_Next(Number, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5]);
+	}
+#endif
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+// Real-time safety checking, for debug builds. With REALTIME_CHECK defined, the threads in a REALTIME_SCOPE are
+// watched for heap allocations, blocking lock acquisitions, waits and sleeps. Each one is counted and the first
+// REALTIME_CHECK_MAX_REPORTS are kept with a stack trace, to be printed once the threads are done.
+//
+// The calls are intercepted where they leave the code, so nothing in the checked code has to change:
+//  - On Windows the imports of the module RealtimeCheck.cpp is linked into are patched when it is loaded. That covers
+//    the CRT heap functions and the kernel32 heap, wait, sleep and lock functions the module calls.
+//  - On Linux the malloc family, the pthread lock and wait functions, the sleeps and syscall (for futex waits) are
+//    interposed. RealtimeCheck.cpp has to be linked into the executable itself (and with -ldl) for the interposition
+//    to apply to every library. Tests\RealtimeCheckTest runs the portable audio code under it.
+//
+// Without REALTIME_CHECK the scopes compile to nothing and RealtimeCheck.cpp is empty.
+
+#define REALTIME_CHECK_MAX_REPORTS 64
+#define REALTIME_CHECK_MAX_FRAMES 32
+
+#ifdef REALTIME_CHECK
+
+#include <stdio.h>
+
+namespace MSHRTFSpatializer
+{
+	class RealtimeCheck
+	{
+	public:
+		// Marks the calling thread real-time until the matching Leave. Scopes nest.
+		static void Enter();
+		static void Leave();
+
+		// Counts a violation if the calling thread is real-time. Allocates nothing and takes no locks, so it can be
+		// called from inside the interceptors.
+		static void Report(const char* p_What);
+
+		static unsigned int GetViolationCount();
+
+		// Prints the kept reports with their stack traces. Only call once the real-time threads are done.
+		static void PrintReports(FILE* p_File);
+	};
+
+	class RealtimeScope
+	{
+	public:
+		RealtimeScope() { RealtimeCheck::Enter(); }
+		~RealtimeScope() { RealtimeCheck::Leave(); }
+	};
+}
+
+#define REALTIME_SCOPE() MSHRTFSpatializer::RealtimeScope RealtimeScope_
+#else
+#define REALTIME_SCOPE()
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "SpatialAudioSink.h"
+#include "ObjectCapture.h"
+
+namespace MSHRTFSpatializer
+{
+	// Objects past these are passed on but not recorded
+	#define RECORDING_SINK_MAX_DYNAMIC_OBJECTS 256
+	#define RECORDING_SINK_MAX_STATIC_CHANNELS 32
+
+	// Passes everything on to another sink and records each pass to an object capture (see ObjectCapture.h). The
+	// samples are copied from the buffers of the sink when the pass ends, so what is recorded is exactly what the sink
+	// renders. Nothing is allocated and nothing waits here; a pass the writer has no room for is left out.
+	class RecordingSink : public SpatialAudioSink
+	{
+	public:
+		RecordingSink(SpatialAudioSink* p_Sink, ObjectCaptureWriter* p_Writer) :
+			m_Sink(p_Sink),
+			m_Writer(p_Writer)
+		{
+			memset(m_Dynamic, 0, sizeof(m_Dynamic));
+			memset(m_Static, 0, sizeof(m_Static));
+		}
+
+		HRESULT BeginUpdate(UINT32* p_AvailableDynamicObjectCount, UINT32* p_FrameCount) override
+		{
+			m_BeginTimestamp = ObjectCaptureWriter::Now();
+
+			HRESULT hr = m_Sink->BeginUpdate(p_AvailableDynamicObjectCount, p_FrameCount);
+			if (SUCCEEDED(hr))
+			{
+				m_FrameCount = *p_FrameCount;
+			}
+
+			for (UINT32 Index = 0; Index < m_DynamicCount; Index++)
+			{
+				m_Dynamic[Index].p_Buffer = nullptr;
+			}
+			m_DynamicCount = 0;
+
+			for (UINT32 Channel = 0; Channel < RECORDING_SINK_MAX_STATIC_CHANNELS; Channel++)
+			{
+				m_Static[Channel].p_Buffer = nullptr;
+			}
+
+			return hr;
+		}
+
+		HRESULT EndUpdate() override
+		{
+			UINT32 NumObjects = 0;
+			for (UINT32 Index = 0; Index < m_DynamicCount; Index++)
+			{
+				NumObjects += (m_Dynamic[Index].p_Buffer != nullptr) ? 1 : 0;
+			}
+			for (UINT32 Channel = 0; Channel < RECORDING_SINK_MAX_STATIC_CHANNELS; Channel++)
+			{
+				NumObjects += (m_Static[Channel].p_Buffer != nullptr) ? 1 : 0;
+			}
+
+			// Every pass takes a sequence number, so that the ones left out show up as gaps
+			if (m_Writer->BeginPass(m_Sequence++, m_BeginTimestamp, NumObjects, m_FrameCount))
+			{
+				for (UINT32 Index = 0; Index < m_DynamicCount; Index++)
+				{
+					RecordedObject& Object = m_Dynamic[Index];
+					if (Object.p_Buffer != nullptr)
+					{
+						m_Writer->AddObject(Index, OBJECT_CAPTURE_DYNAMIC, Object.X, Object.Y, Object.Z, Object.Volume, Object.p_Buffer);
+					}
+				}
+				for (UINT32 Channel = 0; Channel < RECORDING_SINK_MAX_STATIC_CHANNELS; Channel++)
+				{
+					RecordedObject& Object = m_Static[Channel];
+					if (Object.p_Buffer != nullptr)
+					{
+						m_Writer->AddObject(Channel, Object.Type, Object.X, Object.Y, Object.Z, Object.Volume, Object.p_Buffer);
+					}
+				}
+				m_Writer->EndPass();
+			}
+
+			return m_Sink->EndUpdate();
+		}
+
+		HRESULT GetDynamicObjectBuffer(UINT32 Index, float** pp_Buffer) override
+		{
+			HRESULT hr = m_Sink->GetDynamicObjectBuffer(Index, pp_Buffer);
+			if (hr == S_OK && Index < RECORDING_SINK_MAX_DYNAMIC_OBJECTS)
+			{
+				m_Dynamic[Index].p_Buffer = *pp_Buffer;
+				m_Dynamic[Index].Volume = 1.0f;
+				m_DynamicCount = (Index + 1 > m_DynamicCount) ? Index + 1 : m_DynamicCount;
+			}
+			return hr;
+		}
+
+		void SetDynamicObjectPosition(UINT32 Index, float X, float Y, float Z) override
+		{
+			m_Sink->SetDynamicObjectPosition(Index, X, Y, Z);
+			if (Index < RECORDING_SINK_MAX_DYNAMIC_OBJECTS)
+			{
+				m_Dynamic[Index].X = X;
+				m_Dynamic[Index].Y = Y;
+				m_Dynamic[Index].Z = Z;
+			}
+		}
+
+		void SetDynamicObjectVolume(UINT32 Index, float Volume) override
+		{
+			m_Sink->SetDynamicObjectVolume(Index, Volume);
+			if (Index < RECORDING_SINK_MAX_DYNAMIC_OBJECTS)
+			{
+				m_Dynamic[Index].Volume = Volume;
+			}
+		}
+
+		HRESULT GetStaticObjectPosition(AudioObjectType Type, float* p_X, float* p_Y, float* p_Z) override
+		{
+			return m_Sink->GetStaticObjectPosition(Type, p_X, p_Y, p_Z);
+		}
+
+		HRESULT GetStaticObjectBuffer(UINT32 Channel, AudioObjectType Type, BOOL Activate, float** pp_Buffer) override
+		{
+			HRESULT hr = m_Sink->GetStaticObjectBuffer(Channel, Type, Activate, pp_Buffer);
+			if (hr == S_OK && Channel < RECORDING_SINK_MAX_STATIC_CHANNELS)
+			{
+				RecordedObject& Object = m_Static[Channel];
+
+				// Static objects don't move, so the position is only looked up when the channel changes type
+				if (Object.Type != (UINT32)Type)
+				{
+					Object.Type = (UINT32)Type;
+					Object.Volume = 1.0f;
+					if (FAILED(m_Sink->GetStaticObjectPosition(Type, &Object.X, &Object.Y, &Object.Z)))
+					{
+						Object.X = Object.Y = Object.Z = 0.0f;
+					}
+				}
+				Object.p_Buffer = *pp_Buffer;
+			}
+			return hr;
+		}
+
+	protected:
+		struct RecordedObject
+		{
+			const float* p_Buffer;		// Written in this pass, or nullptr
+			UINT32 Type;
+			float X;
+			float Y;
+			float Z;
+			float Volume;
+		};
+
+		SpatialAudioSink* m_Sink;
+		ObjectCaptureWriter* m_Writer;
+
+		UINT64 m_Sequence = 0;
+		INT64 m_BeginTimestamp = 0;
+		UINT32 m_FrameCount = 0;
+
+		RecordedObject m_Dynamic[RECORDING_SINK_MAX_DYNAMIC_OBJECTS];
+		UINT32 m_DynamicCount = 0;		// One past the highest slot written in this pass
+		RecordedObject m_Static[RECORDING_SINK_MAX_STATIC_CHANNELS];
+	};
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "AudioPluginUtil.h"
+
+#if UNITY_WIN
+#include <windows.h>
+#include "SpatialAudioClient.h"
+#else
+#include <stdint.h>
+
+// The Windows types the sink interface is written in, so that simulated sinks and the bed layout build anywhere
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+#define TRUE 1
+#define FALSE 0
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_FAIL ((HRESULT)0x80004005)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+// As SpatialAudioClient.h numbers them
+enum AudioObjectType
+{
+	AudioObjectType_None = 0,
+	AudioObjectType_Dynamic = 1 << 0,
+	AudioObjectType_FrontLeft = 1 << 1,
+	AudioObjectType_FrontRight = 1 << 2,
+	AudioObjectType_FrontCenter = 1 << 3,
+	AudioObjectType_LowFrequency = 1 << 4,
+	AudioObjectType_SideLeft = 1 << 5,
+	AudioObjectType_SideRight = 1 << 6,
+	AudioObjectType_BackLeft = 1 << 7,
+	AudioObjectType_BackRight = 1 << 8,
+	AudioObjectType_TopFrontLeft = 1 << 9,
+	AudioObjectType_TopFrontRight = 1 << 10,
+	AudioObjectType_TopBackLeft = 1 << 11,
+	AudioObjectType_TopBackRight = 1 << 12,
+	AudioObjectType_BottomFrontLeft = 1 << 13,
+	AudioObjectType_BottomFrontRight = 1 << 14,
+	AudioObjectType_BottomBackLeft = 1 << 15,
+	AudioObjectType_BottomBackRight = 1 << 16,
+	AudioObjectType_BackCenter = 1 << 17
+};
+#endif
+
+namespace MSHRTFSpatializer
+{
+	// Where the worker thread sends its audio. The plugin renders through ISAC; the replay tool plugs in a simulated
+	// sink so that ProcessCallback and the pump can be driven without an audio device or a worker thread.
+	class SpatialAudioSink
+	{
+	public:
+		virtual ~SpatialAudioSink() {}
+
+		// Bracket one pump. BeginUpdate reports how many dynamic objects can be written in this pass.
+		virtual HRESULT BeginUpdate(UINT32* p_AvailableDynamicObjectCount, UINT32* p_FrameCount) = 0;
+		virtual HRESULT EndUpdate() = 0;
+
+		// Buffer for one pump period of float samples of the dynamic object in slot Index (below the available count),
+		// activating the object if needed, and the position and volume it is rendered at in this pass
+		virtual HRESULT GetDynamicObjectBuffer(UINT32 Index, float** pp_Buffer) = 0;
+		virtual void SetDynamicObjectPosition(UINT32 Index, float X, float Y, float Z) = 0;
+		virtual void SetDynamicObjectVolume(UINT32 Index, float Volume) = 0;
+
+		// Where the endpoint puts the static object of the given type, in ISAC's coordinate system
+		virtual HRESULT GetStaticObjectPosition(AudioObjectType Type, float* p_X, float* p_Y, float* p_Z) = 0;
+
+		// Buffer of bed channel Channel, the static object of type Type. The object is only activated when Activate
+		// is set; until then S_FALSE is returned and there is no buffer. Once active it stays active.
+		virtual HRESULT GetStaticObjectBuffer(UINT32 Channel, AudioObjectType Type, BOOL Activate, float** pp_Buffer) = 0;
+	};
+
+	// Voices beyond the dynamic object budget are panned into a 7.1.4 bed of static objects. ISAC downmixes or
+	// virtualizes whatever channels the endpoint doesn't have natively.
+	#define ISAC_BED_MASK ((AudioObjectType)(AudioObjectType_FrontLeft | AudioObjectType_FrontRight | AudioObjectType_FrontCenter | AudioObjectType_LowFrequency | \
+		AudioObjectType_SideLeft | AudioObjectType_SideRight | AudioObjectType_BackLeft | AudioObjectType_BackRight | \
+		AudioObjectType_TopFrontLeft | AudioObjectType_TopFrontRight | AudioObjectType_TopBackLeft | AudioObjectType_TopBackRight))
+	#define ISAC_BED_MAX_CHANNELS 17
+
+	// Lists the bed channels in Mask in the order ISAC numbers them, and sets up Panner with the speaker positions p_Sink
+	// reports for them. The LFE channel gets no speaker, so nothing is ever panned to it. p_SpeakerChannel gets the bed
+	// channel of each of the panner's speakers. Returns how many channels there are.
+	inline UINT32 LayOutBed(SpatialAudioSink* p_Sink, AudioObjectType Mask, AudioObjectType* p_ChannelTypes, int* p_SpeakerChannel, VBAPPanner& Panner)
+	{
+		float Azimuths[ISAC_BED_MAX_CHANNELS];
+		float Elevations[ISAC_BED_MAX_CHANNELS];
+		int NumSpeakers = 0;
+
+		UINT32 ChannelCount = 0;
+		for (UINT32 Bit = AudioObjectType_FrontLeft; Bit <= AudioObjectType_BackCenter; Bit <<= 1)
+		{
+			AudioObjectType Type = (AudioObjectType)Bit;
+			if (((UINT32)Mask & Bit) == 0)
+			{
+				continue;
+			}
+
+			p_ChannelTypes[ChannelCount] = Type;
+
+			float x, y, z;
+			if (Type != AudioObjectType_LowFrequency && SUCCEEDED(p_Sink->GetStaticObjectPosition(Type, &x, &y, &z)))
+			{
+				// ISAC has x to the right, y up and z to the back
+				Azimuths[NumSpeakers] = atan2f(-x, -z) * (180.0f / kPI);
+				Elevations[NumSpeakers] = atan2f(y, sqrtf(x * x + z * z)) * (180.0f / kPI);
+				p_SpeakerChannel[NumSpeakers] = (int)ChannelCount;
+				NumSpeakers++;
+			}
+
+			ChannelCount++;
+		}
+
+		Panner.Init(Azimuths, Elevations, NumSpeakers);
+		return ChannelCount;
+	}
+
+	// Replaces ISAC with p_Sink offering DynamicObjectCount dynamic objects. Must be called before the first CreateCallback;
+	// no worker thread is started, and the caller runs the pump with PumpOnce.
+	void AttachSimulatedSink(SpatialAudioSink* p_Sink, UINT32 DynamicObjectCount, UINT32 SampleRate);
+
+	// Sends one pump period of every queued source to p_Sink
+	void PumpOnce(SpatialAudioSink* p_Sink);
+
+	// Spreads the filling of the dynamic objects in each pump over ThreadCount threads, the pump's own included, which
+	// join before EndUpdate. 1 fills them on the pump thread alone. Call from the thread that runs the pump, between pumps.
+	void SetObjectFillThreads(UINT32 ThreadCount);
+
+	// How long each pump has spent between BeginUpdate and the end of EndUpdate, in milliseconds
+	const LatencyHistogram& GetUpdateWindowHistogram();
+
+	// The most blocks of the shared audio block pool that have been in use at once, and how many it has. p_Exhausted gets
+	// how many times a source found the pool dry, and p_DroppedWrites how many callbacks lost some of their audio to that
+	// or to a full chain.
+	void GetAudioBlockUsage(UINT32* p_PeakInUse, UINT32* p_BlockCount, UINT32* p_Exhausted, UINT32* p_DroppedWrites);
+
+	// Writes the first Count frames of one block of Unity's interleaved input to p_Dst and silences Unity's output. The
+	// channels are averaged, unless p_DstRight isn't nullptr: then p_Dst gets the left channel and p_DstRight the right.
+	typedef void (*IngestKernel)(float* p_Dst, float* p_DstRight, UINT32 Count, const float* inbuffer, float* outbuffer, UINT32 length, int inchannels, int outchannels, float GainStart, float GainEnd);
+
+	// The ingest kernel ProcessCallback uses for blocks of BlockSize stereo frames: one specialized for that size if
+	// there is one, or the generic one, which GetIngestKernel(0) always returns
+	IngestKernel GetIngestKernel(UINT32 BlockSize);
+}
@@ -0,0 +1,157 @@
+#include "SpatializerCapture.h"
+
+#include <chrono>
+#include <windows.h>
+
+namespace MSHRTFSpatializer
+{
+	// Copies Count bytes to Offset within the reserved space, which is Count1 bytes at p_Region1 followed by p_Region2
+	static void ScatterBytes(unsigned char* p_Region1, int Count1, unsigned char* p_Region2, int Offset, const void* p_Src, int Count)
+	{
+		const unsigned char* p_Bytes = (const unsigned char*)p_Src;
+		int Count1Part = (Offset < Count1) ? (((Count1 - Offset) < Count) ? (Count1 - Offset) : Count) : 0;
+		if (Count1Part > 0)
+		{
+			memcpy(p_Region1 + Offset, p_Bytes, Count1Part);
+		}
+		if (Count > Count1Part)
+		{
+			int Offset2 = Offset + Count1Part - Count1;
+			memcpy(p_Region2 + Offset2, p_Bytes + Count1Part, Count - Count1Part);
+		}
+	}
+
+	static void SetDroppedHeader(CaptureRecordHeader& Header, uint32_t Dropped, int64_t Timestamp)
+	{
+		memset(&Header, 0, sizeof(Header));
+		Header.Size = sizeof(CaptureRecordHeader);
+		Header.Type = CaptureRecord_Dropped;
+		Header.DspTick = Dropped;
+		Header.Timestamp = Timestamp;
+	}
+
+	CaptureRecorder* CaptureRecorder::Create(const char* p_Path, uint32_t NumParams)
+	{
+		FILE* p_File = nullptr;
+		if (fopen_s(&p_File, p_Path, "wb") != 0 || p_File == nullptr)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+
+		CaptureFileHeader FileHeader;
+		memset(&FileHeader, 0, sizeof(FileHeader));
+		FileHeader.Magic = CAPTURE_MAGIC;
+		FileHeader.Version = CAPTURE_VERSION;
+		FileHeader.RecordHeaderSize = sizeof(CaptureRecordHeader);
+		FileHeader.NumParams = NumParams;
+		FileHeader.TimestampFrequency = Frequency.QuadPart;
+		fwrite(&FileHeader, sizeof(FileHeader), 1, p_File);
+
+		CaptureRecorder* p_Recorder = new CaptureRecorder;
+		p_Recorder->m_File = p_File;
+		p_Recorder->m_Dropped = 0;
+		p_Recorder->m_WriterActive = true;
+		p_Recorder->m_Writer = std::thread(&CaptureRecorder::RunWriter, p_Recorder);
+
+		return p_Recorder;
+	}
+
+	CaptureRecorder::~CaptureRecorder()
+	{
+		if (m_Writer.joinable())
+		{
+			m_WriterActive = false;
+			m_Writer.join();
+		}
+
+		if (m_File != nullptr)
+		{
+			fclose(m_File);
+		}
+	}
+
+	int64_t CaptureRecorder::Now()
+	{
+		LARGE_INTEGER Counter;
+		QueryPerformanceCounter(&Counter);
+		return Counter.QuadPart;
+	}
+
+	void CaptureRecorder::Append(CaptureRecordHeader& Header, const float* p_Samples, uint32_t NumSamples)
+	{
+		const int SampleBytes = NumSamples * sizeof(float);
+		const int Size = (sizeof(CaptureRecordHeader) + SampleBytes + 7) & ~7;
+		Header.Size = Size;
+
+		MutexScopeLock Lock(m_ProducerLock);
+
+		// Records dropped since the last one that fit are marked where they are missing, right in front of this one,
+		// which only goes in if the marker fits along with it
+		const uint32_t Dropped = m_Dropped.load(std::memory_order_relaxed);
+		const int MarkerSize = (Dropped > 0) ? sizeof(CaptureRecordHeader) : 0;
+
+		// The whole record or nothing, so that the writer only ever sees complete records
+		unsigned char* p_Region1;
+		unsigned char* p_Region2;
+		int Count1, Count2;
+		if (m_Ring.Reserve(MarkerSize + Size, p_Region1, Count1, p_Region2, Count2) == 0)
+		{
+			m_Dropped.store(Dropped + 1, std::memory_order_relaxed);
+			return;
+		}
+
+		if (MarkerSize > 0)
+		{
+			CaptureRecordHeader Marker;
+			SetDroppedHeader(Marker, Dropped, Header.Timestamp);
+			ScatterBytes(p_Region1, Count1, p_Region2, 0, &Marker, sizeof(CaptureRecordHeader));
+			m_Dropped.store(0, std::memory_order_relaxed);
+		}
+
+		static const unsigned char Padding[8] = { 0 };
+		ScatterBytes(p_Region1, Count1, p_Region2, MarkerSize, &Header, sizeof(CaptureRecordHeader));
+		ScatterBytes(p_Region1, Count1, p_Region2, MarkerSize + sizeof(CaptureRecordHeader), p_Samples, SampleBytes);
+		ScatterBytes(p_Region1, Count1, p_Region2, MarkerSize + sizeof(CaptureRecordHeader) + SampleBytes, Padding, Size - sizeof(CaptureRecordHeader) - SampleBytes);
+
+		m_Ring.Commit(MarkerSize + Size);
+	}
+
+	void CaptureRecorder::Drain()
+	{
+		const unsigned char* p_Region1;
+		const unsigned char* p_Region2;
+		int Count1, Count2;
+		int Count = m_Ring.Peek(p_Region1, Count1, p_Region2, Count2);
+		if (Count > 0)
+		{
+			fwrite(p_Region1, 1, Count1, m_File);
+			fwrite(p_Region2, 1, Count2, m_File);
+			m_Ring.Skip(Count);
+			fflush(m_File);
+		}
+	}
+
+	void CaptureRecorder::RunWriter()
+	{
+		while (m_WriterActive)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			Drain();
+		}
+
+		// Pick up anything appended after the last pass. Records dropped after the last one that fit have no record to be
+		// marked in front of, so they are marked at the end.
+		Drain();
+		uint32_t Dropped = m_Dropped.exchange(0);
+		if (Dropped > 0)
+		{
+			CaptureRecordHeader Marker;
+			SetDroppedHeader(Marker, Dropped, Now());
+			fwrite(&Marker, sizeof(Marker), 1, m_File);
+			fflush(m_File);
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "AudioPluginUtil.h"
+
+namespace MSHRTFSpatializer
+{
+	// A capture is a CaptureFileHeader followed by records. Every record starts with a CaptureRecordHeader; process records
+	// carry the callback's interleaved input after it, Length * InChannels floats. Records are padded to a multiple of
+	// 8 bytes so a memory-mapped capture can be read in place. Everything is little-endian.
+	const uint32_t CAPTURE_MAGIC = 0x50435349;		// "ISCP"
+	const uint32_t CAPTURE_VERSION = 1;
+	const uint32_t CAPTURE_MAX_PARAMS = 8;
+
+	// Capturing is opt-in: set this environment variable to the path of the file to write
+	#define CAPTURE_ENVIRONMENT_VARIABLE "UNITY_ISAC_CAPTURE"
+
+	// 8 MB holds a few hundred milliseconds of a busy scene, far more than the writer thread ever falls behind
+	#define CAPTURE_RING_SIZE (1 << 23)
+
+	enum CaptureRecordType
+	{
+		CaptureRecord_Create = 0,
+		CaptureRecord_Release,
+		CaptureRecord_Process,
+		CaptureRecord_Dropped,		// Records were lost here because the ring was full; DspTick holds how many
+	};
+
+	struct CaptureFileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t RecordHeaderSize;	// sizeof(CaptureRecordHeader) when the capture was written
+		uint32_t NumParams;
+		int64_t TimestampFrequency;	// Ticks per second of the record timestamps
+	};
+
+	struct CaptureRecordHeader
+	{
+		uint32_t Size;				// Of the whole record, including this header, the samples and the padding
+		uint32_t Type;
+		uint32_t SourceId;			// Identifies the plugin instance across its records
+		uint32_t Flags;				// UnityAudioEffectState flags
+		uint64_t DspTick;
+		int64_t Timestamp;			// When the callback was entered
+		uint32_t SampleRate;
+		uint32_t DspBufferSize;
+		uint32_t HostCompatible;	// The host reported the DSP buffer size and the spatializer data below
+		uint32_t Length;
+		int32_t InChannels;
+		int32_t OutChannels;
+		float ListenerMatrix[16];
+		float SourceMatrix[16];
+		float SpatialBlend;
+		float Spread;
+		float StereoPan;
+		float Params[CAPTURE_MAX_PARAMS];
+	};
+	static_assert(sizeof(CaptureRecordHeader) % 8 == 0, "Records must stay 8 byte aligned");
+
+	// Streams callback traffic to a capture file. Callbacks only append records to a ring buffer; a background thread
+	// writes them out, so the audio threads never wait on the disk. A record that doesn't fit in the ring is dropped
+	// and counted, and a CaptureRecord_Dropped record marks the gap in the file.
+	class CaptureRecorder
+	{
+	public:
+		// Returns nullptr if the file can't be created
+		static CaptureRecorder* Create(const char* p_Path, uint32_t NumParams);
+		~CaptureRecorder();
+
+		// Timestamp for the records, in ticks of the frequency in the file header
+		static int64_t Now();
+
+		// Appends Header followed by NumSamples samples. Fills in Header.Size. Can be called from any thread.
+		void Append(CaptureRecordHeader& Header, const float* p_Samples, uint32_t NumSamples);
+
+		// Body of the writer thread; runs until the recorder is destroyed
+		void RunWriter();
+
+	protected:
+		CaptureRecorder() {}
+
+		// Writes out whatever is in the ring. Writer thread only.
+		void Drain();
+
+		FILE* m_File = nullptr;
+
+		// Unity may run callbacks on more than one thread; the ring takes one producer at a time
+		AudioMutex m_ProducerLock;
+		SPSCRingBuffer<CAPTURE_RING_SIZE, unsigned char, SPSCRingBufferPolicy_AllOrNothing> m_Ring;
+
+		// Records dropped since the last one that went into the ring. Changed under m_ProducerLock; the writer only takes
+		// it over on its last pass, once the callbacks are gone.
+		std::atomic<uint32_t> m_Dropped;
+
+		std::atomic<bool> m_WriterActive;
+		std::thread m_Writer;
+	};
+}
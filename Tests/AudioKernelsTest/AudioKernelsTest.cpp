@@ -0,0 +1,145 @@
+// Checks every variant of the audio kernels (see UnityAudioKernels in AudioPluginUtil.h) that this machine can run
+// against the scalar ones, over spans of every length up to a few vectors and at unaligned offsets. Builds anywhere
+// AudioPluginUtil.cpp does; the plugin's effect callbacks aren't linked, hence the dead code stripping:
+//
+//   g++ -O2 -std=c++14 -ffunction-sections -Wl,--gc-sections -I../.. -o AudioKernelsTest AudioKernelsTest.cpp ../../AudioPluginUtil.cpp
+//
+// Exits with 1 if any variant is off by more than rounding.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../AudioPluginUtil.h"
+
+// Spans up to a few AVX2 vectors, so that every tail length is hit
+#define MAX_SPAN 67
+#define MAX_OFFSET 3
+#define MAX_CHANNELS 8
+#define TOLERANCE 1e-5f
+
+static float g_Source[(MAX_SPAN + MAX_OFFSET) * MAX_CHANNELS];
+static UnityComplexNumber g_Spectra[3][MAX_SPAN + MAX_OFFSET];
+
+static int g_Failures = 0;
+
+static float Random()
+{
+	return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static void Expect(const char* p_Variant, const char* p_Kernel, int Length, const float* p_Expected, const float* p_Actual, int Count)
+{
+	for (int i = 0; i < Count; i++)
+	{
+		if (fabsf(p_Expected[i] - p_Actual[i]) > TOLERANCE * (1.0f + fabsf(p_Expected[i])))
+		{
+			printf("%s %s, %d samples: [%d] is %g, expected %g\n", p_Variant, p_Kernel, Length, i, p_Actual[i], p_Expected[i]);
+			g_Failures++;
+			return;
+		}
+	}
+}
+
+static void TestVariant(const UnityAudioKernels& Scalar, const UnityAudioKernels& Variant)
+{
+	const char* p_Name = Variant.name;
+	static float Expected[MAX_SPAN * MAX_CHANNELS], Actual[MAX_SPAN * MAX_CHANNELS];
+	static UnityComplexNumber ExpectedSpectra[2][MAX_SPAN], ActualSpectra[2][MAX_SPAN];
+
+	for (int Offset = 0; Offset <= MAX_OFFSET; Offset++)
+	{
+		const float* p_Src = g_Source + Offset;
+		for (int Length = 0; Length <= MAX_SPAN; Length++)
+		{
+			for (int Stride = 1; Stride <= 2; Stride++)
+			{
+				float ExpectedPeak = Scalar.CopyScaledMetered(Expected, p_Src, Stride, Length, 0.25f, 1.5f);
+				float ActualPeak = Variant.CopyScaledMetered(Actual, p_Src, Stride, Length, 0.25f, 1.5f);
+				Expect(p_Name, "CopyScaledMetered", Length, Expected, Actual, Length);
+				Expect(p_Name, "CopyScaledMetered peak", Length, &ExpectedPeak, &ActualPeak, 1);
+
+				Variant.CopyScaled(Actual, p_Src, Stride, Length, 0.25f, 1.5f);
+				Expect(p_Name, "CopyScaled", Length, Expected, Actual, Length);
+			}
+
+			float ExpectedPeak = Scalar.Peak(p_Src, Length);
+			float ActualPeak = Variant.Peak(p_Src, Length);
+			Expect(p_Name, "Peak", Length, &ExpectedPeak, &ActualPeak, 1);
+
+			float ExpectedRange[2] = { 0.0f, 0.0f }, ActualRange[2] = { 0.0f, 0.0f };
+			Scalar.MinMax(p_Src, Length, ExpectedRange[0], ExpectedRange[1]);
+			Variant.MinMax(p_Src, Length, ActualRange[0], ActualRange[1]);
+			Expect(p_Name, "MinMax", Length, ExpectedRange, ActualRange, 2);
+
+			for (int i = 0; i < Length; i++)
+			{
+				Expected[i] = Actual[i] = g_Source[i];
+			}
+			Scalar.MixScaled(Expected, p_Src, Length, 1.0f, -0.5f);
+			Variant.MixScaled(Actual, p_Src, Length, 1.0f, -0.5f);
+			Expect(p_Name, "MixScaled", Length, Expected, Actual, Length);
+
+			for (int Channels = 1; Channels <= MAX_CHANNELS; Channels++)
+			{
+				Scalar.Downmix(Expected, p_Src, Channels, Length, 0.5f);
+				Variant.Downmix(Actual, p_Src, Channels, Length, 0.5f);
+				Expect(p_Name, "Downmix", Length, Expected, Actual, Length);
+			}
+
+			// In place, as the binaural renderer uses it
+			const UnityComplexNumber* p_A = g_Spectra[0] + Offset;
+			const UnityComplexNumber* p_B = g_Spectra[1] + Offset;
+			for (int i = 0; i < Length; i++)
+			{
+				ExpectedSpectra[0][i] = ActualSpectra[0][i] = p_A[i];
+			}
+			Scalar.ComplexMultiply(ExpectedSpectra[0], ExpectedSpectra[0], p_B, Length);
+			Variant.ComplexMultiply(ActualSpectra[0], ActualSpectra[0], p_B, Length);
+			Expect(p_Name, "ComplexMultiply", Length, &ExpectedSpectra[0][0].re, &ActualSpectra[0][0].re, 2 * Length);
+
+			for (int i = 0; i < Length; i++)
+			{
+				ExpectedSpectra[0][i] = ActualSpectra[0][i] = p_A[i];
+				ExpectedSpectra[1][i] = ActualSpectra[1][i] = p_B[i];
+			}
+			Scalar.FFTButterflies(ExpectedSpectra[0], ExpectedSpectra[1], g_Spectra[2] + Offset, Length);
+			Variant.FFTButterflies(ActualSpectra[0], ActualSpectra[1], g_Spectra[2] + Offset, Length);
+			Expect(p_Name, "FFTButterflies", Length, &ExpectedSpectra[0][0].re, &ActualSpectra[0][0].re, 2 * Length);
+			Expect(p_Name, "FFTButterflies", Length, &ExpectedSpectra[1][0].re, &ActualSpectra[1][0].re, 2 * Length);
+		}
+	}
+}
+
+int main()
+{
+	srand(1);
+	for (float& Sample : g_Source)
+	{
+		Sample = Random();
+	}
+	for (auto& Spectrum : g_Spectra)
+	{
+		for (UnityComplexNumber& Bin : Spectrum)
+		{
+			Bin.Set(Random(), Random());
+		}
+	}
+
+	const UnityAudioKernels& Scalar = *GetAudioKernels(UnityAudioInstructionSet_Scalar);
+	const UnityAudioInstructionSet Variants[] = { UnityAudioInstructionSet_SSE2, UnityAudioInstructionSet_AVX2, UnityAudioInstructionSet_NEON };
+	for (UnityAudioInstructionSet InstructionSet : Variants)
+	{
+		const UnityAudioKernels* p_Variant = GetAudioKernels(InstructionSet);
+		if (p_Variant == nullptr)
+		{
+			continue;
+		}
+
+		int Before = g_Failures;
+		TestVariant(Scalar, *p_Variant);
+		printf("%s: %s\n", p_Variant->name, (g_Failures == Before) ? "ok" : "FAILED");
+	}
+
+	return (g_Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+// Checks BiquadFilterBank (AudioPluginUtil.h) against the scalar BiquadFilter, with banks of 4, 8 and 16 filters:
+//  - ProcessParallel against one BiquadFilter per lane
+//  - ProcessCascade against the sections chained one after another, delayed by the bank's NUMFILTERS - 1 samples
+//  - a SetTargetCoeffs ramp against filters whose coefficients step linearly over the block, then land on the targets
+//  - the table-driven Setup*Fast coefficients against the exact ones of BiquadFilter::Setup*
+// The blocks are of uneven lengths, so that state carried from one block to the next is checked too. The table lookups
+// live in AudioPluginUtil.cpp; the plugin's effect callbacks aren't linked, hence the dead code stripping:
+//
+//   g++ -O2 -std=c++14 -ffunction-sections -Wl,--gc-sections -I../.. -o BiquadFilterBankTest BiquadFilterBankTest.cpp ../../AudioPluginUtil.cpp
+//
+// Exits with 1 if anything is off by more than rounding (or, for the fast setups, the tables' interpolation).
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../AudioPluginUtil.h"
+
+#define SAMPLE_RATE 48000.0f
+#define MAX_FILTERS 16
+#define MAX_BLOCK 300
+#define TOLERANCE 1e-4f
+
+// The fast setups interpolate sin, cos and the shelf gain from tables
+#define FAST_TOLERANCE 2e-3f
+
+static const int BLOCK_LENGTHS[] = { 1, 7, 64, 3, 300, 128, 2, 255 };
+
+static int g_Failures = 0;
+
+static float Random()
+{
+	return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+static bool Close(float Expected, float Actual, float Tolerance)
+{
+	return fabsf(Expected - Actual) <= Tolerance * (1.0f + fabsf(Expected));
+}
+
+// Coefficients in the order BiquadFilterBank::SetCoeffs takes them
+struct Coeffs
+{
+	float b0, b1, b2, a1, a2;
+};
+
+static Coeffs GetCoeffs(BiquadFilter& Filter)
+{
+	float c[5], *p = c;
+	Filter.StoreCoeffs(p);
+	Coeffs Result = { c[2], c[1], c[0], c[4], c[3] };
+	return Result;
+}
+
+// A different filter for every lane, with cutoffs from 60 Hz to about 5 kHz
+static BiquadFilter MakeFilter(int Lane)
+{
+	BiquadFilter Filter = BiquadFilter();
+	float Cutoff = 60.0f * powf(1.35f, (float)(Lane % 16));
+	switch (Lane % 5)
+	{
+		case 0: Filter.SetupPeaking(Cutoff, SAMPLE_RATE, 6.0f, 1.0f); break;
+		case 1: Filter.SetupLowShelf(Cutoff, SAMPLE_RATE, -9.0f, 0.7f); break;
+		case 2: Filter.SetupHighShelf(Cutoff, SAMPLE_RATE, 4.0f, 0.7f); break;
+		case 3: Filter.SetupLowpass(Cutoff, SAMPLE_RATE, 0.9f); break;
+		default: Filter.SetupHighpass(Cutoff, SAMPLE_RATE, 1.3f); break;
+	}
+	return Filter;
+}
+
+// A biquad with the coefficients spelled out, for the ramp
+struct ReferenceBiquad
+{
+	Coeffs c;
+	float z1, z2;
+
+	float Process(float Input)
+	{
+		float iir = Input - c.a1 * z1 - c.a2 * z2;
+		float fir = c.b0 * iir + c.b1 * z1 + c.b2 * z2;
+		z2 = z1;
+		z1 = iir;
+		return fir;
+	}
+};
+
+// Exposes the coefficients the Setup*Fast functions set
+template<int NUMFILTERS>
+class InspectableBank : public BiquadFilterBank<NUMFILTERS>
+{
+public:
+	Coeffs GetTarget(int Lane) const
+	{
+		Coeffs Result = { this->t_b0[Lane], this->t_b1[Lane], this->t_b2[Lane], this->t_a1[Lane], this->t_a2[Lane] };
+		return Result;
+	}
+};
+
+template<int NUMFILTERS>
+static void TestParallel()
+{
+	BiquadFilterBank<NUMFILTERS> Bank;
+	Bank.Init();
+	BiquadFilter Reference[NUMFILTERS];
+	for (int Lane = 0; Lane < NUMFILTERS; Lane++)
+	{
+		Reference[Lane] = MakeFilter(Lane);
+		Coeffs c = GetCoeffs(Reference[Lane]);
+		Bank.SetCoeffs(Lane, c.b0, c.b1, c.b2, c.a1, c.a2);
+	}
+
+	static float Data[MAX_BLOCK * MAX_FILTERS];
+	int Position = 0;
+	for (int Length : BLOCK_LENGTHS)
+	{
+		float Expected[MAX_BLOCK * MAX_FILTERS];
+		for (int n = 0; n < Length * NUMFILTERS; n++)
+		{
+			Data[n] = Random();
+			Expected[n] = Reference[n % NUMFILTERS].Process(Data[n]);
+		}
+		Bank.ProcessParallel(Data, Length);
+		for (int n = 0; n < Length * NUMFILTERS; n++)
+		{
+			if (!Close(Expected[n], Data[n], TOLERANCE))
+			{
+				printf("%d filters, ProcessParallel: lane %d sample %d is %g, expected %g\n", NUMFILTERS, n % NUMFILTERS, Position + n / NUMFILTERS, Data[n], Expected[n]);
+				g_Failures++;
+				return;
+			}
+		}
+		Position += Length;
+	}
+}
+
+template<int NUMFILTERS>
+static void TestCascade()
+{
+	BiquadFilterBank<NUMFILTERS> Bank;
+	Bank.Init();
+	BiquadFilter Sections[NUMFILTERS];
+	for (int Section = 0; Section < NUMFILTERS; Section++)
+	{
+		Sections[Section] = MakeFilter(Section);
+		Coeffs c = GetCoeffs(Sections[Section]);
+		Bank.SetCoeffs(Section, c.b0, c.b1, c.b2, c.a1, c.a2);
+	}
+
+	// The chained output, kept so that the bank's delayed output can be matched against it
+	static float Chained[MAX_BLOCK * 8];
+	static float Data[MAX_BLOCK];
+	int Position = 0;
+	for (int Length : BLOCK_LENGTHS)
+	{
+		for (int n = 0; n < Length; n++)
+		{
+			Data[n] = Random();
+			float Sample = Data[n];
+			for (BiquadFilter& Section : Sections)
+			{
+				Sample = Section.Process(Sample);
+			}
+			Chained[Position + n] = Sample;
+		}
+		Bank.ProcessCascade(Data, Length);
+		for (int n = 0; n < Length; n++)
+		{
+			int Source = Position + n - (NUMFILTERS - 1);
+			float Expected = (Source < 0) ? 0.0f : Chained[Source];
+			if (!Close(Expected, Data[n], TOLERANCE))
+			{
+				printf("%d filters, ProcessCascade: sample %d is %g, expected %g\n", NUMFILTERS, Position + n, Data[n], Expected);
+				g_Failures++;
+				return;
+			}
+		}
+		Position += Length;
+	}
+}
+
+// Ramps every lane from one filter to another over a block, then runs a block on the targets
+template<int NUMFILTERS>
+static void TestRamp()
+{
+	BiquadFilterBank<NUMFILTERS> Bank;
+	Bank.Init();
+	ReferenceBiquad Reference[NUMFILTERS];
+	Coeffs Targets[NUMFILTERS];
+	for (int Lane = 0; Lane < NUMFILTERS; Lane++)
+	{
+		BiquadFilter From = MakeFilter(Lane);
+		BiquadFilter To = MakeFilter(Lane + 3);
+		Reference[Lane].c = GetCoeffs(From);
+		Reference[Lane].z1 = Reference[Lane].z2 = 0.0f;
+		Targets[Lane] = GetCoeffs(To);
+		Bank.SetCoeffs(Lane, Reference[Lane].c.b0, Reference[Lane].c.b1, Reference[Lane].c.b2, Reference[Lane].c.a1, Reference[Lane].c.a2);
+		Bank.SetTargetCoeffs(Lane, Targets[Lane].b0, Targets[Lane].b1, Targets[Lane].b2, Targets[Lane].a1, Targets[Lane].a2);
+	}
+
+	// The bank steps each coefficient by a Length'th of the way to its target after every sample
+	const int Length = 200;
+	Coeffs Steps[NUMFILTERS];
+	for (int Lane = 0; Lane < NUMFILTERS; Lane++)
+	{
+		const Coeffs& From = Reference[Lane].c;
+		const Coeffs& To = Targets[Lane];
+		const float Scale = 1.0f / (float)Length;
+		Coeffs Step = { (To.b0 - From.b0) * Scale, (To.b1 - From.b1) * Scale, (To.b2 - From.b2) * Scale, (To.a1 - From.a1) * Scale, (To.a2 - From.a2) * Scale };
+		Steps[Lane] = Step;
+	}
+
+	static float Data[MAX_BLOCK * MAX_FILTERS];
+	for (int Block = 0; Block < 2; Block++)
+	{
+		float Expected[MAX_BLOCK * MAX_FILTERS];
+		for (int n = 0; n < Length; n++)
+		{
+			for (int Lane = 0; Lane < NUMFILTERS; Lane++)
+			{
+				ReferenceBiquad& Filter = Reference[Lane];
+				int Index = n * NUMFILTERS + Lane;
+				Data[Index] = Random();
+				Expected[Index] = Filter.Process(Data[Index]);
+				if (Block == 0)
+				{
+					Filter.c.b0 += Steps[Lane].b0;
+					Filter.c.b1 += Steps[Lane].b1;
+					Filter.c.b2 += Steps[Lane].b2;
+					Filter.c.a1 += Steps[Lane].a1;
+					Filter.c.a2 += Steps[Lane].a2;
+				}
+			}
+		}
+		Bank.ProcessParallel(Data, Length);
+		for (int n = 0; n < Length * NUMFILTERS; n++)
+		{
+			if (!Close(Expected[n], Data[n], TOLERANCE))
+			{
+				printf("%d filters, %s: lane %d sample %d is %g, expected %g\n", NUMFILTERS, (Block == 0) ? "SetTargetCoeffs ramp" : "after the ramp",
+					n % NUMFILTERS, n / NUMFILTERS, Data[n], Expected[n]);
+				g_Failures++;
+				return;
+			}
+		}
+
+		// The ramp ends exactly on the targets, not on the sum of the steps
+		for (int Lane = 0; Lane < NUMFILTERS; Lane++)
+		{
+			Reference[Lane].c = Targets[Lane];
+		}
+	}
+}
+
+static void ExpectCoeffs(const char* p_Setup, float Cutoff, const Coeffs& Exact, const Coeffs& Fast)
+{
+	const float ExactValues[5] = { Exact.b0, Exact.b1, Exact.b2, Exact.a1, Exact.a2 };
+	const float FastValues[5] = { Fast.b0, Fast.b1, Fast.b2, Fast.a1, Fast.a2 };
+	for (int i = 0; i < 5; i++)
+	{
+		if (!Close(ExactValues[i], FastValues[i], FAST_TOLERANCE))
+		{
+			printf("%s at %g Hz: coefficient %d is %g, expected %g\n", p_Setup, Cutoff, i, FastValues[i], ExactValues[i]);
+			g_Failures++;
+			return;
+		}
+	}
+}
+
+static void TestFastSetups()
+{
+	InspectableBank<4> Bank;
+	Bank.Init();
+	for (float Cutoff = 20.0f; Cutoff < 20000.0f; Cutoff *= 1.1f)
+	{
+		for (float Q = 0.5f; Q < 4.0f; Q *= 2.0f)
+		{
+			BiquadFilter Exact = BiquadFilter();
+			Exact.SetupLowpass(Cutoff, SAMPLE_RATE, Q);
+			Bank.SetupLowpassFast(0, Cutoff, SAMPLE_RATE, Q);
+			ExpectCoeffs("SetupLowpassFast", Cutoff, GetCoeffs(Exact), Bank.GetTarget(0));
+
+			Exact.SetupHighpass(Cutoff, SAMPLE_RATE, Q);
+			Bank.SetupHighpassFast(1, Cutoff, SAMPLE_RATE, Q);
+			ExpectCoeffs("SetupHighpassFast", Cutoff, GetCoeffs(Exact), Bank.GetTarget(1));
+
+			for (float Gain = -24.0f; Gain <= 24.0f; Gain += 7.5f)
+			{
+				Exact.SetupHighShelf(Cutoff, SAMPLE_RATE, Gain, Q);
+				Bank.SetupHighShelfFast(2, Cutoff, SAMPLE_RATE, Gain, Q);
+				ExpectCoeffs("SetupHighShelfFast", Cutoff, GetCoeffs(Exact), Bank.GetTarget(2));
+			}
+		}
+	}
+}
+
+template<int NUMFILTERS>
+static void TestBank()
+{
+	int Before = g_Failures;
+	TestParallel<NUMFILTERS>();
+	TestCascade<NUMFILTERS>();
+	TestRamp<NUMFILTERS>();
+	printf("%d filters: %s\n", NUMFILTERS, (g_Failures == Before) ? "ok" : "FAILED");
+}
+
+int main()
+{
+	srand(1);
+	TestBank<4>();
+	TestBank<8>();
+	TestBank<16>();
+
+	int Before = g_Failures;
+	TestFastSetups();
+	printf("Fast setups: %s\n", (g_Failures == Before) ? "ok" : "FAILED");
+
+	return (g_Failures == 0) ? 0 : 1;
+}
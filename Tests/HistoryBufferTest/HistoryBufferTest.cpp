@@ -0,0 +1,172 @@
+// Checks HistoryBuffer::ReadBufferMinMax (AudioPluginUtil.h), which reads each pixel's min and max from a pyramid of
+// block envelopes, against a brute-force scan of the samples each pixel covers. Random data is fed through both Feed
+// overloads, a sample and a block at a time (with strides of 1 and 2), for history lengths that aren't whole blocks of
+// the envelope, and read back at several pixel widths and offsets as the writes go round the buffer a few times.
+// Builds anywhere AudioPluginUtil.cpp does; the plugin's effect callbacks aren't linked, hence the dead code stripping:
+//
+//   g++ -O2 -std=c++14 -ffunction-sections -Wl,--gc-sections -I../.. -o HistoryBufferTest HistoryBufferTest.cpp ../../AudioPluginUtil.cpp
+//
+// Exits with 1 if any pixel differs. The envelope only ever takes the min and max of stored samples, so the results
+// have to be exact.
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../../AudioPluginUtil.h"
+
+// Requested lengths, rounded up by Init to whole blocks of the coarsest envelope level it keeps
+static const int LENGTHS[] = { 100, 1000, 5003, 48000 + 17, 3 * 65536 - 5 };
+
+// Pixels per read, and where in the history the reads start
+static const int PIXEL_COUNTS[] = { 1, 7, 200, 1023 };
+static const float OFFSETS[] = { 0.0f, 3.5f, 0.37f };
+
+// How many times the writes go round the buffer, and how often it is read on the way
+#define LAPS 3
+#define READS_PER_LAP 5
+
+#define MAX_BLOCK 3000
+
+static int g_Failures = 0;
+
+static float Random()
+{
+	return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+// Every sample fed so far, newest last, after the zeros the buffer starts out with
+struct Reference
+{
+	std::vector<float> Samples;
+
+	float Age(int Age) const { return Samples[Samples.size() - 1 - Age]; }
+};
+
+static bool CheckRead(HistoryBuffer& Buffer, const Reference& History, int NumPixels, float Offset)
+{
+	// Half the history, so that reads starting further back still fit
+	const int NumSamplesSource = Buffer.length / 2;
+	const int NumSamplesTarget = 2 * NumPixels + 1;
+	static std::vector<float> Result;
+	Result.assign(NumSamplesTarget, 0.0f);
+	Buffer.ReadBufferMinMax(Result.data(), NumSamplesTarget, NumSamplesSource, Offset);
+
+	// The pixels the way ReadBufferMinMax lays them out: the n'th newest covers the ages from p to p + speed
+	const float Speed = (float)NumSamplesSource / (float)NumPixels;
+	float p = Offset;
+	int n;
+	for (n = 0; n < NumPixels; n++)
+	{
+		int Age0 = (int)p;
+		int Age1 = (int)(p + Speed);
+		if (Age1 <= Age0)
+		{
+			Age1 = Age0 + 1;
+		}
+		if (Age1 > Buffer.length)
+		{
+			break;
+		}
+
+		float MinValue = FLT_MAX, MaxValue = -FLT_MAX;
+		for (int Age = Age0; Age < Age1; Age++)
+		{
+			float Sample = History.Age(Age);
+			MinValue = (Sample < MinValue) ? Sample : MinValue;
+			MaxValue = (Sample > MaxValue) ? Sample : MaxValue;
+		}
+
+		const int Pixel = NumPixels - 1 - n;
+		if (Result[2 * Pixel] != MinValue || Result[2 * Pixel + 1] != MaxValue)
+		{
+			printf("Length %d, %d pixels from %g: pixel %d (ages %d to %d) is [%g, %g], expected [%g, %g]\n", Buffer.length, NumPixels, Offset,
+				Pixel, Age0, Age1, Result[2 * Pixel], Result[2 * Pixel + 1], MinValue, MaxValue);
+			return false;
+		}
+		p += Speed;
+	}
+
+	if (Result[NumSamplesTarget - 1] != (float)n)
+	{
+		printf("Length %d, %d pixels from %g: %g pixels written, expected %d\n", Buffer.length, NumPixels, Offset, Result[NumSamplesTarget - 1], n);
+		return false;
+	}
+	return true;
+}
+
+static void TestLength(int RequestedLength)
+{
+	HistoryBuffer Buffer;
+	Buffer.Init(RequestedLength);
+
+	Reference History;
+	History.Samples.assign(Buffer.length, 0.0f);
+
+	static float Block[MAX_BLOCK * 2];
+	const int ReadInterval = Buffer.length / READS_PER_LAP;
+	int NextRead = ReadInterval;
+	int Fed = 0;
+	while (Fed < LAPS * Buffer.length)
+	{
+		// Mostly blocks, some of them longer than the history, and now and then single samples
+		int Kind = rand() % 4;
+		if (Kind == 0)
+		{
+			int Count = 1 + rand() % 40;
+			for (int i = 0; i < Count; i++)
+			{
+				float Sample = Random();
+				Buffer.Feed(Sample);
+				History.Samples.push_back(Sample);
+			}
+			Fed += Count;
+		}
+		else
+		{
+			int Stride = (Kind == 3) ? 2 : 1;
+			int Count = 1 + rand() % ((RequestedLength < 200) ? 3 * RequestedLength / 2 : MAX_BLOCK);
+			for (int i = 0; i < Count * Stride; i++)
+			{
+				Block[i] = Random();
+			}
+			Buffer.Feed(Block, Count, Stride);
+			for (int i = 0; i < Count; i++)
+			{
+				History.Samples.push_back(Block[i * Stride]);
+			}
+			Fed += Count;
+		}
+
+		if (Fed >= NextRead)
+		{
+			NextRead += ReadInterval;
+			for (int NumPixels : PIXEL_COUNTS)
+			{
+				for (float Offset : OFFSETS)
+				{
+					// Offsets below 1 are fractions of the history
+					float Start = (Offset < 1.0f && Offset > 0.0f) ? Offset * (float)Buffer.length : Offset;
+					if (!CheckRead(Buffer, History, NumPixels, Start))
+					{
+						g_Failures++;
+						return;
+					}
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	srand(1);
+	for (int Length : LENGTHS)
+	{
+		int Before = g_Failures;
+		TestLength(Length);
+		printf("Length %d: %s\n", Length, (g_Failures == Before) ? "ok" : "FAILED");
+	}
+	return (g_Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Runs the plugin's portable audio code (the reverb, a binaural voice and an object capture) the way the audio threads
+// do, inside a REALTIME_SCOPE, with the real-time checks of RealtimeCheck.h interposed over the C library. Everything
+// is set up outside the scope first; inside it, nothing may allocate, lock, wait or sleep. Linux only, since that is
+// where the checks interpose by name, and RealtimeCheck.cpp has to be linked into the executable:
+//
+//   g++ -O2 -std=c++14 -DREALTIME_CHECK -pthread -ffunction-sections -Wl,--gc-sections -I../.. -o RealtimeCheckTest
+//       RealtimeCheckTest.cpp ../../RealtimeCheck.cpp ../../AudioPluginUtil.cpp ../../FdnReverb.cpp
+//       ../../BinauralRenderer.cpp ../../HrirDatabase.cpp ../../ObjectCapture.cpp -ldl
+//
+// It first checks that the checks work: an allocation and a contended AudioMutex in a scope have to be reported. The
+// database and the capture are written to the working directory and removed again. Exits with 1 on any violation.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+#include "../../RealtimeCheck.h"
+#include "../../BinauralRenderer.h"
+#include "../../FdnReverb.h"
+#include "../../ObjectCapture.h"
+
+#ifndef REALTIME_CHECK
+#error Build with -DREALTIME_CHECK
+#endif
+
+using namespace MSHRTFSpatializer;
+
+#define SAMPLE_RATE 48000
+#define BLOCK_SIZE 480
+#define BLOCK_COUNT 400
+#define OBJECT_COUNT 4
+
+// A small synthetic database: three rings of eight directions, with decaying noise for responses
+#define TEST_RING_COUNT 3
+#define TEST_RING_DIRECTIONS 8
+#define TEST_LENGTH 128
+
+#define DATABASE_PATH "RealtimeCheckTest.hrir"
+#define CAPTURE_PATH "RealtimeCheckTest.objects"
+
+static bool WriteDatabase(const char* p_Path)
+{
+	FILE* p_File = fopen(p_Path, "wb");
+	if (p_File == nullptr)
+	{
+		return false;
+	}
+
+	const uint32_t DirectionCount = TEST_RING_COUNT * TEST_RING_DIRECTIONS;
+	HrirFileHeader Header = { HRIR_DATABASE_MAGIC, HRIR_DATABASE_VERSION, SAMPLE_RATE, TEST_LENGTH, TEST_RING_COUNT, DirectionCount, 1.0f / 32768.0f, 0 };
+	fwrite(&Header, sizeof(Header), 1, p_File);
+
+	for (uint32_t Ring = 0; Ring < TEST_RING_COUNT; Ring++)
+	{
+		HrirFileRing FileRing = { -40.0f + 40.0f * Ring, Ring * TEST_RING_DIRECTIONS, TEST_RING_DIRECTIONS, 0 };
+		fwrite(&FileRing, sizeof(FileRing), 1, p_File);
+	}
+
+	for (uint32_t Direction = 0; Direction < DirectionCount; Direction++)
+	{
+		float Azimuth = (360.0f / TEST_RING_DIRECTIONS) * (Direction % TEST_RING_DIRECTIONS);
+		float Lateral = sinf(Azimuth * 3.14159265f / 180.0f);
+		HrirFileDirection FileDirection = { Azimuth, 20.0f - 20.0f * Lateral, 20.0f + 20.0f * Lateral, 0 };
+		fwrite(&FileDirection, sizeof(FileDirection), 1, p_File);
+	}
+
+	srand(1);
+	for (uint32_t Tap = 0; Tap < DirectionCount * 2 * TEST_LENGTH; Tap++)
+	{
+		float Decay = expf(-(float)(Tap % TEST_LENGTH) / 16.0f);
+		int16_t Value = (int16_t)((rand() % 32768 - 16384) * Decay);
+		fwrite(&Value, sizeof(Value), 1, p_File);
+	}
+
+	return fclose(p_File) == 0;
+}
+
+// A thread in a scope that has to park on a mutex held by another
+class ContendedMutex : public AudioMutex
+{
+public:
+	bool IsContended() const { return state.load() == CONTENDED; }
+};
+
+static void LockContended(ContendedMutex* p_Mutex)
+{
+	REALTIME_SCOPE();
+	p_Mutex->Lock();
+	p_Mutex->Unlock();
+}
+
+// Checks that an allocation and a wait on a mutex in a scope are both caught
+static bool CheckDetection()
+{
+	unsigned int Before = RealtimeCheck::GetViolationCount();
+	{
+		REALTIME_SCOPE();
+		void* volatile p_Memory = malloc(64);
+		free(p_Memory);
+	}
+	if (RealtimeCheck::GetViolationCount() != Before + 2)
+	{
+		printf("Allocation in a scope: FAILED, %u reports\n", RealtimeCheck::GetViolationCount() - Before);
+		return false;
+	}
+
+	Before = RealtimeCheck::GetViolationCount();
+	static ContendedMutex Mutex;
+	Mutex.Lock();
+	std::thread Waiter(LockContended, &Mutex);
+	while (!Mutex.IsContended())
+	{
+		std::this_thread::yield();
+	}
+	// Give it time to park rather than catching it between marking the lock and the wait
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	Mutex.Unlock();
+	Waiter.join();
+	if (RealtimeCheck::GetViolationCount() == Before)
+	{
+		printf("Contended AudioMutex in a scope: FAILED, not reported\n");
+		return false;
+	}
+
+	printf("Detection: ok\n");
+	return true;
+}
+
+int main()
+{
+	if (!CheckDetection())
+	{
+		return 1;
+	}
+
+	FdnReverb* p_Reverb = FdnReverb::Create(SAMPLE_RATE, ReverbEnvironment_Large);
+	HrirDatabase* p_Database = WriteDatabase(DATABASE_PATH) ? HrirDatabase::Open(DATABASE_PATH) : nullptr;
+	BinauralVoice* p_Voice = (p_Database != nullptr) ? BinauralVoice::Create(p_Database) : nullptr;
+	ObjectCaptureWriter* p_Writer = ObjectCaptureWriter::Create(CAPTURE_PATH, SAMPLE_RATE);
+	if (p_Reverb == nullptr || p_Voice == nullptr || p_Writer == nullptr)
+	{
+		printf("Setup: FAILED\n");
+		return 1;
+	}
+
+	static float Input[BLOCK_SIZE * 2];
+	static float Binaural[BLOCK_SIZE * 2];
+	static float ReverbOutputs[REVERB_OUTPUT_COUNT][BLOCK_SIZE];
+	float* const p_ReverbOutputs[REVERB_OUTPUT_COUNT] = { ReverbOutputs[0], ReverbOutputs[1], ReverbOutputs[2], ReverbOutputs[3] };
+	for (int n = 0; n < BLOCK_SIZE * 2; n++)
+	{
+		Input[n] = sinf(n * 0.05f) * 0.5f;
+	}
+
+	const unsigned int Before = RealtimeCheck::GetViolationCount();
+	uint32_t PassesWritten = 0;
+	{
+		REALTIME_SCOPE();
+		for (uint32_t Block = 0; Block < BLOCK_COUNT; Block++)
+		{
+			// Circle the listener and rise, so that new filters are interpolated and crossfaded to
+			float Angle = Block * 0.05f;
+			float Height = -1.0f + 2.0f * Block / BLOCK_COUNT;
+			p_Voice->Process(Input, Binaural, BLOCK_SIZE, 2, sinf(Angle), Height, cosf(Angle), 1.0f, 0.8f);
+			p_Reverb->Process(Binaural, p_ReverbOutputs, BLOCK_SIZE);
+
+			if (p_Writer->BeginPass(Block, ObjectCaptureWriter::Now(), OBJECT_COUNT, BLOCK_SIZE))
+			{
+				for (uint32_t Object = 0; Object < OBJECT_COUNT; Object++)
+				{
+					p_Writer->AddObject(Object, OBJECT_CAPTURE_DYNAMIC, sinf(Angle), Height, cosf(Angle), 1.0f, ReverbOutputs[Object]);
+				}
+				p_Writer->EndPass();
+				PassesWritten++;
+			}
+		}
+	}
+	const unsigned int Violations = RealtimeCheck::GetViolationCount() - Before;
+
+	delete p_Writer;
+	delete p_Voice;
+	delete p_Database;
+	delete p_Reverb;
+	remove(DATABASE_PATH);
+	remove(CAPTURE_PATH);
+
+	if (Violations != 0)
+	{
+		// The first reports are the ones CheckDetection provoked
+		printf("Audio code: FAILED, %u violations in %u blocks\n", Violations, BLOCK_COUNT);
+		RealtimeCheck::PrintReports(stdout);
+		return 1;
+	}
+	printf("Audio code: ok, %u blocks, %u passes captured\n", BLOCK_COUNT, PassesWritten);
+	return 0;
+}
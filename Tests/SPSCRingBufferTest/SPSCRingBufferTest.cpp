@@ -0,0 +1,294 @@
+// Stress test for SPSCRingBuffer (AudioPluginUtil.h): a producer thread and a consumer thread pass numbered elements
+// through a small ring with each of the three policies, using every way of writing and reading, with the positions
+// starting just short of the 32-bit wraparound. The ring is header-only:
+//
+//   g++ -O2 -std=c++14 -pthread -I../.. -o SPSCRingBufferTest SPSCRingBufferTest.cpp
+//
+// Partial and AllOrNothing must deliver every element once and in order, and AllOrNothing must never transfer part of
+// a request. Overwrite may drop elements when the producer laps the consumer (the consumer is slowed down now and
+// then to make sure it does), but what does arrive must be whole and in order. Exits with 1 on any failure.
+
+#include <stdio.h>
+#include <thread>
+
+#include "../../AudioPluginUtil.h"
+
+#define RING_LENGTH 64
+#define ELEMENT_COUNT 4000000
+
+// Where the positions start, so that they wrap around early in the run
+#define START_POSITION (0u - 1000u)
+
+// Large enough that a copy racing with the producer would be caught half written
+struct Element
+{
+	unsigned int Sequence;
+	unsigned int Check[15];
+};
+
+static Element MakeElement(unsigned int Sequence)
+{
+	Element Result;
+	Result.Sequence = Sequence;
+	for (unsigned int i = 0; i < 15; i++)
+	{
+		Result.Check[i] = Sequence * (2 * i + 3) ^ 0x5a5a5a5au;
+	}
+	return Result;
+}
+
+static bool IsWhole(const Element& Value)
+{
+	for (unsigned int i = 0; i < 15; i++)
+	{
+		if (Value.Check[i] != (Value.Sequence * (2 * i + 3) ^ 0x5a5a5a5au))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Small deterministic generator, one per thread
+struct SequenceRandom
+{
+	unsigned int m_State;
+
+	int Next(int Range)
+	{
+		m_State = m_State * 1664525u + 1013904223u;
+		return (int)((m_State >> 8) % (unsigned int)Range);
+	}
+};
+
+template<SPSCRingBufferPolicy POLICY>
+class TestRing : public SPSCRingBuffer<RING_LENGTH, Element, POLICY>
+{
+public:
+	void StartAt(unsigned int Position)
+	{
+		this->writepos.store(Position, std::memory_order_relaxed);
+		this->writeclaim.store(Position, std::memory_order_relaxed);
+		this->readpos.store(Position, std::memory_order_relaxed);
+	}
+};
+
+struct Result
+{
+	unsigned int m_Received;
+	unsigned int m_Dropped;
+	const char* p_Error;
+	unsigned int m_ErrorSequence;
+};
+
+template<SPSCRingBufferPolicy POLICY>
+static void Produce(TestRing<POLICY>* p_Ring, std::atomic<bool>* p_Done)
+{
+	const bool Overwrite = (POLICY == SPSCRingBufferPolicy_Overwrite);
+	SequenceRandom Generator = { 1 };
+	static Element Chunk[RING_LENGTH * 2];
+	unsigned int Next = 0;
+	while (Next < ELEMENT_COUNT)
+	{
+		// Overwrite takes writes larger than the ring, of which only the newest elements are kept
+		int Count = 1 + Generator.Next(Overwrite ? (RING_LENGTH * 2) : RING_LENGTH);
+		if ((unsigned int)Count > ELEMENT_COUNT - Next)
+		{
+			Count = ELEMENT_COUNT - Next;
+		}
+
+		int Written;
+		if (Generator.Next(2) == 0)
+		{
+			for (int i = 0; i < Count; i++)
+			{
+				Chunk[i] = MakeElement(Next + i);
+			}
+			Written = p_Ring->Write(Chunk, Count);
+		}
+		else
+		{
+			Element* p_Region1; Element* p_Region2; int Count1, Count2;
+			Written = p_Ring->Reserve(Count, p_Region1, Count1, p_Region2, Count2);
+			for (int i = 0; i < Count1; i++)
+			{
+				p_Region1[i] = MakeElement(Next + i);
+			}
+			for (int i = 0; i < Count2; i++)
+			{
+				p_Region2[i] = MakeElement(Next + Count1 + i);
+			}
+			p_Ring->Commit(Written);
+		}
+
+		Next += Written;
+		if (Written == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+	p_Done->store(true, std::memory_order_release);
+}
+
+template<SPSCRingBufferPolicy POLICY>
+static bool Accept(Result& Outcome, unsigned int& Expected, const Element& Value)
+{
+	if (!IsWhole(Value))
+	{
+		Outcome.p_Error = "torn element";
+	}
+	else if (POLICY == SPSCRingBufferPolicy_Overwrite ? (Value.Sequence < Expected) : (Value.Sequence != Expected))
+	{
+		Outcome.p_Error = "out of order";
+	}
+	else
+	{
+		Outcome.m_Dropped += Value.Sequence - Expected;
+		Outcome.m_Received++;
+		Expected = Value.Sequence + 1;
+		return true;
+	}
+	Outcome.m_ErrorSequence = Value.Sequence;
+	return false;
+}
+
+// In-place Peek isn't available with the Overwrite policy, and Consume doesn't pick it for that one
+template<SPSCRingBufferPolicy POLICY>
+static void PeekInPlace(TestRing<POLICY>* p_Ring, int Count, int& Received, unsigned int& Expected, Result& Outcome)
+{
+	const Element* p_Region1; const Element* p_Region2; int Count1, Count2;
+	Received = p_Ring->Peek(p_Region1, Count1, p_Region2, Count2, Count);
+	for (int i = 0; i < Received; i++)
+	{
+		if (!Accept<POLICY>(Outcome, Expected, (i < Count1) ? p_Region1[i] : p_Region2[i - Count1]))
+		{
+			return;
+		}
+	}
+	p_Ring->Skip(Received);
+}
+
+static void PeekInPlace(TestRing<SPSCRingBufferPolicy_Overwrite>*, int, int& Received, unsigned int&, Result&)
+{
+	Received = 0;
+}
+
+template<SPSCRingBufferPolicy POLICY>
+static void Consume(TestRing<POLICY>* p_Ring, std::atomic<bool>* p_Done, Result* p_Outcome)
+{
+	SequenceRandom Generator = { 2 };
+	static Element Chunk[RING_LENGTH];
+	unsigned int Expected = 0;
+	for (;;)
+	{
+		// Read after checking whether the producer is done, so that nothing it wrote is missed at the end
+		bool Done = p_Done->load(std::memory_order_acquire);
+		int Count = 1 + Generator.Next(RING_LENGTH);
+		if (Done && Count > p_Ring->GetNumBuffered())
+		{
+			// What is left may be less than an AllOrNothing read asks for
+			Count = (p_Ring->GetNumBuffered() > 0) ? p_Ring->GetNumBuffered() : 1;
+		}
+		int Received = 0;
+		switch (Generator.Next(POLICY == SPSCRingBufferPolicy_Overwrite ? 2 : 3))
+		{
+			case 0:
+				Received = p_Ring->Read(Chunk, Count);
+				if (POLICY == SPSCRingBufferPolicy_AllOrNothing && Received != 0 && Received != Count)
+				{
+					p_Outcome->p_Error = "partial read";
+					return;
+				}
+				for (int i = 0; i < Received; i++)
+				{
+					if (!Accept<POLICY>(*p_Outcome, Expected, Chunk[i]))
+					{
+						return;
+					}
+				}
+				break;
+
+			case 1:
+				if (p_Ring->Peek(Chunk[0]))
+				{
+					p_Ring->Skip(1);
+					Received = 1;
+					if (!Accept<POLICY>(*p_Outcome, Expected, Chunk[0]))
+					{
+						return;
+					}
+				}
+				break;
+
+			default:
+				PeekInPlace(p_Ring, Count, Received, Expected, *p_Outcome);
+				if (p_Outcome->p_Error != nullptr)
+				{
+					return;
+				}
+				break;
+		}
+
+		if (Received == 0)
+		{
+			if (Done)
+			{
+				break;
+			}
+			std::this_thread::yield();
+		}
+
+		// Fall behind now and then, so that Overwrite gets lapped
+		if (POLICY == SPSCRingBufferPolicy_Overwrite && Generator.Next(16) == 0)
+		{
+			for (volatile int i = 0; i < 2000; i++)
+			{
+			}
+		}
+	}
+
+	if (p_Outcome->m_Received + p_Outcome->m_Dropped != ELEMENT_COUNT || Expected != ELEMENT_COUNT)
+	{
+		p_Outcome->p_Error = "missing the last elements";
+		p_Outcome->m_ErrorSequence = Expected;
+	}
+}
+
+template<SPSCRingBufferPolicy POLICY>
+static bool Run(const char* p_Name)
+{
+	static TestRing<POLICY> Ring;
+	Ring.StartAt(START_POSITION);
+	std::atomic<bool> Done(false);
+	Result Outcome = {};
+
+	std::thread Consumer(Consume<POLICY>, &Ring, &Done, &Outcome);
+	std::thread Producer(Produce<POLICY>, &Ring, &Done);
+	Producer.join();
+	Consumer.join();
+
+	bool Passed = (Outcome.p_Error == nullptr);
+	if (POLICY == SPSCRingBufferPolicy_Overwrite && Passed && Outcome.m_Dropped == 0)
+	{
+		Outcome.p_Error = "never lapped";
+		Passed = false;
+	}
+
+	if (Passed)
+	{
+		printf("%s: ok, %u received, %u dropped\n", p_Name, Outcome.m_Received, Outcome.m_Dropped);
+	}
+	else
+	{
+		printf("%s: FAILED, %s at element %u (%u received)\n", p_Name, Outcome.p_Error, Outcome.m_ErrorSequence, Outcome.m_Received);
+	}
+	return Passed;
+}
+
+int main()
+{
+	bool Passed = Run<SPSCRingBufferPolicy_Partial>("Partial");
+	Passed &= Run<SPSCRingBufferPolicy_AllOrNothing>("AllOrNothing");
+	Passed &= Run<SPSCRingBufferPolicy_Overwrite>("Overwrite");
+	return Passed ? 0 : 1;
+}
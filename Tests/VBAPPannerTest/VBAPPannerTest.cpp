@@ -0,0 +1,311 @@
+// Checks the VBAPPanner (AudioPluginUtil.h) the plugin pans its bed sources with, set up the way CreateBed does: with
+// LayOutBed over the 7.1.4 bed of ISAC_BED_MASK, at the speaker positions the replay tool's SimulatedSink reports. The
+// gains have to keep the total power at 1 in every direction, pan each test azimuth between the speakers either side of
+// it, crossfade between the ear level and the height speakers with elevation, and never reach the LFE channel. A layout
+// with only front speakers checks that sources in a gap wider than 180 degrees go to the speakers at its edges. Builds
+// anywhere AudioPluginUtil.cpp does; the plugin's effect callbacks aren't linked, hence the dead code stripping:
+//
+//   g++ -O2 -std=c++14 -ffunction-sections -Wl,--gc-sections -I../.. -o VBAPPannerTest VBAPPannerTest.cpp ../../AudioPluginUtil.cpp
+//
+// Exits with 1 if any check fails.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../Tools/ISACReplay/SimulatedSink.h"
+
+using namespace MSHRTFSpatializer;
+
+#define TOLERANCE 1e-4f
+#define RANDOM_DIRECTIONS 10000
+
+// The channels ISAC numbers the 7.1.4 bed with
+enum BedChannel
+{
+	FL, FR, FC, LFE, SL, SR, BL, BR, TFL, TFR, TBL, TBR,
+	BED_CHANNELS
+};
+
+static const char* CHANNEL_NAMES[BED_CHANNELS] = { "FL", "FR", "FC", "LFE", "SL", "SR", "BL", "BR", "TFL", "TFR", "TBL", "TBR" };
+
+// Azimuths at ear level, and the speakers either side of each, with the one at the lower azimuth first
+struct PairCase
+{
+	float Azimuth;
+	int Lower;
+	int Upper;
+	float LowerAzimuth;
+	float UpperAzimuth;
+};
+
+static const PairCase PAIR_CASES[] =
+{
+	{ 15.0f, FC, FL, 0.0f, 30.0f },
+	{ -10.0f, FR, FC, -30.0f, 0.0f },
+	{ 50.0f, FL, SL, 30.0f, 90.0f },
+	{ -60.0f, SR, FR, -90.0f, -30.0f },
+	{ 110.0f, SL, BL, 90.0f, 135.0f },
+	{ -100.0f, BR, SR, -135.0f, -90.0f },
+	{ 180.0f, BL, BR, 135.0f, 225.0f },
+	{ 160.0f, BL, BR, 135.0f, 225.0f },
+	{ -150.0f, BL, BR, 135.0f, 225.0f },
+};
+
+static const float DegreesToRadians = 3.14159265f / 180.0f;
+
+static float Random()
+{
+	return (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+}
+
+// The bed as CreateBed sets it up
+struct Bed
+{
+	AudioObjectType ChannelTypes[ISAC_BED_MAX_CHANNELS];
+	int SpeakerChannel[ISAC_BED_MAX_CHANNELS];
+	VBAPPanner Panner;
+	UINT32 ChannelCount;
+
+	// The gain of each bed channel for a source in the given direction, in degrees
+	void Pan(float Azimuth, float Elevation, float* p_ChannelGains) const
+	{
+		PanVector(cosf(Azimuth * DegreesToRadians) * cosf(Elevation * DegreesToRadians),
+			sinf(Azimuth * DegreesToRadians) * cosf(Elevation * DegreesToRadians),
+			sinf(Elevation * DegreesToRadians), p_ChannelGains);
+	}
+
+	void PanVector(float Front, float Left, float Up, float* p_ChannelGains) const
+	{
+		float Gains[VBAPPanner::MAXSPEAKERS];
+		Panner.ComputeGains(Front, Left, Up, Gains);
+		for (UINT32 Channel = 0; Channel < ChannelCount; Channel++)
+		{
+			p_ChannelGains[Channel] = 0.0f;
+		}
+		for (int Speaker = 0; Speaker < Panner.GetNumSpeakers(); Speaker++)
+		{
+			p_ChannelGains[SpeakerChannel[Speaker]] += Gains[Speaker];
+		}
+	}
+};
+
+static float Power(const float* p_Gains, int Count)
+{
+	float Sum = 0.0f;
+	for (int n = 0; n < Count; n++)
+	{
+		Sum += p_Gains[n] * p_Gains[n];
+	}
+	return Sum;
+}
+
+static bool CheckLayout(const Bed& Bed)
+{
+	if (Bed.ChannelCount != BED_CHANNELS || Bed.Panner.GetNumSpeakers() != BED_CHANNELS - 1)
+	{
+		printf("Layout: FAILED, %u channels and %d speakers, expected %d and %d\n", Bed.ChannelCount, Bed.Panner.GetNumSpeakers(),
+			BED_CHANNELS, BED_CHANNELS - 1);
+		return false;
+	}
+
+	for (int Speaker = 0; Speaker < Bed.Panner.GetNumSpeakers(); Speaker++)
+	{
+		if (Bed.ChannelTypes[Bed.SpeakerChannel[Speaker]] == AudioObjectType_LowFrequency)
+		{
+			printf("Layout: FAILED, speaker %d is the LFE channel\n", Speaker);
+			return false;
+		}
+	}
+
+	printf("Layout: ok\n");
+	return true;
+}
+
+// Constant power and no LFE in any direction, straight up and down included
+static bool CheckPower(const Bed& Bed)
+{
+	float Gains[BED_CHANNELS];
+	for (int n = 0; n < RANDOM_DIRECTIONS + 2; n++)
+	{
+		float Front = Random(), Left = Random(), Up = Random();
+		if (n >= RANDOM_DIRECTIONS)
+		{
+			Front = Left = 0.0f;
+			Up = (n == RANDOM_DIRECTIONS) ? 1.0f : -1.0f;
+		}
+		Bed.PanVector(Front, Left, Up, Gains);
+
+		float TotalPower = Power(Gains, BED_CHANNELS);
+		if (fabsf(TotalPower - 1.0f) > TOLERANCE || Gains[LFE] != 0.0f)
+		{
+			printf("Power: FAILED, direction (%g, %g, %g) has power %g and LFE gain %g\n", Front, Left, Up, TotalPower, Gains[LFE]);
+			return false;
+		}
+		for (int Channel = 0; Channel < BED_CHANNELS; Channel++)
+		{
+			if (Gains[Channel] < 0.0f)
+			{
+				printf("Power: FAILED, direction (%g, %g, %g) has gain %g on %s\n", Front, Left, Up, Gains[Channel], CHANNEL_NAMES[Channel]);
+				return false;
+			}
+		}
+	}
+
+	printf("Power: ok\n");
+	return true;
+}
+
+// At ear level only the two speakers either side of the source play, with the gains of pairwise VBAP
+static bool CheckPairs(const Bed& Bed)
+{
+	float Gains[BED_CHANNELS];
+	for (const PairCase& Case : PAIR_CASES)
+	{
+		Bed.Pan(Case.Azimuth, 0.0f, Gains);
+
+		float Azimuth = (Case.Azimuth < Case.LowerAzimuth) ? Case.Azimuth + 360.0f : Case.Azimuth;
+		float ExpectedLower = sinf((Case.UpperAzimuth - Azimuth) * DegreesToRadians);
+		float ExpectedUpper = sinf((Azimuth - Case.LowerAzimuth) * DegreesToRadians);
+		float Norm = sqrtf(ExpectedLower * ExpectedLower + ExpectedUpper * ExpectedUpper);
+
+		bool Ok = fabsf(Gains[Case.Lower] - ExpectedLower / Norm) <= TOLERANCE && fabsf(Gains[Case.Upper] - ExpectedUpper / Norm) <= TOLERANCE;
+		for (int Channel = 0; Channel < BED_CHANNELS; Channel++)
+		{
+			if (Channel != Case.Lower && Channel != Case.Upper && Gains[Channel] != 0.0f)
+			{
+				Ok = false;
+			}
+		}
+
+		if (!Ok)
+		{
+			printf("Pairs: FAILED, azimuth %g expected %s %g and %s %g, got", Case.Azimuth, CHANNEL_NAMES[Case.Lower], ExpectedLower / Norm,
+				CHANNEL_NAMES[Case.Upper], ExpectedUpper / Norm);
+			for (int Channel = 0; Channel < BED_CHANNELS; Channel++)
+			{
+				if (Gains[Channel] != 0.0f)
+				{
+					printf(" %s %g", CHANNEL_NAMES[Channel], Gains[Channel]);
+				}
+			}
+			printf("\n");
+			return false;
+		}
+	}
+
+	// Right on a speaker, only that speaker plays
+	Bed.Pan(30.0f, 0.0f, Gains);
+	if (fabsf(Gains[FL] - 1.0f) > TOLERANCE || fabsf(Power(Gains, BED_CHANNELS) - 1.0f) > TOLERANCE)
+	{
+		printf("Pairs: FAILED, azimuth 30 gives FL %g\n", Gains[FL]);
+		return false;
+	}
+
+	printf("Pairs: ok\n");
+	return true;
+}
+
+// Between the layers the power moves from the ear level speakers to the height speakers as cos and sin of the elevation
+// as a fraction of the way up, and above the height speakers stays with them
+static bool CheckElevation(const Bed& Bed)
+{
+	static const int EAR_LEVEL[] = { FL, FR, FC, SL, SR, BL, BR };
+	static const int HEIGHT[] = { TFL, TFR, TBL, TBR };
+
+	float Gains[BED_CHANNELS];
+	for (float Azimuth : { 45.0f, -20.0f, 170.0f })
+	{
+		for (float Elevation = -30.0f; Elevation <= 80.0f; Elevation += 2.5f)
+		{
+			Bed.Pan(Azimuth, Elevation, Gains);
+
+			float EarPower = 0.0f, HeightPower = 0.0f;
+			for (int Channel : EAR_LEVEL)
+			{
+				EarPower += Gains[Channel] * Gains[Channel];
+			}
+			for (int Channel : HEIGHT)
+			{
+				HeightPower += Gains[Channel] * Gains[Channel];
+			}
+
+			float t = (Elevation < 0.0f) ? 0.0f : (Elevation > 45.0f) ? 1.0f : Elevation / 45.0f;
+			float ExpectedEar = cosf(t * 3.14159265f * 0.5f);
+			ExpectedEar *= ExpectedEar;
+			if (fabsf(EarPower - ExpectedEar) > 1e-3f || fabsf(HeightPower - (1.0f - ExpectedEar)) > 1e-3f)
+			{
+				printf("Elevation: FAILED, azimuth %g elevation %g has power %g at ear level and %g above, expected %g and %g\n",
+					Azimuth, Elevation, EarPower, HeightPower, ExpectedEar, 1.0f - ExpectedEar);
+				return false;
+			}
+		}
+	}
+
+	printf("Elevation: ok\n");
+	return true;
+}
+
+// Three speakers across the front leave 300 degrees without one: sources there have to go to the nearest front speaker
+static bool CheckGap()
+{
+	const float Azimuths[] = { -30.0f, 0.0f, 30.0f };
+	const float Elevations[] = { 0.0f, 0.0f, 0.0f };
+	VBAPPanner Panner;
+	Panner.Init(Azimuths, Elevations, 3);
+
+	float Gains[3];
+	for (float Azimuth = 35.0f; Azimuth <= 325.0f; Azimuth += 5.0f)
+	{
+		Panner.ComputeGains(cosf(Azimuth * DegreesToRadians), sinf(Azimuth * DegreesToRadians), 0.0f, Gains);
+
+		const int Nearest = (Azimuth < 180.0f) ? 2 : (Azimuth > 180.0f) ? 0 : -1;
+		bool Ok = fabsf(Power(Gains, 3) - 1.0f) <= TOLERANCE && Gains[0] >= 0.0f && Gains[1] == 0.0f && Gains[2] >= 0.0f;
+		if (Nearest >= 0 && Gains[Nearest] < Gains[2 - Nearest])
+		{
+			Ok = false;
+		}
+		if (!Ok)
+		{
+			printf("Gap: FAILED, azimuth %g gives %g %g %g\n", Azimuth, Gains[0], Gains[1], Gains[2]);
+			return false;
+		}
+	}
+
+	// Two speakers facing each other leave two gaps of exactly 180 degrees, and no pair at all
+	const float FacingAzimuths[] = { 90.0f, -90.0f };
+	Panner.Init(FacingAzimuths, Elevations, 2);
+	for (float Azimuth = -180.0f; Azimuth < 180.0f; Azimuth += 5.0f)
+	{
+		Panner.ComputeGains(cosf(Azimuth * DegreesToRadians), sinf(Azimuth * DegreesToRadians), 0.0f, Gains);
+
+		const float Expected = sinf((Azimuth + 90.0f) * 0.5f * DegreesToRadians);
+		if (fabsf(Power(Gains, 2) - 1.0f) > TOLERANCE || fabsf(Gains[0] - fabsf(Expected)) > TOLERANCE)
+		{
+			printf("Gap: FAILED, azimuth %g between speakers at 90 and -90 gives %g %g\n", Azimuth, Gains[0], Gains[1]);
+			return false;
+		}
+	}
+
+	printf("Gap: ok\n");
+	return true;
+}
+
+int main()
+{
+	srand(1);
+
+	SimulatedSink Sink(0);
+	Bed Bed;
+	Bed.ChannelCount = LayOutBed(&Sink, ISAC_BED_MASK, Bed.ChannelTypes, Bed.SpeakerChannel, Bed.Panner);
+	if (!CheckLayout(Bed))
+	{
+		return 1;
+	}
+
+	bool Ok = CheckPower(Bed);
+	Ok = CheckPairs(Bed) && Ok;
+	Ok = CheckElevation(Bed) && Ok;
+	Ok = CheckGap() && Ok;
+	return Ok ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// Converts a SOFA file of head-related impulse responses (the SimpleFreeFieldHRIR convention) into an HRIR database for
+// the plugin's software binaural mode (see HrirDatabase.h). SOFA files are netCDF-4 files, so this needs the netCDF C
+// library, which most package managers have (libnetcdf-dev, netcdf from Homebrew or vcpkg):
+//
+//   g++ -O2 -std=c++11 -o HrirConverter HrirConverter.cpp -lnetcdf
+//
+//   HrirConverter <sofa file> <database> [-length <taps>]
+//
+// -length is how many taps of each response are kept after its onset (128 by default, at most HRIR_MAX_LENGTH).
+//
+// The onset of each response is found and cut off, and kept as that ear's delay along with the delay in the SOFA file,
+// less the earliest onset of all. The last taps kept are faded out. Directions are grouped into rings of equal
+// elevation (to a hundredth of a degree), and the taps are stored as 16-bit integers with one scale for the database.
+// The sample rate is kept: the plugin only renders binaurally when it matches the output's.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <netcdf.h>
+
+#include "../../HrirDatabase.h"
+
+using namespace MSHRTFSpatializer;
+
+// Taps kept before the first one within ONSET_THRESHOLD of the peak, so that the onset itself isn't cut
+#define ONSET_LEAD 4
+#define ONSET_THRESHOLD 0.1
+
+// Taps at the end of each response that are faded out
+#define FADE_LENGTH 16
+
+struct Direction
+{
+	int32_t Azimuth;		// In hundredths of a degree, in [0, 36000)
+	int32_t Elevation;
+	uint32_t Measurement;
+	float Delays[2];
+	std::vector<float> Taps[2];
+};
+
+static bool GetDimension(int File, const char* p_Name, size_t* p_Length)
+{
+	int Id;
+	return nc_inq_dimid(File, p_Name, &Id) == NC_NOERR && nc_inq_dimlen(File, Id, p_Length) == NC_NOERR;
+}
+
+// Reads a whole variable as doubles, with the lengths of its dimensions
+static bool GetVariable(int File, const char* p_Name, std::vector<double>& Values, std::vector<size_t>& Dimensions)
+{
+	int Id, DimensionCount;
+	if (nc_inq_varid(File, p_Name, &Id) != NC_NOERR || nc_inq_varndims(File, Id, &DimensionCount) != NC_NOERR)
+		return false;
+
+	std::vector<int> DimensionIds(DimensionCount);
+	nc_inq_vardimid(File, Id, DimensionIds.data());
+
+	size_t Count = 1;
+	Dimensions.resize(DimensionCount);
+	for (int i = 0; i < DimensionCount; i++)
+	{
+		nc_inq_dimlen(File, DimensionIds[i], &Dimensions[i]);
+		Count *= Dimensions[i];
+	}
+
+	Values.resize(Count);
+	return nc_get_var_double(File, Id, Values.data()) == NC_NOERR;
+}
+
+static std::string GetTextAttribute(int File, const char* p_Variable, const char* p_Name)
+{
+	int Id;
+	size_t Length;
+	if (nc_inq_varid(File, p_Variable, &Id) != NC_NOERR || nc_inq_attlen(File, Id, p_Name, &Length) != NC_NOERR)
+		return std::string();
+
+	std::string Value(Length, '\0');
+	nc_get_att_text(File, Id, p_Name, &Value[0]);
+	return Value.c_str();
+}
+
+// Cuts a response down to Length taps from just before its onset, and returns where it was cut
+static uint32_t AlignResponse(const double* p_Response, size_t N, uint32_t Length, std::vector<float>& Taps)
+{
+	double Peak = 0.0;
+	for (size_t n = 0; n < N; n++)
+		Peak = std::max(Peak, fabs(p_Response[n]));
+
+	size_t Onset = 0;
+	while (Onset < N && fabs(p_Response[Onset]) < Peak * ONSET_THRESHOLD)
+		Onset++;
+
+	size_t Start = (Onset > ONSET_LEAD) ? Onset - ONSET_LEAD : 0;
+	Taps.assign(Length, 0.0f);
+	for (uint32_t n = 0; n < Length && Start + n < N; n++)
+		Taps[n] = (float)p_Response[Start + n];
+
+	uint32_t Fade = std::min<uint32_t>(FADE_LENGTH, Length);
+	for (uint32_t n = 0; n < Fade; n++)
+		Taps[Length - Fade + n] *= 0.5f * (1.0f + cosf(3.14159265f * (float)(n + 1) / (float)Fade));
+
+	return (uint32_t)Start;
+}
+
+int main(int argc, char** argv)
+{
+	const char* p_SofaPath = nullptr;
+	const char* p_DatabasePath = nullptr;
+	uint32_t Length = 128;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-length") == 0 && i + 1 < argc)
+			Length = (uint32_t)atoi(argv[++i]);
+		else if (p_SofaPath == nullptr)
+			p_SofaPath = argv[i];
+		else
+			p_DatabasePath = argv[i];
+	}
+
+	if (p_SofaPath == nullptr || p_DatabasePath == nullptr || Length == 0 || Length > HRIR_MAX_LENGTH)
+	{
+		printf("Usage: HrirConverter <sofa file> <database> [-length <taps>]\n");
+		printf("       taps is 1 to %u\n", (unsigned)HRIR_MAX_LENGTH);
+		return 1;
+	}
+
+	int File;
+	if (nc_open(p_SofaPath, NC_NOWRITE, &File) != NC_NOERR)
+	{
+		printf("Can't open %s\n", p_SofaPath);
+		return 1;
+	}
+
+	size_t M, R, N;
+	std::vector<double> IR, SampleRate, Positions, Delays;
+	std::vector<size_t> IRDimensions, SampleRateDimensions, PositionDimensions, DelayDimensions;
+	if (!GetDimension(File, "M", &M) || !GetDimension(File, "R", &R) || !GetDimension(File, "N", &N) || R != 2 ||
+		!GetVariable(File, "Data.IR", IR, IRDimensions) || IR.size() != M * R * N ||
+		!GetVariable(File, "Data.SamplingRate", SampleRate, SampleRateDimensions) || SampleRate.empty() ||
+		!GetVariable(File, "SourcePosition", Positions, PositionDimensions) || Positions.size() % 3 != 0)
+	{
+		printf("%s doesn't hold two-ear impulse responses with source positions\n", p_SofaPath);
+		return 1;
+	}
+
+	// Delays and positions are either per measurement or the same for all of them
+	if (!GetVariable(File, "Data.Delay", Delays, DelayDimensions))
+		Delays.assign(2, 0.0);
+	bool DelayPerMeasurement = Delays.size() == M * 2;
+	bool PositionPerMeasurement = Positions.size() == M * 3;
+	bool Cartesian = GetTextAttribute(File, "SourcePosition", "Type") == "cartesian";
+	nc_close(File);
+
+	std::map<std::pair<int32_t, int32_t>, Direction> Directions;
+	float EarliestDelay = 1e30f;
+	for (size_t m = 0; m < M; m++)
+	{
+		const double* p_Position = &Positions[PositionPerMeasurement ? m * 3 : 0];
+		double Azimuth = p_Position[0];
+		double Elevation = p_Position[1];
+		if (Cartesian)
+		{
+			// x to the front, y to the left, z up
+			Azimuth = atan2(p_Position[1], p_Position[0]) * 180.0 / 3.14159265358979;
+			Elevation = atan2(p_Position[2], sqrt(p_Position[0] * p_Position[0] + p_Position[1] * p_Position[1])) * 180.0 / 3.14159265358979;
+		}
+
+		Direction Measured;
+		Measured.Azimuth = (int32_t)floor(Azimuth * 100.0 + 0.5) % 36000;
+		Measured.Azimuth += (Measured.Azimuth < 0) ? 36000 : 0;
+		Measured.Elevation = (int32_t)floor(Elevation * 100.0 + 0.5);
+		Measured.Measurement = (uint32_t)m;
+
+		for (int Ear = 0; Ear < 2; Ear++)
+		{
+			uint32_t Start = AlignResponse(&IR[(m * 2 + Ear) * N], N, Length, Measured.Taps[Ear]);
+			Measured.Delays[Ear] = (float)Start + (float)Delays[DelayPerMeasurement ? m * 2 + Ear : Ear];
+			EarliestDelay = std::min(EarliestDelay, Measured.Delays[Ear]);
+		}
+
+		std::pair<int32_t, int32_t> Key(Measured.Elevation, Measured.Azimuth);
+		if (Directions.count(Key) != 0)
+		{
+			printf("Measurement %zu repeats the direction of measurement %u; keeping the first\n", m, Directions[Key].Measurement);
+			continue;
+		}
+		Directions[Key] = Measured;
+	}
+
+	// The map is in order of elevation, then azimuth, which is the order of the database
+	std::vector<HrirFileRing> Rings;
+	std::vector<HrirFileDirection> FileDirections;
+	float Peak = 0.0f;
+	for (std::map<std::pair<int32_t, int32_t>, Direction>::iterator i = Directions.begin(); i != Directions.end(); ++i)
+	{
+		Direction& Measured = i->second;
+		if (Rings.empty() || Rings.back().Elevation != (float)Measured.Elevation / 100.0f)
+		{
+			HrirFileRing Ring = { (float)Measured.Elevation / 100.0f, (uint32_t)FileDirections.size(), 0, 0 };
+			Rings.push_back(Ring);
+		}
+		Rings.back().DirectionCount++;
+
+		HrirFileDirection FileDirection = { (float)Measured.Azimuth / 100.0f, Measured.Delays[0] - EarliestDelay, Measured.Delays[1] - EarliestDelay, 0 };
+		if (FileDirection.DelayLeft > HRIR_MAX_DELAY || FileDirection.DelayRight > HRIR_MAX_DELAY)
+		{
+			printf("Measurement %u is delayed more than %.0f samples; the delay is cut short\n", Measured.Measurement, HRIR_MAX_DELAY);
+			FileDirection.DelayLeft = std::min(FileDirection.DelayLeft, HRIR_MAX_DELAY);
+			FileDirection.DelayRight = std::min(FileDirection.DelayRight, HRIR_MAX_DELAY);
+		}
+		FileDirections.push_back(FileDirection);
+
+		for (int Ear = 0; Ear < 2; Ear++)
+			for (uint32_t n = 0; n < Length; n++)
+				Peak = std::max(Peak, fabsf(Measured.Taps[Ear][n]));
+	}
+
+	HrirFileHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = HRIR_DATABASE_MAGIC;
+	Header.Version = HRIR_DATABASE_VERSION;
+	Header.SampleRate = (uint32_t)floor(SampleRate[0] + 0.5);
+	Header.Length = Length;
+	Header.RingCount = (uint32_t)Rings.size();
+	Header.DirectionCount = (uint32_t)FileDirections.size();
+	Header.Scale = (Peak > 0.0f) ? Peak / 32767.0f : 1.0f;
+
+	std::vector<int16_t> Taps;
+	Taps.reserve(FileDirections.size() * 2 * Length);
+	for (std::map<std::pair<int32_t, int32_t>, Direction>::iterator i = Directions.begin(); i != Directions.end(); ++i)
+		for (int Ear = 0; Ear < 2; Ear++)
+			for (uint32_t n = 0; n < Length; n++)
+				Taps.push_back((int16_t)floorf(i->second.Taps[Ear][n] / Header.Scale + 0.5f));
+
+	FILE* p_File = fopen(p_DatabasePath, "wb");
+	if (p_File == nullptr)
+	{
+		printf("Can't create %s\n", p_DatabasePath);
+		return 1;
+	}
+
+	bool Written = fwrite(&Header, sizeof(Header), 1, p_File) == 1 &&
+		fwrite(Rings.data(), sizeof(HrirFileRing), Rings.size(), p_File) == Rings.size() &&
+		fwrite(FileDirections.data(), sizeof(HrirFileDirection), FileDirections.size(), p_File) == FileDirections.size() &&
+		fwrite(Taps.data(), sizeof(int16_t), Taps.size(), p_File) == Taps.size();
+	if (fclose(p_File) != 0 || !Written)
+	{
+		printf("Can't write %s\n", p_DatabasePath);
+		return 1;
+	}
+
+	printf("%u directions on %u rings, %u taps at %u Hz: %zu bytes\n", Header.DirectionCount, Header.RingCount, Length, Header.SampleRate,
+		sizeof(Header) + Rings.size() * sizeof(HrirFileRing) + FileDirections.size() * sizeof(HrirFileDirection) + Taps.size() * sizeof(int16_t));
+	return 0;
+}
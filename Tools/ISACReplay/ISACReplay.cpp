@@ -0,0 +1,899 @@
+// Plays a capture written by the plugin (see CAPTURE_ENVIRONMENT_VARIABLE) back through the plugin's callbacks and its
+// pump, against a simulated sink instead of ISAC. The replay is deterministic: the pump runs on the DSP clock of the
+// capture, not on a timer, so two replays of the same capture with the same build produce the same checksum.
+//
+//   ISACReplay <capture> [-realtime] [-objects <count>] [-latency <frames>] [-record <object capture>] [-threads <count>]
+//   ISACReplay -fillbench <threads> [-objects <count>]
+//   ISACReplay -lockbench <threads>
+//   ISACReplay -binauralbench <database> [-voices <count>]
+//   ISACReplay -ingestbench
+//   ISACReplay -transferbench
+//
+// -realtime paces the callbacks by the timestamps in the capture instead of running as fast as possible.
+// -objects is the number of dynamic objects the simulated sink offers (16 by default).
+// -latency is how far, in frames, the pump trails Unity's DSP clock (960 by default).
+// -record writes what the pump hands the simulated sink to an object capture (see ObjectCapture.h).
+// -threads is how many threads fill the dynamic objects of each pump (see SetObjectFillThreads).
+//
+// -fillbench needs no capture: it plays a tone through as many sources as there are dynamic objects and times the pump
+// with their objects filled on 1 thread, then 2, and so on up to the given count.
+//
+// -lockbench needs no capture either: 1 thread, then 2, and so on up to the given count, copy blocks into a buffer under
+// a kernel mutex, a critical section and an AudioMutex, then with AudioMutex's try path (see MutexScopeTryLock), which
+// skips the copy rather than wait. It prints how long taking the lock took and how many copies the try path skipped.
+//
+// -binauralbench needs no capture either: it renders sources circling the listener (64 by default) with the software
+// binaural renderer and the given HRIR database (see HrirDatabase.h), on one thread, and prints how long each DSP block
+// took and how many voices one core could keep up with.
+//
+// -ingestbench needs no capture either: for each DSP buffer size ProcessCallback has a specialized ingest kernel for, it
+// times that kernel and the generic one on the same blocks of stereo input, and prints how much faster the specialized
+// one is.
+//
+// -transferbench needs no capture either: for 64, 128 and 256 sources, it moves blocks of stereo input through a ring
+// per source and back out a pump at a time, the way ProcessCallback and the pump did before the audio moved to pooled
+// blocks, once with RingWrite, RingFill and RingRead (two contiguous spans per transfer) and once a sample at a time
+// with a wrapped index, and prints how long each pump's worth took.
+//
+// The Debug build defines REALTIME_CHECK (see RealtimeCheck.h): the callbacks and the pump are checked for allocations,
+// locks, waits and sleeps, and the replay prints each one with its stack and exits with 2 if there were any.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <windows.h>
+
+#include "../../AudioPluginUtil.h"
+#include "../../SpatializerCapture.h"
+#include "../../RecordingSink.h"
+#include "../../RealtimeCheck.h"
+#include "../../BinauralRenderer.h"
+#include "SimulatedSink.h"
+
+using namespace MSHRTFSpatializer;
+
+// One plugin instance of the capture, with the state Unity would hand it
+struct ReplaySource
+{
+	UnityAudioEffectState State;
+	UnityAudioSpatializerData SpatializerData;
+	float Params[CAPTURE_MAX_PARAMS];
+	std::vector<float> InBuffer;
+	std::vector<float> OutBuffer;
+};
+
+// Time spent in one kind of call
+struct ReplayTiming
+{
+	UINT64 Calls = 0;
+	INT64 Total = 0;
+	INT64 Max = 0;
+
+	void Add(INT64 Ticks)
+	{
+		Calls++;
+		Total += Ticks;
+		Max = (Ticks > Max) ? Ticks : Max;
+	}
+
+	void Print(const char* p_Name, INT64 Frequency) const
+	{
+		double Scale = 1.0e6 / (double)Frequency;
+		printf("%-10s %10llu calls  %10.2f us avg  %10.2f us max\n", p_Name, Calls, Calls ? (double)Total * Scale / (double)Calls : 0.0, (double)Max * Scale);
+	}
+};
+
+static UnityAudioEffectDefinition* FindSpatializer()
+{
+	UnityAudioEffectDefinition** pp_Definitions = nullptr;
+	int NumDefinitions = UnityGetAudioEffectDefinitions(&pp_Definitions);
+	UnityAudioEffectDefinition* p_Spatializer = nullptr;
+	for (int i = 0; i < NumDefinitions; i++)
+	{
+		if (pp_Definitions[i]->flags & UnityAudioEffectDefinitionFlags_IsSpatializer)
+			p_Spatializer = pp_Definitions[i];
+	}
+	return p_Spatializer;
+}
+
+static int RunFillBenchmark(UINT32 DynamicObjectCount, UINT32 MaxThreads)
+{
+	const UINT32 SampleRate = 48000;
+	const UINT32 WarmupPasses = 100;
+	const UINT32 TimedPasses = 3000;
+
+	SimulatedSink Sink(DynamicObjectCount);
+	AttachSimulatedSink(&Sink, DynamicObjectCount, SampleRate);
+
+	UnityAudioEffectDefinition* p_Spatializer = FindSpatializer();
+	if (p_Spatializer == nullptr)
+	{
+		printf("No spatializer in this build\n");
+		return 1;
+	}
+
+	DenormalGuard Denormals;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	// Point sources on a ring around the listener, each playing its own tone
+	std::vector<ReplaySource*> Sources(DynamicObjectCount);
+	for (UINT32 Index = 0; Index < DynamicObjectCount; Index++)
+	{
+		ReplaySource* p_Source = new ReplaySource;
+		memset(&p_Source->State, 0, sizeof(p_Source->State));
+		memset(&p_Source->SpatializerData, 0, sizeof(p_Source->SpatializerData));
+
+		p_Source->State.structsize = sizeof(UnityAudioEffectState);
+		p_Source->State.samplerate = SampleRate;
+		p_Source->State.internal = p_Source;
+		p_Source->State.spatializerdata = &p_Source->SpatializerData;
+		p_Source->State.dspbuffersize = SIMULATED_FRAME_COUNT;
+		p_Source->State.hostapiversion = UNITY_AUDIO_PLUGIN_API_VERSION;
+		p_Source->State.flags = UnityAudioEffectStateFlags_IsPlaying;
+
+		float Angle = 2.0f * kPI * (float)Index / (float)DynamicObjectCount;
+		float* p_Listener = p_Source->SpatializerData.listenermatrix;
+		float* p_Position = p_Source->SpatializerData.sourcematrix;
+		p_Listener[0] = p_Listener[5] = p_Listener[10] = p_Listener[15] = 1.0f;
+		p_Position[0] = p_Position[5] = p_Position[10] = p_Position[15] = 1.0f;
+		p_Position[12] = 2.0f * sinf(Angle);
+		p_Position[14] = 2.0f * cosf(Angle);
+		p_Source->SpatializerData.spatialblend = 1.0f;
+
+		float Step = 2.0f * kPI * (220.0f + 10.0f * (float)Index) / (float)SampleRate;
+		p_Source->InBuffer.resize(SIMULATED_FRAME_COUNT * 2);
+		p_Source->OutBuffer.resize(SIMULATED_FRAME_COUNT * 2);
+		for (UINT32 Frame = 0; Frame < SIMULATED_FRAME_COUNT; Frame++)
+		{
+			p_Source->InBuffer[Frame * 2] = p_Source->InBuffer[Frame * 2 + 1] = 0.25f * sinf(Step * (float)Frame);
+		}
+
+		p_Spatializer->create(&p_Source->State);
+		Sources[Index] = p_Source;
+	}
+
+	// Each pass is a DSP block of every source and the pump that sends it on. The sources start a block ahead, which
+	// is the slack the pump keeps.
+	UINT64 DspTick = 0;
+	BOOL Primed = FALSE;
+	double SerialAverage = 0.0;
+
+	printf("%u dynamic objects, %u passes per thread count\n", DynamicObjectCount, TimedPasses);
+	for (UINT32 ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount++)
+	{
+		SetObjectFillThreads(ThreadCount);
+
+		ReplayTiming PumpTiming;
+		for (UINT32 Pass = 0; Pass < WarmupPasses + TimedPasses; Pass++)
+		{
+			for (UINT32 Block = 0; Block < (Primed ? 1u : 2u); Block++)
+			{
+				for (UINT32 Index = 0; Index < DynamicObjectCount; Index++)
+				{
+					ReplaySource* p_Source = Sources[Index];
+					p_Source->State.prevdsptick = p_Source->State.currdsptick;
+					p_Source->State.currdsptick = DspTick;
+					p_Spatializer->process(&p_Source->State, p_Source->InBuffer.data(), p_Source->OutBuffer.data(), SIMULATED_FRAME_COUNT, 2, 2);
+				}
+				DspTick += SIMULATED_FRAME_COUNT;
+			}
+			Primed = TRUE;
+
+			INT64 Start = CaptureRecorder::Now();
+			PumpOnce(&Sink);
+			if (Pass >= WarmupPasses)
+				PumpTiming.Add(CaptureRecorder::Now() - Start);
+		}
+
+		double Average = (double)PumpTiming.Total * 1.0e6 / (double)Frequency.QuadPart / (double)PumpTiming.Calls;
+		if (ThreadCount == 1)
+			SerialAverage = Average;
+
+		char Name[32];
+		sprintf_s(Name, "%u thread%s", ThreadCount, (ThreadCount == 1) ? "" : "s");
+		PumpTiming.Print(Name, Frequency.QuadPart);
+		printf("%-10s %.2fx the speed of 1 thread\n", "", SerialAverage / Average);
+	}
+
+	SetObjectFillThreads(1);
+	printf("At most %u of %u dynamic objects in use\n", Sink.GetMaxObjectsInUse(), DynamicObjectCount);
+
+	for (UINT32 Index = 0; Index < DynamicObjectCount; Index++)
+	{
+		p_Spatializer->release(&Sources[Index]->State);
+		delete Sources[Index];
+	}
+	return 0;
+}
+
+// The locks the lock benchmark compares: the kernel mutex the plugin used to take on its audio threads, the critical
+// section AudioMutex used to wrap, and AudioMutex
+struct KernelMutexLock
+{
+	HANDLE m_Mutex = CreateMutex(nullptr, FALSE, nullptr);
+	~KernelMutexLock() { CloseHandle(m_Mutex); }
+	BOOL TryLock() { return WaitForSingleObject(m_Mutex, 0) == WAIT_OBJECT_0; }
+	void Lock() { WaitForSingleObject(m_Mutex, INFINITE); }
+	void Unlock() { ReleaseMutex(m_Mutex); }
+};
+
+struct CriticalSectionLock
+{
+	CRITICAL_SECTION m_Section;
+	CriticalSectionLock() { InitializeCriticalSection(&m_Section); }
+	~CriticalSectionLock() { DeleteCriticalSection(&m_Section); }
+	BOOL TryLock() { return TryEnterCriticalSection(&m_Section); }
+	void Lock() { EnterCriticalSection(&m_Section); }
+	void Unlock() { LeaveCriticalSection(&m_Section); }
+};
+
+struct AudioMutexLock
+{
+	AudioMutex m_Mutex;
+	BOOL TryLock() { return m_Mutex.TryLock(); }
+	void Lock() { m_Mutex.Lock(); }
+	void Unlock() { m_Mutex.Unlock(); }
+};
+
+const UINT32 LOCK_BENCH_ITERATIONS = 200000;
+const UINT32 LOCK_BENCH_BLOCK = 256;
+
+// One thread of the lock benchmark. Like CaptureRecorder::Append on Unity's mixer threads, it copies a block into a
+// buffer shared under the lock, with a block of work of its own in between. With TryOnly it skips the copy instead of
+// waiting whenever the lock is taken.
+template<typename LOCK>
+struct LockContender
+{
+	LOCK* p_Lock;
+	float* p_Shared;
+	volatile LONG* p_Start;
+	BOOL m_TryOnly;
+	ReplayTiming m_Acquire;
+	UINT64 m_Skipped = 0;
+
+	static DWORD WINAPI Main(LPVOID p_Param)
+	{
+		LockContender* p_Contender = (LockContender*)p_Param;
+		float Block[LOCK_BENCH_BLOCK] = { 0.0f };
+		float Work[LOCK_BENCH_BLOCK];
+
+		while (InterlockedCompareExchange(p_Contender->p_Start, 0, 0) == 0)
+		{
+			YieldProcessor();
+		}
+
+		for (UINT32 Iteration = 0; Iteration < LOCK_BENCH_ITERATIONS; Iteration++)
+		{
+			INT64 Start = CaptureRecorder::Now();
+			if (p_Contender->m_TryOnly)
+			{
+				if (!p_Contender->p_Lock->TryLock())
+				{
+					p_Contender->m_Skipped++;
+					continue;
+				}
+			}
+			else
+			{
+				p_Contender->p_Lock->Lock();
+			}
+			p_Contender->m_Acquire.Add(CaptureRecorder::Now() - Start);
+
+			Block[0] = (float)Iteration;
+			memcpy(p_Contender->p_Shared, Block, sizeof(Block));
+			p_Contender->p_Lock->Unlock();
+
+			for (UINT32 n = 0; n < LOCK_BENCH_BLOCK; n++)
+			{
+				Work[n] = Block[n] * 0.5f + (float)n;
+			}
+			Block[1] = Work[LOCK_BENCH_BLOCK - 1];
+		}
+		return 0;
+	}
+};
+
+// Runs ThreadCount contenders on one lock and prints how long they took to get it
+template<typename LOCK>
+static void RunLockContenders(const char* p_Name, UINT32 ThreadCount, BOOL TryOnly, INT64 Frequency)
+{
+	LOCK Lock;
+	static float Shared[LOCK_BENCH_BLOCK];
+	volatile LONG Start = 0;
+
+	std::vector<LockContender<LOCK>> Contenders(ThreadCount);
+	std::vector<HANDLE> Threads(ThreadCount);
+	for (UINT32 Index = 0; Index < ThreadCount; Index++)
+	{
+		Contenders[Index].p_Lock = &Lock;
+		Contenders[Index].p_Shared = Shared;
+		Contenders[Index].p_Start = &Start;
+		Contenders[Index].m_TryOnly = TryOnly;
+		Threads[Index] = CreateThread(nullptr, 0, LockContender<LOCK>::Main, &Contenders[Index], 0, nullptr);
+	}
+
+	INT64 WallStart = CaptureRecorder::Now();
+	InterlockedExchange(&Start, 1);
+
+	ReplayTiming Acquire;
+	UINT64 Skipped = 0;
+	for (UINT32 Index = 0; Index < ThreadCount; Index++)
+	{
+		WaitForSingleObject(Threads[Index], INFINITE);
+		CloseHandle(Threads[Index]);
+
+		Acquire.Calls += Contenders[Index].m_Acquire.Calls;
+		Acquire.Total += Contenders[Index].m_Acquire.Total;
+		Acquire.Max = (Contenders[Index].m_Acquire.Max > Acquire.Max) ? Contenders[Index].m_Acquire.Max : Acquire.Max;
+		Skipped += Contenders[Index].m_Skipped;
+	}
+	double WallMs = (double)(CaptureRecorder::Now() - WallStart) * 1000.0 / (double)Frequency;
+
+	Acquire.Print(p_Name, Frequency);
+	printf("%-10s %10llu skipped  %10.2f ms in all\n", "", Skipped, WallMs);
+}
+
+static int RunLockBenchmark(UINT32 MaxThreads)
+{
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	printf("%u lock/copy/unlock rounds per thread\n", LOCK_BENCH_ITERATIONS);
+	for (UINT32 ThreadCount = 1; ThreadCount <= MaxThreads; ThreadCount++)
+	{
+		printf("%u thread%s\n", ThreadCount, (ThreadCount == 1) ? "" : "s");
+		RunLockContenders<KernelMutexLock>("Mutex", ThreadCount, FALSE, Frequency.QuadPart);
+		RunLockContenders<CriticalSectionLock>("CritSect", ThreadCount, FALSE, Frequency.QuadPart);
+		RunLockContenders<AudioMutexLock>("AudioMtx", ThreadCount, FALSE, Frequency.QuadPart);
+		RunLockContenders<AudioMutexLock>("TryLock", ThreadCount, TRUE, Frequency.QuadPart);
+	}
+	return 0;
+}
+
+static int RunBinauralBenchmark(const char* p_DatabasePath, UINT32 VoiceCount)
+{
+	HrirDatabase* p_Database = HrirDatabase::Open(p_DatabasePath);
+	if (p_Database == nullptr)
+	{
+		printf("Can't open %s as an HRIR database\n", p_DatabasePath);
+		return 1;
+	}
+
+	const UINT32 SampleRate = p_Database->GetSampleRate();
+	const UINT32 Blocks = 10 * SampleRate / SIMULATED_FRAME_COUNT;
+
+	DenormalGuard Denormals;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	std::vector<float> InBuffer(SIMULATED_FRAME_COUNT * 2);
+	std::vector<float> OutBuffer(SIMULATED_FRAME_COUNT * 2);
+	float Step = 2.0f * kPI * 220.0f / (float)SampleRate;
+	for (UINT32 Frame = 0; Frame < SIMULATED_FRAME_COUNT; Frame++)
+	{
+		InBuffer[Frame * 2] = InBuffer[Frame * 2 + 1] = 0.25f * sinf(Step * (float)Frame);
+	}
+
+	std::vector<BinauralVoice*> Voices(VoiceCount);
+	for (UINT32 Index = 0; Index < VoiceCount; Index++)
+	{
+		Voices[Index] = BinauralVoice::Create(p_Database);
+		if (Voices[Index] == nullptr)
+		{
+			printf("The responses in %s are too long to render\n", p_DatabasePath);
+			return 1;
+		}
+	}
+
+	// Every source moves on every block, so that the filters are interpolated and crossfaded each time
+	ReplayTiming RenderTiming;
+	for (UINT32 Block = 0; Block < Blocks; Block++)
+	{
+		INT64 Start = CaptureRecorder::Now();
+		for (UINT32 Index = 0; Index < VoiceCount; Index++)
+		{
+			float Angle = 2.0f * kPI * (float)Index / (float)VoiceCount + 0.02f * (float)Block;
+			Voices[Index]->Process(&InBuffer[0], &OutBuffer[0], SIMULATED_FRAME_COUNT, 2, sinf(Angle), 0.0f, cosf(Angle), 1.0f, 1.0f);
+		}
+		RenderTiming.Add(CaptureRecorder::Now() - Start);
+	}
+
+	double BlockDuration = 1000.0 * (double)SIMULATED_FRAME_COUNT / (double)SampleRate;
+	double Average = 1000.0 * (double)RenderTiming.Total / (double)Frequency.QuadPart / (double)Blocks;
+	printf("%u voices, %u blocks of %u frames at %u Hz\n", VoiceCount, Blocks, SIMULATED_FRAME_COUNT, SampleRate);
+	RenderTiming.Print("Render", Frequency.QuadPart);
+	printf("About %.0f voices per core (a block is due every %.2f ms)\n", (double)VoiceCount * BlockDuration / Average, BlockDuration);
+
+	for (UINT32 Index = 0; Index < VoiceCount; Index++)
+	{
+		delete Voices[Index];
+	}
+	delete p_Database;
+	return 0;
+}
+
+// Blocks of each size the ingest benchmark times, per kernel
+#define INGEST_BENCH_BLOCKS 200000
+
+static INT64 TimeIngestKernel(IngestKernel Kernel, UINT32 BlockSize, const float* p_In, float* p_Out, float* p_Dst)
+{
+	INT64 Start = CaptureRecorder::Now();
+	for (UINT32 Block = 0; Block < INGEST_BENCH_BLOCKS; Block++)
+	{
+		// A fade on every block, as while a source crosses the culling radius
+		float GainStart = (Block & 1) ? 1.0f : 0.5f;
+		Kernel(p_Dst, nullptr, BlockSize, p_In, p_Out, BlockSize, 2, 2, GainStart, 1.5f - GainStart);
+	}
+	return CaptureRecorder::Now() - Start;
+}
+
+static int RunIngestBenchmark()
+{
+	static const UINT32 BLOCK_SIZES[] = { 256, 512, 1024 };
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	printf("%u blocks of stereo input per kernel\n", INGEST_BENCH_BLOCKS);
+	for (UINT32 BlockSize : BLOCK_SIZES)
+	{
+		IngestKernel Specialized = GetIngestKernel(BlockSize);
+		if (Specialized == GetIngestKernel(0))
+		{
+			printf("%-6u no specialized kernel\n", BlockSize);
+			continue;
+		}
+
+		std::vector<float> InBuffer(BlockSize * 2);
+		std::vector<float> OutBuffer(BlockSize * 2);
+		std::vector<float> Samples(BlockSize);
+		float Step = 2.0f * kPI * 220.0f / 48000.0f;
+		for (UINT32 Frame = 0; Frame < BlockSize; Frame++)
+		{
+			InBuffer[Frame * 2] = 0.25f * sinf(Step * (float)Frame);
+			InBuffer[Frame * 2 + 1] = 0.25f * cosf(Step * (float)Frame);
+		}
+
+		// Once each to warm up, then timed
+		TimeIngestKernel(Specialized, BlockSize, InBuffer.data(), OutBuffer.data(), Samples.data());
+		TimeIngestKernel(GetIngestKernel(0), BlockSize, InBuffer.data(), OutBuffer.data(), Samples.data());
+		INT64 SpecializedTicks = TimeIngestKernel(Specialized, BlockSize, InBuffer.data(), OutBuffer.data(), Samples.data());
+		INT64 GenericTicks = TimeIngestKernel(GetIngestKernel(0), BlockSize, InBuffer.data(), OutBuffer.data(), Samples.data());
+
+		double Scale = 1.0e9 / (double)Frequency.QuadPart / (double)INGEST_BENCH_BLOCKS;
+		printf("%-6u specialized %8.1f ns/block  generic %8.1f ns/block  %.2fx\n", BlockSize,
+			(double)SpecializedTicks * Scale, (double)GenericTicks * Scale, (double)GenericTicks / (double)SpecializedTicks);
+	}
+	return 0;
+}
+
+// The ring each source of the transfer benchmark has, as ProcessCallback and the pump shared one before the audio moved
+// to pooled blocks: the left channel of the input, and the position repeated for every sample
+#define TRANSFER_BENCH_RING_SIZE 4800
+#define TRANSFER_BENCH_PUMPS 2000
+
+struct TransferBenchRing
+{
+	float Samples[TRANSFER_BENCH_RING_SIZE];
+	float PosX[TRANSFER_BENCH_RING_SIZE];
+	float PosY[TRANSFER_BENCH_RING_SIZE];
+	float PosZ[TRANSFER_BENCH_RING_SIZE];
+	UINT32 WriteIndex;
+	UINT32 ReadIndex;
+};
+
+static void TransferBySpans(TransferBenchRing& Ring, const float* p_In, float* p_Out, float X, float Y, float Z)
+{
+	RingFill(Ring.PosX, TRANSFER_BENCH_RING_SIZE, Ring.WriteIndex, X, SIMULATED_FRAME_COUNT);
+	RingFill(Ring.PosY, TRANSFER_BENCH_RING_SIZE, Ring.WriteIndex, Y, SIMULATED_FRAME_COUNT);
+	RingFill(Ring.PosZ, TRANSFER_BENCH_RING_SIZE, Ring.WriteIndex, Z, SIMULATED_FRAME_COUNT);
+	Ring.WriteIndex = RingWrite(Ring.Samples, TRANSFER_BENCH_RING_SIZE, Ring.WriteIndex, p_In, 2, SIMULATED_FRAME_COUNT, 1.0f, 1.0f);
+	Ring.ReadIndex = RingRead(p_Out, Ring.Samples, TRANSFER_BENCH_RING_SIZE, Ring.ReadIndex, SIMULATED_FRAME_COUNT, 1.0f, 1.0f);
+}
+
+static void TransferBySamples(TransferBenchRing& Ring, const float* p_In, float* p_Out, float X, float Y, float Z)
+{
+	for (UINT32 inx = 0; inx < SIMULATED_FRAME_COUNT; inx++)
+	{
+		Ring.WriteIndex++;
+		if (Ring.WriteIndex >= TRANSFER_BENCH_RING_SIZE)
+		{
+			Ring.WriteIndex -= TRANSFER_BENCH_RING_SIZE;
+		}
+		Ring.PosX[Ring.WriteIndex] = X;
+		Ring.PosY[Ring.WriteIndex] = Y;
+		Ring.PosZ[Ring.WriteIndex] = Z;
+		Ring.Samples[Ring.WriteIndex] = p_In[inx * 2];
+	}
+	for (UINT32 inx = 0; inx < SIMULATED_FRAME_COUNT; inx++)
+	{
+		p_Out[inx] = Ring.Samples[Ring.ReadIndex];
+		Ring.ReadIndex++;
+		if (Ring.ReadIndex >= TRANSFER_BENCH_RING_SIZE)
+		{
+			Ring.ReadIndex -= TRANSFER_BENCH_RING_SIZE;
+		}
+	}
+}
+
+typedef void (*TransferFunction)(TransferBenchRing& Ring, const float* p_In, float* p_Out, float X, float Y, float Z);
+
+static INT64 TimeTransfer(TransferFunction Transfer, std::vector<TransferBenchRing>& Rings, const float* p_In, float* p_Out)
+{
+	INT64 Start = CaptureRecorder::Now();
+	for (UINT32 Pump = 0; Pump < TRANSFER_BENCH_PUMPS; Pump++)
+	{
+		for (UINT32 Index = 0; Index < (UINT32)Rings.size(); Index++)
+		{
+			Transfer(Rings[Index], p_In, p_Out + Index * SIMULATED_FRAME_COUNT, (float)Index, 0.0f, (float)Pump);
+		}
+	}
+	return CaptureRecorder::Now() - Start;
+}
+
+static int RunTransferBenchmark()
+{
+	static const UINT32 SOURCE_COUNTS[] = { 64, 128, 256 };
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	std::vector<float> InBuffer(SIMULATED_FRAME_COUNT * 2);
+	float Step = 2.0f * kPI * 220.0f / 48000.0f;
+	for (UINT32 Frame = 0; Frame < SIMULATED_FRAME_COUNT; Frame++)
+	{
+		InBuffer[Frame * 2] = 0.25f * sinf(Step * (float)Frame);
+		InBuffer[Frame * 2 + 1] = 0.25f * cosf(Step * (float)Frame);
+	}
+
+	printf("%u pumps of %u frames per source\n", TRANSFER_BENCH_PUMPS, SIMULATED_FRAME_COUNT);
+	for (UINT32 SourceCount : SOURCE_COUNTS)
+	{
+		// The read index trails the write index by two pumps, as the pump waited for
+		std::vector<TransferBenchRing> Rings(SourceCount);
+		for (TransferBenchRing& Ring : Rings)
+		{
+			memset(&Ring, 0, sizeof(Ring));
+			Ring.WriteIndex = 2 * SIMULATED_FRAME_COUNT;
+		}
+		std::vector<float> OutBuffer(SourceCount * SIMULATED_FRAME_COUNT);
+
+		// Once each to warm up, then timed
+		TimeTransfer(TransferBySpans, Rings, InBuffer.data(), OutBuffer.data());
+		TimeTransfer(TransferBySamples, Rings, InBuffer.data(), OutBuffer.data());
+		INT64 SpanTicks = TimeTransfer(TransferBySpans, Rings, InBuffer.data(), OutBuffer.data());
+		INT64 SampleTicks = TimeTransfer(TransferBySamples, Rings, InBuffer.data(), OutBuffer.data());
+
+		double Scale = 1.0e6 / (double)Frequency.QuadPart / (double)TRANSFER_BENCH_PUMPS;
+		printf("%-4u sources  spans %8.2f us/pump  per sample %8.2f us/pump  %.2fx\n", SourceCount,
+			(double)SpanTicks * Scale, (double)SampleTicks * Scale, (double)SampleTicks / (double)SpanTicks);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* p_Path = nullptr;
+	const char* p_RecordPath = nullptr;
+	BOOL RealTime = FALSE;
+	UINT32 DynamicObjectCount = 16;
+	UINT64 Latency = 2 * SIMULATED_FRAME_COUNT;
+	UINT32 FillThreads = 1;
+	UINT32 FillBenchmarkThreads = 0;
+	UINT32 LockBenchmarkThreads = 0;
+	const char* p_BinauralBenchmarkDatabase = nullptr;
+	UINT32 BinauralVoiceCount = 64;
+	BOOL IngestBenchmark = FALSE;
+	BOOL TransferBenchmark = FALSE;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-realtime") == 0)
+			RealTime = TRUE;
+		else if (strcmp(argv[i], "-objects") == 0 && i + 1 < argc)
+			DynamicObjectCount = (UINT32)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-latency") == 0 && i + 1 < argc)
+			Latency = (UINT64)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+			p_RecordPath = argv[++i];
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			FillThreads = (UINT32)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-fillbench") == 0 && i + 1 < argc)
+			FillBenchmarkThreads = (UINT32)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-lockbench") == 0 && i + 1 < argc)
+			LockBenchmarkThreads = (UINT32)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-binauralbench") == 0 && i + 1 < argc)
+			p_BinauralBenchmarkDatabase = argv[++i];
+		else if (strcmp(argv[i], "-voices") == 0 && i + 1 < argc)
+			BinauralVoiceCount = (UINT32)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-ingestbench") == 0)
+			IngestBenchmark = TRUE;
+		else if (strcmp(argv[i], "-transferbench") == 0)
+			TransferBenchmark = TRUE;
+		else
+			p_Path = argv[i];
+	}
+
+	if (FillBenchmarkThreads > 0)
+	{
+		return RunFillBenchmark(DynamicObjectCount, FillBenchmarkThreads);
+	}
+
+	if (LockBenchmarkThreads > 0)
+	{
+		return RunLockBenchmark(LockBenchmarkThreads);
+	}
+
+	if (p_BinauralBenchmarkDatabase != nullptr)
+	{
+		return RunBinauralBenchmark(p_BinauralBenchmarkDatabase, BinauralVoiceCount);
+	}
+
+	if (IngestBenchmark)
+	{
+		return RunIngestBenchmark();
+	}
+
+	if (TransferBenchmark)
+	{
+		return RunTransferBenchmark();
+	}
+
+	if (p_Path == nullptr)
+	{
+		printf("Usage: ISACReplay <capture> [-realtime] [-objects <count>] [-latency <frames>] [-record <object capture>] [-threads <count>]\n");
+		printf("       ISACReplay -fillbench <threads> [-objects <count>]\n");
+		printf("       ISACReplay -lockbench <threads>\n");
+		printf("       ISACReplay -binauralbench <database> [-voices <count>]\n");
+		printf("       ISACReplay -ingestbench\n");
+		printf("       ISACReplay -transferbench\n");
+		return 1;
+	}
+
+	// Map the whole capture; records are read in place
+	HANDLE File = CreateFileA(p_Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		printf("Can't open %s\n", p_Path);
+		return 1;
+	}
+
+	LARGE_INTEGER FileSize;
+	GetFileSizeEx(File, &FileSize);
+	HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const unsigned char* p_Capture = (Mapping != nullptr) ? (const unsigned char*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (p_Capture == nullptr || FileSize.QuadPart < (LONGLONG)sizeof(CaptureFileHeader))
+	{
+		printf("Can't map %s\n", p_Path);
+		return 1;
+	}
+
+	const CaptureFileHeader* p_FileHeader = (const CaptureFileHeader*)p_Capture;
+	if (p_FileHeader->Magic != CAPTURE_MAGIC || p_FileHeader->Version != CAPTURE_VERSION || p_FileHeader->RecordHeaderSize != sizeof(CaptureRecordHeader))
+	{
+		printf("%s is not a capture this build can read\n", p_Path);
+		return 1;
+	}
+
+	const unsigned char* p_Begin = p_Capture + sizeof(CaptureFileHeader);
+	const unsigned char* p_End = p_Capture + FileSize.QuadPart;
+
+	// The sink has to be in place before the first CreateCallback, at the sample rate of the capture
+	UINT32 SampleRate = 48000;
+	for (const unsigned char* p_Record = p_Begin; p_Record + sizeof(CaptureRecordHeader) <= p_End; p_Record += ((const CaptureRecordHeader*)p_Record)->Size)
+	{
+		const CaptureRecordHeader* p_Header = (const CaptureRecordHeader*)p_Record;
+		if (p_Header->Size < sizeof(CaptureRecordHeader))
+			break;
+		if (p_Header->Type == CaptureRecord_Create)
+		{
+			SampleRate = p_Header->SampleRate;
+			break;
+		}
+	}
+
+	SimulatedSink Sink(DynamicObjectCount);
+	SpatialAudioSink* p_PumpSink = &Sink;
+
+	ObjectCaptureWriter* p_Writer = nullptr;
+	RecordingSink* p_Recording = nullptr;
+	if (p_RecordPath != nullptr)
+	{
+		p_Writer = ObjectCaptureWriter::Create(p_RecordPath, SampleRate);
+		if (p_Writer == nullptr)
+		{
+			printf("Can't create %s\n", p_RecordPath);
+			return 1;
+		}
+		p_Recording = new RecordingSink(&Sink, p_Writer);
+		p_PumpSink = p_Recording;
+	}
+
+	AttachSimulatedSink(p_PumpSink, DynamicObjectCount, SampleRate);
+
+	UnityAudioEffectDefinition* p_Spatializer = FindSpatializer();
+	if (p_Spatializer == nullptr)
+	{
+		printf("No spatializer in this build\n");
+		return 1;
+	}
+
+	// Like the worker thread it replaces
+	DenormalGuard Denormals;
+	SetObjectFillThreads(FillThreads);
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+	ReplayTiming ProcessTiming, PumpTiming, ReleaseTiming;
+
+	std::map<UINT32, ReplaySource*> Sources;
+	UINT64 Records = 0;
+	UINT64 DroppedRecords = 0;
+	BOOL PumpStarted = FALSE;
+	UINT64 NextPumpTick = 0;
+	INT64 FirstTimestamp = 0;
+	INT64 ReplayStart = CaptureRecorder::Now();
+
+	for (const unsigned char* p_Record = p_Begin; p_Record + sizeof(CaptureRecordHeader) <= p_End; )
+	{
+		const CaptureRecordHeader* p_Header = (const CaptureRecordHeader*)p_Record;
+		if (p_Header->Size < sizeof(CaptureRecordHeader) || p_Record + p_Header->Size > p_End)
+		{
+			// The capture was cut off in the middle of a record
+			break;
+		}
+		p_Record += p_Header->Size;
+		Records++;
+
+		if (RealTime)
+		{
+			if (Records == 1)
+				FirstTimestamp = p_Header->Timestamp;
+
+			double Due = (double)(p_Header->Timestamp - FirstTimestamp) / (double)p_FileHeader->TimestampFrequency;
+			double Elapsed = (double)(CaptureRecorder::Now() - ReplayStart) / (double)Frequency.QuadPart;
+			if (Due > Elapsed)
+				Sleep((DWORD)((Due - Elapsed) * 1000.0));
+		}
+
+		if (p_Header->Type == CaptureRecord_Dropped)
+		{
+			DroppedRecords += p_Header->DspTick;
+			continue;
+		}
+
+		if (p_Header->Type == CaptureRecord_Create)
+		{
+			ReplaySource* p_Source = new ReplaySource;
+			memset(&p_Source->State, 0, sizeof(p_Source->State));
+			memset(&p_Source->SpatializerData, 0, sizeof(p_Source->SpatializerData));
+			memcpy(p_Source->Params, p_Header->Params, sizeof(p_Source->Params));
+
+			p_Source->State.structsize = sizeof(UnityAudioEffectState);
+			p_Source->State.samplerate = p_Header->SampleRate;
+			p_Source->State.internal = p_Source;
+			p_Source->State.spatializerdata = &p_Source->SpatializerData;
+			p_Source->State.dspbuffersize = p_Header->DspBufferSize;
+			p_Source->State.hostapiversion = p_Header->HostCompatible ? UNITY_AUDIO_PLUGIN_API_VERSION : 0;
+
+			p_Spatializer->create(&p_Source->State);
+			Sources[p_Header->SourceId] = p_Source;
+			continue;
+		}
+
+		std::map<UINT32, ReplaySource*>::iterator Found = Sources.find(p_Header->SourceId);
+		if (Found == Sources.end())
+		{
+			// Created before the capture started
+			continue;
+		}
+		ReplaySource* p_Source = Found->second;
+
+		if (p_Header->Type == CaptureRecord_Release)
+		{
+			INT64 Start = CaptureRecorder::Now();
+			p_Spatializer->release(&p_Source->State);
+			ReleaseTiming.Add(CaptureRecorder::Now() - Start);
+
+			delete p_Source;
+			Sources.erase(Found);
+			continue;
+		}
+
+		if (p_Header->Type != CaptureRecord_Process)
+		{
+			continue;
+		}
+
+		// Run every pump that ISAC would have asked for by the time Unity got to this block
+		if (!PumpStarted)
+		{
+			NextPumpTick = p_Header->DspTick;
+			PumpStarted = TRUE;
+		}
+		while (NextPumpTick + Latency < p_Header->DspTick)
+		{
+			INT64 Start = CaptureRecorder::Now();
+			PumpOnce(p_PumpSink);
+			PumpTiming.Add(CaptureRecorder::Now() - Start);
+			NextPumpTick += SIMULATED_FRAME_COUNT;
+		}
+
+		for (UINT32 i = 0; i < p_FileHeader->NumParams && i < CAPTURE_MAX_PARAMS; i++)
+		{
+			if (p_Source->Params[i] != p_Header->Params[i])
+			{
+				p_Source->Params[i] = p_Header->Params[i];
+				p_Spatializer->setfloatparameter(&p_Source->State, i, p_Header->Params[i]);
+			}
+		}
+
+		p_Source->State.prevdsptick = p_Source->State.currdsptick;
+		p_Source->State.currdsptick = p_Header->DspTick;
+		p_Source->State.flags = p_Header->Flags;
+		memcpy(p_Source->SpatializerData.listenermatrix, p_Header->ListenerMatrix, sizeof(p_Header->ListenerMatrix));
+		memcpy(p_Source->SpatializerData.sourcematrix, p_Header->SourceMatrix, sizeof(p_Header->SourceMatrix));
+		p_Source->SpatializerData.spatialblend = p_Header->SpatialBlend;
+		p_Source->SpatializerData.spread = p_Header->Spread;
+		p_Source->SpatializerData.stereopan = p_Header->StereoPan;
+
+		// ProcessCallback takes non-const buffers, so the samples are copied out of the mapping
+		const float* p_Samples = (const float*)(p_Header + 1);
+		p_Source->InBuffer.assign(p_Samples, p_Samples + p_Header->Length * p_Header->InChannels);
+		p_Source->OutBuffer.resize(p_Header->Length * p_Header->OutChannels + 1);
+
+		INT64 Start = CaptureRecorder::Now();
+		p_Spatializer->process(&p_Source->State, p_Source->InBuffer.data(), p_Source->OutBuffer.data(), p_Header->Length, p_Header->InChannels, p_Header->OutChannels);
+		ProcessTiming.Add(CaptureRecorder::Now() - Start);
+	}
+
+	// Sources still playing when the capture ended are released here, which plays out what they have buffered
+	for (std::map<UINT32, ReplaySource*>::iterator iter = Sources.begin(); iter != Sources.end(); iter++)
+	{
+		INT64 Start = CaptureRecorder::Now();
+		p_Spatializer->release(&iter->second->State);
+		ReleaseTiming.Add(CaptureRecorder::Now() - Start);
+		delete iter->second;
+	}
+
+	printf("%s: %llu records, %llu dropped while capturing\n", p_Path, Records, DroppedRecords);
+	ProcessTiming.Print("Process", Frequency.QuadPart);
+	PumpTiming.Print("Pump", Frequency.QuadPart);
+	ReleaseTiming.Print("Release", Frequency.QuadPart);
+
+	// Time the pump spent between BeginUpdate and EndUpdate, which the sink's real-time thread may be waiting on
+	const LatencyHistogram& UpdateWindow = GetUpdateWindowHistogram();
+	printf("%-10s %10u passes %10.3f ms p50   %10.3f ms p99   %10.3f ms max\n", "Window", UpdateWindow.GetCount(),
+		UpdateWindow.GetPercentile(0.5f), UpdateWindow.GetPercentile(0.99f), UpdateWindow.GetMax());
+	printf("Sink: %llu passes, %llu object frames, at most %u of %u dynamic objects, %u bed channels activated\n",
+		Sink.GetPasses(), Sink.GetDynamicObjectFrames(), Sink.GetMaxObjectsInUse(), DynamicObjectCount, Sink.GetStaticChannelsActivated());
+	printf("Peak %.6f  Checksum %016llx\n", Sink.GetPeak(), Sink.GetChecksum());
+
+	UINT32 PeakBlocksInUse, BlockCount, PoolExhausted, DroppedWrites;
+	GetAudioBlockUsage(&PeakBlocksInUse, &BlockCount, &PoolExhausted, &DroppedWrites);
+	printf("Audio blocks: at most %u of %u in use, pool dry %u times, %u callbacks dropped audio\n", PeakBlocksInUse, BlockCount, PoolExhausted, DroppedWrites);
+
+	SetObjectFillThreads(1);
+
+	// Trims the object capture to what was written
+	delete p_Recording;
+	delete p_Writer;
+
+	UnmapViewOfFile(p_Capture);
+	CloseHandle(Mapping);
+	CloseHandle(File);
+
+#ifdef REALTIME_CHECK
+	RealtimeCheck::PrintReports(stdout);
+	if (RealtimeCheck::GetViolationCount() != 0)
+	{
+		return 2;
+	}
+#endif
+	return 0;
+}
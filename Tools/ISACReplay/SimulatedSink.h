@@ -0,0 +1,179 @@
+#pragma once
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "../../SpatialAudioSink.h"
+
+namespace MSHRTFSpatializer
+{
+	// ISAC renders 10 ms per pass at 48 kHz
+	const UINT32 SIMULATED_FRAME_COUNT = 480;
+	const UINT32 SIMULATED_MAX_STATIC_CHANNELS = 17;
+
+	// Stands in for ISAC in the replay tool. It takes whatever the pump writes, and keeps enough statistics to compare
+	// runs: a checksum of every sample written, the peak level and how many objects were in use.
+	class SimulatedSink : public SpatialAudioSink
+	{
+	public:
+		SimulatedSink(UINT32 DynamicObjectCount) :
+			m_DynamicObjectCount(DynamicObjectCount),
+			m_DynamicBuffers(DynamicObjectCount * SIMULATED_FRAME_COUNT),
+			m_DynamicWritten(DynamicObjectCount, FALSE)
+		{
+			memset(m_StaticBuffers, 0, sizeof(m_StaticBuffers));
+			memset(m_StaticActive, 0, sizeof(m_StaticActive));
+		}
+
+		HRESULT BeginUpdate(UINT32* p_AvailableDynamicObjectCount, UINT32* p_FrameCount) override
+		{
+			*p_AvailableDynamicObjectCount = m_DynamicObjectCount;
+			*p_FrameCount = SIMULATED_FRAME_COUNT;
+			return S_OK;
+		}
+
+		HRESULT EndUpdate() override
+		{
+			UINT32 ObjectsInUse = 0;
+			for (UINT32 Index = 0; Index < m_DynamicObjectCount; Index++)
+			{
+				if (m_DynamicWritten[Index])
+				{
+					Accumulate(&m_DynamicBuffers[Index * SIMULATED_FRAME_COUNT]);
+					m_DynamicWritten[Index] = FALSE;
+					ObjectsInUse++;
+				}
+			}
+
+			for (UINT32 Channel = 0; Channel < SIMULATED_MAX_STATIC_CHANNELS; Channel++)
+			{
+				if (m_StaticActive[Channel])
+				{
+					Accumulate(m_StaticBuffers[Channel]);
+				}
+			}
+
+			m_Passes++;
+			m_DynamicObjectFrames += ObjectsInUse;
+			m_MaxObjectsInUse = (ObjectsInUse > m_MaxObjectsInUse) ? ObjectsInUse : m_MaxObjectsInUse;
+			return S_OK;
+		}
+
+		HRESULT GetDynamicObjectBuffer(UINT32 Index, float** pp_Buffer) override
+		{
+			if (Index >= m_DynamicObjectCount)
+			{
+				return E_FAIL;
+			}
+
+			m_DynamicWritten[Index] = TRUE;
+			*pp_Buffer = &m_DynamicBuffers[Index * SIMULATED_FRAME_COUNT];
+			return S_OK;
+		}
+
+		void SetDynamicObjectPosition(UINT32 Index, float X, float Y, float Z) override
+		{
+			Hash(&X, sizeof(X));
+			Hash(&Y, sizeof(Y));
+			Hash(&Z, sizeof(Z));
+		}
+
+		void SetDynamicObjectVolume(UINT32 Index, float Volume) override
+		{
+			Hash(&Volume, sizeof(Volume));
+		}
+
+		// A 7.1.4 layout: ear level speakers at 0, 30, 90 and 135 degrees, height speakers at 45 and 135 degrees, 45 up
+		HRESULT GetStaticObjectPosition(AudioObjectType Type, float* p_X, float* p_Y, float* p_Z) override
+		{
+			float Azimuth = 0.0f, Elevation = 0.0f;
+			switch (Type)
+			{
+			case AudioObjectType_FrontLeft:			Azimuth = 30.0f; break;
+			case AudioObjectType_FrontRight:		Azimuth = -30.0f; break;
+			case AudioObjectType_FrontCenter:		Azimuth = 0.0f; break;
+			case AudioObjectType_LowFrequency:		Azimuth = 0.0f; break;
+			case AudioObjectType_SideLeft:			Azimuth = 90.0f; break;
+			case AudioObjectType_SideRight:			Azimuth = -90.0f; break;
+			case AudioObjectType_BackLeft:			Azimuth = 135.0f; break;
+			case AudioObjectType_BackRight:			Azimuth = -135.0f; break;
+			case AudioObjectType_TopFrontLeft:		Azimuth = 45.0f; Elevation = 45.0f; break;
+			case AudioObjectType_TopFrontRight:		Azimuth = -45.0f; Elevation = 45.0f; break;
+			case AudioObjectType_TopBackLeft:		Azimuth = 135.0f; Elevation = 45.0f; break;
+			case AudioObjectType_TopBackRight:		Azimuth = -135.0f; Elevation = 45.0f; break;
+			default:
+				return E_FAIL;
+			}
+
+			// ISAC has x to the right, y up and z to the back; the azimuth is counter-clockwise from the front
+			const float DegreesToRadians = 3.14159265f / 180.0f;
+			*p_X = -sinf(Azimuth * DegreesToRadians) * cosf(Elevation * DegreesToRadians);
+			*p_Y = sinf(Elevation * DegreesToRadians);
+			*p_Z = -cosf(Azimuth * DegreesToRadians) * cosf(Elevation * DegreesToRadians);
+			return S_OK;
+		}
+
+		HRESULT GetStaticObjectBuffer(UINT32 Channel, AudioObjectType Type, BOOL Activate, float** pp_Buffer) override
+		{
+			if (Channel >= SIMULATED_MAX_STATIC_CHANNELS)
+			{
+				return E_FAIL;
+			}
+
+			if (!m_StaticActive[Channel])
+			{
+				if (!Activate)
+				{
+					return S_FALSE;
+				}
+				m_StaticActive[Channel] = TRUE;
+				m_StaticChannelsActivated++;
+			}
+
+			*pp_Buffer = m_StaticBuffers[Channel];
+			return S_OK;
+		}
+
+		UINT64 GetChecksum() const { return m_Checksum; }
+		float GetPeak() const { return m_Peak; }
+		UINT64 GetPasses() const { return m_Passes; }
+		UINT64 GetDynamicObjectFrames() const { return m_DynamicObjectFrames; }
+		UINT32 GetMaxObjectsInUse() const { return m_MaxObjectsInUse; }
+		UINT32 GetStaticChannelsActivated() const { return m_StaticChannelsActivated; }
+
+	protected:
+		// FNV-1a over the raw bytes, so that two replays of the same capture can be compared exactly
+		void Hash(const void* p_Data, size_t Size)
+		{
+			const unsigned char* p_Bytes = (const unsigned char*)p_Data;
+			for (size_t n = 0; n < Size; n++)
+			{
+				m_Checksum = (m_Checksum ^ p_Bytes[n]) * 0x100000001b3ULL;
+			}
+		}
+
+		void Accumulate(const float* p_Buffer)
+		{
+			Hash(p_Buffer, SIMULATED_FRAME_COUNT * sizeof(float));
+			for (UINT32 n = 0; n < SIMULATED_FRAME_COUNT; n++)
+			{
+				float Level = fabsf(p_Buffer[n]);
+				m_Peak = (Level > m_Peak) ? Level : m_Peak;
+			}
+		}
+
+		UINT32 m_DynamicObjectCount;
+		std::vector<float> m_DynamicBuffers;
+		std::vector<BOOL> m_DynamicWritten;
+
+		float m_StaticBuffers[SIMULATED_MAX_STATIC_CHANNELS][SIMULATED_FRAME_COUNT];
+		BOOL m_StaticActive[SIMULATED_MAX_STATIC_CHANNELS];
+
+		UINT64 m_Checksum = 0xcbf29ce484222325ULL;
+		float m_Peak = 0.0f;
+		UINT64 m_Passes = 0;
+		UINT64 m_DynamicObjectFrames = 0;
+		UINT32 m_MaxObjectsInUse = 0;
+		UINT32 m_StaticChannelsActivated = 0;
+	};
+}
@@ -0,0 +1,345 @@
+// Reads an object capture written by the plugin (see OBJECT_CAPTURE_ENVIRONMENT_VARIABLE) or by ISACReplay -record,
+// prints a summary of it and exports it for analysis. Only uses the standard library, so it builds anywhere:
+//
+//   g++ -O2 -std=c++11 -o ObjectCaptureReader ObjectCaptureReader.cpp
+//
+//   ObjectCaptureReader <object capture> [-wav <directory>] [-csv <file>] [-timing <file>]
+//
+// -wav writes a mono 32-bit float WAV file per object: dynamic_<slot>.wav for dynamic objects and static_<type>.wav
+//  for the bed. All files share one timeline, with silence wherever the object wasn't written, including passes that
+//  were dropped while capturing.
+// -csv writes a line per object per pass: its position, volume, peak and RMS level.
+// -timing writes a line per pass: when the pump started it, how long it took and how long since the previous pass.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../ObjectCapture.h"
+
+using namespace MSHRTFSpatializer;
+
+// One object's samples on the shared timeline
+struct WavStream
+{
+	FILE* p_File;
+	uint64_t Frames;
+};
+
+static const char* StaticObjectName(uint32_t Type)
+{
+	switch (Type)
+	{
+	case 0x2: return "FrontLeft";
+	case 0x4: return "FrontRight";
+	case 0x8: return "FrontCenter";
+	case 0x10: return "LowFrequency";
+	case 0x20: return "SideLeft";
+	case 0x40: return "SideRight";
+	case 0x80: return "BackLeft";
+	case 0x100: return "BackRight";
+	case 0x200: return "TopFrontLeft";
+	case 0x400: return "TopFrontRight";
+	case 0x800: return "TopBackLeft";
+	case 0x1000: return "TopBackRight";
+	case 0x2000: return "BottomFrontLeft";
+	case 0x4000: return "BottomFrontRight";
+	case 0x8000: return "BottomBackLeft";
+	case 0x10000: return "BottomBackRight";
+	case 0x20000: return "BackCenter";
+	default: return nullptr;
+	}
+}
+
+static void WriteWavHeader(FILE* p_File, uint32_t SampleRate, uint64_t Frames)
+{
+	// WAV sizes are 32 bits; longer streams keep their samples but report the largest size that fits
+	uint64_t DataSize = Frames * sizeof(float);
+	uint32_t ClampedDataSize = (DataSize > 0xFFFFFFFFull - 36) ? (uint32_t)(0xFFFFFFFFull - 36) : (uint32_t)DataSize;
+
+	uint32_t RiffSize = ClampedDataSize + 36;
+	uint32_t FormatSize = 16;
+	uint16_t Format = 3;			// IEEE float
+	uint16_t Channels = 1;
+	uint32_t ByteRate = SampleRate * sizeof(float);
+	uint16_t BlockAlign = sizeof(float);
+	uint16_t BitsPerSample = 32;
+
+	fwrite("RIFF", 1, 4, p_File);
+	fwrite(&RiffSize, 4, 1, p_File);
+	fwrite("WAVEfmt ", 1, 8, p_File);
+	fwrite(&FormatSize, 4, 1, p_File);
+	fwrite(&Format, 2, 1, p_File);
+	fwrite(&Channels, 2, 1, p_File);
+	fwrite(&SampleRate, 4, 1, p_File);
+	fwrite(&ByteRate, 4, 1, p_File);
+	fwrite(&BlockAlign, 2, 1, p_File);
+	fwrite(&BitsPerSample, 2, 1, p_File);
+	fwrite("data", 1, 4, p_File);
+	fwrite(&ClampedDataSize, 4, 1, p_File);
+}
+
+static void WriteSilence(FILE* p_File, uint64_t Frames)
+{
+	static const float Zeros[1024] = { 0 };
+	while (Frames > 0)
+	{
+		uint64_t Count = (Frames < 1024) ? Frames : 1024;
+		fwrite(Zeros, sizeof(float), (size_t)Count, p_File);
+		Frames -= Count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* p_Path = nullptr;
+	const char* p_WavDirectory = nullptr;
+	const char* p_CsvPath = nullptr;
+	const char* p_TimingPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-wav") == 0 && i + 1 < argc)
+			p_WavDirectory = argv[++i];
+		else if (strcmp(argv[i], "-csv") == 0 && i + 1 < argc)
+			p_CsvPath = argv[++i];
+		else if (strcmp(argv[i], "-timing") == 0 && i + 1 < argc)
+			p_TimingPath = argv[++i];
+		else
+			p_Path = argv[i];
+	}
+
+	if (p_Path == nullptr)
+	{
+		printf("Usage: ObjectCaptureReader <object capture> [-wav <directory>] [-csv <file>] [-timing <file>]\n");
+		return 1;
+	}
+
+	FILE* p_File = fopen(p_Path, "rb");
+	if (p_File == nullptr)
+	{
+		printf("Can't open %s\n", p_Path);
+		return 1;
+	}
+
+	ObjectCaptureFileHeader FileHeader;
+	if (fread(&FileHeader, sizeof(FileHeader), 1, p_File) != 1 || FileHeader.Magic != OBJECT_CAPTURE_MAGIC ||
+		FileHeader.Version != OBJECT_CAPTURE_VERSION || FileHeader.PassHeaderSize != sizeof(ObjectCapturePassHeader) ||
+		FileHeader.ObjectHeaderSize != sizeof(ObjectCaptureObjectHeader))
+	{
+		printf("%s is not an object capture this build can read\n", p_Path);
+		return 1;
+	}
+
+	FILE* p_Csv = nullptr;
+	if (p_CsvPath != nullptr)
+	{
+		p_Csv = fopen(p_CsvPath, "w");
+		if (p_Csv == nullptr)
+		{
+			printf("Can't create %s\n", p_CsvPath);
+			return 1;
+		}
+		fprintf(p_Csv, "sequence,time_ms,index,type,x,y,z,volume,peak,rms\n");
+	}
+
+	FILE* p_Timing = nullptr;
+	if (p_TimingPath != nullptr)
+	{
+		p_Timing = fopen(p_TimingPath, "w");
+		if (p_Timing == nullptr)
+		{
+			printf("Can't create %s\n", p_TimingPath);
+			return 1;
+		}
+		fprintf(p_Timing, "sequence,time_ms,duration_us,interval_us,objects\n");
+	}
+
+	const double TicksToMicroseconds = 1.0e6 / (double)FileHeader.TimestampFrequency;
+
+	std::map<uint64_t, WavStream> Streams;
+	std::vector<unsigned char> Record;
+
+	uint64_t Passes = 0;
+	uint64_t DroppedPasses = 0;
+	uint64_t NextSequence = 0;
+	uint64_t TimelineFrames = 0;
+	uint64_t ObjectFrames = 0;
+	uint32_t MaxObjects = 0;
+	int64_t FirstTimestamp = 0;
+	int64_t PreviousTimestamp = 0;
+	double TotalDuration = 0.0, MaxDuration = 0.0;
+	double MinInterval = 0.0, MaxInterval = 0.0;
+	float Peak = 0.0f;
+
+	while (true)
+	{
+		uint32_t Prefix[2];
+		if (fread(Prefix, sizeof(Prefix), 1, p_File) != 1 || Prefix[0] == 0 || Prefix[1] == ObjectCaptureRecord_End)
+		{
+			break;
+		}
+
+		if (Prefix[1] == ObjectCaptureRecord_Padding)
+		{
+			fseek(p_File, (long)(Prefix[0] - sizeof(Prefix)), SEEK_CUR);
+			continue;
+		}
+
+		if (Prefix[1] != ObjectCaptureRecord_Pass || Prefix[0] < sizeof(ObjectCapturePassHeader))
+		{
+			printf("Unknown record at pass %llu, stopping\n", (unsigned long long)Passes);
+			break;
+		}
+
+		Record.resize(Prefix[0]);
+		memcpy(Record.data(), Prefix, sizeof(Prefix));
+		if (fread(Record.data() + sizeof(Prefix), Prefix[0] - sizeof(Prefix), 1, p_File) != 1)
+		{
+			// Cut off in the middle of a pass
+			break;
+		}
+
+		const ObjectCapturePassHeader* p_Pass = (const ObjectCapturePassHeader*)Record.data();
+		const uint32_t ObjectSize = ObjectCaptureObjectSize(p_Pass->FrameCount);
+		if (sizeof(ObjectCapturePassHeader) + (uint64_t)p_Pass->NumObjects * ObjectSize > p_Pass->Size)
+		{
+			printf("Pass %llu is damaged, stopping\n", (unsigned long long)p_Pass->Sequence);
+			break;
+		}
+
+		if (Passes == 0)
+		{
+			FirstTimestamp = p_Pass->BeginTimestamp;
+			NextSequence = p_Pass->Sequence;
+		}
+
+		// Dropped passes still take up time on the timeline
+		if (p_Pass->Sequence > NextSequence)
+		{
+			DroppedPasses += p_Pass->Sequence - NextSequence;
+			TimelineFrames += (p_Pass->Sequence - NextSequence) * p_Pass->FrameCount;
+		}
+		NextSequence = p_Pass->Sequence + 1;
+
+		double TimeMs = (double)(p_Pass->BeginTimestamp - FirstTimestamp) * TicksToMicroseconds / 1000.0;
+		double Duration = (double)(p_Pass->EndTimestamp - p_Pass->BeginTimestamp) * TicksToMicroseconds;
+		double Interval = (Passes > 0) ? (double)(p_Pass->BeginTimestamp - PreviousTimestamp) * TicksToMicroseconds : 0.0;
+		PreviousTimestamp = p_Pass->BeginTimestamp;
+
+		TotalDuration += Duration;
+		MaxDuration = (Duration > MaxDuration) ? Duration : MaxDuration;
+		if (Passes > 0)
+		{
+			MinInterval = (Passes == 1 || Interval < MinInterval) ? Interval : MinInterval;
+			MaxInterval = (Interval > MaxInterval) ? Interval : MaxInterval;
+		}
+		MaxObjects = (p_Pass->NumObjects > MaxObjects) ? p_Pass->NumObjects : MaxObjects;
+
+		if (p_Timing != nullptr)
+		{
+			fprintf(p_Timing, "%llu,%.3f,%.1f,%.1f,%u\n", (unsigned long long)p_Pass->Sequence, TimeMs, Duration, Interval, p_Pass->NumObjects);
+		}
+
+		const unsigned char* p_Object = Record.data() + sizeof(ObjectCapturePassHeader);
+		for (uint32_t n = 0; n < p_Pass->NumObjects; n++, p_Object += ObjectSize)
+		{
+			const ObjectCaptureObjectHeader* p_Header = (const ObjectCaptureObjectHeader*)p_Object;
+			const float* p_Samples = (const float*)(p_Header + 1);
+
+			float ObjectPeak = 0.0f;
+			double SumOfSquares = 0.0;
+			for (uint32_t i = 0; i < p_Pass->FrameCount; i++)
+			{
+				float Level = fabsf(p_Samples[i]);
+				ObjectPeak = (Level > ObjectPeak) ? Level : ObjectPeak;
+				SumOfSquares += (double)p_Samples[i] * p_Samples[i];
+			}
+			Peak = (ObjectPeak > Peak) ? ObjectPeak : Peak;
+			ObjectFrames++;
+
+			if (p_Csv != nullptr)
+			{
+				fprintf(p_Csv, "%llu,%.3f,%u,0x%x,%.4f,%.4f,%.4f,%.4f,%.6f,%.6f\n", (unsigned long long)p_Pass->Sequence, TimeMs,
+					p_Header->Index, p_Header->Type, p_Header->X, p_Header->Y, p_Header->Z, p_Header->Volume,
+					ObjectPeak, p_Pass->FrameCount ? sqrt(SumOfSquares / p_Pass->FrameCount) : 0.0);
+			}
+
+			if (p_WavDirectory != nullptr)
+			{
+				uint64_t Key = ((uint64_t)p_Header->Type << 32) | p_Header->Index;
+				std::map<uint64_t, WavStream>::iterator Found = Streams.find(Key);
+				if (Found == Streams.end())
+				{
+					std::string WavPath = std::string(p_WavDirectory) + "/";
+					char Name[64];
+					if (p_Header->Type == OBJECT_CAPTURE_DYNAMIC)
+						snprintf(Name, sizeof(Name), "dynamic_%u.wav", p_Header->Index);
+					else if (StaticObjectName(p_Header->Type) != nullptr)
+						snprintf(Name, sizeof(Name), "static_%s.wav", StaticObjectName(p_Header->Type));
+					else
+						snprintf(Name, sizeof(Name), "static_%u_0x%x.wav", p_Header->Index, p_Header->Type);
+					WavPath += Name;
+
+					WavStream Stream;
+					Stream.p_File = fopen(WavPath.c_str(), "wb");
+					Stream.Frames = 0;
+					if (Stream.p_File == nullptr)
+					{
+						printf("Can't create %s\n", WavPath.c_str());
+						return 1;
+					}
+					WriteWavHeader(Stream.p_File, FileHeader.SampleRate, 0);
+					Found = Streams.insert(std::make_pair(Key, Stream)).first;
+				}
+
+				WavStream& Stream = Found->second;
+				if (Stream.Frames < TimelineFrames)
+				{
+					WriteSilence(Stream.p_File, TimelineFrames - Stream.Frames);
+					Stream.Frames = TimelineFrames;
+				}
+				fwrite(p_Samples, sizeof(float), p_Pass->FrameCount, Stream.p_File);
+				Stream.Frames += p_Pass->FrameCount;
+			}
+		}
+
+		TimelineFrames += p_Pass->FrameCount;
+		Passes++;
+	}
+
+	// Every stream runs to the end of the timeline
+	for (std::map<uint64_t, WavStream>::iterator iter = Streams.begin(); iter != Streams.end(); iter++)
+	{
+		WavStream& Stream = iter->second;
+		WriteSilence(Stream.p_File, TimelineFrames - Stream.Frames);
+		fseek(Stream.p_File, 0, SEEK_SET);
+		WriteWavHeader(Stream.p_File, FileHeader.SampleRate, TimelineFrames);
+		fclose(Stream.p_File);
+	}
+
+	if (p_Csv != nullptr)
+	{
+		fclose(p_Csv);
+	}
+	if (p_Timing != nullptr)
+	{
+		fclose(p_Timing);
+	}
+	fclose(p_File);
+
+	printf("%s: %llu passes (%.2f s at %u Hz), %llu dropped while capturing\n", p_Path, (unsigned long long)Passes,
+		FileHeader.SampleRate ? (double)TimelineFrames / FileHeader.SampleRate : 0.0, FileHeader.SampleRate, (unsigned long long)DroppedPasses);
+	printf("Objects: %llu object frames, at most %u in one pass, peak %.6f\n", (unsigned long long)ObjectFrames, MaxObjects, Peak);
+	printf("Pump: %.1f us avg, %.1f us max per pass; %.1f to %.1f us between passes\n",
+		Passes ? TotalDuration / Passes : 0.0, MaxDuration, MinInterval, MaxInterval);
+	if (p_WavDirectory != nullptr)
+	{
+		printf("Wrote %u WAV files to %s\n", (unsigned)Streams.size(), p_WavDirectory);
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include "WorkerPool.h"
+#include "AudioPluginUtil.h"
+#include "RealtimeCheck.h"
+
+namespace MSHRTFSpatializer
+{
+	WorkerPool::WorkerPool(UINT32 ThreadCount) :
+		m_ThreadCount(ThreadCount),
+		m_Stop(FALSE),
+		m_Function(nullptr),
+		m_Context(nullptr),
+		m_Batch(0),
+		m_Pending(0)
+	{
+		memset(m_Workers, 0, sizeof(m_Workers));
+		memset(m_Shares, 0, sizeof(m_Shares));
+	}
+
+	WorkerPool* WorkerPool::Create(UINT32 ThreadCount)
+	{
+		if (ThreadCount < 1)
+		{
+			ThreadCount = 1;
+		}
+		else if (ThreadCount > WORKER_POOL_MAX_THREADS)
+		{
+			ThreadCount = WORKER_POOL_MAX_THREADS;
+		}
+
+		WorkerPool* p_Pool = new WorkerPool(ThreadCount);
+		int Priority = GetThreadPriority(GetCurrentThread());
+
+		// Worker 0 is whoever calls Run
+		for (UINT32 Index = 1; Index < ThreadCount; Index++)
+		{
+			Worker& PoolWorker = p_Pool->m_Workers[Index];
+			PoolWorker.p_Pool = p_Pool;
+			PoolWorker.m_Index = Index;
+			PoolWorker.m_Wake = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+			if (PoolWorker.m_Wake != nullptr)
+			{
+				PoolWorker.m_Thread = CreateThread(nullptr, 0, WorkerMain, &PoolWorker, 0, nullptr);
+			}
+
+			if (PoolWorker.m_Thread == nullptr)
+			{
+				if (PoolWorker.m_Wake != nullptr)
+				{
+					CloseHandle(PoolWorker.m_Wake);
+				}
+
+				// Only stop the workers that were started
+				p_Pool->m_ThreadCount = Index;
+				delete p_Pool;
+				return nullptr;
+			}
+
+			SetThreadPriority(PoolWorker.m_Thread, Priority);
+		}
+
+		return p_Pool;
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		InterlockedExchange(&m_Stop, TRUE);
+
+		for (UINT32 Index = 1; Index < m_ThreadCount; Index++)
+		{
+			SetEvent(m_Workers[Index].m_Wake);
+			WaitForSingleObject(m_Workers[Index].m_Thread, INFINITE);
+			CloseHandle(m_Workers[Index].m_Thread);
+			CloseHandle(m_Workers[Index].m_Wake);
+		}
+	}
+
+	LONG64 WorkerPool::PackRange(LONG Batch, UINT32 Begin, UINT32 End)
+	{
+		return (LONG64)(((UINT64)(ULONG)Batch << 32) | ((UINT64)End << 16) | (UINT64)Begin);
+	}
+
+	BOOL WorkerPool::TakeTask(Share& TaskShare, LONG Batch, BOOL FromBack, UINT32* p_Task)
+	{
+		for (;;)
+		{
+			LONG64 Range = InterlockedCompareExchange64(&TaskShare.m_Range, 0, 0);
+			UINT32 Begin = (UINT32)Range & 0xffff;
+			UINT32 End = ((UINT32)Range >> 16) & 0xffff;
+			if ((LONG)(Range >> 32) != Batch || Begin >= End)
+			{
+				return FALSE;
+			}
+
+			LONG64 Remaining = FromBack ? PackRange(Batch, Begin, End - 1) : PackRange(Batch, Begin + 1, End);
+			if (InterlockedCompareExchange64(&TaskShare.m_Range, Remaining, Range) == Range)
+			{
+				*p_Task = FromBack ? End - 1 : Begin;
+				return TRUE;
+			}
+		}
+	}
+
+	void WorkerPool::RunShares(UINT32 First, LONG Batch)
+	{
+		UINT32 Task;
+
+		// A task can only be taken while its batch is running, so m_Function and m_Context are the batch's
+		while (TakeTask(m_Shares[First], Batch, FALSE, &Task))
+		{
+			m_Function(m_Context, Task);
+			InterlockedDecrement(&m_Pending);
+		}
+
+		for (UINT32 Offset = 1; Offset < m_ThreadCount; Offset++)
+		{
+			Share& Victim = m_Shares[(First + Offset) % m_ThreadCount];
+			while (TakeTask(Victim, Batch, TRUE, &Task))
+			{
+				m_Function(m_Context, Task);
+				InterlockedDecrement(&m_Pending);
+			}
+		}
+	}
+
+	void WorkerPool::Run(TaskFunction p_Function, void* p_Context, UINT32 TaskCount)
+	{
+		if (TaskCount == 0)
+		{
+			return;
+		}
+
+		m_Function = p_Function;
+		m_Context = p_Context;
+		InterlockedExchange(&m_Pending, (LONG)TaskCount);
+
+		LONG Batch = m_Batch + 1;
+		for (UINT32 Index = 0; Index < m_ThreadCount; Index++)
+		{
+			InterlockedExchange64(&m_Shares[Index].m_Range, PackRange(Batch, TaskCount * Index / m_ThreadCount, TaskCount * (Index + 1) / m_ThreadCount));
+		}
+		InterlockedExchange(&m_Batch, Batch);
+
+		for (UINT32 Index = 1; Index < m_ThreadCount; Index++)
+		{
+			SetEvent(m_Workers[Index].m_Wake);
+		}
+
+		RunShares(0, Batch);
+
+		// Every task has been taken; the last few are finishing on the other threads
+		while (InterlockedCompareExchange(&m_Pending, 0, 0) != 0)
+		{
+			YieldProcessor();
+		}
+	}
+
+	DWORD WINAPI WorkerPool::WorkerMain(LPVOID p_Param)
+	{
+		Worker* p_Worker = (Worker*)p_Param;
+		WorkerPool* p_Pool = p_Worker->p_Pool;
+
+		// Like the pump the tasks are run for
+		DenormalGuard Denormals;
+
+		for (;;)
+		{
+			WaitForSingleObject(p_Worker->m_Wake, INFINITE);
+			if (InterlockedCompareExchange(&p_Pool->m_Stop, 0, 0))
+			{
+				break;
+			}
+
+			REALTIME_SCOPE();
+			p_Pool->RunShares(p_Worker->m_Index, InterlockedCompareExchange(&p_Pool->m_Batch, 0, 0));
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <windows.h>
+
+#define WORKER_POOL_MAX_THREADS 16
+
+namespace MSHRTFSpatializer
+{
+	// Runs batches of independent tasks across a few threads, the one calling Run included. Each thread starts at the
+	// front of its own share of the batch, then steals from the back of the others' shares, so a thread that is slow to
+	// wake up or draws a slow task doesn't hold the batch up. Run doesn't allocate, lock or wait: it wakes the workers
+	// and spins until the last task is done, so the pump can use it inside a Begin/EndUpdate window.
+	class WorkerPool
+	{
+	public:
+		typedef void (*TaskFunction)(void* p_Context, UINT32 Task);
+
+		// ThreadCount includes the thread that calls Run, so a pool of 1 starts no threads. The workers run at the
+		// priority of the thread that creates the pool, which should be the one that calls Run.
+		// Returns nullptr if the threads can't be started.
+		static WorkerPool* Create(UINT32 ThreadCount);
+		~WorkerPool();
+
+		UINT32 GetThreadCount() const { return m_ThreadCount; }
+
+		// Calls p_Function for every task below TaskCount (at most 65535) and returns once they have all finished.
+		// Only one thread may call Run at a time.
+		void Run(TaskFunction p_Function, void* p_Context, UINT32 TaskCount);
+
+	private:
+		// The tasks of a share that haven't been taken yet. The batch number in the top half means a thread that
+		// wakes up late for a batch that is already done can't take a task from the next one.
+		struct Share
+		{
+			volatile LONG64 m_Range;
+
+			// Keeps every share on its own cache line
+			BYTE m_Padding[64 - sizeof(LONG64)];
+		};
+
+		struct Worker
+		{
+			WorkerPool* p_Pool;
+			UINT32 m_Index;
+			HANDLE m_Thread;
+			HANDLE m_Wake;
+		};
+
+		WorkerPool(UINT32 ThreadCount);
+
+		static DWORD WINAPI WorkerMain(LPVOID p_Param);
+		static LONG64 PackRange(LONG Batch, UINT32 Begin, UINT32 End);
+
+		// Takes tasks until none of the batch are left untaken, starting with share First
+		void RunShares(UINT32 First, LONG Batch);
+		BOOL TakeTask(Share& TaskShare, LONG Batch, BOOL FromBack, UINT32* p_Task);
+
+		UINT32 m_ThreadCount;
+		Worker m_Workers[WORKER_POOL_MAX_THREADS];
+		volatile LONG m_Stop;
+
+		TaskFunction m_Function;
+		void* m_Context;
+		volatile LONG m_Batch;
+		volatile LONG m_Pending;
+		Share m_Shares[WORKER_POOL_MAX_THREADS];
+	};
+}